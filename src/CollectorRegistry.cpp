@@ -0,0 +1,257 @@
+#include "CollectorRegistry.h"
+#include <fstream>
+#include <cstdlib>
+#include <cctype>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+const char* const CollectorRegistry::DefaultConfigPath = "collectors.conf";
+
+/**
+* The names of the costs as they are written in a configuration file
+*/
+static const char* const CostNames[] = { "low", "medium", "high" };
+
+/**
+* Removes the whitespace around a setting
+*/
+static std::string trim(const std::string& text)
+{
+    size_t first = 0, last = text.size();
+    while (first < last && isspace((unsigned char)text[first])) first++;
+    while (last > first && isspace((unsigned char)text[last - 1])) last--;
+
+    return text.substr(first, last - first);
+}
+
+CollectorRegistry::CollectorRegistry()
+{
+    //the sensors of the hardware monitoring library, every kind of hardware is opened on its own
+    add({ "sensors.cpu", CollectorCost::Low, 0, {}, 1, "CPU load, clock and temperature sensors" });
+    add({ "sensors.gpu", CollectorCost::Medium, 0, {}, 1, "GPU sensors" });
+    add({ "sensors.ram", CollectorCost::Low, 0, {}, 1, "Memory load sensors" });
+    add({ "sensors.mainboard", CollectorCost::Medium, 0, {}, 1, "Mainboard voltage, fan and temperature sensors" });
+    add({ "sensors.fan-controller", CollectorCost::Medium, 0, {}, 1, "Fan controller sensors" });
+    add({ "sensors.hdd", CollectorCost::High, 0, { "storage" }, 1, "Disk temperature and load sensors, shown under the physical disks" });
+
+    add({ "memory", CollectorCost::Low, 0, {}, 1, "Memory usage, paging and reclaim rates and the usage of every NUMA node" });
+
+    //the storage inventory and the samplers of the devices in it
+    add({ "storage", CollectorCost::Medium, 0, {}, 1, "Physical disks and drives" });
+    add({ "storage-watcher", CollectorCost::Low, 0, { "storage" }, 1, "Picks up storage devices that are plugged in or removed" });
+    add({ "disk-activity", CollectorCost::Low, 0, { "storage" }, 1, "Throughput, IOPS, latency, queue depth and utilization of the physical disks" });
+    add({ "volume-space", CollectorCost::Low, 10000, { "storage" }, 1, "Capacity of the volumes and when they will be full" });
+    add({ "disk-health", CollectorCost::High, 10 * 60000, { "storage" }, 0, "SMART and NVMe health of the physical disks" });
+
+    add({ "network", CollectorCost::Medium, 0, {}, 1, "Network adapters" });
+    add({ "sockets", CollectorCost::High, 2000, {}, 1, "TCP and UDP sockets by state and the processes that own the most of them" });
+    add({ "tcp-health", CollectorCost::High, 10000, {}, 0, "Round trip time, retransmits and congestion window of the TCP connections per remote address and process" });
+    add({ "network-activity", CollectorCost::Low, 0, { "network" }, 1, "Throughput, packet, error and drop rates of the network adapters" });
+    add({ "processes", CollectorCost::High, 0, {}, 1, "Processes, only collected while a recording asks for them" });
+}
+
+double CollectorRegistry::getTimeMilliseconds()
+{
+#ifdef _WIN32
+    return (double)GetTickCount64();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+void CollectorRegistry::add(const CollectorInfo& collector)
+{
+    auto found = this->collector_index.find(collector.Name);
+    if (found != this->collector_index.end())
+    {
+        this->collectors[found->second] = collector;
+        this->last_run_times[found->second] = -1;
+        return;
+    }
+
+    this->collector_index[collector.Name] = this->collectors.size();
+    this->collectors.push_back(collector);
+    this->last_run_times.push_back(-1);
+}
+
+bool CollectorRegistry::loadConfig(const std::string& path, std::string& error, const bool must_exist)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        if (!must_exist) return 1;
+
+        error = "Could not open " + path;
+        return 0;
+    }
+
+    std::string line;
+    unsigned int line_number = 0;
+
+    while (std::getline(file, line))
+    {
+        line_number++;
+
+        //comments run to the end of the line
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t separator = line.find('=');
+        if (separator == std::string::npos)
+        {
+            error = path + ":" + std::to_string(line_number) + ": expected <setting> = <value>";
+            return 0;
+        }
+
+        std::string setting_error;
+        if (!set(trim(line.substr(0, separator)), trim(line.substr(separator + 1)), setting_error))
+        {
+            error = path + ":" + std::to_string(line_number) + ": " + setting_error;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+bool CollectorRegistry::set(const std::string& setting, const std::string& value, std::string& error)
+{
+    if (setting == "max-cost")
+    {
+        for (unsigned int cost = 0; cost < sizeof(CostNames) / sizeof(CostNames[0]); cost++)
+        {
+            if (value != CostNames[cost]) continue;
+
+            this->max_cost = (CollectorCost)cost;
+            return 1;
+        }
+
+        error = "unknown cost " + value;
+        return 0;
+    }
+
+    //the cadence of a collector is set with a suffix on its name
+    std::string name = setting;
+    bool cadence = 0;
+    if (name.size() > 8 && name.compare(name.size() - 8, 8, ".cadence") == 0)
+    {
+        name.erase(name.size() - 8);
+        cadence = 1;
+    }
+
+    auto found = this->collector_index.find(name);
+    if (found == this->collector_index.end())
+    {
+        error = "unknown collector " + name;
+        return 0;
+    }
+
+    CollectorInfo& collector = this->collectors[found->second];
+
+    if (cadence)
+    {
+        char* end = nullptr;
+        unsigned long milliseconds = strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0')
+        {
+            error = "the cadence of " + name + " has to be a number of milliseconds";
+            return 0;
+        }
+
+        collector.Cadence = (unsigned int)milliseconds;
+        return 1;
+    }
+
+    if (value == "on") collector.Enabled = 1;
+    else if (value == "off") collector.Enabled = 0;
+    else
+    {
+        error = name + " has to be on or off";
+        return 0;
+    }
+
+    return 1;
+}
+
+bool CollectorRegistry::isEnabled(const size_t index, const unsigned int depth) const
+{
+    const CollectorInfo& collector = this->collectors[index];
+    if (!collector.Enabled || collector.Cost > this->max_cost || depth > this->collectors.size()) return 0;
+
+    for (const std::string& dependency : collector.Dependencies)
+    {
+        auto found = this->collector_index.find(dependency);
+        if (found == this->collector_index.end() || !isEnabled(found->second, depth + 1)) return 0;
+    }
+
+    return 1;
+}
+
+bool CollectorRegistry::isEnabled(const std::string& name) const
+{
+    auto found = this->collector_index.find(name);
+    if (found == this->collector_index.end()) return 0;
+
+    return isEnabled(found->second, 0);
+}
+
+bool CollectorRegistry::isDue(const std::string& name)
+{
+    auto found = this->collector_index.find(name);
+    if (found == this->collector_index.end() || !isEnabled(found->second, 0)) return 0;
+
+    double& last_run_time = this->last_run_times[found->second];
+    double time = getTimeMilliseconds();
+
+    if (last_run_time >= 0 && time - last_run_time < this->collectors[found->second].Cadence) return 0;
+
+    last_run_time = time;
+    return 1;
+}
+
+unsigned int CollectorRegistry::getCadence(const std::string& name) const
+{
+    auto found = this->collector_index.find(name);
+    if (found == this->collector_index.end()) return 0;
+
+    return this->collectors[found->second].Cadence;
+}
+
+std::shared_ptr<PlatformSessions> CollectorRegistry::getSessions() const
+{
+    return this->sessions;
+}
+
+void CollectorRegistry::print(std::ostream& stream) const
+{
+    for (size_t index = 0; index < this->collectors.size(); index++)
+    {
+        const CollectorInfo& collector = this->collectors[index];
+
+        stream << collector.Name << '\n';
+        stream << "    " << collector.Description << '\n';
+        stream << "    enabled: " << (isEnabled(index, 0) ? "on" : "off");
+
+        //say why a collector that is switched on does not run
+        if (collector.Enabled && !isEnabled(index, 0)) stream << (collector.Cost > this->max_cost ? " (over max-cost)" : " (a dependency is off)");
+
+        stream << ", cost: " << CostNames[(unsigned int)collector.Cost];
+        stream << ", cadence: " << (collector.Cadence == 0 ? std::string("every tick") : std::to_string(collector.Cadence) + " ms");
+
+        if (!collector.Dependencies.empty())
+        {
+            stream << ", needs:";
+            for (const std::string& dependency : collector.Dependencies) stream << ' ' << dependency;
+        }
+
+        stream << '\n';
+    }
+}
@@ -0,0 +1,149 @@
+#include "DeviceProbes.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/**
+* The time between checks while waiting for the probes
+*/
+static const unsigned int ProbePollMilliseconds = 5;
+
+/**
+* Gets the time from a monotonic clock
+* @return The time in milliseconds
+*/
+static unsigned long long getTimeMilliseconds()
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI probeThreadMain(LPVOID parameter)
+{
+    DeviceProbes::run(parameter);
+    return 0;
+}
+#else
+static void* probeThreadMain(void* parameter)
+{
+    DeviceProbes::run(parameter);
+    return nullptr;
+}
+#endif
+
+void DeviceProbes::run(void* parameter)
+{
+    std::shared_ptr<Probe>* probe = (std::shared_ptr<Probe>*)parameter;
+
+    (*probe)->Work();
+
+#ifdef _WIN32
+    InterlockedExchange(&(*probe)->Finished, 1);
+#else
+    __atomic_store_n(&(*probe)->Finished, 1, __ATOMIC_RELEASE);
+#endif
+
+    delete probe;
+}
+
+bool DeviceProbes::isFinished(Probe& probe)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(&probe.Finished, 0, 0) != 0;
+#else
+    return __atomic_load_n(&probe.Finished, __ATOMIC_ACQUIRE) != 0;
+#endif
+}
+
+unsigned long long DeviceProbes::start(const std::wstring& key, std::function<void()> work)
+{
+    std::shared_ptr<Probe> probe = std::make_shared<Probe>();
+    probe->Key = key;
+    probe->ID = this->next_id++;
+    probe->Work = std::move(work);
+    probe->Finished = 0;
+
+    this->probes.push_back(probe);
+
+    //the thread keeps its own reference so the probe outlives this object if it hangs
+    std::shared_ptr<Probe>* parameter = new std::shared_ptr<Probe>(probe);
+
+#ifdef _WIN32
+    HANDLE thread = CreateThread(NULL, 0, probeThreadMain, parameter, 0, NULL);
+    if (thread != NULL)
+    {
+        //nothing ever waits on the thread itself
+        CloseHandle(thread);
+        return probe->ID;
+    }
+#else
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, probeThreadMain, parameter) == 0)
+    {
+        pthread_detach(thread);
+        return probe->ID;
+    }
+#endif
+
+    //without a thread the probe can only be run without a deadline
+    run(parameter);
+    return probe->ID;
+}
+
+bool DeviceProbes::wait(const unsigned int timeout_milliseconds)
+{
+    unsigned long long start_time = getTimeMilliseconds();
+
+    while (1)
+    {
+        bool all_finished = 1;
+        for (std::shared_ptr<Probe>& probe : this->probes)
+        {
+            all_finished &= isFinished(*probe);
+        }
+
+        if (all_finished) return 1;
+        if (getTimeMilliseconds() - start_time >= timeout_milliseconds) return 0;
+
+#ifdef _WIN32
+        Sleep(ProbePollMilliseconds);
+#else
+        timespec delay = { 0, ProbePollMilliseconds * 1000000L };
+        nanosleep(&delay, nullptr);
+#endif
+    }
+}
+
+std::vector<DeviceProbes::FinishedProbe> DeviceProbes::takeFinished()
+{
+    std::vector<FinishedProbe> finished;
+
+    for (size_t index = 0; index < this->probes.size();)
+    {
+        if (isFinished(*this->probes[index]))
+        {
+            finished.push_back({ this->probes[index]->Key, this->probes[index]->ID });
+            this->probes.erase(this->probes.begin() + index);
+        }
+        else
+        {
+            index++;
+        }
+    }
+
+    return finished;
+}
+
+size_t DeviceProbes::getPendingCount()
+{
+    return this->probes.size();
+}
@@ -0,0 +1,259 @@
+#include "DiskActivity.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+/**
+* /proc/diskstats counts sectors of 512 bytes whatever the sector size of the disk is
+*/
+static const unsigned long long DiskstatsSectorSize = 512;
+
+void DiskActivity::init(StorageInformation& storageInformation)
+{
+    for (auto& physicalDisk : storageInformation.PhysicalDisks)
+    {
+        addDisk(physicalDisk.first, physicalDisk.second.DeviceID);
+    }
+
+#ifndef _WIN32
+    this->diskstats_file = open(this->diskstats_path.c_str(), O_RDONLY);
+#endif
+}
+
+bool DiskActivity::addDisk(const std::wstring& key, const std::wstring& deviceID)
+{
+    WatchedDisk disk = {};
+    disk.Key = key;
+    disk.DeviceID = std::string(deviceID.begin(), deviceID.end());
+    disk.HasPrevious = 0;
+    disk.Handle = nullptr;
+
+#ifdef _WIN32
+    //the device ID of a physical disk is its number, no access rights are needed to query the counters
+    std::string path = "\\\\.\\PhysicalDrive" + disk.DeviceID;
+    HANDLE handle = CreateFileA(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return 0;
+
+    disk.Handle = handle;
+#endif
+
+    this->watched_disks.push_back(disk);
+    this->Disks[disk.Key] = DiskMetrics();
+
+    return 1;
+}
+
+bool DiskActivity::refresh(StorageInformation& storageInformation, const StorageInformation::StorageChanges& changes)
+{
+    bool changed = 0;
+
+    //a disk that was removed and plugged in again starts from a new baseline, its counters were reset
+    for (size_t index = 0; index < this->watched_disks.size();)
+    {
+        WatchedDisk& disk = this->watched_disks[index];
+        bool removed = std::find(changes.RemovedDisks.begin(), changes.RemovedDisks.end(), disk.Key) != changes.RemovedDisks.end();
+
+        if (!removed && storageInformation.PhysicalDisks.find(disk.Key) != storageInformation.PhysicalDisks.end())
+        {
+            index++;
+            continue;
+        }
+
+#ifdef _WIN32
+        if (disk.Handle != nullptr) CloseHandle((HANDLE)disk.Handle);
+#endif
+
+        this->Disks.erase(disk.Key);
+        this->watched_disks.erase(this->watched_disks.begin() + index);
+        changed = 1;
+    }
+
+    for (auto& physicalDisk : storageInformation.PhysicalDisks)
+    {
+        if (this->Disks.find(physicalDisk.first) != this->Disks.end()) continue;
+
+        changed |= addDisk(physicalDisk.first, physicalDisk.second.DeviceID);
+    }
+
+    return changed;
+}
+
+DiskActivity::~DiskActivity()
+{
+#ifdef _WIN32
+    for (WatchedDisk& disk : this->watched_disks)
+    {
+        if (disk.Handle != nullptr) CloseHandle((HANDLE)disk.Handle);
+    }
+#else
+    if (this->diskstats_file >= 0) close(this->diskstats_file);
+#endif
+}
+
+#ifndef _WIN32
+void DiskActivity::readDiskstats(std::vector<DiskCounters>& counters, std::vector<bool>& found)
+{
+    if (this->diskstats_file < 0) return;
+
+    //a single read from the start gets a fresh copy of every counter
+    if (this->diskstats_buffer.size() < 64 * 1024) this->diskstats_buffer.resize(64 * 1024);
+
+    ssize_t length = 0;
+    while (1)
+    {
+        length = pread(this->diskstats_file, &this->diskstats_buffer[0], this->diskstats_buffer.size(), 0);
+        if (length < 0) return;
+
+        //hosts with many devices need a bigger buffer
+        if ((size_t)length < this->diskstats_buffer.size()) break;
+        this->diskstats_buffer.resize(this->diskstats_buffer.size() * 2);
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+
+    const char* position = this->diskstats_buffer.data();
+    const char* end = position + length;
+
+    while (position < end)
+    {
+        const char* line_end = (const char*)memchr(position, '\n', end - position);
+        if (line_end == nullptr) line_end = end;
+
+        //major, minor and the name come before the counters
+        char* field = nullptr;
+        strtoul(position, &field, 10);
+        strtoul(field, &field, 10);
+
+        while (field < line_end && *field == ' ') field++;
+        const char* name = field;
+        while (field < line_end && *field != ' ') field++;
+        size_t name_length = field - name;
+
+        for (size_t index = 0; index < this->watched_disks.size(); index++)
+        {
+            const std::string& device = this->watched_disks[index].DeviceID;
+            if (found[index] || device.size() != name_length || memcmp(device.data(), name, name_length) != 0) continue;
+
+            //reads, reads merged, sectors read, read time, writes, writes merged, sectors written, write time, in flight, busy time, weighted time
+            unsigned long long values[11] = {};
+            for (unsigned long long& value : values)
+            {
+                value = strtoull(field, &field, 10);
+            }
+
+            DiskCounters& disk_counters = counters[index];
+            disk_counters.Reads = values[0];
+            disk_counters.ReadBytes = values[2] * DiskstatsSectorSize;
+            disk_counters.Writes = values[4];
+            disk_counters.WriteBytes = values[6] * DiskstatsSectorSize;
+            disk_counters.ServiceMilliseconds = (double)(values[3] + values[7]);
+            disk_counters.QueueDepth = (double)values[8];
+            disk_counters.BusyMilliseconds = (double)values[9];
+            disk_counters.QueueMilliseconds = (double)values[10];
+            disk_counters.TimeMilliseconds = time;
+
+            found[index] = 1;
+            break;
+        }
+
+        position = line_end + 1;
+    }
+}
+#endif
+
+bool DiskActivity::computeMetrics(const DiskCounters& previous, const DiskCounters& current, DiskMetrics& metrics)
+{
+    double elapsed = current.TimeMilliseconds - previous.TimeMilliseconds;
+
+    //a counter that went backwards means the disk was reset, or a 32 bit counter wrapped
+    if (elapsed <= 0 || current.Reads < previous.Reads || current.Writes < previous.Writes || current.ReadBytes < previous.ReadBytes || current.WriteBytes < previous.WriteBytes)
+    {
+        metrics = DiskMetrics();
+        return 0;
+    }
+
+    double seconds = elapsed / 1000;
+    unsigned long long operations = (current.Reads - previous.Reads) + (current.Writes - previous.Writes);
+
+    metrics.ReadBytesPerSecond = (current.ReadBytes - previous.ReadBytes) / seconds;
+    metrics.WriteBytesPerSecond = (current.WriteBytes - previous.WriteBytes) / seconds;
+    metrics.ReadsPerSecond = (current.Reads - previous.Reads) / seconds;
+    metrics.WritesPerSecond = (current.Writes - previous.Writes) / seconds;
+
+    //the time spent on the operations that finished in the interval
+    metrics.AverageLatency = operations != 0 ? (current.ServiceMilliseconds - previous.ServiceMilliseconds) / operations : 0;
+
+    //the average queue if the time spent queued is counted, the current queue otherwise
+    if (current.QueueMilliseconds != 0)
+    {
+        metrics.QueueDepth = (current.QueueMilliseconds - previous.QueueMilliseconds) / elapsed;
+    }
+    else
+    {
+        metrics.QueueDepth = current.QueueDepth;
+    }
+
+    metrics.Utilization = (current.BusyMilliseconds - previous.BusyMilliseconds) / elapsed * 100;
+    if (metrics.Utilization < 0) metrics.Utilization = 0;
+    if (metrics.Utilization > 100) metrics.Utilization = 100;
+
+    return 1;
+}
+
+void DiskActivity::update()
+{
+    std::vector<DiskCounters> counters(this->watched_disks.size(), DiskCounters());
+    std::vector<bool> found(this->watched_disks.size(), 0);
+
+#ifdef _WIN32
+    for (size_t index = 0; index < this->watched_disks.size(); index++)
+    {
+        DISK_PERFORMANCE performance;
+        DWORD bytesReturned = 0;
+
+        if (!DeviceIoControl((HANDLE)this->watched_disks[index].Handle, IOCTL_DISK_PERFORMANCE, NULL, 0, &performance, sizeof(performance), &bytesReturned, NULL)) continue;
+
+        //the times are counted in 100 nanosecond intervals, the disk was busy whenever it was not idle
+        DiskCounters& disk_counters = counters[index];
+        disk_counters.Reads = performance.ReadCount;
+        disk_counters.ReadBytes = (unsigned long long)performance.BytesRead.QuadPart;
+        disk_counters.Writes = performance.WriteCount;
+        disk_counters.WriteBytes = (unsigned long long)performance.BytesWritten.QuadPart;
+        disk_counters.ServiceMilliseconds = (performance.ReadTime.QuadPart + performance.WriteTime.QuadPart) / 10000.0;
+        disk_counters.BusyMilliseconds = (performance.QueryTime.QuadPart - performance.IdleTime.QuadPart) / 10000.0;
+        disk_counters.QueueMilliseconds = 0;
+        disk_counters.QueueDepth = performance.QueueDepth;
+        disk_counters.TimeMilliseconds = performance.QueryTime.QuadPart / 10000.0;
+
+        found[index] = 1;
+    }
+#else
+    readDiskstats(counters, found);
+#endif
+
+    for (size_t index = 0; index < this->watched_disks.size(); index++)
+    {
+        WatchedDisk& disk = this->watched_disks[index];
+
+        //a disk that could not be read keeps its last metrics and baseline
+        if (!found[index]) continue;
+
+        if (disk.HasPrevious)
+        {
+            computeMetrics(disk.Previous, counters[index], this->Disks[disk.Key]);
+        }
+
+        disk.Previous = counters[index];
+        disk.HasPrevious = 1;
+    }
+}
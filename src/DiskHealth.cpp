@@ -0,0 +1,390 @@
+#include "DiskHealth.h"
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <scsi/sg.h>
+#include <linux/nvme_ioctl.h>
+#endif
+
+/**
+* The SMART attributes the health metrics are taken from
+*/
+enum SmartAttribute : unsigned char
+{
+    SmartPowerOnHours = 9,
+    SmartAvailableReservedSpace = 170,
+    SmartUnexpectedPowerLoss = 174,
+    SmartWearLevelingCount = 177,
+    SmartReportedUncorrectable = 187,
+    SmartTemperatureAirflow = 190,
+    SmartPowerOffRetract = 192,
+    SmartTemperature = 194,
+    SmartOfflineUncorrectable = 198,
+    SmartPercentLifetimeRemaining = 202,
+    SmartMediaWearoutIndicator = 233,
+};
+
+/**
+* The attribute table of the SMART data starts after the revision number and holds up to 30 entries of 12 bytes
+*/
+static const size_t SmartAttributeTableOffset = 2;
+static const size_t SmartAttributeSize = 12;
+static const size_t SmartAttributeCount = 30;
+
+/**
+* Reads a little endian counter of the given size, NVMe counters are 16 bytes wide and only lose precision past 2^53
+*/
+static double readLittleEndian(const unsigned char* data, const size_t size)
+{
+    double value = 0;
+    for (size_t index = size; index > 0; index--)
+    {
+        value = value * 256 + data[index - 1];
+    }
+
+    return value;
+}
+
+DiskHealth::DiskHealth(StorageInformation& storageInformation, const double sample_interval) : sample_interval(sample_interval)
+{
+    for (auto& physicalDisk : storageInformation.PhysicalDisks)
+    {
+        addDisk(physicalDisk.first, physicalDisk.second.DeviceID, physicalDisk.second.BusType == L"NVMe");
+    }
+}
+
+void DiskHealth::addDisk(const std::wstring& key, const std::wstring& deviceID, const bool nvme)
+{
+    WatchedDisk disk;
+    disk.Key = key;
+    disk.Nvme = nvme;
+    disk.ReadID = 0;
+    disk.Reading = 0;
+
+#ifdef _WIN32
+    //the device ID of a physical disk is its number
+    disk.DevicePath = "\\\\.\\PhysicalDrive" + std::string(deviceID.begin(), deviceID.end());
+#else
+    disk.DevicePath = "/dev/" + std::string(deviceID.begin(), deviceID.end());
+#endif
+
+    this->watched_disks[disk.Key] = disk;
+    this->Disks[disk.Key] = DiskHealthMetrics();
+}
+
+void DiskHealth::startRead(WatchedDisk& disk)
+{
+    std::shared_ptr<DiskHealthMetrics> result = std::make_shared<DiskHealthMetrics>();
+    std::string devicePath = disk.DevicePath;
+    bool nvme = disk.Nvme;
+
+    disk.Result = result;
+    disk.Reading = 1;
+
+    //a disk that could not be read reports every metric as NaN
+    disk.ReadID = this->reads.start(disk.Key, [result, devicePath, nvme]() {
+        if (!readDisk(devicePath, nvme, *result)) *result = DiskHealthMetrics();
+    });
+}
+
+bool DiskHealth::refresh(StorageInformation& storageInformation, const StorageInformation::StorageChanges& changes)
+{
+    bool changed = 0;
+
+    //the read of a disk that is gone can still finish, it is dropped once it does
+    //a disk that was removed and plugged in again starts over
+    for (auto disk = this->watched_disks.begin(); disk != this->watched_disks.end();)
+    {
+        bool removed = std::find(changes.RemovedDisks.begin(), changes.RemovedDisks.end(), disk->first) != changes.RemovedDisks.end();
+
+        if (!removed && storageInformation.PhysicalDisks.find(disk->first) != storageInformation.PhysicalDisks.end())
+        {
+            disk++;
+            continue;
+        }
+
+        this->Disks.erase(disk->first);
+        disk = this->watched_disks.erase(disk);
+        changed = 1;
+    }
+
+    //new disks are read right away instead of waiting for the next sample
+    for (auto& physicalDisk : storageInformation.PhysicalDisks)
+    {
+        if (this->watched_disks.find(physicalDisk.first) != this->watched_disks.end()) continue;
+
+        addDisk(physicalDisk.first, physicalDisk.second.DeviceID, physicalDisk.second.BusType == L"NVMe");
+        if (this->last_sample_time >= 0) startRead(this->watched_disks[physicalDisk.first]);
+        changed = 1;
+    }
+
+    return changed;
+}
+
+double DiskHealth::getTimeMilliseconds()
+{
+#ifdef _WIN32
+    return (double)GetTickCount64();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+bool DiskHealth::parseNvmeHealthLog(const unsigned char* page, const size_t size, DiskHealthMetrics& metrics)
+{
+    if (size < LogPageSize) return 0;
+
+    //the composite temperature is in kelvin, 0 means the drive does not report it
+    double kelvin = readLittleEndian(page + 1, 2);
+    metrics.Temperature = kelvin != 0 ? kelvin - 273 : std::numeric_limits<double>::quiet_NaN();
+
+    metrics.AvailableSpare = page[3];
+
+    //the percentage used goes past 100 once the drive outlived its rated endurance
+    metrics.PercentageUsed = page[5];
+
+    metrics.PowerOnHours = readLittleEndian(page + 128, 16);
+    metrics.UnsafeShutdowns = readLittleEndian(page + 144, 16);
+    metrics.MediaErrors = readLittleEndian(page + 160, 16);
+
+    return 1;
+}
+
+bool DiskHealth::parseAtaSmartData(const unsigned char* data, const size_t size, DiskHealthMetrics& metrics)
+{
+    if (size < SmartAttributeTableOffset + SmartAttributeSize * SmartAttributeCount) return 0;
+
+    double uncorrectable = std::numeric_limits<double>::quiet_NaN();
+    double offline_uncorrectable = std::numeric_limits<double>::quiet_NaN();
+    double power_loss = std::numeric_limits<double>::quiet_NaN();
+    double retracts = std::numeric_limits<double>::quiet_NaN();
+
+    for (size_t index = 0; index < SmartAttributeCount; index++)
+    {
+        //ID, 2 bytes of flags, the normalized value, the worst value, 6 bytes of raw value and a reserved byte
+        const unsigned char* attribute = data + SmartAttributeTableOffset + index * SmartAttributeSize;
+        unsigned char id = attribute[0];
+        double normalized = attribute[3];
+        const unsigned char* raw = attribute + 5;
+
+        //unused entries have an ID of 0
+        if (id == 0) continue;
+
+        switch (id)
+        {
+        case SmartTemperature:
+            metrics.Temperature = raw[0];
+            break;
+
+        case SmartTemperatureAirflow:
+            //only used if the drive has no other temperature
+            if (std::isnan(metrics.Temperature)) metrics.Temperature = raw[0];
+            break;
+
+        case SmartPowerOnHours:
+            //the upper bytes hold the minutes on some drives
+            metrics.PowerOnHours = readLittleEndian(raw, 4);
+            break;
+
+        case SmartAvailableReservedSpace:
+            metrics.AvailableSpare = normalized;
+            break;
+
+        case SmartWearLevelingCount:
+        case SmartMediaWearoutIndicator:
+        case SmartPercentLifetimeRemaining:
+            //the normalized value counts the life that is left down from 100
+            metrics.PercentageUsed = 100 - normalized;
+            break;
+
+        case SmartReportedUncorrectable:
+            uncorrectable = readLittleEndian(raw, 6);
+            break;
+
+        case SmartOfflineUncorrectable:
+            offline_uncorrectable = readLittleEndian(raw, 6);
+            break;
+
+        case SmartUnexpectedPowerLoss:
+            power_loss = readLittleEndian(raw, 6);
+            break;
+
+        case SmartPowerOffRetract:
+            retracts = readLittleEndian(raw, 6);
+            break;
+        }
+    }
+
+    //SSDs count unexpected power loss, hard drives count the emergency head retracts it causes
+    metrics.MediaErrors = !std::isnan(uncorrectable) ? uncorrectable : offline_uncorrectable;
+    metrics.UnsafeShutdowns = !std::isnan(power_loss) ? power_loss : retracts;
+
+    return 1;
+}
+
+bool DiskHealth::readDisk(const std::string& devicePath, const bool nvme, DiskHealthMetrics& metrics)
+{
+    std::vector<unsigned char> data(LogPageSize, 0);
+
+#ifdef _WIN32
+    //reading SMART data needs write access to the device, which needs administrator rights
+    HANDLE handle = CreateFileA(devicePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return 0;
+
+    DWORD bytesReturned = 0;
+    bool read = 0;
+
+    if (nvme)
+    {
+        //the storage driver asks the drive for the log page, the page follows the protocol data in the buffer
+        std::vector<unsigned char> buffer(FIELD_OFFSET(STORAGE_PROPERTY_QUERY, AdditionalParameters) + sizeof(STORAGE_PROTOCOL_SPECIFIC_DATA) + LogPageSize, 0);
+
+        STORAGE_PROPERTY_QUERY* query = (STORAGE_PROPERTY_QUERY*)buffer.data();
+        STORAGE_PROTOCOL_SPECIFIC_DATA* protocolData = (STORAGE_PROTOCOL_SPECIFIC_DATA*)query->AdditionalParameters;
+
+        query->PropertyId = StorageDeviceProtocolSpecificProperty;
+        query->QueryType = PropertyStandardQuery;
+        protocolData->ProtocolType = ProtocolTypeNvme;
+        protocolData->DataType = NVMeDataTypeLogPage;
+        protocolData->ProtocolDataRequestValue = 0x02;
+        protocolData->ProtocolDataRequestSubValue = 0;
+        protocolData->ProtocolDataOffset = sizeof(STORAGE_PROTOCOL_SPECIFIC_DATA);
+        protocolData->ProtocolDataLength = LogPageSize;
+
+        if (DeviceIoControl(handle, IOCTL_STORAGE_QUERY_PROPERTY, buffer.data(), (DWORD)buffer.size(), buffer.data(), (DWORD)buffer.size(), &bytesReturned, NULL))
+        {
+            STORAGE_PROTOCOL_DATA_DESCRIPTOR* descriptor = (STORAGE_PROTOCOL_DATA_DESCRIPTOR*)buffer.data();
+            STORAGE_PROTOCOL_SPECIFIC_DATA* returnedData = &descriptor->ProtocolSpecificData;
+
+            if (returnedData->ProtocolDataOffset >= sizeof(STORAGE_PROTOCOL_SPECIFIC_DATA) && returnedData->ProtocolDataLength >= LogPageSize)
+            {
+                memcpy(data.data(), (unsigned char*)returnedData + returnedData->ProtocolDataOffset, LogPageSize);
+                read = 1;
+            }
+        }
+    }
+    else
+    {
+        //SMART READ DATA through the legacy SMART interface of the disk driver
+        SENDCMDINPARAMS command = {};
+        command.cBufferSize = READ_ATTRIBUTE_BUFFER_SIZE;
+        command.irDriveRegs.bFeaturesReg = READ_ATTRIBUTES;
+        command.irDriveRegs.bSectorCountReg = 1;
+        command.irDriveRegs.bSectorNumberReg = 1;
+        command.irDriveRegs.bCylLowReg = SMART_CYL_LOW;
+        command.irDriveRegs.bCylHighReg = SMART_CYL_HI;
+        command.irDriveRegs.bCommandReg = SMART_CMD;
+
+        std::vector<unsigned char> buffer(sizeof(SENDCMDOUTPARAMS) - 1 + READ_ATTRIBUTE_BUFFER_SIZE, 0);
+
+        if (DeviceIoControl(handle, SMART_RCV_DRIVE_DATA, &command, sizeof(command) - 1, buffer.data(), (DWORD)buffer.size(), &bytesReturned, NULL))
+        {
+            memcpy(data.data(), ((SENDCMDOUTPARAMS*)buffer.data())->bBuffer, LogPageSize);
+            read = 1;
+        }
+    }
+
+    CloseHandle(handle);
+    if (!read) return 0;
+#else
+    int device = open(devicePath.c_str(), O_RDONLY | O_NONBLOCK);
+    if (device < 0) return 0;
+
+    int result = -1;
+
+    if (nvme)
+    {
+        //Get Log Page for the SMART / Health Information log of the whole controller, the length is counted in dwords from 0
+        nvme_admin_cmd command;
+        memset(&command, 0, sizeof(command));
+        command.opcode = 0x02;
+        command.nsid = 0xFFFFFFFF;
+        command.addr = (unsigned long long)(uintptr_t)data.data();
+        command.data_len = LogPageSize;
+        command.cdw10 = 0x02 | ((LogPageSize / 4 - 1) << 16);
+
+        result = ioctl(device, NVME_IOCTL_ADMIN_CMD, &command);
+    }
+    else
+    {
+        //SMART READ DATA wrapped in an ATA PASS-THROUGH (16) command, the way SATA disks are reached through the SCSI layer
+        unsigned char cdb[16] = {};
+        cdb[0] = 0x85;
+        cdb[1] = 4 << 1;            //PIO data in
+        cdb[2] = 0x0E;              //the transfer goes to the host and its length is in the sector count, in blocks
+        cdb[4] = 0xD0;              //SMART READ DATA
+        cdb[6] = 1;
+        cdb[10] = 0x4F;
+        cdb[12] = 0xC2;
+        cdb[14] = 0xB0;             //SMART
+
+        unsigned char sense[32] = {};
+
+        sg_io_hdr_t header;
+        memset(&header, 0, sizeof(header));
+        header.interface_id = 'S';
+        header.dxfer_direction = SG_DXFER_FROM_DEV;
+        header.cmd_len = sizeof(cdb);
+        header.cmdp = cdb;
+        header.dxfer_len = LogPageSize;
+        header.dxferp = data.data();
+        header.mx_sb_len = sizeof(sense);
+        header.sbp = sense;
+        header.timeout = 10000;
+
+        result = ioctl(device, SG_IO, &header);
+        if (result == 0 && (header.status != 0 || header.host_status != 0)) result = -1;
+    }
+
+    close(device);
+    if (result != 0) return 0;
+#endif
+
+    return nvme ? parseNvmeHealthLog(data.data(), data.size(), metrics) : parseAtaSmartData(data.data(), data.size(), metrics);
+}
+
+bool DiskHealth::update()
+{
+    bool changed = 0;
+
+    //take the results of the reads that finished since the last update
+    for (const DeviceProbes::FinishedProbe& finished : this->reads.takeFinished())
+    {
+        //a disk that was removed, or removed and plugged in again, only takes the result of its last read
+        auto disk = this->watched_disks.find(finished.Key);
+        if (disk == this->watched_disks.end() || disk->second.ReadID != finished.ID) continue;
+
+        disk->second.Reading = 0;
+
+        this->Disks[finished.Key] = *disk->second.Result;
+        changed = 1;
+    }
+
+    double time = getTimeMilliseconds();
+    if (this->last_sample_time >= 0 && time - this->last_sample_time < this->sample_interval) return changed;
+
+    this->last_sample_time = time;
+
+    for (auto& watched_disk : this->watched_disks)
+    {
+        WatchedDisk& disk = watched_disk.second;
+
+        //a disk that is still answering the last read is not asked again
+        if (disk.Reading) continue;
+
+        startRead(disk);
+    }
+
+    return changed;
+}
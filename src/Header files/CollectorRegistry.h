@@ -0,0 +1,142 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <ostream>
+#include "PlatformSessions.h"
+
+/**
+* How much a collector costs to run, a configuration can leave out everything above a cost
+*/
+enum class CollectorCost : unsigned char
+{
+	Low,		//reads counters the kernel keeps, well under a millisecond
+	Medium,		//queries an inventory or walks a table, a few milliseconds
+	High,		//asks the devices themselves or walks every process, can take long or wake devices up
+};
+
+/**
+* Describes a collector to the registry
+*/
+struct CollectorInfo
+{
+	std::string					Name;
+	CollectorCost				Cost;
+
+	/**
+	* The time between runs in milliseconds, 0 to run every tick
+	*/
+	unsigned int				Cadence;
+
+	/**
+	* The collectors this one needs, it is disabled whenever one of them is
+	*/
+	std::vector<std::string>	Dependencies;
+	bool						Enabled;
+	std::string					Description;
+};
+
+/**
+* Knows every collector, whether it is enabled and when it is due, and owns the platform sessions they share
+* Collectors are enabled or disabled from a configuration file with a line per setting:
+*     # comment
+*     <collector> = on | off
+*     <collector>.cadence = <milliseconds>
+*     max-cost = low | medium | high
+* The application only creates the collectors that are enabled, a disabled one costs nothing
+*/
+class CollectorRegistry
+{
+	std::vector<CollectorInfo> collectors;
+
+	/**
+	* The index of every collector in collectors by its name
+	*/
+	std::map<std::string, size_t> collector_index;
+
+	/**
+	* The time every collector last ran in milliseconds, negative before its first run
+	*/
+	std::vector<double> last_run_times;
+
+	/**
+	* Collectors that cost more than this are disabled
+	*/
+	CollectorCost max_cost = CollectorCost::High;
+
+	std::shared_ptr<PlatformSessions> sessions = std::make_shared<PlatformSessions>();
+
+	/**
+	* Gets the time from a monotonic clock
+	* @return The time in milliseconds
+	*/
+	static double getTimeMilliseconds();
+
+	/**
+	* Checks a collector and its dependencies
+	* @param depth Stops a dependency cycle from recursing forever
+	*/
+	bool isEnabled(const size_t index, const unsigned int depth) const;
+
+public:
+	/**
+	* The name of the configuration file that is loaded when no other file is given, if it exists
+	*/
+	static const char* const DefaultConfigPath;
+
+	/**
+	* Registers the collectors of the application with their default settings
+	*/
+	CollectorRegistry();
+
+	/**
+	* Adds a collector, a collector with the same name is replaced
+	*/
+	void add(const CollectorInfo& collector);
+
+	/**
+	* Applies the settings of a configuration file
+	* @param path The path of the file
+	* @param error Receives what is wrong with the file
+	* @param must_exist If a missing file is an error, otherwise it is the same as an empty file
+	* @return false if the file could not be read or has a setting that is not known
+	*/
+	bool loadConfig(const std::string& path, std::string& error, const bool must_exist = 1);
+
+	/**
+	* Applies a single setting as written in a configuration file
+	* @param setting The name of the setting, a collector, <collector>.cadence or max-cost
+	* @param value The value of the setting
+	* @param error Receives what is wrong with the setting
+	* @return false if the setting or its value is not known
+	*/
+	bool set(const std::string& setting, const std::string& value, std::string& error);
+
+	/**
+	* Checks if a collector is enabled, its own flag, its cost and every collector it depends on have to allow it
+	* @return false for a collector that is not registered
+	*/
+	bool isEnabled(const std::string& name) const;
+
+	/**
+	* Checks if an enabled collector is due to run and marks it as run if it is
+	* @return If the collector should run now
+	*/
+	bool isDue(const std::string& name);
+
+	/**
+	* @return The cadence of a collector in milliseconds, 0 if it runs every tick or is not registered
+	*/
+	unsigned int getCadence(const std::string& name) const;
+
+	/**
+	* @return The sessions the collectors share
+	*/
+	std::shared_ptr<PlatformSessions> getSessions() const;
+
+	/**
+	* Prints every collector with its cost, cadence, dependencies and whether it is enabled
+	*/
+	void print(std::ostream& stream) const;
+};
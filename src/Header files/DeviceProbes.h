@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+/**
+* Runs device probes on their own threads and waits for them up to a deadline
+* A probe cannot be cancelled once it is stuck in the system, one that misses the deadline is left running and collected with takeFinished() if it ever returns
+* The work of a probe must only touch data it owns, the probe can outlive whoever started it
+*/
+class DeviceProbes
+{
+	/**
+	* A probe shared between its thread and the object that started it, whichever lets go of it last frees it
+	*/
+	struct Probe
+	{
+		std::wstring			Key;
+		unsigned long long		ID;
+		std::function<void()>	Work;
+
+		/**
+		* Set by the thread of the probe once the work returned, only read and written atomically
+		*/
+		long					Finished;
+	};
+
+	/**
+	* The probes that were started and not collected yet
+	*/
+	std::vector<std::shared_ptr<Probe>> probes;
+
+	/**
+	* The ID the next probe gets, a key can be probed again while its earlier probe is still running so only the ID tells them apart
+	*/
+	unsigned long long next_id = 1;
+
+	/**
+	* Checks if the work of a probe returned
+	*/
+	static bool isFinished(Probe& probe);
+
+public:
+	/**
+	* A probe that finished
+	*/
+	struct FinishedProbe
+	{
+		std::wstring			Key;
+		unsigned long long		ID;
+	};
+
+	/**
+	* Runs the work of a probe and marks it as finished, the entry point of the probe threads
+	* @param parameter A heap allocated std::shared_ptr to the probe, deleted when the work returns
+	*/
+	static void run(void* parameter);
+
+	/**
+	* Starts a probe on a new thread, the work runs on the calling thread if no thread can be created
+	* @param key The key the probe is reported by when it finishes
+	* @param work The probe, everything it writes must be owned by it
+	* @return The ID of the probe
+	*/
+	unsigned long long start(const std::wstring& key, std::function<void()> work);
+
+	/**
+	* Waits until every probe finished or the timeout passed
+	* @param timeout_milliseconds The longest time to wait
+	* @return If every probe finished
+	*/
+	bool wait(const unsigned int timeout_milliseconds);
+
+	/**
+	* Collects the probes that finished since the last call
+	* @return The keys and IDs of the collected probes
+	*/
+	std::vector<FinishedProbe> takeFinished();
+
+	/**
+	* @return The number of probes that were started and not collected yet
+	*/
+	size_t getPendingCount();
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include "StorageInformation.h"
+
+/**
+* How busy a physical disk was since the previous sample
+*/
+struct DiskMetrics
+{
+	double		ReadBytesPerSecond = 0;
+	double		WriteBytesPerSecond = 0;
+	double		ReadsPerSecond = 0;
+	double		WritesPerSecond = 0;
+	double		AverageLatency = 0;
+	double		QueueDepth = 0;
+	double		Utilization = 0;
+};
+
+/**
+* Describes a member of DiskMetrics so every metric can be shown and recorded the same way
+*/
+struct DiskMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double DiskMetrics::* Value;
+};
+
+/**
+* Every metric of a disk in the order they are shown and recorded
+* The type takes the place of the sensor type in the recorded column names
+*/
+const DiskMetricInfo DiskMetricInfos[] =
+{
+	{ "Read Rate", "Throughput", "B/s", &DiskMetrics::ReadBytesPerSecond },
+	{ "Write Rate", "Throughput", "B/s", &DiskMetrics::WriteBytesPerSecond },
+	{ "Read Operations", "IOPS", "/s", &DiskMetrics::ReadsPerSecond },
+	{ "Write Operations", "IOPS", "/s", &DiskMetrics::WritesPerSecond },
+	{ "Average Latency", "Latency", "ms", &DiskMetrics::AverageLatency },
+	{ "Queue Depth", "Queue", "", &DiskMetrics::QueueDepth },
+	{ "Utilization", "Load", "%", &DiskMetrics::Utilization },
+};
+
+const unsigned int DiskMetricCount = sizeof(DiskMetricInfos) / sizeof(DiskMetricInfos[0]);
+
+/**
+* Samples the I/O counters of the physical disks and turns them into rates
+* The counters only ever grow, every metric is computed from the difference to the previous sample
+* Uses the disk performance counters on Windows and /proc/diskstats on Linux
+*/
+class DiskActivity
+{
+private:
+	/**
+	* The cumulative counters of a disk at the time they were read
+	*/
+	struct DiskCounters
+	{
+		unsigned long long	ReadBytes;
+		unsigned long long	WriteBytes;
+		unsigned long long	Reads;
+		unsigned long long	Writes;
+		double				ServiceMilliseconds;
+		double				BusyMilliseconds;
+		double				QueueMilliseconds;
+		double				QueueDepth;
+		double				TimeMilliseconds;
+	};
+
+	/**
+	* A disk being sampled
+	*/
+	struct WatchedDisk
+	{
+		std::wstring		Key;
+		std::string			DeviceID;
+		DiskCounters		Previous;
+		bool				HasPrevious;
+
+		/**
+		* The handle the counters are read through on Windows, opened once
+		*/
+		void*				Handle;
+	};
+
+	std::vector<WatchedDisk> watched_disks;
+
+#ifndef _WIN32
+	/**
+	* /proc/diskstats is kept open and read again from the start every sample
+	*/
+	std::string diskstats_path = "/proc/diskstats";
+	int diskstats_file = -1;
+	std::string diskstats_buffer;
+
+	/**
+	* Reads the counters of every watched disk from /proc/diskstats
+	* @param counters Receives the counters in the order of watched_disks
+	* @param found Marks the disks that were found
+	*/
+	void readDiskstats(std::vector<DiskCounters>& counters, std::vector<bool>& found);
+#endif
+
+	/**
+	* Opens what is needed to read the counters of the given disks
+	*/
+	void init(StorageInformation& storageInformation);
+
+	/**
+	* Starts sampling a physical disk
+	* @param key The key of the disk in StorageInformation::PhysicalDisks
+	* @param deviceID The device ID of the disk
+	* @return false if the counters of the disk cannot be read
+	*/
+	bool addDisk(const std::wstring& key, const std::wstring& deviceID);
+
+	/**
+	* Turns the difference between two samples into rates
+	* @return false if a counter went backwards, the disk was reset and the sample is only used as the next baseline
+	*/
+	static bool computeMetrics(const DiskCounters& previous, const DiskCounters& current, DiskMetrics& metrics);
+
+public:
+	/**
+	* The metrics of every disk with the same keys as StorageInformation::PhysicalDisks, all 0 until the second update()
+	*/
+	std::map<std::wstring, DiskMetrics> Disks;
+
+	/**
+	* @param storageInformation The physical disks to sample
+	*/
+	DiskActivity(StorageInformation& storageInformation)
+	{
+		init(storageInformation);
+	}
+
+#ifndef _WIN32
+	/**
+	* Reads the counters from the given file instead of /proc/diskstats, used to test against fake counters
+	* @param storageInformation The physical disks to sample
+	* @param diskstats_path The file that takes the place of /proc/diskstats
+	*/
+	DiskActivity(StorageInformation& storageInformation, const std::string& diskstats_path) : diskstats_path(diskstats_path)
+	{
+		init(storageInformation);
+	}
+#endif
+
+	~DiskActivity();
+
+	DiskActivity(const DiskActivity&) = delete;
+	DiskActivity& operator=(const DiskActivity&) = delete;
+
+	/**
+	* Samples the counters of every disk and updates their metrics from the previous sample
+	*/
+	void update();
+
+	/**
+	* Stops sampling the disks that were removed and starts sampling the ones that were added, the other disks keep their baseline
+	* @param storageInformation The physical disks after they were refreshed
+	* @param changes The changes the refresh reported
+	* @return If any disk was added or removed
+	*/
+	bool refresh(StorageInformation& storageInformation, const StorageInformation::StorageChanges& changes);
+};
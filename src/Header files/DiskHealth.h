@@ -0,0 +1,163 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <limits>
+#include "StorageInformation.h"
+#include "DeviceProbes.h"
+
+/**
+* The health of a physical disk from its SMART attributes or its NVMe health log
+* A metric the disk does not report is NaN
+*/
+struct DiskHealthMetrics
+{
+	double		Temperature = std::numeric_limits<double>::quiet_NaN();
+	double		PercentageUsed = std::numeric_limits<double>::quiet_NaN();
+	double		AvailableSpare = std::numeric_limits<double>::quiet_NaN();
+	double		MediaErrors = std::numeric_limits<double>::quiet_NaN();
+	double		PowerOnHours = std::numeric_limits<double>::quiet_NaN();
+	double		UnsafeShutdowns = std::numeric_limits<double>::quiet_NaN();
+};
+
+/**
+* Describes a member of DiskHealthMetrics so every metric can be shown and recorded the same way
+*/
+struct DiskHealthMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double DiskHealthMetrics::* Value;
+};
+
+/**
+* Every health metric of a disk in the order they are shown and recorded
+* The type takes the place of the sensor type in the recorded column names
+*/
+const DiskHealthMetricInfo DiskHealthMetricInfos[] =
+{
+	{ "Drive Temperature", "Temperature", "C", &DiskHealthMetrics::Temperature },
+	{ "Wear", "Level", "%", &DiskHealthMetrics::PercentageUsed },
+	{ "Available Spare", "Level", "%", &DiskHealthMetrics::AvailableSpare },
+	{ "Media Errors", "Errors", "", &DiskHealthMetrics::MediaErrors },
+	{ "Power On Time", "Time", "h", &DiskHealthMetrics::PowerOnHours },
+	{ "Unsafe Shutdowns", "Errors", "", &DiskHealthMetrics::UnsafeShutdowns },
+};
+
+const unsigned int DiskHealthMetricCount = sizeof(DiskHealthMetricInfos) / sizeof(DiskHealthMetricInfos[0]);
+
+/**
+* Reads the SMART attributes of ATA disks and the health log of NVMe disks every few minutes and keeps the last results
+* The reads run on their own threads through DeviceProbes, a disk that takes long to answer never delays the caller
+* Reading the health of a disk needs administrator rights on Windows and root on Linux, the metrics of a disk that could not be read stay NaN
+*/
+class DiskHealth
+{
+	/**
+	* A disk being sampled
+	*/
+	struct WatchedDisk
+	{
+		std::wstring							Key;
+		std::string								DevicePath;
+		bool									Nvme;
+
+		/**
+		* The result the running read writes into, it is owned by the read so a read that hangs can be left behind
+		*/
+		std::shared_ptr<DiskHealthMetrics>		Result;
+		unsigned long long						ReadID;
+		bool									Reading;
+	};
+
+	std::map<std::wstring, WatchedDisk> watched_disks;
+
+	DeviceProbes reads;
+
+	/**
+	* The time between reads and the time of the last one in milliseconds, negative before the first one
+	*/
+	double sample_interval;
+	double last_sample_time = -1;
+
+	/**
+	* Gets the time from a monotonic clock
+	* @return The time in milliseconds
+	*/
+	static double getTimeMilliseconds();
+
+	/**
+	* Reads the health of a disk from the device, blocks for as long as the disk takes to answer
+	* @param devicePath The path of the disk device
+	* @param nvme If the disk is read through the NVMe health log instead of the SMART attributes
+	* @param metrics Receives the health of the disk
+	* @return false if the disk could not be read
+	*/
+	static bool readDisk(const std::string& devicePath, const bool nvme, DiskHealthMetrics& metrics);
+
+	/**
+	* Starts watching a physical disk, its metrics are NaN until its first read finishes
+	* @param key The key of the disk in StorageInformation::PhysicalDisks
+	* @param deviceID The device ID of the disk
+	* @param nvme If the disk is an NVMe disk
+	*/
+	void addDisk(const std::wstring& key, const std::wstring& deviceID, const bool nvme);
+
+	/**
+	* Starts reading the health of a disk on its own thread
+	* @param disk The disk to read
+	*/
+	void startRead(WatchedDisk& disk);
+
+public:
+	/**
+	* The size of the NVMe SMART / Health Information log page and of the ATA SMART data
+	*/
+	static const unsigned int LogPageSize = 512;
+
+	/**
+	* The last health read from every disk with the same keys as StorageInformation::PhysicalDisks
+	*/
+	std::map<std::wstring, DiskHealthMetrics> Disks;
+
+	/**
+	* @param storageInformation The physical disks to read
+	* @param sample_interval The time between reads in milliseconds
+	*/
+	DiskHealth(StorageInformation& storageInformation, const double sample_interval = 10 * 60000);
+
+	/**
+	* Takes the results of the reads that finished and starts new ones when sample_interval has passed, never waits for a disk
+	* A disk whose last read has not finished yet is skipped until it does
+	* @return If the health of any disk changed
+	*/
+	bool update();
+
+	/**
+	* Stops watching the disks that were removed and starts reading the ones that were added, the other disks keep their last results
+	* @param storageInformation The physical disks after they were refreshed
+	* @param changes The changes the refresh reported
+	* @return If any disk was added or removed
+	*/
+	bool refresh(StorageInformation& storageInformation, const StorageInformation::StorageChanges& changes);
+
+	/**
+	* Parses the NVMe SMART / Health Information log page (log identifier 02h)
+	* @param page The log page as returned by the drive
+	* @param size The size of the page in bytes
+	* @param metrics Receives the metrics found in the page
+	* @return false if the page is too short
+	*/
+	static bool parseNvmeHealthLog(const unsigned char* page, const size_t size, DiskHealthMetrics& metrics);
+
+	/**
+	* Parses the attribute table of the ATA SMART READ DATA response
+	* @param data The response as returned by the drive
+	* @param size The size of the response in bytes
+	* @param metrics Receives the metrics of the attributes found in the table
+	* @return false if the response is too short
+	*/
+	static bool parseAtaSmartData(const unsigned char* data, const size_t size, DiskHealthMetrics& metrics);
+};
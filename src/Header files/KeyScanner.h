@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+* Reads the values of known keys out of a "<key> <value>" or "<key>: <value>" text file like /proc/meminfo or /proc/vmstat in a single pass
+* The files keep the same keys in the same order between reads, only the widths of the values change
+* The first scan finds the offset of every key, the later scans check the key at its expected offset and only look at the lines in between when it moved
+*/
+class KeyScanner
+{
+	struct Key
+	{
+		std::string		Name;
+
+		/**
+		* The index of the value in the array passed to scan()
+		*/
+		size_t			ValueIndex;
+
+		/**
+		* The offset of the line of the key in the last scan, npos if the key was not found
+		*/
+		size_t			Offset;
+	};
+
+	/**
+	* The keys sorted by their offset after the first scan, the keys that were not found come last
+	*/
+	std::vector<Key> keys;
+
+	/**
+	* Marks that the offsets were found, cleared when a key is no longer after the one before it
+	*/
+	bool calibrated = 0;
+
+	/**
+	* Finds every key by going through all lines and sorts the keys by their offset
+	*/
+	void calibrate(const char* buffer, const size_t length);
+
+	/**
+	* Checks if the line at an offset is the line of a key
+	* @return The offset of the value after the key, npos if the line has a different key
+	*/
+	static size_t matchKey(const char* buffer, const size_t length, const size_t offset, const std::string& name);
+
+	/**
+	* Reads the number after a key
+	* @param offset The offset right after the key, whitespace and a colon are skipped
+	*/
+	static double parseValue(const char* buffer, const size_t length, size_t offset);
+
+public:
+	/**
+	* @param names The keys to read, their values are written in the same order
+	*/
+	KeyScanner(const std::vector<std::string>& names);
+
+	/**
+	* Reads the value of every key
+	* @param buffer The content of the file, it does not have to end with a null
+	* @param length The length of the content
+	* @param values Receives the value of every key in the order the names were given, keys that are not in the file are left as they are
+	* @return The number of keys that were found
+	*/
+	size_t scan(const char* buffer, const size_t length, double* values);
+};
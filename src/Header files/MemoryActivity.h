@@ -0,0 +1,249 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <limits>
+#include "KeyScanner.h"
+
+/**
+* The usage of the memory of the whole system and how hard it is paging
+* A metric the platform does not report is NaN, the rates are NaN until the second update()
+*/
+struct MemoryMetrics
+{
+	double		TotalBytes = std::numeric_limits<double>::quiet_NaN();
+	double		UsedBytes = std::numeric_limits<double>::quiet_NaN();
+	double		AvailableBytes = std::numeric_limits<double>::quiet_NaN();
+	double		CachedBytes = std::numeric_limits<double>::quiet_NaN();
+	double		DirtyBytes = std::numeric_limits<double>::quiet_NaN();
+	double		CommittedBytes = std::numeric_limits<double>::quiet_NaN();
+	double		SwapTotalBytes = std::numeric_limits<double>::quiet_NaN();
+	double		SwapUsedBytes = std::numeric_limits<double>::quiet_NaN();
+	double		PageFaultsPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		MajorFaultsPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		SwapInBytesPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		SwapOutBytesPerSecond = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The pages looked at to find memory to free, high when the system is short of memory
+	*/
+	double		ReclaimScansPerSecond = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The pages that were taken from the cache or other processes to be reused
+	*/
+	double		ReclaimedPerSecond = std::numeric_limits<double>::quiet_NaN();
+};
+
+/**
+* Describes a member of MemoryMetrics so every metric can be shown and recorded the same way
+*/
+struct MemoryMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double MemoryMetrics::* Value;
+};
+
+/**
+* Every metric of the system memory in the order they are shown and recorded
+* The type takes the place of the sensor type in the recorded column names
+*/
+const MemoryMetricInfo MemoryMetricInfos[] =
+{
+	{ "Total Memory", "Memory", "B", &MemoryMetrics::TotalBytes },
+	{ "Used Memory", "Memory", "B", &MemoryMetrics::UsedBytes },
+	{ "Available Memory", "Memory", "B", &MemoryMetrics::AvailableBytes },
+	{ "Cached", "Memory", "B", &MemoryMetrics::CachedBytes },
+	{ "Dirty", "Memory", "B", &MemoryMetrics::DirtyBytes },
+	{ "Committed", "Memory", "B", &MemoryMetrics::CommittedBytes },
+	{ "Swap Total", "Swap", "B", &MemoryMetrics::SwapTotalBytes },
+	{ "Swap Used", "Swap", "B", &MemoryMetrics::SwapUsedBytes },
+	{ "Page Faults", "Paging", "/s", &MemoryMetrics::PageFaultsPerSecond },
+	{ "Major Faults", "Paging", "/s", &MemoryMetrics::MajorFaultsPerSecond },
+	{ "Swap In", "Paging", "B/s", &MemoryMetrics::SwapInBytesPerSecond },
+	{ "Swap Out", "Paging", "B/s", &MemoryMetrics::SwapOutBytesPerSecond },
+	{ "Reclaim Scans", "Reclaim", "pages/s", &MemoryMetrics::ReclaimScansPerSecond },
+	{ "Reclaimed", "Reclaim", "pages/s", &MemoryMetrics::ReclaimedPerSecond },
+};
+
+const unsigned int MemoryMetricCount = sizeof(MemoryMetricInfos) / sizeof(MemoryMetricInfos[0]);
+
+/**
+* The usage of the memory of a single NUMA node
+* A metric the platform does not report is NaN, the rates are NaN until the second update()
+*/
+struct NodeMemoryMetrics
+{
+	double		TotalBytes = std::numeric_limits<double>::quiet_NaN();
+	double		UsedBytes = std::numeric_limits<double>::quiet_NaN();
+	double		FreeBytes = std::numeric_limits<double>::quiet_NaN();
+	double		FilePagesBytes = std::numeric_limits<double>::quiet_NaN();
+	double		AnonymousBytes = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The share of the pages allocated on this node since the previous sample that were asked for by a CPU of the node
+	*/
+	double		LocalAllocations = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The pages allocated on this node that were meant for another node that was full
+	*/
+	double		MissesPerSecond = std::numeric_limits<double>::quiet_NaN();
+};
+
+/**
+* Describes a member of NodeMemoryMetrics so every metric can be shown and recorded the same way
+*/
+struct NodeMemoryMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double NodeMemoryMetrics::* Value;
+};
+
+/**
+* Every metric of a NUMA node in the order they are shown and recorded
+*/
+const NodeMemoryMetricInfo NodeMemoryMetricInfos[] =
+{
+	{ "Total Memory", "Memory", "B", &NodeMemoryMetrics::TotalBytes },
+	{ "Used Memory", "Memory", "B", &NodeMemoryMetrics::UsedBytes },
+	{ "Free Memory", "Memory", "B", &NodeMemoryMetrics::FreeBytes },
+	{ "File Pages", "Memory", "B", &NodeMemoryMetrics::FilePagesBytes },
+	{ "Anonymous Pages", "Memory", "B", &NodeMemoryMetrics::AnonymousBytes },
+	{ "Local Allocations", "Locality", "%", &NodeMemoryMetrics::LocalAllocations },
+	{ "Misses", "Locality", "pages/s", &NodeMemoryMetrics::MissesPerSecond },
+};
+
+const unsigned int NodeMemoryMetricCount = sizeof(NodeMemoryMetricInfos) / sizeof(NodeMemoryMetricInfos[0]);
+
+/**
+* Samples the usage of the memory, the paging activity and the usage of every NUMA node
+* Uses GlobalMemoryStatusEx, GetPerformanceInfo and the memory performance counters on Windows,
+* /proc/meminfo, /proc/vmstat and /sys/devices/system/node on Linux
+* The Linux files are kept open and read again from the start every sample, their keys are found with a KeyScanner
+*/
+class MemoryActivity
+{
+private:
+#ifdef _WIN32
+	/**
+	* The query of the paging counters and the counters in the order of WindowsCounterPaths, PDH handles
+	*/
+	void* counter_query = nullptr;
+	std::vector<void*> counters;
+
+	/**
+	* The NUMA nodes of the system by their number
+	*/
+	std::vector<unsigned int> node_numbers;
+#else
+	std::string proc_root = "/proc";
+	std::string sysfs_root = "/sys";
+
+	int meminfo_file = -1;
+	int vmstat_file = -1;
+
+	/**
+	* The buffer every file is read into, grown to fit the biggest one
+	*/
+	std::string read_buffer;
+
+	std::unique_ptr<KeyScanner> meminfo_scanner;
+	std::unique_ptr<KeyScanner> vmstat_scanner;
+
+	/**
+	* The vmstat counters of the previous sample in the order of VmstatKeys
+	*/
+	std::vector<double> previous_vmstat;
+
+	/**
+	* A NUMA node being sampled
+	*/
+	struct WatchedNode
+	{
+		unsigned int				Number;
+		int							MeminfoFile;
+		int							NumastatFile;
+		std::unique_ptr<KeyScanner>	MeminfoScanner;
+		std::unique_ptr<KeyScanner>	NumastatScanner;
+
+		/**
+		* The numastat counters of the previous sample in the order of NumastatKeys
+		*/
+		std::vector<double>			PreviousNumastat;
+	};
+
+	std::vector<WatchedNode> watched_nodes;
+
+	/**
+	* The time of the previous sample in milliseconds, negative before the first one
+	*/
+	double previous_time = -1;
+
+	/**
+	* Reads a file that is kept open from the start into read_buffer
+	* @return The length of the content, 0 if it could not be read
+	*/
+	size_t readFile(const int file);
+
+	/**
+	* Samples the system wide usage and the vmstat counters
+	* @param elapsed The milliseconds since the previous sample, 0 on the first sample
+	*/
+	void readSystem(const double elapsed);
+
+	/**
+	* Samples the usage and the allocation counters of every node
+	* @param elapsed The milliseconds since the previous sample, 0 on the first sample
+	*/
+	void readNodes(const double elapsed);
+#endif
+
+	/**
+	* Opens the counters and finds the NUMA nodes
+	*/
+	void init();
+
+public:
+	/**
+	* The metrics of the whole system
+	*/
+	MemoryMetrics System;
+
+	/**
+	* The metrics of every NUMA node by its number, empty on a system with a single node as there is nothing to break down
+	*/
+	std::map<unsigned int, NodeMemoryMetrics> Nodes;
+
+	MemoryActivity()
+	{
+		init();
+	}
+
+#ifndef _WIN32
+	/**
+	* Reads the files from under the given directories instead of /proc and /sys, used to test against fake files
+	* @param proc_root The directory that takes the place of /proc
+	* @param sysfs_root The directory that takes the place of /sys
+	*/
+	MemoryActivity(const std::string& proc_root, const std::string& sysfs_root) : proc_root(proc_root), sysfs_root(sysfs_root)
+	{
+		init();
+	}
+#endif
+
+	~MemoryActivity();
+
+	MemoryActivity(const MemoryActivity&) = delete;
+	MemoryActivity& operator=(const MemoryActivity&) = delete;
+
+	/**
+	* Samples the memory and updates the rates from the previous sample
+	*/
+	void update();
+};
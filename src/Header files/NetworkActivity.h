@@ -0,0 +1,163 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <limits>
+#include "NetworkInformation.h"
+
+/**
+* The traffic of a network interface since the previous sample
+* The rates are NaN until the second update() and after the counters of the interface were reset
+*/
+struct InterfaceMetrics
+{
+	double		ReceiveBytesPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		TransmitBytesPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		ReceivePacketsPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		TransmitPacketsPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		ReceiveErrorsPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		TransmitErrorsPerSecond = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The packets that were fine but thrown away, usually because a queue or buffer was full
+	*/
+	double		ReceiveDropsPerSecond = std::numeric_limits<double>::quiet_NaN();
+	double		TransmitDropsPerSecond = std::numeric_limits<double>::quiet_NaN();
+};
+
+/**
+* Describes a member of InterfaceMetrics so every metric can be shown and recorded the same way
+*/
+struct InterfaceMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double InterfaceMetrics::* Value;
+};
+
+/**
+* Every metric of a network interface in the order they are shown and recorded
+* The type takes the place of the sensor type in the recorded column names
+*/
+const InterfaceMetricInfo InterfaceMetricInfos[] =
+{
+	{ "Received", "Throughput", "B/s", &InterfaceMetrics::ReceiveBytesPerSecond },
+	{ "Sent", "Throughput", "B/s", &InterfaceMetrics::TransmitBytesPerSecond },
+	{ "Packets Received", "Packets", "/s", &InterfaceMetrics::ReceivePacketsPerSecond },
+	{ "Packets Sent", "Packets", "/s", &InterfaceMetrics::TransmitPacketsPerSecond },
+	{ "Receive Errors", "Errors", "/s", &InterfaceMetrics::ReceiveErrorsPerSecond },
+	{ "Send Errors", "Errors", "/s", &InterfaceMetrics::TransmitErrorsPerSecond },
+	{ "Receive Drops", "Drops", "/s", &InterfaceMetrics::ReceiveDropsPerSecond },
+	{ "Send Drops", "Drops", "/s", &InterfaceMetrics::TransmitDropsPerSecond },
+};
+
+const unsigned int InterfaceMetricCount = sizeof(InterfaceMetricInfos) / sizeof(InterfaceMetricInfos[0]);
+
+/**
+* Samples the traffic counters of the network adapters and turns them into rates
+* Uses the interface table of the IP helper on Windows and /proc/net/dev on Linux
+*/
+class NetworkActivity
+{
+private:
+	/**
+	* The cumulative counters of an interface in the order of InterfaceMetricInfos
+	*/
+	struct InterfaceCounters
+	{
+		unsigned long long	Values[InterfaceMetricCount];
+	};
+
+	/**
+	* The adapters being sampled, the counters of an interface are matched to its adapter by its interface index on Windows and by its name on Linux
+	*/
+	const NetworkInformation& network_information;
+
+	/**
+	* An interface at the position of its adapter in NetworkInformation::Adapters
+	*/
+	struct WatchedInterface
+	{
+		std::wstring		Name;
+
+		/**
+		* Marks the adapters that are sampled, an adapter without an interface or with the name of an adapter before it is not
+		*/
+		bool				Watched;
+
+		InterfaceCounters	Previous;
+		bool				HasPrevious;
+	};
+
+	std::vector<WatchedInterface> watched_interfaces;
+
+	/**
+	* The time of the previous sample in milliseconds, negative before the first one
+	*/
+	double previous_time = -1;
+
+#ifndef _WIN32
+	/**
+	* /proc/net/dev is kept open and read again from the start every sample
+	*/
+	std::string netdev_path = "/proc/net/dev";
+	int netdev_file = -1;
+	std::string netdev_buffer;
+
+	/**
+	* Reads the counters of every watched interface from /proc/net/dev
+	* @param counters Receives the counters in the order of watched_interfaces
+	* @param found Marks the interfaces that were found
+	*/
+	void readNetdev(std::vector<InterfaceCounters>& counters, std::vector<bool>& found);
+#endif
+
+	/**
+	* Starts sampling every adapter and opens what is needed to read their counters
+	*/
+	void init();
+
+	/**
+	* Gets how much a counter grew between two samples
+	* A counter that went backwards wrapped around if both samples fit in 32 bits and the previous one was close to the limit, 32 bit kernels and older drivers keep 32 bit counters
+	* @return The growth, NaN if the counter was reset
+	*/
+	static double getCounterDelta(const unsigned long long previous, const unsigned long long current);
+
+public:
+	/**
+	* The metrics of every adapter by its name
+	*/
+	std::map<std::wstring, InterfaceMetrics> Interfaces;
+
+	/**
+	* @param networkInformation The adapters to sample, it is looked up every sample and has to outlive the collector
+	*/
+	NetworkActivity(const NetworkInformation& networkInformation) : network_information(networkInformation)
+	{
+		init();
+	}
+
+#ifndef _WIN32
+	/**
+	* Reads the counters from the given file instead of /proc/net/dev, used to test against fake counters
+	* @param networkInformation The adapters to sample
+	* @param netdev_path The file that takes the place of /proc/net/dev
+	*/
+	NetworkActivity(const NetworkInformation& networkInformation, const std::string& netdev_path) : network_information(networkInformation), netdev_path(netdev_path)
+	{
+		init();
+	}
+#endif
+
+	~NetworkActivity();
+
+	NetworkActivity(const NetworkActivity&) = delete;
+	NetworkActivity& operator=(const NetworkActivity&) = delete;
+
+	/**
+	* Samples the counters of every interface and updates their metrics from the previous sample
+	*/
+	void update();
+};
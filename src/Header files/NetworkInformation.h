@@ -1,9 +1,32 @@
 #pragma once
 #include <iostream>
 #include <vector>
+#include <string>
+#include <unordered_map>
+#ifdef _WIN32
 #include <comdef.h>
 #include <Wbemidl.h>
+#endif
+#include "PlatformSessions.h"
 
+/**
+* What an adapter is backed by, used to group the adapters so the many virtual ones of a host can be shown as a summary
+*/
+enum class AdapterClass : unsigned int
+{
+    Physical,
+    Virtual,
+    Loopback,
+    Tunnel,
+    Container
+};
+
+/**
+* The name of every adapter class in the order of AdapterClass
+*/
+const char* const AdapterClassNames[] = { "Physical", "Virtual", "Loopback", "Tunnel", "Container" };
+
+const unsigned int AdapterClassCount = sizeof(AdapterClassNames) / sizeof(AdapterClassNames[0]);
 
 class NetworkInformation
 {
@@ -38,16 +61,123 @@ class NetworkInformation
         long long                   Speed;
         std::wstring                Status;
         std::wstring                TimeOfLastReset;
+        AdapterClass                Class;
     };
 
-    void initAdapters();
+    /**
+    * The position of every adapter in Adapters by its name, its MAC address and its interface index
+    * Adapters that share a MAC address, like VLANs and the members of a bond, are found by the first one
+    */
+    std::unordered_map<std::wstring, size_t> adapters_by_name;
+    std::unordered_map<std::wstring, size_t> adapters_by_mac_address;
+    std::unordered_map<int, size_t> adapters_by_interface_index;
+
+    /**
+    * Tells what an adapter is backed by from what the platform reported about it
+    */
+    static AdapterClass classifyAdapter(const NetworkAdapter& adapter);
+
+    /**
+    * Queries all network adapters, from WMI on Windows and from rtnetlink and sysfs on Linux
+    * @param sessions The sessions that hold the connection to WMI or the netlink socket and the sysfs directory
+    */
+    void initAdapters(PlatformSessions& sessions);
+
+#ifndef _WIN32
+    std::string sysfs_root = "/sys";
+
+    /**
+    * The buffer every netlink answer is received into, grown to fit the biggest message and reused by every dump
+    */
+    std::vector<char> netlink_buffer;
+
+    /**
+    * Asks the kernel for every link or every address and parses the answer
+    * @param sessions The sessions the socket is from, they send the request and receive the answer
+    * @param netlink_socket A NETLINK_ROUTE socket
+    * @param type RTM_GETLINK or RTM_GETADDR
+    * @return false if the request could not be sent or the answer was cut short
+    */
+    bool dumpNetlink(PlatformSessions& sessions, const int netlink_socket, const unsigned short type);
+
+    /**
+    * Reads what netlink does not tell about an adapter from sysfs, its driver, its device and its speed
+    * Virtual adapters have no device, only the device link is looked at for them
+    * @param sysfs_directory The descriptor of sysfs_root
+    */
+    void readSysfsAttributes(const int sysfs_directory, NetworkAdapter& adapter);
+#endif
 
 public:
     std::vector<NetworkAdapter> Adapters;
 
+    /**
+    * Creates an inventory without any adapters, used when the network collector is disabled
+    */
     NetworkInformation()
     {
-        initAdapters();
     }
+
+    /**
+    * @param sessions The sessions shared with the other collectors
+    */
+    NetworkInformation(PlatformSessions& sessions)
+    {
+        initAdapters(sessions);
+        indexAdapters();
+    }
+
+    /**
+    * Classifies every adapter and builds the lookups by name, MAC address and interface index
+    * Called by the constructors, and after adapters were added to a collector that was created empty or from a replayed dump
+    */
+    void indexAdapters();
+
+    /**
+    * Finds an adapter by its name
+    * @return The adapter, nullptr if there is none with the name
+    */
+    const NetworkAdapter* findByName(const std::wstring& name) const;
+
+    /**
+    * Finds an adapter by its MAC address, written like the MACAddress of the adapters
+    * @return The first adapter with the address, nullptr if there is none
+    */
+    const NetworkAdapter* findByMACAddress(const std::wstring& address) const;
+
+    /**
+    * Finds an adapter by the index of its interface
+    * @return The adapter, nullptr if there is none with the index
+    */
+    const NetworkAdapter* findByInterfaceIndex(const int interfaceIndex) const;
+
+    /**
+    * Counts the adapters of a class
+    * @param up Receives how many of them are up
+    * @return The number of adapters of the class
+    */
+    size_t countAdapters(const AdapterClass adapterClass, size_t& up) const;
+
+#ifndef _WIN32
+    /**
+    * Reads the sysfs attributes from under the given directory instead of /sys, used to test against a fake sysfs
+    * @param sessions The sessions shared with the other collectors
+    * @param sysfs_root The directory that takes the place of /sys
+    */
+    NetworkInformation(PlatformSessions& sessions, const std::string& sysfs_root) : sysfs_root(sysfs_root)
+    {
+        initAdapters(sessions);
+        indexAdapters();
+    }
+
+    /**
+    * Adds the links and addresses in a netlink answer, RTM_NEWLINK and RTM_NEWADDR messages, to the adapters
+    * Used by initAdapters() and to replay a recorded dump
+    * @param buffer The messages as received from the socket
+    * @param length The length of the messages
+    * @return false once the answer is done or failed, true if more messages follow
+    */
+    bool parseNetlinkMessages(const char* buffer, const size_t length);
+#endif
 };
 
@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <utility>
+#include <functional>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#ifdef _WIN32
+struct IWbemServices;
+#else
+struct nlmsghdr;
+#endif
+
+/**
+* The connections to the operating system the collectors share, every session is only opened the first time a collector asks for it
+* A deployment that disables the collectors needing a session never pays for opening it
+* Uses WMI connections on Windows, netlink sockets and sysfs directory descriptors on Linux
+* Every method can be called from any thread, the sessions are closed when the object is destroyed
+*/
+class PlatformSessions
+{
+#ifdef _WIN32
+	/**
+	* Guards the sessions, a SRWLOCK
+	*/
+	void* lock = nullptr;
+
+	/**
+	* The cookie that keeps the multithreaded apartment alive so the WMI connections can be used from every thread
+	*/
+	void* mta_cookie = nullptr;
+
+	/**
+	* The connection to every WMI namespace that was asked for by the namespace
+	*/
+	std::map<std::wstring, IWbemServices*> wmi_services;
+
+	/**
+	* Connects to a WMI namespace, blocks for as long as WMI takes to answer
+	* @return The connection, nullptr if it could not connect
+	*/
+	static IWbemServices* connectWmi(const std::wstring& wmiNamespace);
+#else
+	pthread_mutex_t lock;
+
+	/**
+	* The netlink sockets by their protocol and the multicast groups they joined
+	*/
+	std::map<std::pair<int, unsigned int>, int> netlink_sockets;
+
+	/**
+	* The last sequence number handed out for a request on the netlink sockets
+	*/
+	unsigned int netlink_sequence = 0;
+
+	/**
+	* The directories kept open to read the files in them relative to the descriptor by their path
+	*/
+	std::map<std::string, int> directories;
+#endif
+
+public:
+	PlatformSessions();
+	~PlatformSessions();
+
+	PlatformSessions(const PlatformSessions&) = delete;
+	PlatformSessions& operator=(const PlatformSessions&) = delete;
+
+#ifdef _WIN32
+	/**
+	* Gets the connection to a WMI namespace, connecting to it the first time it is asked for
+	* The connection is made outside the lock, a WMI service that hangs never blocks the callers of other namespaces
+	* @param wmiNamespace The namespace, like ROOT\CIMV2
+	* @return A new reference to the connection that the caller has to Release(), nullptr if it could not connect
+	*/
+	IWbemServices* getWmiServices(const std::wstring& wmiNamespace);
+
+	/**
+	* Reads a table of the IP helper, growing the buffer until the table fits
+	* @param buffer The buffer the table is read into, kept by the caller so a busy host does not allocate it every time
+	* @param read Reads the table into a buffer of the given size, returns the error and the size it needs
+	* @return If the table was read
+	*/
+	static bool readTable(std::vector<unsigned char>& buffer, unsigned long (*read)(void* table, unsigned long* size));
+#else
+	/**
+	* Gets a netlink socket, opening it the first time it is asked for
+	* A socket that joined multicast groups receives their events, it should only be read by a single collector
+	* @param protocol The netlink protocol, like NETLINK_ROUTE
+	* @param groups The multicast groups to join, 0 for a socket that only sends requests
+	* @return The socket that stays owned by the sessions, -1 if it could not be opened
+	*/
+	int getNetlinkSocket(const int protocol, const unsigned int groups = 0);
+
+	/**
+	* Gets a sequence number for a request on a netlink socket
+	* The sockets are shared, a collector that tells its answers apart by their sequence number never takes the late answers of another one for its own
+	* @return A number that was not handed out before, never 0
+	*/
+	unsigned int getNetlinkSequence();
+
+	/**
+	* Sends a dump request on a netlink socket and hands every read of the answer to a parser until it is done
+	* @param netlink_socket A socket from getNetlinkSocket()
+	* @param request The request with its length set, its flags and sequence number are filled in
+	* @param sequence Receives the sequence number of the request before the first read is parsed, the parser skips the answers of other requests by it
+	* @param buffer The buffer the answer is received into, grown to fit the biggest message and kept by the caller for the next dump
+	* @param parse Parses the messages of a read, returns false once the answer is done or failed
+	* @return false if the request could not be sent or the answer was cut short
+	*/
+	bool dumpNetlink(const int netlink_socket, nlmsghdr* request, unsigned int& sequence, std::vector<char>& buffer, const std::function<bool(const char*, size_t)>& parse);
+
+	/**
+	* Gets a directory descriptor to open the files in it with openat(), opening it the first time it is asked for
+	* Reading relative to the descriptor skips resolving the whole path on every read
+	* @param path The path of the directory
+	* @return The descriptor that stays owned by the sessions, -1 if it could not be opened
+	*/
+	int getDirectory(const std::string& path);
+#endif
+
+	/**
+	* @return The number of sessions that were opened
+	*/
+	size_t getOpenCount();
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "RecordBlock.h"
+
+/**
+* Turns the processes seen every tick into the compact process samples of a recording
+* A process gets a key and its ID, start time and name are stored once when it first appears,
+* after that a row only has a sample of it if its usage changed or it is among the busiest processes
+*/
+class ProcessRecordTracker
+{
+private:
+    /**
+    * The state of a process that is being recorded
+    */
+    struct TrackedProcess
+    {
+        unsigned int        Key;
+        long long           StartTime;
+        float               LastCPUUsage;
+        unsigned long long  LastMemoryUsage;
+        unsigned long long  LastSeenTick;
+    };
+
+    /**
+    * A process added during the current tick
+    */
+    struct Candidate
+    {
+        unsigned int        ID;
+        long long           StartTime;
+        const std::wstring* Name;
+        float               CPUUsage;
+        unsigned long long  MemoryUsage;
+    };
+
+    /**
+    * The recorded processes by their ID
+    */
+    std::unordered_map<unsigned int, TrackedProcess> tracked_processes;
+
+    /**
+    * The processes of the current tick, reused between ticks
+    */
+    std::vector<Candidate> candidates;
+
+    /**
+    * Marks the candidates that have to be sampled this tick, reused between ticks
+    */
+    std::vector<unsigned char> sampled;
+    std::vector<unsigned int> ranking;
+
+    unsigned int next_key = 0;
+    unsigned long long tick = 0;
+
+    /**
+    * The number of busiest processes by CPU and by memory that are sampled every tick
+    */
+    unsigned int top_count;
+
+    /**
+    * The change in CPU usage in percent and in memory usage in bytes that makes a process get sampled
+    */
+    float cpu_usage_threshold = 0.5f;
+    unsigned long long memory_usage_threshold = 1024 * 1024;
+
+    /**
+    * Marks the top_count candidates with the highest value as sampled
+    * @param value Gets the value of a candidate to rank by
+    */
+    template <typename T>
+    void markTop(T value);
+
+public:
+    /**
+    * @param top_count The number of busiest processes by CPU and by memory that are sampled every tick
+    */
+    ProcessRecordTracker(const unsigned int top_count = 10) : top_count(top_count)
+    {
+    }
+
+    /**
+    * Sets the number of busiest processes by CPU and by memory that are sampled every tick
+    */
+    void setTopCount(const unsigned int count);
+
+    /**
+    * Adds a process to the current tick
+    * @param id The process ID
+    * @param start_time The time the process started at in milliseconds since the unix epoch, tells apart processes that reused an ID
+    * @param name The name of the process, has to stay valid until endTick()
+    * @param cpu_usage The CPU usage in percent
+    * @param memory_usage The memory usage in bytes
+    */
+    void addProcess(const unsigned int id, const long long start_time, const std::wstring& name, const float cpu_usage, const unsigned long long memory_usage);
+
+    /**
+    * Ends the current tick and adds its process samples as the next row of the block
+    * Processes that were not added this tick are marked as ended
+    * @param block The block the current row belongs to
+    */
+    void endTick(RecordBlock& block);
+
+    /**
+    * Forgets all processes so they are stored again with new keys, used when a block could not be written
+    */
+    void reset();
+};
+
+/**
+* Encodes the process table and samples of a block as variable length integers
+* CPU usage is stored in tenths of a percent and memory usage in KiB
+* @param block The block to encode the process data of
+* @param known_processes Processes from earlier blocks to store in the table again, used to make every segment readable on its own
+* @param encoded Receives the encoded payload
+*/
+void encodeProcessBlock(const RecordBlock& block, const std::vector<RecordProcess>& known_processes, std::vector<unsigned char>& encoded);
+
+/**
+* Decodes a payload created by encodeProcessBlock()
+* @param data The encoded payload
+* @param size The size of the payload in bytes
+* @param rows The number of rows in the block
+* @param block Receives the process table and samples
+* @return false if the payload is truncated
+*/
+bool decodeProcessBlock(const unsigned char* data, const size_t size, const unsigned int rows, RecordBlock& block);
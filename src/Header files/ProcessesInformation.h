@@ -13,6 +13,7 @@ class ProcessesInformation
 private: struct Process
 	{
 		unsigned int			ID;
+		long long				StartTime;
         std::wstring            Path;
 		std::wstring			Name;
 		double					CPUUsage;
@@ -88,6 +89,7 @@ public: void updateProcessesDynamicInfo();
 
     /**
     * Fetches all Processes from the OS and stores them in the processes map
+    * Only new processes get their static info fetched, processes that exited are removed
     * @see processes()
     */
 public: void fetchProcesses();
@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+/**
+* A mergeable quantile sketch with a bounded relative error (DDSketch)
+* Values are counted in logarithmically sized buckets so any quantile is within relative_accuracy of the true value,
+* the number of buckets is capped so memory stays constant, if the cap is hit the lowest buckets are merged
+*/
+class QuantileSketch
+{
+private:
+    /**
+    * Counts of consecutive buckets starting at the bucket index offset
+    */
+    struct BucketStore
+    {
+        int Offset = 0;
+        std::vector<unsigned long long> Counts;
+    };
+
+    /**
+    * The relative accuracy the sketch was created with and the bucket growth factor derived from it
+    */
+    double relative_accuracy;
+    double gamma;
+    double log_gamma;
+
+    /**
+    * The maximum number of buckets of every sign
+    */
+    unsigned int max_buckets;
+
+    /**
+    * Buckets of the positive values and of the magnitudes of the negative values
+    */
+    BucketStore positive;
+    BucketStore negative;
+
+    /**
+    * Values too close to zero to have a bucket
+    */
+    unsigned long long zero_count = 0;
+
+    unsigned long long count = 0;
+    double min = 0;
+    double max = 0;
+
+    /**
+    * @return The index of the bucket that holds the given positive value
+    */
+    int getBucketIndex(const double value) const;
+
+    /**
+    * @return The value that represents the bucket, within the relative accuracy of every value in it
+    */
+    double getBucketValue(const int index) const;
+
+    /**
+    * Adds the given count to a bucket, growing the store and merging its lowest buckets if it is over the cap
+    */
+    void addToStore(BucketStore& store, const int index, const unsigned long long bucket_count);
+
+public:
+    /**
+    * @param relative_accuracy The relative error every quantile is within
+    * @param max_buckets The maximum number of buckets of every sign
+    */
+    QuantileSketch(const double relative_accuracy = 0.01, const unsigned int max_buckets = 2048);
+
+    /**
+    * Adds a value, NaN is ignored
+    */
+    void add(const double value);
+
+    /**
+    * Adds every value of another sketch created with the same relative accuracy
+    * @return false if the sketches have different accuracies and can not be merged
+    */
+    bool merge(const QuantileSketch& other);
+
+    /**
+    * Gets the value at the given quantile
+    * @param quantile Between 0 and 1
+    * @return The value, NaN if the sketch is empty
+    */
+    double getQuantile(const double quantile) const;
+
+    /**
+    * @return The number of values added
+    */
+    unsigned long long getCount() const;
+
+    /**
+    * @return The exact minimum and maximum of the values added, NaN if the sketch is empty
+    */
+    double getMin() const;
+    double getMax() const;
+
+    /**
+    * Forgets every value
+    */
+    void clear();
+
+    /**
+    * Appends the sketch to a buffer so it can be stored and merged later
+    * @param encoded The buffer to append to
+    */
+    void serialize(std::vector<unsigned char>& encoded) const;
+
+    /**
+    * Reads a sketch written by serialize()
+    * @param data The buffer to read from
+    * @param size The size of the buffer in bytes
+    * @param offset The offset to read at, moved past the sketch
+    * @return false if the buffer is truncated
+    */
+    bool deserialize(const unsigned char* data, const size_t size, size_t& offset);
+};
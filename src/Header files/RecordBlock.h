@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/**
+* A process as stored once in the process table of a recording, samples refer to it by its key
+*/
+struct RecordProcess
+{
+    unsigned int    Key;
+    unsigned int    ID;
+    long long       StartTime;
+    std::string     Name;
+};
+
+/**
+* The usage of a process in a single row
+* A sample marked as ended means the process exited and its key is not used again
+*/
+struct RecordProcessSample
+{
+    unsigned int        Key;
+    float               CPUUsage;
+    unsigned long long  MemoryUsage;
+    bool                Ended;
+};
+
+/**
+* A block of recorded rows handed from the sampling thread to the writer thread
+* Values are stored row after row, every row has exactly columns values
+*/
+struct RecordBlock
+{
+    /**
+    * The number of values in a single row
+    */
+    unsigned int columns = 0;
+
+    /**
+    * The number of complete rows stored in the block
+    */
+    unsigned int rows = 0;
+
+    /**
+    * The time every row was sampled at in microseconds since the recording started, from a monotonic clock
+    */
+    std::vector<long long> timestamps;
+
+    /**
+    * The wall clock time every row was sampled at in milliseconds since the unix epoch
+    */
+    std::vector<long long> wall_times;
+
+    /**
+    * The values of all rows, row major
+    */
+    std::vector<float> values;
+
+    /**
+    * The processes that appeared in this block, every sample refers to a process of this or an earlier block
+    */
+    std::vector<RecordProcess> processes;
+
+    /**
+    * The process samples of all rows, row after row, only processes that changed or are among the busiest are sampled
+    */
+    std::vector<RecordProcessSample> process_samples;
+
+    /**
+    * The number of process samples in every row, empty if processes are not recorded
+    */
+    std::vector<unsigned int> process_sample_counts;
+
+    /**
+    * Marks that the sampling thread forgot the processes of the earlier blocks because one of them could not be handed over
+    * The writer thread ends every process it still counts as running in the first row of this block, the processes that are still running are stored again with new keys
+    */
+    bool processes_reset = 0;
+
+    /**
+    * Creates an empty block that can hold up to capacity rows of the given width
+    * @param columns The number of values in a single row
+    * @param capacity The number of rows to reserve memory for
+    */
+    RecordBlock(const unsigned int columns, const unsigned int capacity) : columns(columns)
+    {
+        timestamps.reserve(capacity);
+        wall_times.reserve(capacity);
+        values.reserve((size_t)columns * capacity);
+    }
+};
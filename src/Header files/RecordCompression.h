@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "RecordBlock.h"
+
+/**
+* Encodes the rows of a block into a compressed payload
+* Monotonic and wall clock times are stored as delta-of-delta and every column as the XOR of consecutive float values
+* so slowly changing sensors cost a few bits per sample instead of a full float
+* The payload starts with the byte offset of every column so a single column can be decoded on its own
+* @param block The block to encode
+* @param encoded Receives the encoded payload
+*/
+void encodeCompressedBlock(const RecordBlock& block, std::vector<unsigned char>& encoded);
+
+/**
+* Decodes a payload created by encodeCompressedBlock()
+* @param data The encoded payload
+* @param size The size of the payload in bytes
+* @param rows The number of rows in the block
+* @param columns The number of columns in the block
+* @param block Receives the decoded times and values in row major order
+* @return false if the payload is truncated
+*/
+bool decodeCompressedBlock(const unsigned char* data, const size_t size, const unsigned int rows, const unsigned int columns, RecordBlock& block);
+
+/**
+* Decodes the monotonic timestamps and a single column of a payload created by encodeCompressedBlock()
+* @param data The encoded payload
+* @param size The size of the payload in bytes
+* @param rows The number of rows in the block
+* @param columns The number of columns in the block
+* @param column The column to decode
+* @param timestamps Receives the monotonic timestamps of all rows
+* @param values Receives the values of the column for all rows
+* @return false if the payload is truncated or the column does not exist
+*/
+bool decodeCompressedColumn(const unsigned char* data, const size_t size, const unsigned int rows, const unsigned int columns, const unsigned int column, std::vector<long long>& timestamps, std::vector<float>& values);
@@ -0,0 +1,259 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include "RecordBlock.h"
+#include "RecordRollup.h"
+#include "QuantileSketch.h"
+
+/**
+* The file formats a session can be recorded in
+*/
+enum class RecordFormat
+{
+    CSV,
+    Binary,
+    CompressedBinary
+};
+
+/**
+* Everything about a recording that does not change between rows
+*/
+struct RecordSchema
+{
+    /**
+    * The static storage and network information as printed at the top of a CSV recording
+    */
+    std::string static_info;
+
+    /**
+    * The name of every column in a row as "Hardware.Sensor.SensorType"
+    */
+    std::vector<std::string> column_names;
+
+    /**
+    * The wall clock time the recording started at in milliseconds since the unix epoch
+    */
+    long long start_time = 0;
+};
+
+/**
+* Identifies a binary recording, the last two characters are the format version
+*/
+const char BinaryRecordMagic[8] = { 'S', 'I', 'B', 'R', 'E', 'C', '0', '3' };
+
+/**
+* Marks the beginning of a block of rows in a binary recording
+*/
+const unsigned int BinaryRecordBlockMarker = 0x4B4C4230;
+
+/**
+* Marks the beginning of a compressed block of rows in a binary recording
+* @see encodeCompressedBlock()
+*/
+const unsigned int BinaryRecordCompressedBlockMarker = 0x4B4C4231;
+
+/**
+* Marks the process table and samples that belong to the block of rows following it in a binary recording
+* @see encodeProcessBlock()
+*/
+const unsigned int BinaryRecordProcessBlockMarker = 0x4B4C4232;
+
+/**
+* Marks the finished buckets of a rollup tier in a binary recording
+* @see RecordRollup
+*/
+const unsigned int BinaryRecordRollupBlockMarker = 0x4B4C4233;
+
+/**
+* Marks the quantile sketches of every column written when a binary recording is closed
+* @see QuantileSketch::serialize()
+*/
+const unsigned int BinaryRecordSummaryBlockMarker = 0x4B4C4234;
+
+/**
+* The line that starts the summary written at the end of a CSV recording
+*/
+const char CsvSummaryMarker[] = "==== Summary ====";
+
+/**
+* The percentiles written to the summary of a recording
+*/
+const double RecordSummaryPercentiles[] = { 50, 95, 99 };
+
+/**
+* Added to the name of a recording file while it is being written, removed once the file is finished
+* A file that still has it on the next start was left behind by a crash and gets recovered
+*/
+const char RecordInProgressSuffix[] = ".partial";
+
+/**
+* The headers of the time columns that start every row of a CSV recording
+*/
+const char CsvWallTimeColumn[] = "UTC Time";
+const char CsvMonotonicTimeColumn[] = "Elapsed Seconds";
+
+/**
+* Updates a CRC-32 checksum with the given bytes
+* Every block of a binary recording is followed by the checksum of its marker, header and body
+* @param checksum The checksum of the bytes so far, 0 to start a new one
+* @param data The bytes to add
+* @param size The number of bytes
+* @return The updated checksum
+*/
+unsigned int updateRecordChecksum(const unsigned int checksum, const void* data, const size_t size);
+
+/**
+* Gets the file extension used for the given format
+* @param format The recording format
+* @return The extension including the dot
+*/
+std::string getRecordFileExtension(const RecordFormat format);
+
+/**
+* Formats a wall clock time as "YYYY-MM-DD HH:MM:SS.mmm" in UTC
+* @param wall_time The time in milliseconds since the unix epoch
+* @return The formatted time
+*/
+std::string formatWallTime(const long long wall_time);
+
+/**
+* Writes the static info and the column headers in the CSV layout
+* @param stream The stream to write to
+* @param schema The schema of the recording
+*/
+void writeCsvHeader(std::ostream& stream, const RecordSchema& schema);
+
+/**
+* Writes all rows of the given block as comma separated values, every row starts with its wall clock and monotonic time
+* @param stream The stream to write to
+* @param block The block to write
+*/
+void writeCsvBlock(std::ostream& stream, const RecordBlock& block);
+
+/**
+* Writes the file header of a binary recording, the static info followed by the column names
+* @param stream The binary stream to write to
+* @param schema The schema of the recording
+*/
+void writeBinaryHeader(std::ostream& stream, const RecordSchema& schema);
+
+/**
+* Writes a block of a binary recording, the monotonic and wall clock times of all rows followed by every column as float32 values and the checksum of the block
+* @param stream The binary stream to write to
+* @param block The block to write
+*/
+void writeBinaryBlock(std::ostream& stream, const RecordBlock& block);
+
+/**
+* Writes a compressed block of a binary recording, timestamps as delta-of-delta and every column XOR encoded, followed by the checksum of the block
+* @param stream The binary stream to write to
+* @param block The block to write
+* @param scratch Buffer reused between calls to hold the encoded payload
+*/
+void writeCompressedBinaryBlock(std::ostream& stream, const RecordBlock& block, std::vector<unsigned char>& scratch);
+
+/**
+* Writes the processes of a block to a binary recording, has to be written before the block itself
+* Nothing is written if the block has no process samples
+* @param stream The binary stream to write to
+* @param block The block to write the processes of
+* @param known_processes Processes from earlier blocks to store in the table again
+* @param scratch Buffer reused between calls to hold the encoded payload
+*/
+void writeBinaryProcessBlock(std::ostream& stream, const RecordBlock& block, const std::vector<RecordProcess>& known_processes, std::vector<unsigned char>& scratch);
+
+/**
+* Writes the finished buckets of a rollup tier to a binary recording
+* The bucket times are followed by the minimum, maximum, average and last values of every column and the checksum of the block
+* @param stream The binary stream to write to
+* @param block The buckets to write
+*/
+void writeBinaryRollupBlock(std::ostream& stream, const RecordRollupBlock& block);
+
+/**
+* Reads the next block of a binary recording if it is a rollup block
+* The stream is left at the beginning of the next block if it is not a rollup block
+* @param stream The binary stream to read from
+* @param block Receives the buckets of the block in row major order
+* @param schema_columns The number of columns in the schema of the recording, a block with more is corrupted
+* @return false if the next block is not a complete rollup block or its header does not fit the schema and the rest of the stream
+*/
+bool readBinaryRollupBlock(std::istream& stream, RecordRollupBlock& block, const unsigned int schema_columns);
+
+/**
+* Adds every value of a block to the sketch of its column
+* @param block The block to add
+* @param sketches The sketches of every column, resized to the number of columns if needed
+*/
+void updateRecordSummary(const RecordBlock& block, std::vector<QuantileSketch>& sketches);
+
+/**
+* Writes the count, minimum, maximum and percentiles of every column after the rows of a CSV recording
+* @param stream The stream to write to
+* @param schema The schema of the recording
+* @param sketches The sketches of every column
+*/
+void writeCsvSummary(std::ostream& stream, const RecordSchema& schema, const std::vector<QuantileSketch>& sketches);
+
+/**
+* Writes the sketches of every column to a binary recording followed by the checksum of the block
+* The sketches are stored whole so the summaries of several segments can be merged
+* @param stream The binary stream to write to
+* @param sketches The sketches of every column
+* @param scratch Buffer reused between calls to hold the encoded payload
+*/
+void writeBinarySummaryBlock(std::ostream& stream, const std::vector<QuantileSketch>& sketches, std::vector<unsigned char>& scratch);
+
+/**
+* Reads the next block of a binary recording if it is a summary block
+* The stream is left at the beginning of the next block if it is not a summary block
+* @param stream The binary stream to read from
+* @param sketches Receives the sketches of every column
+* @param schema_columns The number of columns in the schema of the recording, a block with more is corrupted
+* @return false if the next block is not a complete summary block or its header does not fit the schema and the rest of the stream
+*/
+bool readBinarySummaryBlock(std::istream& stream, std::vector<QuantileSketch>& sketches, const unsigned int schema_columns);
+
+/**
+* Reads the file header of a binary recording
+* @param stream The binary stream to read from
+* @param schema Receives the schema of the recording
+* @return false if the stream is not a binary recording
+*/
+bool readBinaryHeader(std::istream& stream, RecordSchema& schema);
+
+/**
+* Reads the next block of a binary recording, compressed blocks are decoded, rollup and summary blocks are skipped
+* @param stream The binary stream to read from
+* @param block Receives the rows of the block in row major order and its processes if they were recorded
+* @param schema_columns The number of columns in the schema of the recording, a block with more is corrupted
+* @return false if there are no more complete blocks, the header of the block does not fit the schema and the rest of the stream or its checksum does not match
+*/
+bool readBinaryBlock(std::istream& stream, RecordBlock& block, const unsigned int schema_columns);
+
+/**
+* Finds how much of a recording left behind by a crash is intact
+* Binary recordings keep every block up to the first truncated or corrupted one, CSV recordings keep every complete line
+* @param stream The binary stream of the recording to check
+* @param format The format of the recording
+* @return The length in bytes the file can be truncated to, 0 if nothing can be recovered
+*/
+unsigned long long findRecoverableLength(std::istream& stream, const RecordFormat format);
+
+/**
+* Converts a binary recording into the CSV layout written by the recorder
+* Recorded processes are written to a second CSV file named like the first one with " - Processes" added, the summary of all rows is written after them
+* @param binaryFileName The path of the binary recording
+* @param csvFileName The path of the CSV file to create
+* @return false if the binary recording could not be read or the CSV file could not be created
+*/
+bool exportBinaryRecordToCsv(const std::string& binaryFileName, const std::string& csvFileName);
+
+/**
+* Writes the same generated rows in every recording format and prints the throughput and size of each
+* @param out The stream to print the results on
+* @param columns The number of values in a row
+* @param rows The number of rows to write
+*/
+void benchmarkRecordFormats(std::ostream& out, const unsigned int columns, const unsigned int rows);
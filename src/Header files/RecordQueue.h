@@ -0,0 +1,133 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <windows.h>
+
+/**
+* A bounded single-producer/single-consumer queue used to hand items from the sampling thread to a worker thread
+* Pushing never blocks, if the queue is full the push fails and the item stays with the caller
+*/
+template <typename T>
+class RecordQueue
+{
+private:
+    /**
+    * Ring buffer holding the queued items
+    */
+    std::vector<std::unique_ptr<T>> slots;
+
+    /**
+    * Index of the oldest item in the ring buffer
+    */
+    size_t head = 0;
+
+    /**
+    * Number of items currently in the ring buffer
+    */
+    size_t count = 0;
+
+    /**
+    * Marks that no more items will be pushed and the consumer should return once the queue is empty
+    */
+    bool closed = 0;
+
+    /**
+    * Protects the members above, only held for the duration of a pointer move
+    */
+    SRWLOCK lock;
+
+    /**
+    * Signaled when an item is pushed or the queue is closed
+    */
+    CONDITION_VARIABLE item_available;
+
+public:
+    /**
+    * @param capacity The maximum number of items the queue can hold
+    */
+    RecordQueue(const size_t capacity) : slots(capacity)
+    {
+        InitializeSRWLock(&lock);
+        InitializeConditionVariable(&item_available);
+    }
+
+    /**
+    * Pushes an item to the back of the queue without blocking
+    * @param item The item to push, moved from only if the push succeeded
+    * @return false if the queue is full or closed
+    */
+    bool tryPush(std::unique_ptr<T>& item)
+    {
+        AcquireSRWLockExclusive(&lock);
+
+        //refuse the item if there is no space or the consumer is shutting down
+        if (count == slots.size() || closed)
+        {
+            ReleaseSRWLockExclusive(&lock);
+            return 0;
+        }
+
+        slots[(head + count) % slots.size()] = std::move(item);
+        count++;
+
+        ReleaseSRWLockExclusive(&lock);
+
+        //wake the consumer
+        WakeConditionVariable(&item_available);
+
+        return 1;
+    }
+
+    /**
+    * Pops an item from the front of the queue, blocks until an item is available or the queue is closed
+    * @param item Receives the popped item
+    * @return false if the queue is closed and empty
+    */
+    bool waitPop(std::unique_ptr<T>& item)
+    {
+        AcquireSRWLockExclusive(&lock);
+
+        //wait for an item or for the queue to be closed
+        while (count == 0 && !closed)
+        {
+            SleepConditionVariableSRW(&item_available, &lock, INFINITE, 0);
+        }
+
+        //nothing left to drain
+        if (count == 0)
+        {
+            ReleaseSRWLockExclusive(&lock);
+            return 0;
+        }
+
+        item = std::move(slots[head]);
+        head = (head + 1) % slots.size();
+        count--;
+
+        ReleaseSRWLockExclusive(&lock);
+
+        return 1;
+    }
+
+    /**
+    * Marks the queue as closed, the consumer drains the remaining items then waitPop() returns false
+    */
+    void close()
+    {
+        AcquireSRWLockExclusive(&lock);
+        closed = 1;
+        ReleaseSRWLockExclusive(&lock);
+
+        WakeAllConditionVariable(&item_available);
+    }
+
+    /**
+    * Opens a closed queue again so it can be reused for a new consumer
+    */
+    void reopen()
+    {
+        AcquireSRWLockExclusive(&lock);
+        closed = 0;
+        ReleaseSRWLockExclusive(&lock);
+    }
+};
@@ -0,0 +1,208 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include "RecordFormat.h"
+
+/**
+* The statistics of a sensor over a time range of a recording
+*/
+struct RecordQueryResult
+{
+    unsigned long long Count = 0;
+    double Min = 0;
+    double Max = 0;
+    double Average = 0;
+
+    /**
+    * The requested percentiles as pairs of the percentile and its value
+    */
+    std::vector<std::pair<double, double>> Percentiles;
+};
+
+/**
+* A point of a trend of a sensor, covers a single row or a bucket of rows
+*/
+struct RecordTrendPoint
+{
+    /**
+    * The time of the row or the start of the bucket in microseconds since the recording started
+    */
+    long long Time = 0;
+
+    double Min = 0;
+    double Max = 0;
+    double Average = 0;
+    double Last = 0;
+};
+
+/**
+* Reads recordings without loading them into memory
+* The file is memory mapped and a sparse time index over its blocks is built when it is opened,
+* queries then only touch the blocks that overlap the requested time range
+* Works on binary recordings and on the CSV layout written by the recorder
+*/
+class RecordReader
+{
+private:
+    /**
+    * An entry of the sparse time index
+    * For binary recordings every block has an entry, for CSV recordings every csv_index_stride rows have an entry
+    */
+    struct IndexEntry
+    {
+        size_t          Offset;
+        unsigned int    Rows;
+        long long       FirstTime;
+        long long       LastTime;
+        bool            Compressed;
+        size_t          PayloadSize;
+    };
+
+    /**
+    * The number of CSV rows covered by a single index entry
+    */
+    const unsigned int csv_index_stride = 1024;
+
+    /**
+    * The mapped file contents
+    */
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    /**
+    * Platform handles of the mapped file
+    */
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+
+    /**
+    * The format of the opened file
+    */
+    RecordFormat record_format = RecordFormat::CSV;
+
+    /**
+    * Marks that the CSV recording has no time column and the row number is used as its time
+    */
+    bool csv_row_number_time = 0;
+
+    /**
+    * The static information and column names of the opened file
+    */
+    RecordSchema schema;
+
+    std::vector<IndexEntry> index;
+
+    /**
+    * The rollup blocks of every tier by the bucket size of the tier in seconds, FirstTime and LastTime cover the whole buckets
+    */
+    std::map<unsigned int, std::vector<IndexEntry>> rollup_index;
+
+    /**
+    * Maps the given file into memory
+    * @return false if the file could not be mapped
+    */
+    bool mapFile(const std::string& fileName);
+
+    /**
+    * Unmaps the current file
+    */
+    void unmapFile();
+
+    /**
+    * Parses the binary header and indexes every block
+    * @return false if the file is not a valid binary recording
+    */
+    bool indexBinary();
+
+    /**
+    * Parses the CSV header and indexes every csv_index_stride rows
+    * @return false if the file is not a CSV recording
+    */
+    bool indexCsv();
+
+    /**
+    * Reads the timestamps and a single column of a block from the mapped file
+    */
+    bool readBinaryColumn(const IndexEntry& entry, const unsigned int column, std::vector<long long>& timestamps, std::vector<float>& values);
+
+    /**
+    * Reads the times and a single column of the rows covered by a CSV index entry
+    */
+    bool readCsvColumn(const IndexEntry& entry, const unsigned int column, std::vector<long long>& timestamps, std::vector<float>& values);
+
+    /**
+    * Reads the bucket times and the statistics of a single column of a rollup block from the mapped file
+    */
+    bool readRollupColumn(const IndexEntry& entry, const unsigned int column, std::vector<long long>& bucket_times, std::vector<float>& statistics);
+
+    /**
+    * Adds every row of a column in the time range to the trend, rows are grouped into buckets of the given size
+    * @param bucket_size The size of a bucket in microseconds, 0 makes every row its own point
+    */
+    bool readRawTrend(const unsigned int column, const long long from, const long long to, const long long bucket_size, std::vector<RecordTrendPoint>& points);
+
+public:
+    ~RecordReader()
+    {
+        close();
+    }
+
+    /**
+    * Opens and indexes a recording
+    * @param fileName The path of the recording
+    * @return false if the file could not be opened or is not a recording
+    */
+    bool open(const std::string& fileName);
+
+    /**
+    * Closes the opened recording
+    */
+    void close();
+
+    /**
+    * @return The static information and column names of the opened recording
+    */
+    const RecordSchema& getSchema();
+
+    /**
+    * Gets the index of a column by its name
+    * @param name The column name as written in the header
+    * @return The index of the column or -1 if it does not exist
+    */
+    int findColumn(const std::string& name);
+
+    /**
+    * Gets the time range covered by the recording
+    * @param first Receives the time of the first row in microseconds since the recording started
+    * @param last Receives the time of the last row in microseconds since the recording started
+    * @return false if the recording has no rows
+    */
+    bool getTimeRange(long long& first, long long& last);
+
+    /**
+    * Calculates the statistics of a column over a time range, missing values are skipped
+    * CSV recordings made before the time columns were added use the row number in seconds as the time of a row
+    * @param column The index of the column
+    * @param from The start of the range in microseconds since the recording started
+    * @param to The end of the range in microseconds since the recording started, inclusive
+    * @param percentiles The percentiles to calculate, between 0 and 100
+    * @param result Receives the statistics
+    * @return false if the column does not exist or the file is corrupted
+    */
+    bool query(const unsigned int column, const long long from, const long long to, const std::vector<double>& percentiles, RecordQueryResult& result);
+
+    /**
+    * Gets the trend of a column over a time range with at most about max_points points
+    * Uses the raw rows if there are few enough of them, otherwise the finest rollup tier that fits,
+    * recordings without rollups are grouped into buckets from the raw rows
+    * @param column The index of the column
+    * @param from The start of the range in microseconds since the recording started
+    * @param to The end of the range in microseconds since the recording started, inclusive
+    * @param max_points The number of points the trend should not go over
+    * @param points Receives the points of the trend ordered by time
+    * @param tier Receives the bucket size of the used rollup tier in seconds, 0 if the raw rows were used
+    * @return false if the column does not exist or the file is corrupted
+    */
+    bool queryTrend(const unsigned int column, long long from, long long to, const unsigned int max_points, std::vector<RecordTrendPoint>& points, unsigned int& tier);
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include "RecordBlock.h"
+
+/**
+* The bucket sizes in seconds of the rollup tiers kept next to the raw rows, every tier is a multiple of the one before it
+*/
+const unsigned int RecordRollupTiers[] = { 60, 3600 };
+
+/**
+* Finished buckets of a single rollup tier
+* Every bucket has the minimum, maximum, average and last value of every column, NaN if the column had no value in the bucket
+*/
+struct RecordRollupBlock
+{
+    /**
+    * The size of a bucket in seconds
+    */
+    unsigned int tier = 0;
+
+    unsigned int columns = 0;
+    unsigned int rows = 0;
+
+    /**
+    * The start of every bucket in microseconds since the recording started
+    */
+    std::vector<long long> bucket_times;
+
+    /**
+    * The statistics of all buckets, row major
+    */
+    std::vector<float> min;
+    std::vector<float> max;
+    std::vector<float> average;
+    std::vector<float> last;
+};
+
+/**
+* Keeps the rollup tiers of a recording up to date as rows arrive
+* Rows only update the buckets of the first tier, every other tier is updated once per finished bucket of the tier before it
+*/
+class RecordRollup
+{
+private:
+    /**
+    * The bucket of a tier that is still receiving values
+    */
+    struct Tier
+    {
+        long long BucketMicroseconds;
+        long long BucketStart;
+        std::vector<float> Min;
+        std::vector<float> Max;
+        std::vector<double> Sum;
+        std::vector<unsigned long long> Count;
+        std::vector<float> Last;
+    };
+
+    unsigned int columns = 0;
+
+    std::vector<Tier> tiers;
+
+    /**
+    * Finished buckets of every tier that have not been taken yet
+    */
+    std::vector<RecordRollupBlock> finished;
+
+    /**
+    * Starts an empty bucket in the given tier
+    */
+    void openBucket(const size_t tier, const long long bucket_start);
+
+    /**
+    * Adds a value to a column of the open bucket of a tier
+    */
+    void addValue(const size_t tier, const unsigned int column, const float min, const float max, const double sum, const unsigned long long count, const float last);
+
+    /**
+    * Moves the open bucket of a tier to the finished buckets and adds it to the next tier
+    */
+    void closeBucket(const size_t tier);
+
+public:
+    /**
+    * Forgets all buckets and starts over for rows of the given width
+    * @param columns The number of values in a row
+    */
+    void reset(const unsigned int columns);
+
+    /**
+    * Adds all rows of a block to the open buckets, buckets are finished once a row past their end arrives
+    * @param block The rows to add
+    */
+    void addBlock(const RecordBlock& block);
+
+    /**
+    * Finishes the open buckets of every tier, used when the recording ends
+    */
+    void finish();
+
+    /**
+    * Takes the buckets finished since the last call, one block per tier that has any
+    * @param blocks Receives the finished buckets
+    */
+    void takeFinished(std::vector<RecordRollupBlock>& blocks);
+};
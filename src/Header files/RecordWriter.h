@@ -0,0 +1,227 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <memory>
+#include <deque>
+#include <unordered_map>
+#include <windows.h>
+#include "RecordBlock.h"
+#include "RecordFormat.h"
+#include "RecordRollup.h"
+#include "RecordQueue.h"
+
+/**
+* When a recording is split into a new segment and how many finished segments are kept
+* Every segment starts with the full schema so it can be read on its own, 0 disables a limit
+*/
+struct RecordRotationPolicy
+{
+    /**
+    * Start a new segment once the current one reaches this size in bytes
+    */
+    unsigned long long MaxSegmentBytes = 0;
+
+    /**
+    * Start a new segment once the current one covers this many seconds
+    */
+    long long MaxSegmentSeconds = 0;
+
+    /**
+    * Delete the oldest segments once the segments of the recording take more than this many bytes
+    */
+    unsigned long long MaxTotalBytes = 0;
+
+    /**
+    * Delete the oldest segments once the recording has more than this many segments
+    */
+    unsigned int MaxSegments = 0;
+
+    /**
+    * @return If the recording is split into segments at all
+    */
+    bool rotates() const
+    {
+        return MaxSegmentBytes != 0 || MaxSegmentSeconds != 0;
+    }
+};
+
+/**
+* Owns the recording file and writes blocks of rows to it on a dedicated thread
+* so that slow storage never stalls the sampling thread
+*/
+class RecordWriter
+{
+private:
+    /**
+    * file output stream used to store the session data, only touched by the writer thread while running
+    */
+    std::ofstream record_stream;
+
+    /**
+    * stores the name of the recording without the extension, segments add their number to it
+    */
+    std::string record_stream_file_name;
+
+    /**
+    * stores the name of the segment being written without the extension
+    */
+    std::string segment_file_name;
+
+    /**
+    * When to start a new segment and how many to keep
+    */
+    RecordRotationPolicy rotation_policy;
+
+    /**
+    * The number of the segment being written, starting at 1
+    */
+    unsigned int segment_number = 0;
+
+    /**
+    * The number of rows written to the current segment and the monotonic time of its first row
+    */
+    unsigned long long segment_rows = 0;
+    long long segment_first_time = 0;
+
+    /**
+    * The finished segments of this recording from oldest to newest with their sizes in bytes
+    */
+    std::deque<std::pair<std::string, unsigned long long>> finished_segments;
+    unsigned long long finished_segments_bytes = 0;
+
+    /**
+    * The static information and column names written at the beginning of the file
+    */
+    RecordSchema schema;
+
+    /**
+    * The format the file is written in
+    */
+    RecordFormat record_format = RecordFormat::CSV;
+
+    /**
+    * Holds the encoded payload of a compressed block, reused between blocks
+    */
+    std::vector<unsigned char> compression_scratch;
+
+    /**
+    * The recorded processes that have not ended yet by their key, stored again at the beginning of every segment
+    */
+    std::unordered_map<unsigned int, RecordProcess> live_processes;
+    std::vector<RecordProcess> known_processes;
+
+    /**
+    * Keeps the minute and hour rollups of the current segment in the binary formats, updated as blocks are written
+    */
+    RecordRollup rollup;
+    std::vector<RecordRollupBlock> rollup_blocks;
+
+    /**
+    * The sketches of every column of the current segment, written as its summary when it is closed
+    */
+    std::vector<QuantileSketch> summary;
+
+    /**
+    * Blocks waiting to be written by the writer thread
+    */
+    RecordQueue<RecordBlock> block_queue;
+
+    /**
+    * Handle of the writer thread, NULL if not running
+    */
+    HANDLE writer_thread = NULL;
+
+    /**
+    * Entry point of the writer thread
+    * @param parameter The RecordWriter object that started the thread
+    */
+    static DWORD WINAPI writerThreadMain(LPVOID parameter);
+
+    /**
+    * creates the next segment and writes the schema to it in the chosen format
+    */
+    void init_stream();
+
+    /**
+    * writes the summary of the segment, closes the output stream and renames the segment to add the final timestamp
+    */
+    void close_stream();
+
+    /**
+    * Writes the rollup buckets that were finished since the last call
+    */
+    void writeRollups();
+
+    /**
+    * Checks the rotation policy before a block is written to the current segment
+    * @param block The block about to be written
+    * @return If the block has to go into a new segment
+    */
+    bool segmentFull(const RecordBlock& block);
+
+    /**
+    * Deletes the oldest finished segments until the retention limits of the rotation policy are met
+    * @param reserved_segments The number of segments about to be written that have to fit in the limits as well
+    */
+    void enforceRetention(const unsigned int reserved_segments);
+
+    /**
+    * Adds an ended sample of every process that is still running to the first row of a block, used when the sampling thread forgot them
+    * @param block The block whose first row ends the processes
+    */
+    void endLiveProcesses(RecordBlock& block);
+
+    /**
+    * Writes all rows of the given block to the stream in the chosen format
+    * @param block The block to write, the processes it ends are added to it
+    */
+    void writeBlock(RecordBlock& block);
+
+public:
+    /**
+    * @param queue_capacity The number of blocks that can wait for the writer thread before blocks get dropped
+    */
+    RecordWriter(const size_t queue_capacity = 64) : block_queue(queue_capacity)
+    {
+    }
+
+    ~RecordWriter()
+    {
+        stop();
+    }
+
+    /**
+    * Recovers the recordings that were left unfinished by a crash
+    * Every file that still has the in progress suffix is truncated to its last valid block and renamed like a finished recording
+    * @param directory The directory the recordings are written to
+    * @return The number of recovered recordings
+    */
+    static unsigned int recoverRecordings(const std::string& directory);
+
+    /**
+    * Starts the writer thread, the file is created on the writer thread
+    * @param fileName The name of the file to create without the extension
+    * @param schema The static information and column names to write at the beginning of the file
+    * @param format The format to write the file in
+    * @param rotationPolicy When to split the recording into segments and how many segments to keep
+    * @return false if the thread could not be started
+    */
+    bool start(const std::string& fileName, const RecordSchema& schema, const RecordFormat format, const RecordRotationPolicy& rotationPolicy = RecordRotationPolicy());
+
+    /**
+    * Hands a block to the writer thread without blocking
+    * @param block The block to write, moved from only if it was accepted
+    * @return false if the queue is full and the block was not accepted
+    */
+    bool submit(std::unique_ptr<RecordBlock>& block);
+
+    /**
+    * Writes all blocks still in the queue, closes the file and joins the writer thread
+    */
+    void stop();
+
+    /**
+    * @return If the writer thread is running
+    */
+    bool isRunning();
+};
@@ -1,8 +1,23 @@
 #pragma once
-#include <fstream>
-#include <queue>
+#include <sstream>
+#include <memory>
+#include <vector>
+#include <map>
 #include "StorageInformation.h"
+#include "DiskActivity.h"
+#include "MemoryActivity.h"
+#include "VolumeSpace.h"
+#include "DiskHealth.h"
 #include "NetworkInformation.h"
+#include "NetworkActivity.h"
+#include "SocketTable.h"
+#include "TcpHealth.h"
+#include "ProcessesInformation.h"
+#include "ProcessRecord.h"
+#include "RecordBlock.h"
+#include "RecordFormat.h"
+#include "RecordWriter.h"
+#include "QuantileSketch.h"
 
 /**
 * Manages the recording and saving of the given data
@@ -11,14 +26,24 @@ class SessionRecorder
 {
 private:
     /**
-    * file output stream used to store the session data
+    * Writes the recorded blocks to the output file on its own thread
     */
-    std::ofstream record_stream;
+    RecordWriter record_writer;
 
     /**
-    * stores the name of the current output file stream
+    * Holds the static information and column headers until the writer thread writes them to the file
     */
-    std::string record_stream_file_name;
+    std::ostringstream preamble_stream;
+
+    /**
+    * The static information and column names of the current recording
+    */
+    RecordSchema record_schema;
+
+    /**
+    * The performance counter value when the recording started, row timestamps are relative to it
+    */
+    LARGE_INTEGER start_counter;
 
     /**
     * Marks the state of the recording now
@@ -31,15 +56,130 @@ private:
     bool column_headers_printed = 0;
 
     /**
-    * creates a csv file with it's name as the current date and time initializes the session_record_stream stream
-    * @return The name of the file created without the extension
+    * The block that rows are currently being added to
+    */
+    std::unique_ptr<RecordBlock> current_block;
+
+    /**
+    * Marks that a row has been started in current_block but not committed yet
+    */
+    bool row_open = 0;
+
+    /**
+    * The column of the first sensor of every hardware in a recorded row
+    */
+    std::vector<unsigned int> hardware_column_offset;
+
+    /**
+    * The number of sensors of every hardware, used to ignore sensors that appeared after the recording started
+    */
+    std::vector<unsigned int> hardware_sensor_count;
+
+    /**
+    * The memory sampler whose metrics are recorded, nullptr if the memory is not recorded
+    */
+    const MemoryActivity* memory_activity = nullptr;
+
+    /**
+    * The column of the first metric of the system memory and of every NUMA node by its number
+    */
+    unsigned int memory_column_offset = 0;
+    std::map<unsigned int, unsigned int> memory_node_column_offset;
+
+    /**
+    * The column of the first activity metric of every physical disk by its key in StorageInformation::PhysicalDisks
+    */
+    std::map<std::wstring, unsigned int> disk_column_offset;
+
+    /**
+    * The column of the first capacity metric of every volume by its key in StorageInformation::Drives
+    */
+    std::map<std::wstring, unsigned int> volume_column_offset;
+
+    /**
+    * The network sampler whose interfaces get columns, nullptr if the traffic is not recorded
+    */
+    const NetworkActivity* network_activity = nullptr;
+
+    /**
+    * The column of the first traffic metric of every network interface by its adapter name
+    */
+    std::map<std::wstring, unsigned int> interface_column_offset;
+
+    /**
+    * Marks if the counts of sockets per state are recorded and the column of the first state
+    */
+    bool record_sockets = 0;
+    unsigned int socket_column_offset = 0;
+
+    /**
+    * Marks if the health of the TCP connections of the system is recorded and the column of its first metric
+    */
+    bool record_tcp_health = 0;
+    unsigned int tcp_health_column_offset = 0;
+
+    /**
+    * The column of the first health metric of every physical disk, only filled when the disk health is recorded
+    */
+    std::map<std::wstring, unsigned int> disk_health_column_offset;
+
+    /**
+    * Marks if the health of the disks is recorded, set when the disk health sampler is enabled
+    */
+    bool record_disk_health = 0;
+
+    /**
+    * Marks if the activity of the disks and the capacity of the volumes are recorded, cleared when their collectors are disabled
+    */
+    bool record_disk_activity = 1;
+    bool record_volume_space = 1;
+
+    /**
+    * The sketch of every recorded column, updated with every value so the percentiles can be shown while recording
+    */
+    std::vector<QuantileSketch> column_sketches;
+
+    /**
+    * The number of values in a recorded row
+    */
+    unsigned int column_count = 0;
+
+    /**
+    * The number of rows collected before the block is handed to the writer thread
+    * Every block is flushed to the file on its own, so this is also the most a crash can lose
+    */
+    unsigned int rows_per_block = 60;
+
+    /**
+    * The number of rows dropped because the writer thread could not keep up
     */
-    void init_stream();
+    unsigned long long dropped_rows = 0;
 
     /**
-    * closes the output stream and renames the file to add the final timestamp
+    * When the recording file is split into segments and how many segments are kept
     */
-    void close_stream();
+    RecordRotationPolicy rotation_policy;
+
+    /**
+    * The name recordings are written to without the extension, empty to name them by the date they started in the Recordings directory
+    */
+    std::string output_file_name;
+
+    /**
+    * Picks the process samples to record every tick
+    */
+    ProcessRecordTracker process_tracker;
+
+    /**
+    * The number of processes in the process table of current_block before the process samples of the open row were added
+    */
+    size_t row_process_table_size = 0;
+
+    /**
+    * Marks if processes should be recorded and if the current recording records them, only binary recordings can
+    */
+    bool record_processes = 0;
+    bool processes_active = 0;
 
     /**
     * Initializes members that need to be reset when the recording state is changed
@@ -47,14 +187,31 @@ private:
     void initRecordingVariables();
 
     /**
-    * Initializes the sizes of the recording bufffer
+    * Gets the time since the recording started using a monotonic clock
+    * @return The elapsed time in microseconds
+    */
+    long long getElapsedMicroseconds();
+
+    /**
+    * Gets the current wall clock time in UTC
+    * @return The time in milliseconds since the unix epoch
     */
-    void initBuffer(OpenHardwareMonitor::Hardware::Computer^ computer);
+    long long getWallTimeMilliseconds();
 
     /**
-    * Prints the names of the sensors to the stream as column headers
+    * Initializes the column layout of the recorded rows and the first block
     */
-    void printColumnHeaders(OpenHardwareMonitor::Hardware::Computer^ computer);
+    void initBuffer(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation);
+
+    /**
+    * Stores the names of the sensors and the disk activity metrics in the schema as column headers
+    */
+    void printColumnHeaders(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation);
+
+    /**
+    * Stores a value in the given column of the current row and adds it to the sketch of the column
+    */
+    void storeValue(const size_t column, const float value);
 
     /**
     * Print all static storage information at the beginning of the file
@@ -71,28 +228,19 @@ private:
     */
     void printStaticInfo(StorageInformation& storageInformation, NetworkInformation& networkInformation);
 public:
-    /**
-    * Buffer for session recording
-    * first dimension is hardware index
-    * the second dimension is sensor index
-    * third dimension is the data
-    */
-    std::vector<std::vector<std::queue<float>>> record_buffer;
-
     /**
     * deconstructor
     */
     ~SessionRecorder()
     {
-        close_stream();
+        stopRecording();
     }
 
     /**
-    * Constructor initializes the stream if called
+    * Constructor
     */
     SessionRecorder()
     {
-        //init_stream();
     }
 
     /**
@@ -101,23 +249,177 @@ public:
     */
     bool isRecording();
 
+    /**
+    * @return If processes are recorded in the current recording
+    */
+    bool isRecordingProcesses();
+
+    /**
+    * Getter for the dropped_rows counter
+    * @return The number of rows dropped since the recording started because the writer thread could not keep up
+    */
+    unsigned long long getDroppedRows();
+
+    /**
+    * Sets when recordings are split into segments and how many segments are kept, applies to recordings started afterwards
+    * @param policy The rotation and retention limits
+    */
+    void setRotationPolicy(const RecordRotationPolicy& policy);
+
+    /**
+    * Sets the file recordings are written to, applies to recordings started afterwards
+    * @param fileName The path of the recording, the extension of the format is added if it is missing, empty to name recordings by the date they started
+    */
+    void setOutputFileName(const std::string& fileName);
+
+    /**
+    * Sets if processes are recorded, applies to binary recordings started afterwards
+    * @param enabled If processes should be recorded
+    * @param top_count The number of busiest processes by CPU and by memory that are recorded every tick even if they did not change
+    */
+    void setProcessRecording(const bool enabled, const unsigned int top_count = 10);
+
+    /**
+    * Sets if the health of the physical disks is recorded, applies to recordings started afterwards
+    * @param enabled If the disk health should be recorded
+    */
+    void setDiskHealthRecording(const bool enabled);
+
+    /**
+    * Sets the memory sampler whose metrics are recorded, applies to recordings started afterwards
+    * @param memoryActivity The sampler that knows the NUMA nodes to make columns for, nullptr to not record the memory
+    */
+    void setMemoryRecording(const MemoryActivity* memoryActivity);
+
+    /**
+    * Sets the network sampler whose traffic is recorded, applies to recordings started afterwards
+    * @param networkActivity The sampler that knows the interfaces to make columns for, nullptr to not record the traffic
+    */
+    void setNetworkActivityRecording(const NetworkActivity* networkActivity);
+
+    /**
+    * Sets if the counts of sockets per state are recorded, applies to recordings started afterwards
+    * @param enabled If the socket counts should be recorded
+    */
+    void setSocketRecording(const bool enabled);
+
+    /**
+    * Sets if the health of the TCP connections of the system is recorded, applies to recordings started afterwards
+    * @param enabled If the TCP health should be recorded
+    */
+    void setTcpHealthRecording(const bool enabled);
+
+    /**
+    * Sets if the activity of the physical disks is recorded, applies to recordings started afterwards
+    * @param enabled If the disk activity should be recorded
+    */
+    void setDiskActivityRecording(const bool enabled);
+
+    /**
+    * Sets if the capacity of the volumes is recorded, applies to recordings started afterwards
+    * @param enabled If the volume capacity should be recorded
+    */
+    void setVolumeSpaceRecording(const bool enabled);
+
+    /**
+    * Sets how many rows are collected before they are written to the file as one checksummed block, applies to recordings started afterwards
+    * @param rows The number of rows in a block, fewer rows lose less data on a crash but add more writes
+    */
+    void setCheckpointRows(const unsigned int rows);
+
     /**
     * Starts the recording of current session
+    * @param format The format to write the recording in
     */
-    void startRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation);
+    void startRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation, const RecordFormat format = RecordFormat::CSV);
 
     /**
-    * Stops the recording of the current session
+    * Stops the recording of the current session, waits for all recorded rows to be written
     */
     void stopRecording();
 
     /**
     * Toggles the recording of the current session
+    * @param format The format to write the recording in if it gets started
+    */
+    void toggleRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation, const RecordFormat format = RecordFormat::CSV);
+
+    /**
+    * Starts the row of the current tick with its monotonic and wall clock time, every value starts as missing
+    */
+    void beginRow();
+
+    /**
+    * Stores a sensor value in the current row, NaN marks a sensor without a value
+    * @param hardware_index The index of the hardware in the computer object
+    * @param sensor_index The index of the sensor in the hardware
+    * @param value The value of the sensor
+    */
+    void recordValue(const int hardware_index, const int sensor_index, const float value);
+
+    /**
+    * Stores the metrics of the system memory and every NUMA node in the current row
+    * @param memoryActivity The memory activity updated for this tick
+    */
+    void recordMemory(MemoryActivity& memoryActivity);
+
+    /**
+    * Stores the activity metrics of every physical disk in the current row
+    * @param diskActivity The disk activity updated for this tick
+    */
+    void recordDiskActivity(DiskActivity& diskActivity);
+
+    /**
+    * Stores the capacity metrics of every volume in the current row
+    * @param volumeSpace The volume space updated for this tick
+    */
+    void recordVolumeSpace(VolumeSpace& volumeSpace);
+
+    /**
+    * Stores the traffic metrics of every network interface in the current row
+    * @param networkActivity The network activity updated for this tick
+    */
+    void recordNetworkActivity(NetworkActivity& networkActivity);
+
+    /**
+    * Stores the number of sockets in every state in the current row
+    * @param socketTable The socket table updated for this tick
+    */
+    void recordSockets(SocketTable& socketTable);
+
+    /**
+    * Stores the health of the TCP connections of the system in the current row
+    * @param tcpHealth The TCP health sampler updated for this tick
+    */
+    void recordTcpHealth(const TcpHealth& tcpHealth);
+
+    /**
+    * Stores the last health read from every physical disk in the current row
+    * @param diskHealth The disk health updated for this tick
+    */
+    void recordDiskHealth(DiskHealth& diskHealth);
+
+    /**
+    * Gets the sketch of the values a sensor had since the recording started
+    * @param hardware_index The index of the hardware in the computer object
+    * @param sensor_index The index of the sensor in the hardware
+    * @return The sketch, nullptr if the sensor is not being recorded
+    */
+    const QuantileSketch* getSensorSketch(const int hardware_index, const int sensor_index);
+
+    /**
+    * Stores the processes of the current row, only the processes that changed or are among the busiest are kept
+    * @param processesInformation The processes with their dynamic info updated for this tick
+    */
+    void recordProcesses(ProcessesInformation& processesInformation);
+
+    /**
+    * Ends the current row, hands the block to the writer thread once it is full
     */
-    void toggleRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation);
+    void commitRow();
 
     /**
-    * Flushes the contents of session_record_buffer to the session_record_stream stream
+    * Hands the rows collected so far to the writer thread without waiting for them to be written
     */
     void flush_buffer();
 };
\ No newline at end of file
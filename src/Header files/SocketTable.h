@@ -0,0 +1,277 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "PlatformSessions.h"
+
+/**
+* The state of a socket, the TCP states and a single state for every UDP socket
+*/
+enum class SocketState : unsigned char
+{
+	Established,
+	SynSent,
+	SynReceived,
+	FinWait1,
+	FinWait2,
+	TimeWait,
+	Closed,
+	CloseWait,
+	LastAck,
+	Listen,
+	Closing,
+	Udp
+};
+
+/**
+* The name of every socket state in the order of SocketState
+*/
+const char* const SocketStateNames[] = { "Established", "SYN Sent", "SYN Received", "FIN Wait 1", "FIN Wait 2", "TIME_WAIT", "Closed", "CLOSE_WAIT", "Last ACK", "Listen", "Closing", "UDP" };
+
+const unsigned int SocketStateCount = sizeof(SocketStateNames) / sizeof(SocketStateNames[0]);
+
+/**
+* Takes snapshots of the TCP and UDP sockets of the system with their state, queues and owning process
+* Uses GetExtendedTcpTable and GetExtendedUdpTable on Windows and sock_diag netlink dumps on Linux
+* The counts per state and per process are updated from the sockets that appeared, changed or went away since the previous snapshot instead of being counted again
+*/
+class SocketTable
+{
+public:
+	/**
+	* What tells a socket apart from every other socket of the system
+	*/
+	struct SocketKey
+	{
+		unsigned char		Protocol;
+		unsigned char		Family;
+		unsigned short		LocalPort;
+		unsigned short		RemotePort;
+		unsigned char		LocalAddress[16];
+		unsigned char		RemoteAddress[16];
+
+		/**
+		* The socket cookie on Linux, it tells apart the sockets that share their ports like with SO_REUSEPORT
+		* The owning process on Windows, which has no cookie
+		*/
+		unsigned long long	Cookie;
+
+		bool operator==(const SocketKey& other) const;
+	};
+
+	struct SocketKeyHash
+	{
+		size_t operator()(const SocketKey& key) const;
+	};
+
+	struct Socket
+	{
+		SocketState			State;
+
+		/**
+		* The bytes waiting to be read and to be sent, always 0 on Windows which does not report them
+		* The queue of a listening socket is its backlog of connections waiting to be accepted
+		*/
+		unsigned int		ReceiveQueue;
+		unsigned int		SendQueue;
+
+		/**
+		* The owning process, 0 if it is not known or the socket belongs to no process like the ones in TIME_WAIT
+		*/
+		unsigned int		ProcessID;
+
+		/**
+		* The inode of the socket on Linux, 0 for the sockets that have no file anymore
+		*/
+		unsigned long long	Inode;
+
+		/**
+		* The snapshot the socket was last seen in
+		*/
+		unsigned long long	Generation;
+	};
+
+	/**
+	* The sockets owned by a process
+	*/
+	struct ProcessSockets
+	{
+		unsigned int		Sockets = 0;
+		unsigned int		Established = 0;
+		unsigned int		Listening = 0;
+
+		/**
+		* The name of the process, read the first time getProcessName() asks for it
+		*/
+		std::wstring		Name;
+		bool				NameRead = 0;
+	};
+
+private:
+	std::unordered_map<SocketKey, Socket, SocketKeyHash> sockets;
+
+	/**
+	* The sockets of every process by its ID, the processes without a socket are removed
+	*/
+	std::unordered_map<unsigned int, ProcessSockets> processes;
+
+	unsigned int state_counts[SocketStateCount] = {};
+
+	unsigned long long generation = 0;
+
+	/**
+	* Counts a socket that was added to or removed from the table in its state and its process
+	* @param change 1 when the socket was added, -1 when it was removed
+	*/
+	void countSocket(const Socket& socket, const int change);
+
+	/**
+	* Adds a socket of the current snapshot or updates the one that was already in the table
+	*/
+	void addSocket(const SocketKey& key, const SocketState state, const unsigned int receiveQueue, const unsigned int sendQueue, const unsigned int processID, const unsigned long long inode);
+
+
+#ifdef _WIN32
+	/**
+	* The buffer every table is read into, kept between snapshots so a busy host does not allocate it every time
+	*/
+	std::vector<unsigned char> table_buffer;
+#else
+	std::string proc_root = "/proc";
+
+	PlatformSessions& sessions;
+
+	/**
+	* The buffer every netlink answer is received into, grown to fit the biggest message and reused by every dump
+	*/
+	std::vector<char> netlink_buffer;
+
+	/**
+	* The sequence number of the current dump from the sessions, the answers left over from a dump that timed out are skipped
+	*/
+	unsigned int sequence = 0;
+
+	/**
+	* The owning process of every socket inode found in the file descriptors of the processes
+	*/
+	std::unordered_map<unsigned long long, unsigned int> inode_owners;
+
+	/**
+	* The inodes of the sockets the last scan found no owner for, they belong to processes that cannot be looked into
+	* A scan is only worth it once a socket that is not one of them has no owner
+	*/
+	std::unordered_set<unsigned long long> unowned_inodes;
+
+	/**
+	* The least milliseconds between two scans of the file descriptors of every process
+	* A scan reads a link for every open file of the host, sockets opened in between stay without an owner until the next one
+	*/
+	double owner_scan_interval = 5000;
+
+	/**
+	* The time of the last scan of the file descriptors in milliseconds, negative before the first one
+	*/
+	double last_owner_scan = -1;
+
+	/**
+	* Asks the kernel for every socket of a family and protocol and adds them to the table
+	* @param netlink_socket A NETLINK_SOCK_DIAG socket
+	* @return false if the request could not be sent or the answer was cut short
+	*/
+	bool dumpSockets(const int netlink_socket, const unsigned char family, const unsigned char protocol);
+
+	/**
+	* Finds the owner of every socket inode by going through the file descriptors of every process
+	*/
+	void scanOwners();
+
+	/**
+	* Gives the sockets without an owner the one a scan of the file descriptors finds, scanning only when a socket that was not looked for before has none
+	*/
+	void findOwners();
+#endif
+
+public:
+#ifdef _WIN32
+	SocketTable(PlatformSessions& sessions)
+	{
+	}
+#else
+	/**
+	* @param sessions The sessions that hold the sock_diag socket and the /proc directory
+	*/
+	SocketTable(PlatformSessions& sessions) : sessions(sessions)
+	{
+	}
+
+	/**
+	* Reads the owners of the sockets from under the given directory instead of /proc, used to test against fake processes
+	* @param sessions The sessions that hold the sock_diag socket
+	* @param proc_root The directory that takes the place of /proc
+	* @param ownerScanInterval The least milliseconds between two scans of the file descriptors
+	*/
+	SocketTable(PlatformSessions& sessions, const std::string& proc_root, const double ownerScanInterval) : proc_root(proc_root), sessions(sessions), owner_scan_interval(ownerScanInterval)
+	{
+	}
+
+	/**
+	* Adds the sockets in a sock_diag answer to the current snapshot, used by update() and to replay a recorded dump
+	* @param buffer The messages as received from the socket
+	* @param length The length of the messages
+	* @param protocol The protocol the dump was asked for, the answers do not tell
+	* @param sequence The sequence number of the request, the messages left over from other requests are skipped, 0 to take every message
+	* @return false once the answer is done or failed, true if more messages follow
+	*/
+	bool parseDiagMessages(const char* buffer, const size_t length, const unsigned char protocol, const unsigned int sequence);
+#endif
+
+	SocketTable(const SocketTable&) = delete;
+	SocketTable& operator=(const SocketTable&) = delete;
+
+	/**
+	* Starts a new snapshot, the sockets that are not added to it again are closed, used by update() and to replay recorded dumps
+	*/
+	void startSnapshot();
+
+	/**
+	* Finishes the current snapshot, removes the sockets that were closed and looks for the owners of the new ones on Linux
+	* @param complete If every socket of the system was added, a snapshot that missed some keeps the sockets it did not see
+	*/
+	void finishSnapshot(const bool complete);
+
+	/**
+	* Takes a new snapshot of the sockets and updates the counts from the previous one
+	*/
+	void update();
+
+	/**
+	* @return Every socket of the last snapshot by its key
+	*/
+	const std::unordered_map<SocketKey, Socket, SocketKeyHash>& getSockets() const;
+
+	/**
+	* @return The number of sockets in a state
+	*/
+	unsigned int getStateCount(const SocketState state) const;
+
+	/**
+	* Finds the sockets of a process, used to join the table with the processes
+	* @return The sockets of the process, nullptr if it owns none
+	*/
+	const ProcessSockets* findProcess(const unsigned int processID) const;
+
+	/**
+	* Gets the processes that own the most sockets
+	* @param count The number of processes to get
+	* @return The IDs of the processes and their socket counts, the most sockets first
+	*/
+	std::vector<std::pair<unsigned int, unsigned int>> getTopProcesses(const size_t count) const;
+
+	/**
+	* Gets the name of a process that owns sockets, it is read once and kept until the process has no sockets left
+	* @return The name, empty if it could not be read
+	*/
+	const std::wstring& getProcessName(const unsigned int processID);
+};
@@ -2,6 +2,10 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
+#include <functional>
+#include "DeviceProbes.h"
+#include "PlatformSessions.h"
 
 /**
 * Gets and stores all available static information about system drives and physical disks
@@ -21,6 +25,13 @@ class StorageInformation
 		unsigned long	Cylinders_QuadPart;
 		std::wstring	VolumeType;
 		std::wstring	VolumeName;
+		std::wstring	Device;
+		std::wstring	FileSystem;
+
+		/**
+		* The drive did not answer its probe before the deadline, only what is known without asking the drive is filled in until it does
+		*/
+		bool			ProbeTimedOut;
 	};
 
 	/**
@@ -42,50 +53,255 @@ class StorageInformation
 		std::wstring			FriendlyName;
 	};
 
+public:
+	/**
+	* The devices that were added, removed or updated by a refresh
+	*/
+	struct StorageChanges
+	{
+		std::vector<std::wstring>	AddedDrives;
+		std::vector<std::wstring>	RemovedDrives;
+		std::vector<std::wstring>	UpdatedDrives;
+		std::vector<std::wstring>	AddedDisks;
+		std::vector<std::wstring>	RemovedDisks;
+
+		/**
+		* @return If nothing changed
+		*/
+		bool empty() const;
+
+		/**
+		* Adds the changes of another refresh to these
+		*/
+		void append(const StorageChanges& changes);
+	};
+
+private:
+#ifdef _WIN32
+	/**
+	* Initializes BytesPerSector and Cylinders_QuadPart members in the given Drive struct
+	* @param Volume The volume to query, the drive letter followed by a colon
+	* @param drive The drive to initialize
+	*/
+	static void InitDiskGeometry(const std::wstring& Volume, Drive& drive);
+
 	/**
-	* Initializes BytesPerSector and Cylinders_QuadPart members in the Drive struct for the given DriveLetter in the Drives std::map
-	* @param DriveLetter The drive letter to initialize in the Drives std::map
+	* Initializes VolumeType member in the given Drive struct
+	* @param Volume The volume to query, the drive letter followed by a colon
+	* @param drive The drive to initialize
 	*/
-	void InitDiskGeometry(const wchar_t DriveLetter);
+	static void InitDriveType(const std::wstring& Volume, Drive& drive);
 
 	/**
-	* Initializes VolumeType member in the Drive struct for the given DriveLetter in the Drives std::map
-	* @param DriveLetter The drive letter to initialize in the Drives std::map
+	* Initializes VolumeName, VolumeSerialNumber and FileSystem in the given Drive struct
+	* @param Volume The volume to query, the drive letter followed by a colon
+	* @param drive The drive to initialize
 	*/
-	void InitDriveType(const wchar_t DriveLetter);
+	static void InitVolumeInfo(const std::wstring& Volume, Drive& drive);
 
 	/**
-	* Initializes VolumeName and VolumeSerialNumber in the Drive struct for the given DriveLetter in the Drives std::map
-	* @param DriveLetter The drive letter to initialize in the Drives std::map
+	* Queries all available physical disks from WMI
+	* @param sessions The sessions that hold the connection to WMI
+	* @param physicalDisks The std::map to add the disks to
+	* @return false if WMI could not be asked or the query failed, the disks added so far are not all of them
 	*/
-	void InitVolumeInfo(const wchar_t DriveLetter);
+	static bool QueryPhysicalDisks(PlatformSessions& sessions, std::map<std::wstring, PhysicalDisk>& physicalDisks);
+#else
+	/**
+	* The root of the sysfs tree and the mountinfo file the information is read from, can point to a fake tree for testing
+	*/
+	std::string sysfs_root = "/sys";
+	std::string mountinfo_path = "/proc/self/mountinfo";
+
+	/**
+	* The descriptor of sysfs_root every attribute is read relative to, owned by the sessions
+	*/
+	int sysfs_directory = -1;
+
+	/**
+	* Initializes BytesPerSector and VolumeType in the given Drive struct from the block device it is mounted from
+	* @param drive The drive to initialize
+	* @param DeviceNumber The "major:minor" number of the mounted block device
+	*/
+	void InitBlockDeviceInfo(Drive& drive, const std::string& DeviceNumber);
+
+	/**
+	* Initializes the given PhysicalDisk struct from the sysfs entry of the disk
+	* @param name The kernel name of the disk
+	* @param disk The disk to initialize
+	*/
+	void InitPhysicalDisk(const std::string& name, PhysicalDisk& disk);
+#endif
 
 	/**
-	* Initializes the Drive struct for all available drives in the Drives std::map
-	* @param DriveLetter The drive letter to initialize in the Drives std::map
+	* Runs the probes of the drives and physical disks concurrently, a device that does not respond only delays the startup until the deadline
 	*/
-	void InitDrives();
+	DeviceProbes probes;
+	unsigned int probe_timeout;
 
 	/**
-	* Initializes the PhysicalDisks std::vector with all available physical disks
+	* The sessions shared with the other collectors, the probes hold their own reference so one that hangs can outlive this object
 	*/
-	void InitPhysicalDisks();
+	std::shared_ptr<PlatformSessions> sessions;
+
+	/**
+	* Opens the sessions that are needed and reads every device
+	*/
+	void init();
+
+	/**
+	* A running probe and the result it writes into, every probe owns its copy so one that finishes late never touches Drives or PhysicalDisks
+	*/
+	template <typename T>
+	struct RunningProbe
+	{
+		unsigned long long		ID;
+		std::shared_ptr<T>		Result;
+	};
+
+	/**
+	* The physical disks listed by a query, they only replace PhysicalDisks if the query succeeded
+	*/
+	struct PhysicalDiskQuery
+	{
+		bool									Succeeded = 0;
+		std::map<std::wstring, PhysicalDisk>	PhysicalDisks;
+	};
+
+	std::map<std::wstring, RunningProbe<Drive>> probed_drives;
+	RunningProbe<PhysicalDiskQuery> probed_physical_disks = {};
+
+	/**
+	* Marks that the physical disks changed while they were being queried, they are queried again once the running query finishes
+	*/
+	bool physical_disks_changed = 0;
+
+	/**
+	* Fills in everything about a drive that has to ask the drive itself, it can block for as long as the drive does not respond
+	* On Windows that is the geometry, the type and the volume information, on Linux the file system ID
+	* @param Volume The volume to query
+	* @param drive The drive to initialize
+	*/
+	static void ProbeDrive(const std::wstring& Volume, Drive& drive);
+
+	/**
+	* The probe every drive is filled in by, ProbeDrive() unless a test put a drive that never answers in its place
+	*/
+	std::function<void(const std::wstring&, Drive&)> drive_probe = ProbeDrive;
+
+	/**
+	* Starts the probe of a drive in the Drives std::map, its result is merged back once it finishes
+	* @param Volume The volume key of the drive
+	*/
+	void startDriveProbe(const std::wstring& Volume);
+
+	/**
+	* Merges the results of the probes that finished since the last call
+	* @param changes Receives the drives that were updated and the physical disks that were added or removed
+	*/
+	void mergeFinishedProbes(StorageChanges& changes);
+
+	/**
+	* Waits for the probes up to the deadline, marks the devices that did not answer in time as timed out
+	*/
+	void waitForProbes();
+
+	/**
+	* Reads the list of available drives and everything about them that is known without asking the drives themselves
+	* On Windows every drive letter in use is a drive, on Linux every mount of a block device or a network file system, pseudo file systems are skipped
+	* @param drives The std::map to add the drives to
+	*/
+	void ReadDriveList(std::map<std::wstring, Drive>& drives);
 
 public:
 
 	/**
-	* A std::map storing all available drives as a Drive object with the key being the drive letter
+	* A std::map storing all available drives as a Drive object with the key being the volume
+	* The volume is the drive letter followed by a colon on Windows and the mount point on Linux
 	*/
-	std::map<wchar_t, Drive> Drives;
+	std::map<std::wstring, Drive> Drives;
 
 	/**
-	* A std::map of all available physical disks as a PhysicalDrive object with the key being the Friendly Name
+	* A std::map of all available physical disks as a PhysicalDrive object with the key being the Friendly Name on Windows and the kernel device name on Linux
 	*/
 	std::map<std::wstring, PhysicalDisk> PhysicalDisks;
 
-	StorageInformation()
+	/**
+	* The physical disks did not answer their probe before the deadline, PhysicalDisks stays empty until they do
+	*/
+	bool PhysicalDisksTimedOut = 0;
+
+	/**
+	* The time every device gets to answer its probe by default in milliseconds
+	*/
+	static const unsigned int DefaultProbeTimeout = 3000;
+
+	/**
+	* Creates an inventory without any devices, used when the storage collector is disabled
+	*/
+	StorageInformation() : probe_timeout(0)
+	{
+	}
+
+	/**
+	* @param sessions The sessions shared with the other collectors
+	* @param probe_timeout The time every device gets to answer its probe in milliseconds, the devices are probed concurrently
+	*/
+	StorageInformation(std::shared_ptr<PlatformSessions> sessions, const unsigned int probe_timeout = DefaultProbeTimeout) : probe_timeout(probe_timeout), sessions(sessions)
+	{
+		init();
+	}
+
+#ifndef _WIN32
+	/**
+	* Reads the storage information from the given sysfs tree and mountinfo file instead of the ones of the running system
+	* @param sessions The sessions shared with the other collectors
+	* @param sysfs_root The directory that takes the place of /sys
+	* @param mountinfo_path The file that takes the place of /proc/self/mountinfo
+	* @param probe_timeout The time every device gets to answer its probe in milliseconds
+	*/
+	StorageInformation(std::shared_ptr<PlatformSessions> sessions, const std::string& sysfs_root, const std::string& mountinfo_path, const unsigned int probe_timeout = DefaultProbeTimeout) : sysfs_root(sysfs_root), mountinfo_path(mountinfo_path), probe_timeout(probe_timeout), sessions(sessions)
+	{
+		init();
+	}
+
+	/**
+	* Reads the storage information from the given sysfs tree and mountinfo file and fills in the drives with the given probe instead of asking them, used to test drives that do not answer
+	* @param sessions The sessions shared with the other collectors
+	* @param sysfs_root The directory that takes the place of /sys
+	* @param mountinfo_path The file that takes the place of /proc/self/mountinfo
+	* @param probe_timeout The time every device gets to answer its probe in milliseconds
+	* @param drive_probe Takes the place of ProbeDrive(), everything it writes must be owned by the drive it is given
+	*/
+	StorageInformation(std::shared_ptr<PlatformSessions> sessions, const std::string& sysfs_root, const std::string& mountinfo_path, const unsigned int probe_timeout, std::function<void(const std::wstring&, Drive&)> drive_probe) : sysfs_root(sysfs_root), mountinfo_path(mountinfo_path), probe_timeout(probe_timeout), sessions(sessions), drive_probe(drive_probe)
 	{
-		InitDrives();
-		InitPhysicalDisks();
+		init();
 	}
+#endif
+
+	/**
+	* Reads the list of drives again, drives that appeared are added and probed and drives that are gone are removed
+	* The drives that are still there are left as they are and not probed again
+	* @return The drives that were added or removed, a drive whose device or file system changed is both
+	*/
+	StorageChanges refreshDrives();
+
+	/**
+	* Reads the list of physical disks again, disks that appeared are added and disks that are gone are removed
+	* On Linux only the new disks are read from sysfs, on Windows the WMI query runs in the background and its changes come from collectLateProbes()
+	* @return The disks that were added or removed
+	*/
+	StorageChanges refreshPhysicalDisks();
+
+	/**
+	* Merges the results of the probes that finished since the last call, without waiting for the ones still running
+	* @return The drives whose probe finished and the physical disks that were added or removed by a query that finished
+	*/
+	StorageChanges collectLateProbes();
+
+	/**
+	* Checks if the probe of a drive is still running
+	* @param Volume The volume key of the drive
+	*/
+	bool isProbing(const std::wstring& Volume) const;
 };
\ No newline at end of file
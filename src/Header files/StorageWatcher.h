@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "PlatformSessions.h"
+
+/**
+* Tells when storage devices are plugged in or removed and when drives are mounted or unmounted
+* Uses device interface notifications and the drive letter mask on Windows, kernel uevents over netlink and the mount table on Linux
+* Nothing is ever waited for, poll() only checks what arrived since the last call
+*/
+class StorageWatcher
+{
+#ifdef _WIN32
+	/**
+	* The notification handles of the disk and the volume device interfaces
+	*/
+	void* disk_notification = nullptr;
+	void* volume_notification = nullptr;
+
+	/**
+	* The changes the notification callbacks reported since the last poll, only read and written atomically
+	*/
+	long pending_changes = 0;
+
+	/**
+	* The drive letters in use at the last poll
+	*/
+	unsigned long logical_drives = 0;
+#else
+	/**
+	* The netlink socket the kernel sends its device events to, owned by the sessions, and the mount table, kept open to be polled
+	* The mount table reports a change to poll() whenever a mount was added or removed since it was last polled
+	*/
+	int uevent_socket = -1;
+	int mountinfo_file = -1;
+
+	/**
+	* Receives a single device event, they are a few hundred bytes
+	*/
+	std::vector<char> uevent_buffer;
+
+	/**
+	* Reads the device events that arrived since the last poll
+	* @return The changes they caused
+	*/
+	unsigned int readDeviceEvents();
+
+	/**
+	* Checks if the mount table changed since the last poll
+	*/
+	bool mountsChanged();
+#endif
+
+public:
+	/**
+	* The kinds of changes poll() reports
+	*/
+	enum Change : unsigned int
+	{
+		DisksChanged = 1,
+		DrivesChanged = 2,
+	};
+
+	/**
+	* @param sessions The sessions the netlink socket of the device events is taken from
+	*/
+	StorageWatcher(PlatformSessions& sessions);
+	~StorageWatcher();
+
+	StorageWatcher(const StorageWatcher&) = delete;
+	StorageWatcher& operator=(const StorageWatcher&) = delete;
+
+	/**
+	* Checks what changed since the last call without waiting
+	* @return The Change flags of what changed, 0 if nothing did
+	*/
+	unsigned int poll();
+
+	/**
+	* Parses a kernel device event as it arrives over netlink, "action@devpath" followed by NUL separated KEY=VALUE pairs
+	* @param message The event
+	* @param size The size of the event in bytes
+	* @return The changes the event causes, a whole disk that was added or removed changes the disks
+	*/
+	static unsigned int parseDeviceEvent(const char* message, const size_t size);
+};
@@ -0,0 +1,365 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <limits>
+#include <unordered_map>
+#include "PlatformSessions.h"
+#include "SocketTable.h"
+
+/**
+* The health of a group of open TCP connections in the last sample
+* The metrics are NaN when the group had no connection that reported them
+*/
+struct TcpHealthMetrics
+{
+	double		Connections = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The smoothed round trip time of the connections in milliseconds, averaged and the worst one
+	*/
+	double		AverageRtt = std::numeric_limits<double>::quiet_NaN();
+	double		MaxRtt = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The average of how much the round trip time of every connection varies in milliseconds
+	*/
+	double		RttVariation = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The segments retransmitted by the open connections since they were opened and their share of the segments they sent in percent
+	*/
+	double		Retransmits = std::numeric_limits<double>::quiet_NaN();
+	double		RetransmitRatio = std::numeric_limits<double>::quiet_NaN();
+
+	/**
+	* The average congestion window in bytes, how much a connection may have in flight before it waits for an acknowledgement
+	*/
+	double		AverageCongestionWindow = std::numeric_limits<double>::quiet_NaN();
+};
+
+/**
+* Describes a member of TcpHealthMetrics so every metric can be shown and recorded the same way
+*/
+struct TcpHealthMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double TcpHealthMetrics::* Value;
+};
+
+/**
+* Every metric of a group of connections in the order they are shown and recorded
+* The type takes the place of the sensor type in the recorded column names
+*/
+const TcpHealthMetricInfo TcpHealthMetricInfos[] =
+{
+	{ "Connections", "Connections", "", &TcpHealthMetrics::Connections },
+	{ "Average RTT", "Latency", "ms", &TcpHealthMetrics::AverageRtt },
+	{ "Max RTT", "Latency", "ms", &TcpHealthMetrics::MaxRtt },
+	{ "RTT Variation", "Latency", "ms", &TcpHealthMetrics::RttVariation },
+	{ "Retransmits", "Retransmits", "segments", &TcpHealthMetrics::Retransmits },
+	{ "Retransmit Ratio", "Retransmits", "%", &TcpHealthMetrics::RetransmitRatio },
+	{ "Average Cwnd", "Congestion", "B", &TcpHealthMetrics::AverageCongestionWindow },
+};
+
+const unsigned int TcpHealthMetricCount = sizeof(TcpHealthMetricInfos) / sizeof(TcpHealthMetricInfos[0]);
+
+/**
+* Samples the round trip time, retransmits and congestion window of every open TCP connection and sums them up for the whole system, per remote address and per process
+* Uses the extended TCP statistics of the IP helper on Windows and the tcp_info of sock_diag netlink dumps on Linux
+* Nothing is kept per connection between samples, the remote addresses and processes are counted in a fixed number of slots so a host with tens of thousands of connections takes as much memory as one with a few
+*/
+class TcpHealth
+{
+public:
+	/**
+	* The statistics of one connection as read from the system
+	*/
+	struct ConnectionSample
+	{
+		/**
+		* The round trip time and its variation in milliseconds, NaN if none was measured yet
+		*/
+		double				Rtt;
+		double				RttVariation;
+
+		unsigned long long	Retransmits;
+
+		/**
+		* The segments sent, 0 if the system does not report them
+		*/
+		unsigned long long	SegmentsSent;
+
+		/**
+		* The congestion window in bytes
+		*/
+		double				CongestionWindow;
+	};
+
+	/**
+	* The remote address of a connection, the port is left out as a server sees every client on another one
+	*/
+	struct EndpointKey
+	{
+		unsigned char		Family;
+		unsigned char		Address[16];
+
+		bool operator==(const EndpointKey& other) const;
+	};
+
+	struct EndpointKeyHash
+	{
+		size_t operator()(const EndpointKey& key) const;
+	};
+
+	struct EndpointHealth
+	{
+		/**
+		* The remote address as text
+		*/
+		std::string			Address;
+		TcpHealthMetrics	Metrics;
+	};
+
+	struct ProcessHealth
+	{
+		unsigned int		ProcessID;
+		TcpHealthMetrics	Metrics;
+	};
+
+private:
+	/**
+	* The sums of the statistics of a group of connections that the metrics are made from
+	*/
+	struct Aggregate
+	{
+		unsigned int		Connections = 0;
+
+		/**
+		* The connections that measured a round trip time, one that is still connecting has none yet
+		*/
+		unsigned int		RttConnections = 0;
+		double				RttSum = 0;
+		double				RttMax = 0;
+		double				RttVariationSum = 0;
+		unsigned long long	Retransmits = 0;
+		unsigned long long	SegmentsSent = 0;
+
+		/**
+		* The retransmits of only the connections that reported their segments sent, the ratio is made from them
+		*/
+		unsigned long long	RatioRetransmits = 0;
+		double				CongestionWindowSum = 0;
+
+		void add(const ConnectionSample& sample);
+		void merge(const Aggregate& other);
+		TcpHealthMetrics getMetrics() const;
+	};
+
+	/**
+	* Counts the connections of the groups that have the most of them in a fixed number of slots (the space saving algorithm)
+	* A group that is not counted yet when the slots are full takes the slot of the group with the fewest connections, whose sums move to Other
+	* The weight a group takes over from the slot it took keeps the groups with the most connections in the slots whatever order the connections come in
+	*/
+	template <typename Key, typename Hash>
+	class BoundedAggregates
+	{
+	public:
+		struct Slot
+		{
+			Key					Group;
+			Aggregate			Sums;
+
+			/**
+			* The connections of the group plus the ones of the groups that had the slot before it, only used to choose the slot to give away
+			*/
+			unsigned long long	Weight;
+		};
+
+	private:
+		size_t capacity;
+		std::vector<Slot> slots;
+		std::unordered_map<Key, size_t, Hash> positions;
+
+	public:
+		/**
+		* The connections of the groups that lost their slot
+		*/
+		Aggregate Other;
+
+		BoundedAggregates(const size_t capacity) : capacity(capacity)
+		{
+			this->slots.reserve(capacity);
+			this->positions.reserve(capacity);
+		}
+
+		/**
+		* Forgets every group, the memory is kept for the next sample
+		*/
+		void clear()
+		{
+			this->slots.clear();
+			this->positions.clear();
+			this->Other = Aggregate();
+		}
+
+		void add(const Key& group, const ConnectionSample& sample)
+		{
+			auto found = this->positions.find(group);
+			if (found != this->positions.end())
+			{
+				Slot& slot = this->slots[found->second];
+				slot.Sums.add(sample);
+				slot.Weight++;
+				return;
+			}
+
+			if (this->slots.size() < this->capacity)
+			{
+				this->positions[group] = this->slots.size();
+				this->slots.push_back(Slot{ group, Aggregate(), 1 });
+				this->slots.back().Sums.add(sample);
+				return;
+			}
+
+			if (this->slots.empty()) return;
+
+			//the slot with the least weight is given away, a scan of the slots is only needed once they are full
+			size_t lightest = 0;
+			for (size_t index = 1; index < this->slots.size(); index++)
+			{
+				if (this->slots[index].Weight < this->slots[lightest].Weight) lightest = index;
+			}
+
+			Slot& slot = this->slots[lightest];
+			this->Other.merge(slot.Sums);
+			this->positions.erase(slot.Group);
+
+			slot.Group = group;
+			slot.Sums = Aggregate();
+			slot.Sums.add(sample);
+			slot.Weight++;
+			this->positions[group] = lightest;
+		}
+
+		const std::vector<Slot>& getSlots() const
+		{
+			return this->slots;
+		}
+	};
+
+	BoundedAggregates<EndpointKey, EndpointKeyHash> endpoints;
+	BoundedAggregates<unsigned int, std::hash<unsigned int>> processes;
+	Aggregate system;
+
+	/**
+	* The socket table the owners of the connections are taken from on Linux, nullptr if the sockets are not sampled
+	*/
+	const SocketTable* socket_table;
+
+	/**
+	* Counts a connection in the system, its remote address and its process
+	* @param processID The owning process, 0 if it is not known
+	*/
+	void addConnection(const unsigned char family, const unsigned char* remoteAddress, const unsigned int processID, const ConnectionSample& sample);
+
+#ifndef _WIN32
+	PlatformSessions& sessions;
+
+	/**
+	* The buffer every netlink answer is received into, grown to fit the biggest message and reused by every dump
+	*/
+	std::vector<char> netlink_buffer;
+
+	/**
+	* The sequence number of the current dump from the sessions, the answers left over from a dump that timed out are skipped
+	*/
+	unsigned int sequence = 0;
+
+	/**
+	* Asks the kernel for the tcp_info of every connection of a family and counts them
+	* @param netlink_socket A NETLINK_SOCK_DIAG socket
+	* @return false if the request could not be sent or the answer was cut short
+	*/
+	bool dumpConnections(const int netlink_socket, const unsigned char family);
+#else
+	/**
+	* The buffer the connection tables are read into, kept between samples so a busy host does not allocate it every time
+	*/
+	std::vector<unsigned char> table_buffer;
+#endif
+
+public:
+	/**
+	* The number of remote addresses and processes that are counted on their own, the rest are only in the system metrics
+	*/
+	static const size_t EndpointSlots = 256;
+	static const size_t ProcessSlots = 256;
+
+	/**
+	* The metrics of every open connection of the system
+	*/
+	TcpHealthMetrics System;
+
+	/**
+	* @param sessions The sessions that hold the sock_diag socket
+	* @param socketTable The socket table to take the owners of the connections from on Linux, nullptr to leave the processes out
+	*/
+#ifdef _WIN32
+	TcpHealth(PlatformSessions& sessions, const SocketTable* socketTable) : endpoints(EndpointSlots), processes(ProcessSlots), socket_table(socketTable)
+	{
+	}
+#else
+	TcpHealth(PlatformSessions& sessions, const SocketTable* socketTable) : endpoints(EndpointSlots), processes(ProcessSlots), socket_table(socketTable), sessions(sessions)
+	{
+	}
+
+	/**
+	* Counts the connections in a sock_diag answer in the current sample, used by update() and to replay a recorded dump
+	* @param buffer The messages as received from the socket
+	* @param length The length of the messages
+	* @param sequence The sequence number of the request, the messages left over from other requests are skipped, 0 to take every message
+	* @return false once the answer is done or failed, true if more messages follow
+	*/
+	bool parseDiagMessages(const char* buffer, const size_t length, const unsigned int sequence);
+#endif
+
+	TcpHealth(const TcpHealth&) = delete;
+	TcpHealth& operator=(const TcpHealth&) = delete;
+
+	/**
+	* Forgets the connections of the last sample, used by update() and to replay recorded dumps
+	*/
+	void startSample();
+
+	/**
+	* Makes the system metrics from the connections counted since startSample()
+	*/
+	void finishSample();
+
+	/**
+	* Reads the statistics of every open connection and sums them up again
+	* On Windows the statistics of a connection are switched on the first time it is seen, which needs administrator rights, it is counted from the next sample
+	*/
+	void update();
+
+	/**
+	* Gets the remote addresses with the most connections
+	* @param count The number of addresses to get
+	* @return The addresses and their metrics, the most connections first
+	*/
+	std::vector<EndpointHealth> getTopEndpoints(const size_t count) const;
+
+	/**
+	* Gets the processes with the most connections
+	* @param count The number of processes to get
+	* @return The processes and their metrics, the most connections first
+	*/
+	std::vector<ProcessHealth> getTopProcesses(const size_t count) const;
+
+	/**
+	* @return The metrics of the connections to the remote addresses that lost their slot to ones with more connections
+	*/
+	TcpHealthMetrics getOtherEndpoints() const;
+};
@@ -0,0 +1,183 @@
+#pragma once
+#include <string>
+#include <map>
+#include <deque>
+#include <memory>
+#include "StorageInformation.h"
+#include "DeviceProbes.h"
+
+/**
+* The capacity of a volume and how fast it is filling up
+* The inode counts are 0 on file systems that do not have a fixed number of them
+*/
+struct VolumeMetrics
+{
+	double		TotalBytes = 0;
+	double		FreeBytes = 0;
+	double		UsedBytes = 0;
+	double		UsedInodes = 0;
+	double		FreeInodes = 0;
+
+	/**
+	* The growth of the used space in bytes per hour over the fill rate window, negative if the volume is being emptied
+	*/
+	double		FillRate = 0;
+
+	/**
+	* The hours until the free space runs out at the current fill rate, NaN if the volume is not filling up
+	*/
+	double		HoursToFull = 0;
+};
+
+/**
+* Describes a member of VolumeMetrics so every metric can be shown and recorded the same way
+*/
+struct VolumeMetricInfo
+{
+	const char*		Name;
+	const char*		Type;
+	const char*		Unit;
+	double VolumeMetrics::* Value;
+};
+
+/**
+* Every metric of a volume in the order they are shown and recorded
+* The type takes the place of the sensor type in the recorded column names
+*/
+const VolumeMetricInfo VolumeMetricInfos[] =
+{
+	{ "Total Space", "Capacity", "B", &VolumeMetrics::TotalBytes },
+	{ "Free Space", "Capacity", "B", &VolumeMetrics::FreeBytes },
+	{ "Used Space", "Capacity", "B", &VolumeMetrics::UsedBytes },
+	{ "Used Inodes", "Inodes", "", &VolumeMetrics::UsedInodes },
+	{ "Free Inodes", "Inodes", "", &VolumeMetrics::FreeInodes },
+	{ "Fill Rate", "Fill Rate", "B/h", &VolumeMetrics::FillRate },
+	{ "Time To Full", "Time", "h", &VolumeMetrics::HoursToFull },
+};
+
+const unsigned int VolumeMetricCount = sizeof(VolumeMetricInfos) / sizeof(VolumeMetricInfos[0]);
+
+/**
+* Samples the capacity and free space of every volume and projects when each one will be full
+* Volumes are sampled every sample_interval milliseconds, the fill rate is the least squares slope of the used space over the samples of the last window_length milliseconds
+* The reads run on their own threads through DeviceProbes, a network share that stops answering never delays the caller
+*/
+class VolumeSpace
+{
+private:
+	/**
+	* The used space of a volume at the time it was sampled
+	*/
+	struct UsageSample
+	{
+		double		TimeMilliseconds;
+		double		UsedBytes;
+	};
+
+	/**
+	* What a read of a volume writes into, it is owned by the read so a read that hangs can be left behind
+	*/
+	struct VolumeRead
+	{
+		VolumeMetrics		Metrics;
+		bool				Succeeded = 0;
+	};
+
+	/**
+	* A volume being sampled
+	*/
+	struct WatchedVolume
+	{
+		std::wstring				Key;
+		std::wstring				RootPath;
+		std::deque<UsageSample>		History;
+
+		/**
+		* The result the running read writes into and the time it was started in milliseconds
+		*/
+		std::shared_ptr<VolumeRead>	Result;
+		double						ReadTime = 0;
+		unsigned long long			ReadID = 0;
+		bool						Reading = 0;
+	};
+
+	std::deque<WatchedVolume> watched_volumes;
+
+	DeviceProbes reads;
+
+	/**
+	* The time between samples and the length of the fill rate window in milliseconds
+	*/
+	double sample_interval;
+	double window_length;
+
+	/**
+	* The time of the last sample in milliseconds, negative before the first one
+	*/
+	double last_sample_time = -1;
+
+	/**
+	* Gets the time from a monotonic clock
+	* @return The time in milliseconds
+	*/
+	static double getTimeMilliseconds();
+
+	/**
+	* Reads the capacity of a volume from the file system, blocks for as long as the file system takes to answer
+	* @return false if the volume could not be read
+	*/
+	static bool readVolume(const std::wstring& rootPath, VolumeMetrics& metrics);
+
+	/**
+	* Fits a line through the used space samples
+	* @return The slope in bytes per hour, 0 if there are not enough samples
+	*/
+	static double estimateFillRate(const std::deque<UsageSample>& history);
+
+	/**
+	* Starts sampling a volume, its metrics are 0 until the next sample
+	* @param key The key of the volume in StorageInformation::Drives
+	*/
+	void addVolume(const std::wstring& key);
+
+	/**
+	* Starts reading the capacity of a volume on its own thread
+	* @param volume The volume to read
+	* @param time The time of the sample the read belongs to
+	*/
+	void startRead(WatchedVolume& volume, const double time);
+
+	/**
+	* Adds the used space of a read that finished to the history of its volume and projects when the volume will be full
+	*/
+	void addSample(WatchedVolume& volume, const VolumeRead& read);
+
+public:
+	/**
+	* The metrics of every volume with the same keys as StorageInformation::Drives
+	*/
+	std::map<std::wstring, VolumeMetrics> Volumes;
+
+	/**
+	* @param storageInformation The volumes to sample
+	* @param sample_interval The time between samples in milliseconds
+	* @param window_length The length of the window the fill rate is estimated over in milliseconds
+	*/
+	VolumeSpace(StorageInformation& storageInformation, const double sample_interval = 10000, const double window_length = 15 * 60000);
+
+	/**
+	* Takes the results of the reads that finished and starts new ones when sample_interval has passed, never waits for a volume
+	* A volume whose last read has not finished yet keeps its last metrics and is skipped until it does
+	* @return If the metrics of any volume changed
+	*/
+	bool update();
+
+	/**
+	* Stops sampling the volumes that were removed and starts sampling the ones that were added, the other volumes keep their history
+	* A drive whose probe is still running or timed out is not sampled until it answers, the read of a volume that was removed is dropped once it finishes
+	* @param storageInformation The drives after they were refreshed
+	* @param changes The changes the refresh reported
+	* @return If any volume was added or removed, the next update samples every volume right away
+	*/
+	bool refresh(StorageInformation& storageInformation, const StorageInformation::StorageChanges& changes);
+};
@@ -0,0 +1,120 @@
+#include "KeyScanner.h"
+#include <cstring>
+#include <algorithm>
+
+KeyScanner::KeyScanner(const std::vector<std::string>& names)
+{
+    for (size_t index = 0; index < names.size(); index++)
+    {
+        this->keys.push_back({ names[index], index, std::string::npos });
+    }
+}
+
+size_t KeyScanner::matchKey(const char* buffer, const size_t length, const size_t offset, const std::string& name)
+{
+    //the key has to start a line and be followed by its separator, MemFree must not match MemFreeX
+    if (offset != 0 && (offset > length || buffer[offset - 1] != '\n')) return std::string::npos;
+    if (offset + name.size() >= length || memcmp(buffer + offset, name.data(), name.size()) != 0) return std::string::npos;
+
+    char separator = buffer[offset + name.size()];
+    if (separator != ':' && separator != ' ' && separator != '\t') return std::string::npos;
+
+    return offset + name.size();
+}
+
+double KeyScanner::parseValue(const char* buffer, const size_t length, size_t offset)
+{
+    while (offset < length && (buffer[offset] == ':' || buffer[offset] == ' ' || buffer[offset] == '\t')) offset++;
+
+    bool negative = offset < length && buffer[offset] == '-';
+    if (negative) offset++;
+
+    unsigned long long value = 0;
+    while (offset < length && buffer[offset] >= '0' && buffer[offset] <= '9')
+    {
+        value = value * 10 + (buffer[offset] - '0');
+        offset++;
+    }
+
+    return negative ? -(double)value : (double)value;
+}
+
+void KeyScanner::calibrate(const char* buffer, const size_t length)
+{
+    for (Key& key : this->keys) key.Offset = std::string::npos;
+
+    size_t line = 0;
+    while (line < length)
+    {
+        for (Key& key : this->keys)
+        {
+            if (key.Offset != std::string::npos || matchKey(buffer, length, line, key.Name) == std::string::npos) continue;
+
+            key.Offset = line;
+            break;
+        }
+
+        const char* line_end = (const char*)memchr(buffer + line, '\n', length - line);
+        if (line_end == nullptr) break;
+
+        line = line_end - buffer + 1;
+    }
+
+    //the keys are looked for in the order they appear, npos sorts the missing keys last
+    std::sort(this->keys.begin(), this->keys.end(), [](const Key& first, const Key& second) { return first.Offset < second.Offset; });
+
+    this->calibrated = 1;
+}
+
+size_t KeyScanner::scan(const char* buffer, const size_t length, double* values)
+{
+    if (!this->calibrated) calibrate(buffer, length);
+
+    size_t found = 0;
+    size_t position = 0;
+
+    //how far the lines moved since the last scan, a wider value moves every line after it
+    long long drift = 0;
+
+    for (Key& key : this->keys)
+    {
+        //the keys that were missing in the first scan stay missing
+        if (key.Offset == std::string::npos) break;
+
+        size_t offset = (size_t)((long long)key.Offset + drift);
+        size_t value_offset = offset >= position ? matchKey(buffer, length, offset, key.Name) : std::string::npos;
+
+        //the key moved further than the lines before it, look at every line between the previous key and the end
+        if (value_offset == std::string::npos)
+        {
+            for (offset = position; offset < length;)
+            {
+                value_offset = matchKey(buffer, length, offset, key.Name);
+                if (value_offset != std::string::npos) break;
+
+                const char* line_end = (const char*)memchr(buffer + offset, '\n', length - offset);
+                if (line_end == nullptr) break;
+
+                offset = line_end - buffer + 1;
+            }
+        }
+
+        //the keys changed their order, find all of them again
+        if (value_offset == std::string::npos)
+        {
+            this->calibrated = 0;
+            return scan(buffer, length, values);
+        }
+
+        drift = (long long)offset - (long long)key.Offset;
+        key.Offset = offset;
+
+        values[key.ValueIndex] = parseValue(buffer, length, value_offset);
+        found++;
+
+        const char* line_end = (const char*)memchr(buffer + value_offset, '\n', length - value_offset);
+        position = line_end != nullptr ? line_end - buffer + 1 : length;
+    }
+
+    return found;
+}
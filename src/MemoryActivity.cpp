@@ -0,0 +1,359 @@
+#include "MemoryActivity.h"
+#include <cmath>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <pdh.h>
+#pragma comment(lib, "pdh.lib")
+#pragma comment(lib, "psapi.lib")
+#else
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#endif
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+#ifdef _WIN32
+/**
+* The counters of the paging activity, added with their English names so they are found whatever the language of the system is
+*/
+static const wchar_t* const WindowsCounterPaths[] =
+{
+    L"\\Memory\\Page Faults/sec",
+    L"\\Memory\\Page Reads/sec",
+    L"\\Memory\\Pages Input/sec",
+    L"\\Memory\\Pages Output/sec",
+    L"\\Memory\\Transition Pages RePurposed/sec",
+    L"\\Memory\\Modified Page List Bytes",
+    L"\\Paging File(_Total)\\% Usage",
+};
+
+enum WindowsCounter : unsigned int { PageFaults, PageReads, PagesInput, PagesOutput, PagesRepurposed, ModifiedBytes, PagingFileUsage };
+
+void MemoryActivity::init()
+{
+    //a system with a single node has nothing to break down
+    ULONG highest_node = 0;
+    if (GetNumaHighestNodeNumber(&highest_node) && highest_node > 0)
+    {
+        for (ULONG node = 0; node <= highest_node; node++)
+        {
+            ULONGLONG available = 0;
+            if (!GetNumaAvailableMemoryNodeEx((USHORT)node, &available)) continue;
+
+            this->node_numbers.push_back(node);
+            this->Nodes[node] = NodeMemoryMetrics();
+        }
+    }
+
+    PDH_HQUERY query = NULL;
+    if (PdhOpenQueryW(NULL, 0, &query) != ERROR_SUCCESS) return;
+
+    this->counter_query = query;
+
+    //a counter that does not exist on this version of Windows stays nullptr and its metric NaN
+    for (const wchar_t* path : WindowsCounterPaths)
+    {
+        PDH_HCOUNTER counter = NULL;
+        this->counters.push_back(PdhAddEnglishCounterW(query, path, 0, &counter) == ERROR_SUCCESS ? counter : nullptr);
+    }
+
+    //the rates are computed by the counters from the previous collection
+    PdhCollectQueryData(query);
+}
+
+MemoryActivity::~MemoryActivity()
+{
+    if (this->counter_query != nullptr) PdhCloseQuery((PDH_HQUERY)this->counter_query);
+}
+
+/**
+* Gets the value of a counter from the last collection
+* @return The value, NaN if the counter does not exist or has no value yet
+*/
+static double getCounterValue(const std::vector<void*>& counters, const WindowsCounter counter)
+{
+    if (counter >= counters.size() || counters[counter] == nullptr) return NaN;
+
+    PDH_FMT_COUNTERVALUE value;
+    if (PdhGetFormattedCounterValue((PDH_HCOUNTER)counters[counter], PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, NULL, &value) != ERROR_SUCCESS) return NaN;
+    if (value.CStatus != PDH_CSTATUS_VALID_DATA && value.CStatus != PDH_CSTATUS_NEW_DATA) return NaN;
+
+    return value.doubleValue;
+}
+
+void MemoryActivity::update()
+{
+    MEMORYSTATUSEX status = {};
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status))
+    {
+        this->System.TotalBytes = (double)status.ullTotalPhys;
+        this->System.AvailableBytes = (double)status.ullAvailPhys;
+        this->System.UsedBytes = (double)(status.ullTotalPhys - status.ullAvailPhys);
+    }
+
+    double page_size = 4096;
+
+    PERFORMANCE_INFORMATION performance = {};
+    if (GetPerformanceInfo(&performance, sizeof(performance)))
+    {
+        page_size = (double)performance.PageSize;
+
+        this->System.CachedBytes = (double)performance.SystemCache * page_size;
+        this->System.CommittedBytes = (double)performance.CommitTotal * page_size;
+
+        //the commit limit is the physical memory and the paging files together
+        this->System.SwapTotalBytes = performance.CommitLimit > performance.PhysicalTotal ? (double)(performance.CommitLimit - performance.PhysicalTotal) * page_size : 0;
+    }
+
+    if (this->counter_query != nullptr && PdhCollectQueryData((PDH_HQUERY)this->counter_query) == ERROR_SUCCESS)
+    {
+        //a page read is a single read from the disk for a hard fault, it can bring in several pages
+        this->System.PageFaultsPerSecond = getCounterValue(this->counters, PageFaults);
+        this->System.MajorFaultsPerSecond = getCounterValue(this->counters, PageReads);
+        this->System.SwapInBytesPerSecond = getCounterValue(this->counters, PagesInput) * page_size;
+        this->System.SwapOutBytesPerSecond = getCounterValue(this->counters, PagesOutput) * page_size;
+        this->System.ReclaimedPerSecond = getCounterValue(this->counters, PagesRepurposed);
+        this->System.DirtyBytes = getCounterValue(this->counters, ModifiedBytes);
+        this->System.SwapUsedBytes = this->System.SwapTotalBytes * getCounterValue(this->counters, PagingFileUsage) / 100;
+    }
+
+    //only the free memory of a node is known
+    for (unsigned int node : this->node_numbers)
+    {
+        ULONGLONG available = 0;
+        if (GetNumaAvailableMemoryNodeEx((USHORT)node, &available)) this->Nodes[node].FreeBytes = (double)available;
+    }
+}
+#else
+/**
+* The keys read from /proc/meminfo, the values are in kB
+*/
+static const std::vector<std::string> MeminfoKeys = { "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "Dirty", "Committed_AS", "SwapTotal", "SwapFree" };
+
+enum MeminfoValue : unsigned int { MemTotal, MemFree, MemAvailable, Buffers, Cached, Dirty, CommittedAS, SwapTotal, SwapFree };
+
+/**
+* The counters read from /proc/vmstat, they only ever grow
+*/
+static const std::vector<std::string> VmstatKeys = { "pgfault", "pgmajfault", "pswpin", "pswpout", "pgscan_kswapd", "pgscan_direct", "pgsteal_kswapd", "pgsteal_direct" };
+
+enum VmstatValue : unsigned int { PageFault, MajorFault, SwapIn, SwapOut, ScanKswapd, ScanDirect, StealKswapd, StealDirect };
+
+/**
+* The keys of the meminfo of a node after its "Node <number> " prefix, the values are in kB
+*/
+static const std::vector<std::string> NodeMeminfoKeys = { "MemTotal", "MemFree", "MemUsed", "FilePages", "AnonPages" };
+
+enum NodeMeminfoValue : unsigned int { NodeTotal, NodeFree, NodeUsed, NodeFilePages, NodeAnonPages };
+
+/**
+* The allocation counters of a node in its numastat
+*/
+static const std::vector<std::string> NumastatKeys = { "numa_miss", "local_node", "other_node" };
+
+enum NumastatValue : unsigned int { NumaMiss, LocalNode, OtherNode };
+
+/**
+* Turns the difference between two samples of a counter into a rate
+* @return The rate, NaN if either sample is missing or the counter went backwards
+*/
+static double getRate(const double current, const double previous, const double seconds)
+{
+    if (std::isnan(current) || std::isnan(previous) || seconds <= 0 || current < previous) return NaN;
+
+    return (current - previous) / seconds;
+}
+
+/**
+* Adds two counters that are split in the kernel, either of them can be missing on older kernels
+*/
+static double addCounters(const double first, const double second)
+{
+    if (std::isnan(first)) return second;
+    if (std::isnan(second)) return first;
+
+    return first + second;
+}
+
+void MemoryActivity::init()
+{
+    this->meminfo_file = open((this->proc_root + "/meminfo").c_str(), O_RDONLY | O_CLOEXEC);
+    this->vmstat_file = open((this->proc_root + "/vmstat").c_str(), O_RDONLY | O_CLOEXEC);
+
+    this->meminfo_scanner = std::make_unique<KeyScanner>(MeminfoKeys);
+    this->vmstat_scanner = std::make_unique<KeyScanner>(VmstatKeys);
+    this->previous_vmstat.assign(VmstatKeys.size(), NaN);
+
+    //the nodes are directories named node<number>
+    std::string node_root = this->sysfs_root + "/devices/system/node";
+    std::vector<unsigned int> numbers;
+
+    DIR* directory = opendir(node_root.c_str());
+    if (directory != nullptr)
+    {
+        while (dirent* entry = readdir(directory))
+        {
+            if (strncmp(entry->d_name, "node", 4) != 0 || entry->d_name[4] == '\0') continue;
+
+            char* end = nullptr;
+            unsigned long number = strtoul(entry->d_name + 4, &end, 10);
+            if (*end == '\0') numbers.push_back((unsigned int)number);
+        }
+
+        closedir(directory);
+    }
+
+    //a system with a single node has nothing to break down
+    if (numbers.size() < 2) return;
+
+    std::sort(numbers.begin(), numbers.end());
+
+    for (unsigned int number : numbers)
+    {
+        std::string node_path = node_root + "/node" + std::to_string(number);
+
+        //the keys of a node are prefixed with its number
+        std::vector<std::string> meminfo_keys;
+        for (const std::string& key : NodeMeminfoKeys)
+        {
+            meminfo_keys.push_back("Node " + std::to_string(number) + " " + key);
+        }
+
+        WatchedNode node;
+        node.Number = number;
+        node.MeminfoFile = open((node_path + "/meminfo").c_str(), O_RDONLY | O_CLOEXEC);
+        node.NumastatFile = open((node_path + "/numastat").c_str(), O_RDONLY | O_CLOEXEC);
+        node.MeminfoScanner = std::make_unique<KeyScanner>(meminfo_keys);
+        node.NumastatScanner = std::make_unique<KeyScanner>(NumastatKeys);
+        node.PreviousNumastat.assign(NumastatKeys.size(), NaN);
+
+        this->watched_nodes.push_back(std::move(node));
+        this->Nodes[number] = NodeMemoryMetrics();
+    }
+}
+
+MemoryActivity::~MemoryActivity()
+{
+    if (this->meminfo_file >= 0) close(this->meminfo_file);
+    if (this->vmstat_file >= 0) close(this->vmstat_file);
+
+    for (WatchedNode& node : this->watched_nodes)
+    {
+        if (node.MeminfoFile >= 0) close(node.MeminfoFile);
+        if (node.NumastatFile >= 0) close(node.NumastatFile);
+    }
+}
+
+size_t MemoryActivity::readFile(const int file)
+{
+    if (file < 0) return 0;
+
+    if (this->read_buffer.size() < 16 * 1024) this->read_buffer.resize(16 * 1024);
+
+    while (1)
+    {
+        ssize_t length = pread(file, &this->read_buffer[0], this->read_buffer.size(), 0);
+        if (length < 0) return 0;
+
+        //the file did not fit, read it again with a bigger buffer
+        if ((size_t)length < this->read_buffer.size()) return (size_t)length;
+        this->read_buffer.resize(this->read_buffer.size() * 2);
+    }
+}
+
+void MemoryActivity::readSystem(const double elapsed)
+{
+    std::vector<double> meminfo(MeminfoKeys.size(), NaN);
+
+    size_t length = readFile(this->meminfo_file);
+    if (length != 0) this->meminfo_scanner->scan(this->read_buffer.data(), length, meminfo.data());
+
+    //kernels before 3.14 do not estimate the available memory, the free memory and the caches are close to it
+    double available = meminfo[MemAvailable];
+    if (std::isnan(available)) available = meminfo[MemFree] + meminfo[Buffers] + meminfo[Cached];
+
+    this->System.TotalBytes = meminfo[MemTotal] * 1024;
+    this->System.AvailableBytes = available * 1024;
+    this->System.UsedBytes = (meminfo[MemTotal] - available) * 1024;
+    this->System.CachedBytes = (meminfo[Buffers] + meminfo[Cached]) * 1024;
+    this->System.DirtyBytes = meminfo[Dirty] * 1024;
+    this->System.CommittedBytes = meminfo[CommittedAS] * 1024;
+    this->System.SwapTotalBytes = meminfo[SwapTotal] * 1024;
+    this->System.SwapUsedBytes = (meminfo[SwapTotal] - meminfo[SwapFree]) * 1024;
+
+    std::vector<double> vmstat(VmstatKeys.size(), NaN);
+
+    length = readFile(this->vmstat_file);
+    if (length != 0) this->vmstat_scanner->scan(this->read_buffer.data(), length, vmstat.data());
+
+    //the swap counters are in pages
+    static const double page_size = (double)sysconf(_SC_PAGESIZE);
+    double seconds = elapsed / 1000;
+    const std::vector<double>& previous = this->previous_vmstat;
+
+    this->System.PageFaultsPerSecond = getRate(vmstat[PageFault], previous[PageFault], seconds);
+    this->System.MajorFaultsPerSecond = getRate(vmstat[MajorFault], previous[MajorFault], seconds);
+    this->System.SwapInBytesPerSecond = getRate(vmstat[SwapIn], previous[SwapIn], seconds) * page_size;
+    this->System.SwapOutBytesPerSecond = getRate(vmstat[SwapOut], previous[SwapOut], seconds) * page_size;
+    this->System.ReclaimScansPerSecond = getRate(addCounters(vmstat[ScanKswapd], vmstat[ScanDirect]), addCounters(previous[ScanKswapd], previous[ScanDirect]), seconds);
+    this->System.ReclaimedPerSecond = getRate(addCounters(vmstat[StealKswapd], vmstat[StealDirect]), addCounters(previous[StealKswapd], previous[StealDirect]), seconds);
+
+    this->previous_vmstat = vmstat;
+}
+
+void MemoryActivity::readNodes(const double elapsed)
+{
+    double seconds = elapsed / 1000;
+
+    for (WatchedNode& node : this->watched_nodes)
+    {
+        NodeMemoryMetrics& metrics = this->Nodes[node.Number];
+
+        std::vector<double> meminfo(NodeMeminfoKeys.size(), NaN);
+
+        size_t length = readFile(node.MeminfoFile);
+        if (length != 0) node.MeminfoScanner->scan(this->read_buffer.data(), length, meminfo.data());
+
+        metrics.TotalBytes = meminfo[NodeTotal] * 1024;
+        metrics.FreeBytes = meminfo[NodeFree] * 1024;
+        metrics.UsedBytes = meminfo[NodeUsed] * 1024;
+        metrics.FilePagesBytes = meminfo[NodeFilePages] * 1024;
+        metrics.AnonymousBytes = meminfo[NodeAnonPages] * 1024;
+
+        std::vector<double> numastat(NumastatKeys.size(), NaN);
+
+        length = readFile(node.NumastatFile);
+        if (length != 0) node.NumastatScanner->scan(this->read_buffer.data(), length, numastat.data());
+
+        const std::vector<double>& previous = node.PreviousNumastat;
+        double local = getRate(numastat[LocalNode], previous[LocalNode], seconds);
+        double other = getRate(numastat[OtherNode], previous[OtherNode], seconds);
+
+        //a node that allocated nothing keeps the share it had
+        if (local + other > 0) metrics.LocalAllocations = local / (local + other) * 100;
+        metrics.MissesPerSecond = getRate(numastat[NumaMiss], previous[NumaMiss], seconds);
+
+        node.PreviousNumastat = numastat;
+    }
+}
+
+void MemoryActivity::update()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+
+    double elapsed = this->previous_time >= 0 ? time - this->previous_time : 0;
+    this->previous_time = time;
+
+    readSystem(elapsed);
+    readNodes(elapsed);
+}
+#endif
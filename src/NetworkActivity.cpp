@@ -0,0 +1,206 @@
+#include "NetworkActivity.h"
+#include <cmath>
+#include <cstring>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/**
+* The largest value of a 32 bit counter, counters that never went past it may have wrapped around
+*/
+static const unsigned long long Counter32Max = 0xFFFFFFFFull;
+
+void NetworkActivity::init()
+{
+    for (auto& adapter : this->network_information.Adapters)
+    {
+        WatchedInterface watched = {};
+        watched.Name = adapter.Name;
+        watched.HasPrevious = 0;
+
+        //an adapter without an interface is not bound to anything and never has traffic, the lookup by name finds the first adapter with a name
+        watched.Watched = adapter.InterfaceIndex != 0 && this->network_information.findByName(adapter.Name) == &adapter;
+
+        if (watched.Watched) this->Interfaces[watched.Name] = InterfaceMetrics();
+
+        this->watched_interfaces.push_back(watched);
+    }
+
+#ifndef _WIN32
+    this->netdev_file = open(this->netdev_path.c_str(), O_RDONLY);
+#endif
+}
+
+NetworkActivity::~NetworkActivity()
+{
+#ifndef _WIN32
+    if (this->netdev_file >= 0) close(this->netdev_file);
+#endif
+}
+
+double NetworkActivity::getCounterDelta(const unsigned long long previous, const unsigned long long current)
+{
+    if (current >= previous) return (double)(current - previous);
+
+    //a 32 bit counter that wrapped around had to be in its upper half, a counter that was reset can be anywhere
+    if (previous > Counter32Max / 2 && previous <= Counter32Max && current <= Counter32Max) return (double)(Counter32Max - previous + current + 1);
+
+    return NaN;
+}
+
+#ifndef _WIN32
+void NetworkActivity::readNetdev(std::vector<InterfaceCounters>& counters, std::vector<bool>& found)
+{
+    if (this->netdev_file < 0) return;
+
+    //a single read from the start gets a fresh copy of every counter
+    if (this->netdev_buffer.size() < 64 * 1024) this->netdev_buffer.resize(64 * 1024);
+
+    ssize_t length = 0;
+    while (1)
+    {
+        length = pread(this->netdev_file, &this->netdev_buffer[0], this->netdev_buffer.size(), 0);
+        if (length < 0) return;
+
+        //hosts with many interfaces need a bigger buffer
+        if ((size_t)length < this->netdev_buffer.size()) break;
+        this->netdev_buffer.resize(this->netdev_buffer.size() * 2);
+    }
+
+    const char* position = this->netdev_buffer.data();
+    const char* end = position + length;
+    std::wstring name;
+
+    while (position < end)
+    {
+        const char* line_end = (const char*)memchr(position, '\n', end - position);
+        if (line_end == nullptr) line_end = end;
+
+        //the name is right-aligned and ends with a colon, a long name runs into the first counter, the two header lines have no colon
+        const char* colon = (const char*)memchr(position, ':', line_end - position);
+        if (colon != nullptr)
+        {
+            const char* name_start = position;
+            while (name_start < colon && *name_start == ' ') name_start++;
+            name.assign(name_start, colon);
+
+            const auto* adapter = this->network_information.findByName(name);
+            size_t watched = adapter != nullptr ? adapter - this->network_information.Adapters.data() : this->watched_interfaces.size();
+
+            if (watched < this->watched_interfaces.size() && this->watched_interfaces[watched].Watched)
+            {
+                //bytes, packets, errors, drops, fifo, frame, compressed and multicast are received, then the same for sent
+                unsigned long long values[16] = {};
+                char* field = (char*)colon + 1;
+                for (unsigned long long& value : values)
+                {
+                    value = strtoull(field, &field, 10);
+                }
+
+                unsigned long long* interface_counters = counters[watched].Values;
+                interface_counters[0] = values[0];
+                interface_counters[1] = values[8];
+                interface_counters[2] = values[1];
+                interface_counters[3] = values[9];
+                interface_counters[4] = values[2];
+                interface_counters[5] = values[10];
+                interface_counters[6] = values[3];
+                interface_counters[7] = values[11];
+
+                found[watched] = 1;
+            }
+        }
+
+        position = line_end + 1;
+    }
+}
+#endif
+
+void NetworkActivity::update()
+{
+    std::vector<InterfaceCounters> counters(this->watched_interfaces.size(), InterfaceCounters());
+    std::vector<bool> found(this->watched_interfaces.size(), 0);
+
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    double time = counter.QuadPart * 1000.0 / frequency.QuadPart;
+
+    //the whole table is read at once, the 64 bit counters of every interface
+    MIB_IF_TABLE2* table = nullptr;
+    if (GetIfTable2(&table) == NO_ERROR)
+    {
+        for (ULONG row = 0; row < table->NumEntries; row++)
+        {
+            const MIB_IF_ROW2& entry = table->Table[row];
+
+            const auto* adapter = this->network_information.findByInterfaceIndex((int)entry.InterfaceIndex);
+            if (adapter == nullptr) continue;
+
+            size_t watched = adapter - this->network_information.Adapters.data();
+            if (!this->watched_interfaces[watched].Watched) continue;
+
+            unsigned long long* interface_counters = counters[watched].Values;
+            interface_counters[0] = entry.InOctets;
+            interface_counters[1] = entry.OutOctets;
+            interface_counters[2] = entry.InUcastPkts + entry.InNUcastPkts;
+            interface_counters[3] = entry.OutUcastPkts + entry.OutNUcastPkts;
+            interface_counters[4] = entry.InErrors;
+            interface_counters[5] = entry.OutErrors;
+            interface_counters[6] = entry.InDiscards;
+            interface_counters[7] = entry.OutDiscards;
+
+            found[watched] = 1;
+        }
+
+        FreeMibTable(table);
+    }
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double time = now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+
+    readNetdev(counters, found);
+#endif
+
+    double seconds = this->previous_time >= 0 ? (time - this->previous_time) / 1000 : 0;
+    this->previous_time = time;
+
+    for (size_t index = 0; index < this->watched_interfaces.size(); index++)
+    {
+        WatchedInterface& watched = this->watched_interfaces[index];
+        if (!watched.Watched) continue;
+
+        InterfaceMetrics& metrics = this->Interfaces[watched.Name];
+
+        //an interface that is gone has no traffic to show, it starts from a new baseline if it comes back
+        if (!found[index])
+        {
+            metrics = InterfaceMetrics();
+            watched.HasPrevious = 0;
+            continue;
+        }
+
+        if (watched.HasPrevious && seconds > 0)
+        {
+            for (unsigned int metric = 0; metric < InterfaceMetricCount; metric++)
+            {
+                metrics.*InterfaceMetricInfos[metric].Value = getCounterDelta(watched.Previous.Values[metric], counters[index].Values[metric]) / seconds;
+            }
+        }
+
+        watched.Previous = counters[index];
+        watched.HasPrevious = 1;
+    }
+}
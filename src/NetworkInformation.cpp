@@ -1,10 +1,9 @@
 #include "NetworkInformation.h"
+#ifdef _WIN32
 #include <msclr\marshal_cppstd.h> //Needed to convert between System::String and std:string
 
-void NetworkInformation::initAdapters()
+void NetworkInformation::initAdapters(PlatformSessions& sessions)
 {
-#pragma comment(lib, "wbemuuid.lib")
-
     HRESULT hres = CoInitializeEx(0, COINIT_MULTITHREADED);
 
     //Error checking
@@ -13,64 +12,12 @@ void NetworkInformation::initAdapters()
         return;
     }
 
-    //Initialize the COM interface pointer
-    IWbemLocator* pLoc = nullptr;
-    hres = CoCreateInstance(
-        CLSID_WbemLocator,          // CLSID of the object
-        0,                          // Reserved
-        CLSCTX_INPROC_SERVER,       // Context
-        IID_IWbemLocator,           // Interface ID
-        (LPVOID*)&pLoc              // Interface pointer
-    );
+    //the connection is shared with the other collectors that query the same namespace
+    IWbemServices* pSvc = sessions.getWmiServices(L"ROOT\\CIMV2");
 
     //Error checking
-    if (FAILED(hres)) {
-        //Failed to create IWbemLocator object. Error code: hres
-        CoUninitialize();
-        return;
-    }
-
-    //Connect to WMI through the IWbemLocator::ConnectServer method
-    IWbemServices* pSvc = nullptr;
-
-    BSTR nmespace = SysAllocString(L"ROOT\\CIMV2");
-
-    hres = pLoc->ConnectServer(
-        nmespace, // Namespace
-        nullptr,                               // User
-        nullptr,                               // Password
-        0,                                     // Locale
-        NULL,                                  // Security flags
-        0,                                     // Authority
-        0,                                     // Context
-        &pSvc                                  // IWbemServices pointer
-    );
-
-    //Error checking
-    if (FAILED(hres)) {
-        //Could not connect to WMI namespace. Error code: hres
-        pLoc->Release();
-        CoUninitialize();
-        return;
-    }
-
-    //Set security levels on the proxy
-    hres = CoSetProxyBlanket(
-        pSvc,                        // IWbemServices pointer
-        RPC_C_AUTHN_WINNT,           // Authentication service
-        RPC_C_AUTHZ_NONE,            // Authorization service
-        NULL,                        // Server principal name
-        RPC_C_AUTHN_LEVEL_CALL,      // Authentication level
-        RPC_C_IMP_LEVEL_IMPERSONATE, // Impersonation level
-        NULL,                        // Authentication info
-        EOAC_NONE                    // Additional capabilities
-    );
-
-    //Error checking
-    if (FAILED(hres)) {
-        //Could not set proxy blanket. Error code: hres
-        pSvc->Release();
-        pLoc->Release();
+    if (pSvc == nullptr) {
+        //Could not connect to WMI namespace
         CoUninitialize();
         return;
     }
@@ -89,8 +36,8 @@ void NetworkInformation::initAdapters()
     if (FAILED(hres)) {
         //Query for network adapter data failed. Error code: hres
         pSvc->Release();
-        pLoc->Release();
         CoUninitialize();
+        return;
     }
 
     // Retrieve and print network adapter information
@@ -316,7 +263,82 @@ void NetworkInformation::initAdapters()
 
     // Cleanup
     pSvc->Release();
-    pLoc->Release();
     pEnumerator->Release();
     CoUninitialize();
-}
\ No newline at end of file
+}
+
+AdapterClass NetworkInformation::classifyAdapter(const NetworkAdapter& adapter)
+{
+    //WMI has no kind for virtual adapters, the names their drivers give them are all there is
+    static const wchar_t* const TunnelNames[] = { L"Tunnel", L"Teredo", L"6to4", L"ISATAP", L"IP-HTTPS", L"WAN Miniport", L"VPN", L"TAP-Windows", L"WireGuard" };
+
+    if (adapter.Name.find(L"Loopback") != std::wstring::npos) return AdapterClass::Loopback;
+
+    //the host side of the adapters Hyper-V gives containers
+    if (adapter.Name.find(L"Container") != std::wstring::npos) return AdapterClass::Container;
+
+    for (const wchar_t* name : TunnelNames)
+    {
+        if (adapter.Name.find(name) != std::wstring::npos) return AdapterClass::Tunnel;
+    }
+
+    return adapter.PhysicalAdapter ? AdapterClass::Physical : AdapterClass::Virtual;
+}
+#endif
+
+void NetworkInformation::indexAdapters()
+{
+    this->adapters_by_name.clear();
+    this->adapters_by_mac_address.clear();
+    this->adapters_by_interface_index.clear();
+
+    for (size_t position = 0; position < this->Adapters.size(); position++)
+    {
+        NetworkAdapter& adapter = this->Adapters[position];
+        adapter.Class = classifyAdapter(adapter);
+
+        //emplace keeps the first adapter when several share a key
+        this->adapters_by_name.emplace(adapter.Name, position);
+        this->adapters_by_interface_index.emplace(adapter.InterfaceIndex, position);
+
+        //the loopback and tunnels have an empty or all zero address
+        if (!adapter.MACAddress.empty() && adapter.MACAddress.find_first_not_of(L"0:") != std::wstring::npos)
+        {
+            this->adapters_by_mac_address.emplace(adapter.MACAddress, position);
+        }
+    }
+}
+
+const NetworkInformation::NetworkAdapter* NetworkInformation::findByName(const std::wstring& name) const
+{
+    auto position = this->adapters_by_name.find(name);
+    return position != this->adapters_by_name.end() ? &this->Adapters[position->second] : nullptr;
+}
+
+const NetworkInformation::NetworkAdapter* NetworkInformation::findByMACAddress(const std::wstring& address) const
+{
+    auto position = this->adapters_by_mac_address.find(address);
+    return position != this->adapters_by_mac_address.end() ? &this->Adapters[position->second] : nullptr;
+}
+
+const NetworkInformation::NetworkAdapter* NetworkInformation::findByInterfaceIndex(const int interfaceIndex) const
+{
+    auto position = this->adapters_by_interface_index.find(interfaceIndex);
+    return position != this->adapters_by_interface_index.end() ? &this->Adapters[position->second] : nullptr;
+}
+
+size_t NetworkInformation::countAdapters(const AdapterClass adapterClass, size_t& up) const
+{
+    size_t count = 0;
+    up = 0;
+
+    for (const NetworkAdapter& adapter : this->Adapters)
+    {
+        if (adapter.Class != adapterClass) continue;
+
+        count++;
+        if (adapter.NetConnectionStatus == 2) up++;
+    }
+
+    return count;
+}
@@ -0,0 +1,331 @@
+#include "NetworkInformation.h"
+#ifndef _WIN32
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+/**
+* IFLA_PERM_ADDRESS, only in the headers of kernels from 5.5 on
+*/
+static const unsigned short LinkPermanentAddress = 54;
+
+/**
+* The operational states of RFC 2863 in the order of IF_OPER_*
+*/
+static const wchar_t* const OperationalStates[] = { L"Unknown", L"Not Present", L"Down", L"Lower Layer Down", L"Testing", L"Dormant", L"Up" };
+
+enum OperationalState : unsigned char { OperUnknown, OperNotPresent, OperDown, OperLowerLayerDown, OperTesting, OperDormant, OperUp };
+
+/**
+* Widens a string the same way the rest of the program narrows them
+*/
+static std::wstring toWide(const std::string& text)
+{
+    return std::wstring(text.begin(), text.end());
+}
+
+/**
+* Formats a link layer address the same way WMI does, as upper case hex bytes separated by colons
+*/
+static std::wstring formatHardwareAddress(const unsigned char* address, const size_t length)
+{
+    std::string formatted;
+    char byte[4];
+
+    for (size_t index = 0; index < length; index++)
+    {
+        snprintf(byte, sizeof(byte), index == 0 ? "%02X" : ":%02X", address[index]);
+        formatted += byte;
+    }
+
+    return toWide(formatted);
+}
+
+/**
+* Names the type of a link from its ARP hardware type
+*/
+static std::wstring getAdapterType(const unsigned short type)
+{
+    switch (type)
+    {
+    case ARPHRD_ETHER: return L"Ethernet 802.3";
+    case ARPHRD_LOOPBACK: return L"Loopback";
+    case ARPHRD_IEEE80211:
+    case ARPHRD_IEEE80211_RADIOTAP: return L"Wireless";
+    case ARPHRD_INFINIBAND: return L"InfiniBand";
+    case ARPHRD_PPP: return L"PPP";
+    case ARPHRD_TUNNEL:
+    case ARPHRD_TUNNEL6:
+    case ARPHRD_SIT:
+    case ARPHRD_IPGRE: return L"Tunnel";
+    case ARPHRD_NONE: return L"None";
+    default: return L"Other";
+    }
+}
+
+/**
+* Gets the last part of a path, the name a sysfs link points to
+*/
+static std::string getLinkTarget(const int directory, const std::string& path)
+{
+    char target[PATH_MAX];
+    ssize_t length = readlinkat(directory, path.c_str(), target, sizeof(target) - 1);
+    if (length <= 0) return std::string();
+
+    target[length] = '\0';
+    const char* name = strrchr(target, '/');
+
+    return name != nullptr ? name + 1 : target;
+}
+
+void NetworkInformation::initAdapters(PlatformSessions& sessions)
+{
+    //the socket is opened once and shared, only requests are sent on it
+    int netlink_socket = sessions.getNetlinkSocket(NETLINK_ROUTE);
+    if (netlink_socket < 0) return;
+
+    //a dump answers with every link or address in as few reads as the buffer allows, however many interfaces there are
+    if (!dumpNetlink(sessions, netlink_socket, RTM_GETLINK)) return;
+    dumpNetlink(sessions, netlink_socket, RTM_GETADDR);
+
+    int sysfs_directory = sessions.getDirectory(this->sysfs_root);
+    if (sysfs_directory < 0) return;
+
+    for (NetworkAdapter& adapter : this->Adapters)
+    {
+        //links created by a virtual driver have its kind as their product name and never have a device, thousands of veths cost nothing here
+        if (!adapter.ProductName.empty() || adapter.AdapterType == L"Loopback") continue;
+
+        readSysfsAttributes(sysfs_directory, adapter);
+    }
+}
+
+bool NetworkInformation::dumpNetlink(PlatformSessions& sessions, const int netlink_socket, const unsigned short type)
+{
+    struct
+    {
+        nlmsghdr            Header;
+        union
+        {
+            ifinfomsg       Link;
+            ifaddrmsg       Address;
+        };
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.Header.nlmsg_len = NLMSG_LENGTH(type == RTM_GETLINK ? sizeof(ifinfomsg) : sizeof(ifaddrmsg));
+    request.Header.nlmsg_type = type;
+
+    //only the inventory sends requests on the route socket, its answers are parsed whatever their sequence number
+    unsigned int sequence;
+    return sessions.dumpNetlink(netlink_socket, &request.Header, sequence, this->netlink_buffer, [this](const char* buffer, const size_t length)
+    {
+        return parseNetlinkMessages(buffer, length);
+    });
+}
+
+bool NetworkInformation::parseNetlinkMessages(const char* buffer, const size_t length)
+{
+    unsigned int remaining = (unsigned int)length;
+
+    for (const nlmsghdr* message = (const nlmsghdr*)buffer; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining))
+    {
+        if (message->nlmsg_type == NLMSG_DONE || message->nlmsg_type == NLMSG_ERROR) return 0;
+
+        if (message->nlmsg_type == RTM_NEWLINK)
+        {
+            const ifinfomsg* link = (const ifinfomsg*)NLMSG_DATA(message);
+
+            //a link that is dumped again is updated in place
+            auto position = this->adapters_by_interface_index.find(link->ifi_index);
+            if (position == this->adapters_by_interface_index.end())
+            {
+                position = this->adapters_by_interface_index.emplace(link->ifi_index, this->Adapters.size()).first;
+                this->Adapters.push_back(NetworkAdapter());
+            }
+
+            NetworkAdapter& adapter = this->Adapters[position->second];
+            adapter.Index = link->ifi_index;
+            adapter.InterfaceIndex = link->ifi_index;
+            adapter.DeviceID = std::to_wstring(link->ifi_index);
+            adapter.AdapterType = getAdapterType(link->ifi_type);
+            adapter.Installed = 1;
+            adapter.NetEnabled = (link->ifi_flags & IFF_UP) != 0;
+
+            unsigned char state = OperUnknown;
+            std::wstring kind;
+
+            int attributes_length = IFLA_PAYLOAD(message);
+            for (const rtattr* attribute = IFLA_RTA(link); RTA_OK(attribute, attributes_length); attribute = RTA_NEXT(attribute, attributes_length))
+            {
+                const unsigned char* data = (const unsigned char*)RTA_DATA(attribute);
+                size_t data_length = RTA_PAYLOAD(attribute);
+
+                switch (attribute->rta_type)
+                {
+                case IFLA_IFNAME:
+                    adapter.Name = toWide(std::string((const char*)data, strnlen((const char*)data, data_length)));
+                    adapter.NetConnectionID = adapter.Name;
+                    adapter.Caption = adapter.Name;
+                    break;
+
+                case IFLA_ADDRESS:
+                    adapter.MACAddress = formatHardwareAddress(data, data_length);
+                    break;
+
+                case LinkPermanentAddress:
+                    adapter.PermanentAddress = formatHardwareAddress(data, data_length);
+                    break;
+
+                case IFLA_OPERSTATE:
+                    if (data_length >= 1) state = data[0];
+                    break;
+
+                case IFLA_LINKINFO:
+                {
+                    //the kind of a virtual link, like veth, bridge or tun, is nested in its link info
+                    int info_length = (int)data_length;
+                    for (const rtattr* info = (const rtattr*)data; RTA_OK(info, info_length); info = RTA_NEXT(info, info_length))
+                    {
+                        if (info->rta_type != IFLA_INFO_KIND) continue;
+
+                        kind = toWide(std::string((const char*)RTA_DATA(info), strnlen((const char*)RTA_DATA(info), RTA_PAYLOAD(info))));
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+                }
+            }
+
+            //the loopback and some virtual links never report a state, they are up whenever they are running
+            if (state == OperUnknown && (link->ifi_flags & IFF_RUNNING)) state = OperUp;
+            if (state > OperUp) state = OperUnknown;
+
+            adapter.Status = OperationalStates[state];
+
+            //the same codes as the NetConnectionStatus and Availability of WMI
+            switch (state)
+            {
+            case OperUp:
+                adapter.NetConnectionStatus = 2;
+                adapter.Availability = L"Running/Full Power";
+                break;
+            case OperDormant:
+                adapter.NetConnectionStatus = 1;
+                adapter.Availability = L"Not Ready";
+                break;
+            case OperDown:
+            case OperLowerLayerDown:
+                adapter.NetConnectionStatus = 7;
+                adapter.Availability = L"Off Line";
+                break;
+            case OperNotPresent:
+                adapter.NetConnectionStatus = 4;
+                adapter.Availability = L"Not Installed";
+                break;
+            default:
+                adapter.NetConnectionStatus = 0;
+                adapter.Availability = L"Unknown";
+                break;
+            }
+
+            //a physical adapter is described by its driver once sysfs was read
+            adapter.Description = !kind.empty() ? kind : adapter.AdapterType;
+            adapter.ProductName = kind;
+        }
+        else if (message->nlmsg_type == RTM_NEWADDR)
+        {
+            const ifaddrmsg* address = (const ifaddrmsg*)NLMSG_DATA(message);
+
+            auto position = this->adapters_by_interface_index.find((int)address->ifa_index);
+            if (position == this->adapters_by_interface_index.end()) continue;
+
+            //IFA_LOCAL is the address of the interface on point to point links, IFA_ADDRESS is the peer there
+            const void* local = nullptr;
+            const void* peer = nullptr;
+
+            int attributes_length = IFA_PAYLOAD(message);
+            for (const rtattr* attribute = IFA_RTA(address); RTA_OK(attribute, attributes_length); attribute = RTA_NEXT(attribute, attributes_length))
+            {
+                if (attribute->rta_type == IFA_LOCAL) local = RTA_DATA(attribute);
+                else if (attribute->rta_type == IFA_ADDRESS) peer = RTA_DATA(attribute);
+            }
+
+            const void* value = local != nullptr ? local : peer;
+            if (value == nullptr) continue;
+
+            char text[INET6_ADDRSTRLEN];
+            if (inet_ntop(address->ifa_family, value, text, sizeof(text)) == nullptr) continue;
+
+            this->Adapters[position->second].NetworkAddresses.push_back(toWide(std::string(text) + "/" + std::to_string(address->ifa_prefixlen)));
+        }
+    }
+
+    return 1;
+}
+
+AdapterClass NetworkInformation::classifyAdapter(const NetworkAdapter& adapter)
+{
+    //the kinds of the virtual drivers that carry their traffic inside another protocol
+    static const wchar_t* const TunnelKinds[] = { L"tun", L"ipip", L"sit", L"gre", L"gretap", L"ip6gre", L"ip6gretap", L"ip6tnl", L"vti", L"vti6", L"vxlan", L"geneve", L"wireguard", L"erspan", L"ip6erspan", L"bareudp" };
+
+    if (adapter.AdapterType == L"Loopback") return AdapterClass::Loopback;
+
+    //one end of a veth pair is moved into a container, the end left on the host is what is listed
+    if (adapter.ProductName == L"veth" || adapter.ProductName == L"netkit") return AdapterClass::Container;
+
+    if (adapter.AdapterType == L"Tunnel" || adapter.AdapterType == L"PPP") return AdapterClass::Tunnel;
+    for (const wchar_t* kind : TunnelKinds)
+    {
+        if (adapter.ProductName == kind) return AdapterClass::Tunnel;
+    }
+
+    return adapter.PhysicalAdapter ? AdapterClass::Physical : AdapterClass::Virtual;
+}
+
+void NetworkInformation::readSysfsAttributes(const int sysfs_directory, NetworkAdapter& adapter)
+{
+    std::string path = "class/net/" + std::string(adapter.Name.begin(), adapter.Name.end());
+
+    //only adapters backed by a device have a driver and a speed, a single failed readlink is all a virtual one costs
+    std::string device = getLinkTarget(sysfs_directory, path + "/device");
+    if (device.empty()) return;
+
+    adapter.PhysicalAdapter = 1;
+    adapter.PNPDeviceID = toWide(device);
+
+    std::string driver = getLinkTarget(sysfs_directory, path + "/device/driver");
+    if (!driver.empty())
+    {
+        adapter.ServiceName = toWide(driver);
+        adapter.Description = adapter.ServiceName;
+    }
+
+    if (faccessat(sysfs_directory, (path + "/wireless").c_str(), F_OK, 0) == 0) adapter.AdapterType = L"Wireless";
+
+    //the speed is in Mbit/s and -1 while the link is down, WMI reports bit/s
+    int file = openat(sysfs_directory, (path + "/speed").c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) return;
+
+    char buffer[32];
+    ssize_t length = read(file, buffer, sizeof(buffer) - 1);
+    close(file);
+
+    if (length <= 0) return;
+    buffer[length] = '\0';
+
+    long long speed = strtoll(buffer, nullptr, 10);
+    if (speed > 0) adapter.Speed = speed * 1000000;
+}
+#endif
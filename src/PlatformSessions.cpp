@@ -0,0 +1,274 @@
+#include "PlatformSessions.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <comdef.h>
+#include <Wbemidl.h>
+#pragma comment(lib, "wbemuuid.lib")
+#else
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+/**
+* The milliseconds the kernel gets to answer every part of a dump
+*/
+static const int NetlinkTimeout = 1000;
+#endif
+
+#ifdef _WIN32
+PlatformSessions::PlatformSessions()
+{
+    InitializeSRWLock((PSRWLOCK)&this->lock);
+}
+
+PlatformSessions::~PlatformSessions()
+{
+    //a probe that still runs holds its own reference to the connection it uses
+    for (auto& services : this->wmi_services)
+    {
+        if (services.second != nullptr) services.second->Release();
+    }
+
+    if (this->mta_cookie != nullptr) CoDecrementMTAUsage((CO_MTA_USAGE_COOKIE)this->mta_cookie);
+}
+
+IWbemServices* PlatformSessions::connectWmi(const std::wstring& wmiNamespace)
+{
+    IWbemLocator* pLoc = nullptr;
+    HRESULT hres = CoCreateInstance(CLSID_WbemLocator, 0, CLSCTX_INPROC_SERVER, IID_IWbemLocator, (LPVOID*)&pLoc);
+
+    //Error checking
+    if (FAILED(hres)) {
+        //Failed to create IWbemLocator object. Error code: hres
+        return nullptr;
+    }
+
+    //Connect to WMI through the IWbemLocator::ConnectServer method
+    IWbemServices* pSvc = nullptr;
+    hres = pLoc->ConnectServer(_bstr_t(wmiNamespace.c_str()), nullptr, nullptr, 0, NULL, 0, 0, &pSvc);
+    pLoc->Release();
+
+    //Error checking
+    if (FAILED(hres)) {
+        //Could not connect to WMI namespace. Error code: hres
+        return nullptr;
+    }
+
+    //Set security levels on the proxy
+    hres = CoSetProxyBlanket(pSvc, RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, NULL, RPC_C_AUTHN_LEVEL_CALL, RPC_C_IMP_LEVEL_IMPERSONATE, NULL, EOAC_NONE);
+
+    //Error checking
+    if (FAILED(hres)) {
+        //Could not set proxy blanket. Error code: hres
+        pSvc->Release();
+        return nullptr;
+    }
+
+    return pSvc;
+}
+
+IWbemServices* PlatformSessions::getWmiServices(const std::wstring& wmiNamespace)
+{
+    AcquireSRWLockExclusive((PSRWLOCK)&this->lock);
+
+    //the connections are made in the multithreaded apartment, it has to outlive every thread that used it
+    if (this->mta_cookie == nullptr)
+    {
+        CO_MTA_USAGE_COOKIE cookie = NULL;
+        if (SUCCEEDED(CoIncrementMTAUsage(&cookie))) this->mta_cookie = cookie;
+    }
+
+    auto found = this->wmi_services.find(wmiNamespace);
+    if (found != this->wmi_services.end())
+    {
+        IWbemServices* services = found->second;
+        if (services != nullptr) services->AddRef();
+
+        ReleaseSRWLockExclusive((PSRWLOCK)&this->lock);
+        return services;
+    }
+
+    ReleaseSRWLockExclusive((PSRWLOCK)&this->lock);
+
+    IWbemServices* services = connectWmi(wmiNamespace);
+    if (services == nullptr) return nullptr;
+
+    AcquireSRWLockExclusive((PSRWLOCK)&this->lock);
+
+    //another thread connected to the same namespace in the meantime, its connection is kept
+    IWbemServices*& stored = this->wmi_services[wmiNamespace];
+    if (stored == nullptr)
+    {
+        stored = services;
+    }
+    else
+    {
+        services->Release();
+        services = stored;
+    }
+
+    services->AddRef();
+
+    ReleaseSRWLockExclusive((PSRWLOCK)&this->lock);
+    return services;
+}
+
+bool PlatformSessions::readTable(std::vector<unsigned char>& buffer, unsigned long (*read)(void* table, unsigned long* size))
+{
+    //the table can grow between asking for its size and reading it
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        DWORD size = (DWORD)buffer.size();
+        DWORD result = read(buffer.empty() ? nullptr : buffer.data(), &size);
+
+        if (result == NO_ERROR) return 1;
+        if (result != ERROR_INSUFFICIENT_BUFFER) return 0;
+
+        buffer.resize(size + size / 4);
+    }
+
+    return 0;
+}
+
+size_t PlatformSessions::getOpenCount()
+{
+    AcquireSRWLockShared((PSRWLOCK)&this->lock);
+    size_t count = this->wmi_services.size();
+    ReleaseSRWLockShared((PSRWLOCK)&this->lock);
+
+    return count;
+}
+#else
+PlatformSessions::PlatformSessions()
+{
+    pthread_mutex_init(&this->lock, nullptr);
+}
+
+PlatformSessions::~PlatformSessions()
+{
+    for (auto& netlink_socket : this->netlink_sockets)
+    {
+        close(netlink_socket.second);
+    }
+
+    for (auto& directory : this->directories)
+    {
+        close(directory.second);
+    }
+
+    pthread_mutex_destroy(&this->lock);
+}
+
+int PlatformSessions::getNetlinkSocket(const int protocol, const unsigned int groups)
+{
+    pthread_mutex_lock(&this->lock);
+
+    auto found = this->netlink_sockets.find(std::make_pair(protocol, groups));
+    if (found != this->netlink_sockets.end())
+    {
+        pthread_mutex_unlock(&this->lock);
+        return found->second;
+    }
+
+    int netlink_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+    if (netlink_socket >= 0 && groups != 0)
+    {
+        sockaddr_nl address;
+        memset(&address, 0, sizeof(address));
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = groups;
+
+        if (bind(netlink_socket, (sockaddr*)&address, sizeof(address)) != 0)
+        {
+            close(netlink_socket);
+            netlink_socket = -1;
+        }
+    }
+
+    //a socket that could not be opened is tried again the next time it is asked for
+    if (netlink_socket >= 0) this->netlink_sockets[std::make_pair(protocol, groups)] = netlink_socket;
+
+    pthread_mutex_unlock(&this->lock);
+    return netlink_socket;
+}
+
+unsigned int PlatformSessions::getNetlinkSequence()
+{
+    pthread_mutex_lock(&this->lock);
+
+    //0 is what the kernel puts in the events it sends on its own
+    if (++this->netlink_sequence == 0) this->netlink_sequence++;
+    unsigned int sequence = this->netlink_sequence;
+
+    pthread_mutex_unlock(&this->lock);
+    return sequence;
+}
+
+bool PlatformSessions::dumpNetlink(const int netlink_socket, nlmsghdr* request, unsigned int& sequence, std::vector<char>& buffer, const std::function<bool(const char*, size_t)>& parse)
+{
+    request->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request->nlmsg_seq = sequence = getNetlinkSequence();
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    if (sendto(netlink_socket, request, request->nlmsg_len, 0, (sockaddr*)&kernel, sizeof(kernel)) < 0) return 0;
+
+    //the kernel fills up to 32 KiB per read when the buffer is big enough
+    if (buffer.size() < 32 * 1024) buffer.resize(32 * 1024);
+
+    while (1)
+    {
+        pollfd answer = { netlink_socket, POLLIN, 0 };
+        if (poll(&answer, 1, NetlinkTimeout) <= 0) return 0;
+
+        //peek at the size first so a message bigger than the buffer is never cut
+        ssize_t length = recv(netlink_socket, buffer.data(), buffer.size(), MSG_PEEK | MSG_TRUNC);
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) return 0;
+
+        if ((size_t)length > buffer.size())
+        {
+            buffer.resize((size_t)length);
+            continue;
+        }
+
+        length = recv(netlink_socket, buffer.data(), buffer.size(), 0);
+        if (length <= 0) return 0;
+
+        if (!parse(buffer.data(), (size_t)length)) return 1;
+    }
+}
+
+int PlatformSessions::getDirectory(const std::string& path)
+{
+    pthread_mutex_lock(&this->lock);
+
+    auto found = this->directories.find(path);
+    if (found != this->directories.end())
+    {
+        pthread_mutex_unlock(&this->lock);
+        return found->second;
+    }
+
+    int directory = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory >= 0) this->directories[path] = directory;
+
+    pthread_mutex_unlock(&this->lock);
+    return directory;
+}
+
+size_t PlatformSessions::getOpenCount()
+{
+    pthread_mutex_lock(&this->lock);
+    size_t count = this->netlink_sockets.size() + this->directories.size();
+    pthread_mutex_unlock(&this->lock);
+
+    return count;
+}
+#endif
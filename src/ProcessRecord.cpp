@@ -0,0 +1,322 @@
+#include "ProcessRecord.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+* Converts a UTF-16 string to UTF-8
+*/
+static std::string toUtf8(const std::wstring& text)
+{
+    std::string result;
+    result.reserve(text.size());
+
+    for (size_t index = 0; index < text.size(); index++)
+    {
+        unsigned int code = (unsigned int)text[index];
+
+        //combine surrogate pairs
+        if (code >= 0xD800 && code <= 0xDBFF && index + 1 < text.size() && text[index + 1] >= 0xDC00 && text[index + 1] <= 0xDFFF)
+        {
+            code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned int)text[index + 1] - 0xDC00);
+            index++;
+        }
+
+        if (code < 0x80)
+        {
+            result += (char)code;
+        }
+        else if (code < 0x800)
+        {
+            result += (char)(0xC0 | (code >> 6));
+            result += (char)(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            result += (char)(0xE0 | (code >> 12));
+            result += (char)(0x80 | ((code >> 6) & 0x3F));
+            result += (char)(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            result += (char)(0xF0 | (code >> 18));
+            result += (char)(0x80 | ((code >> 12) & 0x3F));
+            result += (char)(0x80 | ((code >> 6) & 0x3F));
+            result += (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    return result;
+}
+
+/**
+* Appends an unsigned integer using 7 bits per byte, the high bit marks that more bytes follow
+*/
+static void writeVarint(std::vector<unsigned char>& encoded, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        encoded.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    encoded.push_back((unsigned char)value);
+}
+
+/**
+* Reads an unsigned integer written by writeVarint()
+* @return false if the data ended before the integer did
+*/
+static bool readVarint(const unsigned char* data, const size_t size, size_t& offset, unsigned long long& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (offset >= size) return 0;
+
+        unsigned char byte = data[offset++];
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) return 1;
+    }
+
+    return 0;
+}
+
+template <typename T>
+void ProcessRecordTracker::markTop(T value)
+{
+    //every candidate is among the busiest if there are not more of them
+    if (this->candidates.size() <= this->top_count)
+    {
+        std::fill(this->sampled.begin(), this->sampled.end(), 1);
+        return;
+    }
+
+    this->ranking.resize(this->candidates.size());
+    for (unsigned int index = 0; index < this->ranking.size(); index++) this->ranking[index] = index;
+
+    std::nth_element(this->ranking.begin(), this->ranking.begin() + this->top_count, this->ranking.end(), [&](const unsigned int first, const unsigned int second)
+    {
+        return value(this->candidates[first]) > value(this->candidates[second]);
+    });
+
+    for (unsigned int index = 0; index < this->top_count; index++)
+    {
+        this->sampled[this->ranking[index]] = 1;
+    }
+}
+
+void ProcessRecordTracker::setTopCount(const unsigned int count)
+{
+    this->top_count = count;
+}
+
+void ProcessRecordTracker::addProcess(const unsigned int id, const long long start_time, const std::wstring& name, const float cpu_usage, const unsigned long long memory_usage)
+{
+    this->candidates.push_back({ id, start_time, &name, cpu_usage, memory_usage });
+}
+
+void ProcessRecordTracker::endTick(RecordBlock& block)
+{
+    this->tick++;
+
+    size_t row_start = block.process_samples.size();
+
+    //the busiest processes are always sampled
+    this->sampled.assign(this->candidates.size(), 0);
+    if (this->top_count != 0)
+    {
+        markTop([](const Candidate& candidate) { return candidate.CPUUsage; });
+        markTop([](const Candidate& candidate) { return candidate.MemoryUsage; });
+    }
+
+    for (size_t index = 0; index < this->candidates.size(); index++)
+    {
+        const Candidate& candidate = this->candidates[index];
+
+        auto found = this->tracked_processes.find(candidate.ID);
+
+        //the ID was reused by a new process, the old one ended
+        if (found != this->tracked_processes.end() && found->second.StartTime != candidate.StartTime)
+        {
+            block.process_samples.push_back({ found->second.Key, 0, 0, 1 });
+            this->tracked_processes.erase(found);
+            found = this->tracked_processes.end();
+        }
+
+        bool sample = this->sampled[index] != 0;
+
+        if (found == this->tracked_processes.end())
+        {
+            //store the static information of the process once
+            TrackedProcess process = { this->next_key++, candidate.StartTime, 0, 0, 0 };
+            block.processes.push_back({ process.Key, candidate.ID, candidate.StartTime, toUtf8(*candidate.Name) });
+
+            found = this->tracked_processes.emplace(candidate.ID, process).first;
+            sample = 1;
+        }
+        else
+        {
+            //compare with the last sampled values so slow changes add up until they are sampled
+            TrackedProcess& process = found->second;
+            unsigned long long memory_change = candidate.MemoryUsage > process.LastMemoryUsage ? candidate.MemoryUsage - process.LastMemoryUsage : process.LastMemoryUsage - candidate.MemoryUsage;
+
+            sample |= std::fabs(candidate.CPUUsage - process.LastCPUUsage) >= this->cpu_usage_threshold || memory_change >= this->memory_usage_threshold;
+        }
+
+        found->second.LastSeenTick = this->tick;
+
+        if (sample)
+        {
+            found->second.LastCPUUsage = candidate.CPUUsage;
+            found->second.LastMemoryUsage = candidate.MemoryUsage;
+
+            block.process_samples.push_back({ found->second.Key, candidate.CPUUsage, candidate.MemoryUsage, 0 });
+        }
+    }
+
+    //processes that were not added this tick ended
+    for (auto process = this->tracked_processes.begin(); process != this->tracked_processes.end();)
+    {
+        if (process->second.LastSeenTick != this->tick)
+        {
+            block.process_samples.push_back({ process->second.Key, 0, 0, 1 });
+            process = this->tracked_processes.erase(process);
+        }
+        else
+        {
+            process++;
+        }
+    }
+
+    //samples are sorted by key so the keys can be stored as small differences
+    std::sort(block.process_samples.begin() + row_start, block.process_samples.end(), [](const RecordProcessSample& first, const RecordProcessSample& second)
+    {
+        return first.Key < second.Key;
+    });
+
+    block.process_sample_counts.push_back((unsigned int)(block.process_samples.size() - row_start));
+
+    this->candidates.clear();
+}
+
+void ProcessRecordTracker::reset()
+{
+    this->tracked_processes.clear();
+    this->candidates.clear();
+}
+
+void encodeProcessBlock(const RecordBlock& block, const std::vector<RecordProcess>& known_processes, std::vector<unsigned char>& encoded)
+{
+    encoded.clear();
+
+    //the process table
+    writeVarint(encoded, known_processes.size() + block.processes.size());
+
+    auto writeProcess = [&](const RecordProcess& process)
+    {
+        writeVarint(encoded, process.Key);
+        writeVarint(encoded, process.ID);
+        writeVarint(encoded, (unsigned long long)process.StartTime);
+        writeVarint(encoded, process.Name.size());
+        encoded.insert(encoded.end(), process.Name.begin(), process.Name.end());
+    };
+
+    for (const RecordProcess& process : known_processes) writeProcess(process);
+    for (const RecordProcess& process : block.processes) writeProcess(process);
+
+    //the samples of every row
+    size_t sample_index = 0;
+    for (unsigned int count : block.process_sample_counts)
+    {
+        writeVarint(encoded, count);
+
+        unsigned int previous_key = 0;
+        for (unsigned int sample = 0; sample < count; sample++, sample_index++)
+        {
+            const RecordProcessSample& process_sample = block.process_samples[sample_index];
+
+            writeVarint(encoded, process_sample.Key - previous_key);
+            previous_key = process_sample.Key;
+
+            //0 marks an ended process, otherwise the CPU usage in tenths of a percent plus one
+            if (process_sample.Ended)
+            {
+                writeVarint(encoded, 0);
+                continue;
+            }
+
+            float cpu_usage = process_sample.CPUUsage > 0 ? process_sample.CPUUsage : 0;
+            writeVarint(encoded, (unsigned long long)std::llround(cpu_usage * 10) + 1);
+            writeVarint(encoded, (process_sample.MemoryUsage + 512) / 1024);
+        }
+    }
+}
+
+bool decodeProcessBlock(const unsigned char* data, const size_t size, const unsigned int rows, RecordBlock& block)
+{
+    size_t offset = 0;
+    unsigned long long value = 0;
+
+    block.processes.clear();
+    block.process_samples.clear();
+    block.process_sample_counts.clear();
+
+    //the process table
+    unsigned long long process_count = 0;
+    if (!readVarint(data, size, offset, process_count)) return 0;
+
+    for (unsigned long long index = 0; index < process_count; index++)
+    {
+        RecordProcess process;
+        unsigned long long key = 0, id = 0, start_time = 0, length = 0;
+
+        if (!readVarint(data, size, offset, key) || !readVarint(data, size, offset, id) || !readVarint(data, size, offset, start_time)) return 0;
+        if (!readVarint(data, size, offset, length) || length > size - offset) return 0;
+
+        process.Key = (unsigned int)key;
+        process.ID = (unsigned int)id;
+        process.StartTime = (long long)start_time;
+        process.Name.assign((const char*)data + offset, (size_t)length);
+        offset += (size_t)length;
+
+        block.processes.push_back(process);
+    }
+
+    //the samples of every row
+    for (unsigned int row = 0; row < rows; row++)
+    {
+        unsigned long long count = 0;
+        if (!readVarint(data, size, offset, count)) return 0;
+
+        block.process_sample_counts.push_back((unsigned int)count);
+
+        unsigned int key = 0;
+        for (unsigned long long sample = 0; sample < count; sample++)
+        {
+            RecordProcessSample process_sample = {};
+
+            if (!readVarint(data, size, offset, value)) return 0;
+            key += (unsigned int)value;
+            process_sample.Key = key;
+
+            if (!readVarint(data, size, offset, value)) return 0;
+
+            if (value == 0)
+            {
+                process_sample.Ended = 1;
+            }
+            else
+            {
+                process_sample.CPUUsage = (float)(value - 1) / 10;
+
+                if (!readVarint(data, size, offset, value)) return 0;
+                process_sample.MemoryUsage = value * 1024;
+            }
+
+            block.process_samples.push_back(process_sample);
+        }
+    }
+
+    return 1;
+}
@@ -1,5 +1,6 @@
 #include "ProcessesInformation.h"
 #include "GlobalFunctions.h"
+#include <vector>
 #include <msclr\marshal_cppstd.h>
 
 void ProcessesInformation::fetchProcessStaticInfo(const DWORD& processID)
@@ -40,6 +41,14 @@ void ProcessesInformation::fetchProcessStaticInfo(const DWORD& processID)
         this->processes[processID].PagefileUsage = pmc.PagefileUsage;
     }
 
+    // Get process start time, tells apart processes that reuse the same ID
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        long long ticks = ((long long)creationTime.dwHighDateTime << 32) | creationTime.dwLowDateTime;
+        this->processes[processID].StartTime = (ticks - 116444736000000000LL) / 10000LL;
+    }
+
     // Get process path
     wchar_t processPath[MAX_PATH];
     DWORD pathSize = sizeof(processPath) / sizeof(processPath[0]);
@@ -116,7 +125,8 @@ double ProcessesInformation::getCPUUsage(const DWORD& processID)
         return 0;
     }
 
-    //If no prior times were saved then store the current times and recurse the function to get the new times
+    //If no prior times were saved then store the current times, the usage is known from the next call on
+    //calling again right away would spin until the system time changes
     if ((this->lastProcessTimes[processID].last_system_time_ == 0) || (this->lastProcessTimes[processID].last_time_ == 0))
     {
         this->lastProcessTimes[processID].last_system_time_ = system_time;
@@ -125,19 +135,19 @@ double ProcessesInformation::getCPUUsage(const DWORD& processID)
         //Close the handle
         CloseHandle(hProcess);
 
-        return this->getCPUUsage(processID);
+        return 0;
     }
 
     //get times delta
     system_time_delta = system_time - this->lastProcessTimes[processID].last_system_time_;
     time_delta = time - this->lastProcessTimes[processID].last_time_;
 
-    //if delta is zero i.e no time has passed then we call again to get a reading
+    //if delta is zero i.e no time has passed then there is no new reading
     if (time_delta == 0)
     {
         //Close the handle
         CloseHandle(hProcess);
-        return this->getCPUUsage(processID);
+        return 0;
     }
 
     //calculate usage
@@ -193,29 +203,77 @@ void ProcessesInformation::updateProcessesDynamicInfo()
 
 void ProcessesInformation::fetchProcesses()
 {
-    DWORD aProcesses[1024], cbNeeded;
+    std::vector<DWORD> aProcesses(1024);
+    DWORD cbNeeded;
+
+    //grow the buffer until all process IDs fit
+    while (1)
+    {
+        //If fails to enumarate then return
+        if (!EnumProcesses(aProcesses.data(), (DWORD)(aProcesses.size() * sizeof(DWORD)), &cbNeeded)) {
+            return;
+        }
 
-    //If fails to enumarate then return
-    if (!EnumProcesses(aProcesses, sizeof(aProcesses), &cbNeeded)) {
-        return;
+        if (cbNeeded < aProcesses.size() * sizeof(DWORD)) break;
+
+        aProcesses.resize(aProcesses.size() * 2);
     }
 
     //Divide by byte size to get the count of items
     cbNeeded /= sizeof(DWORD);
 
+    //mark the processes that are still running
+    std::map<DWORD, Process> running;
+
     //Iterate over all elements in aProcesses
     for (unsigned int i = 0; i < cbNeeded; i++)
     {
         //If not null then add to the processes map
         if (aProcesses[i] != NULL) 
         {
+            auto process = this->processes.find(aProcesses[i]);
+
+            //keep the info of known processes
+            if (process != this->processes.end())
+            {
+                running[aProcesses[i]] = std::move(process->second);
+                continue;
+            }
+
             //Assign process ID
-            this->processes[aProcesses[i]].ID = aProcesses[i];
+            running[aProcesses[i]].ID = aProcesses[i];
+        }
+    }
+
+    //forget the CPU times of processes that exited
+    for (auto times = this->lastProcessTimes.begin(); times != this->lastProcessTimes.end();)
+    {
+        if (running.find(times->first) == running.end())
+        {
+            times = this->lastProcessTimes.erase(times);
+        }
+        else
+        {
+            times++;
+        }
+    }
+
+    //fetch static info of the new processes
+    std::vector<DWORD> newProcesses;
+    for (std::pair<const DWORD, Process>& process : running)
+    {
+        if (this->processes.find(process.first) == this->processes.end())
+        {
+            newProcesses.push_back(process.first);
         }
     }
 
-    //fetch static info
-    fetchProcessesStaticInfo();
+    this->processes.swap(running);
+
+    for (DWORD processID : newProcesses)
+    {
+        fetchProcessStaticInfo(processID);
+    }
 }
 
 void ProcessesInformation::fetchNumberOfProcessors()
@@ -0,0 +1,260 @@
+#include "QuantileSketch.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+/**
+* Values closer to zero than this are counted as zero
+*/
+static const double MinIndexableValue = 1e-9;
+
+/**
+* Appends a plain value to a buffer
+*/
+template <typename T>
+static void appendValue(std::vector<unsigned char>& encoded, const T& value)
+{
+    const unsigned char* bytes = (const unsigned char*)&value;
+    encoded.insert(encoded.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+* Reads a plain value from a buffer
+* @return false if the buffer ended before the value
+*/
+template <typename T>
+static bool takeValue(const unsigned char* data, const size_t size, size_t& offset, T& value)
+{
+    if (offset + sizeof(T) > size) return 0;
+
+    memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return 1;
+}
+
+QuantileSketch::QuantileSketch(const double relative_accuracy, const unsigned int max_buckets) : relative_accuracy(relative_accuracy), max_buckets(max_buckets)
+{
+    this->gamma = (1 + relative_accuracy) / (1 - relative_accuracy);
+    this->log_gamma = std::log(this->gamma);
+}
+
+int QuantileSketch::getBucketIndex(const double value) const
+{
+    return (int)std::ceil(std::log(value) / this->log_gamma);
+}
+
+double QuantileSketch::getBucketValue(const int index) const
+{
+    //the middle of the bucket in relative terms
+    return 2 * std::pow(this->gamma, index) / (this->gamma + 1);
+}
+
+void QuantileSketch::addToStore(BucketStore& store, const int index, const unsigned long long bucket_count)
+{
+    if (store.Counts.empty())
+    {
+        store.Offset = index;
+        store.Counts.push_back(0);
+    }
+
+    //grow the store to include the bucket
+    if (index < store.Offset)
+    {
+        store.Counts.insert(store.Counts.begin(), store.Offset - index, 0);
+        store.Offset = index;
+    }
+    else if (index >= store.Offset + (int)store.Counts.size())
+    {
+        store.Counts.resize(index - store.Offset + 1, 0);
+    }
+
+    store.Counts[index - store.Offset] += bucket_count;
+
+    //merge the lowest buckets into the first one that is kept, only the low quantiles lose accuracy
+    if (store.Counts.size() > this->max_buckets)
+    {
+        size_t extra = store.Counts.size() - this->max_buckets;
+
+        unsigned long long collapsed = 0;
+        for (size_t bucket = 0; bucket <= extra; bucket++) collapsed += store.Counts[bucket];
+
+        store.Counts.erase(store.Counts.begin(), store.Counts.begin() + extra);
+        store.Counts[0] = collapsed;
+        store.Offset += (int)extra;
+    }
+}
+
+void QuantileSketch::add(const double value)
+{
+    if (std::isnan(value)) return;
+
+    if (value > MinIndexableValue)
+    {
+        addToStore(this->positive, getBucketIndex(value), 1);
+    }
+    else if (value < -MinIndexableValue)
+    {
+        addToStore(this->negative, getBucketIndex(-value), 1);
+    }
+    else
+    {
+        this->zero_count++;
+    }
+
+    if (this->count == 0 || value < this->min) this->min = value;
+    if (this->count == 0 || value > this->max) this->max = value;
+
+    this->count++;
+}
+
+bool QuantileSketch::merge(const QuantileSketch& other)
+{
+    if (other.relative_accuracy != this->relative_accuracy) return 0;
+    if (other.count == 0) return 1;
+
+    for (size_t bucket = 0; bucket < other.positive.Counts.size(); bucket++)
+    {
+        if (other.positive.Counts[bucket]) addToStore(this->positive, other.positive.Offset + (int)bucket, other.positive.Counts[bucket]);
+    }
+
+    for (size_t bucket = 0; bucket < other.negative.Counts.size(); bucket++)
+    {
+        if (other.negative.Counts[bucket]) addToStore(this->negative, other.negative.Offset + (int)bucket, other.negative.Counts[bucket]);
+    }
+
+    this->zero_count += other.zero_count;
+
+    if (this->count == 0 || other.min < this->min) this->min = other.min;
+    if (this->count == 0 || other.max > this->max) this->max = other.max;
+
+    this->count += other.count;
+
+    return 1;
+}
+
+double QuantileSketch::getQuantile(const double quantile) const
+{
+    if (this->count == 0) return std::numeric_limits<double>::quiet_NaN();
+
+    if (quantile <= 0) return this->min;
+    if (quantile >= 1) return this->max;
+
+    //the rank of the value, counted from the most negative value
+    unsigned long long rank = (unsigned long long)(quantile * (this->count - 1));
+    unsigned long long seen = 0;
+    double value = this->max;
+
+    bool found = 0;
+
+    //negative values from the largest magnitude down
+    for (size_t bucket = this->negative.Counts.size(); bucket > 0 && !found; bucket--)
+    {
+        seen += this->negative.Counts[bucket - 1];
+        if (seen > rank)
+        {
+            value = -getBucketValue(this->negative.Offset + (int)bucket - 1);
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        seen += this->zero_count;
+        if (seen > rank)
+        {
+            value = 0;
+            found = 1;
+        }
+    }
+
+    for (size_t bucket = 0; bucket < this->positive.Counts.size() && !found; bucket++)
+    {
+        seen += this->positive.Counts[bucket];
+        if (seen > rank)
+        {
+            value = getBucketValue(this->positive.Offset + (int)bucket);
+            found = 1;
+        }
+    }
+
+    //the exact extremes are known so the estimate never goes past them
+    if (value < this->min) value = this->min;
+    if (value > this->max) value = this->max;
+
+    return value;
+}
+
+unsigned long long QuantileSketch::getCount() const
+{
+    return this->count;
+}
+
+double QuantileSketch::getMin() const
+{
+    return this->count == 0 ? std::numeric_limits<double>::quiet_NaN() : this->min;
+}
+
+double QuantileSketch::getMax() const
+{
+    return this->count == 0 ? std::numeric_limits<double>::quiet_NaN() : this->max;
+}
+
+void QuantileSketch::clear()
+{
+    this->positive = BucketStore();
+    this->negative = BucketStore();
+    this->zero_count = 0;
+    this->count = 0;
+    this->min = 0;
+    this->max = 0;
+}
+
+void QuantileSketch::serialize(std::vector<unsigned char>& encoded) const
+{
+    appendValue(encoded, this->relative_accuracy);
+    appendValue(encoded, this->count);
+    appendValue(encoded, this->zero_count);
+    appendValue(encoded, this->min);
+    appendValue(encoded, this->max);
+
+    for (const BucketStore* store : { &this->positive, &this->negative })
+    {
+        appendValue(encoded, store->Offset);
+        appendValue(encoded, (unsigned int)store->Counts.size());
+
+        for (unsigned long long bucket_count : store->Counts)
+        {
+            appendValue(encoded, bucket_count);
+        }
+    }
+}
+
+bool QuantileSketch::deserialize(const unsigned char* data, const size_t size, size_t& offset)
+{
+    double accuracy = 0;
+    if (!takeValue(data, size, offset, accuracy)) return 0;
+
+    //buckets only line up between sketches of the same accuracy
+    if (accuracy != this->relative_accuracy)
+    {
+        *this = QuantileSketch(accuracy, this->max_buckets);
+    }
+
+    if (!takeValue(data, size, offset, this->count) || !takeValue(data, size, offset, this->zero_count)) return 0;
+    if (!takeValue(data, size, offset, this->min) || !takeValue(data, size, offset, this->max)) return 0;
+
+    for (BucketStore* store : { &this->positive, &this->negative })
+    {
+        unsigned int buckets = 0;
+        if (!takeValue(data, size, offset, store->Offset) || !takeValue(data, size, offset, buckets)) return 0;
+        if (buckets > (size - offset) / sizeof(unsigned long long)) return 0;
+
+        store->Counts.resize(buckets);
+        for (unsigned long long& bucket_count : store->Counts)
+        {
+            takeValue(data, size, offset, bucket_count);
+        }
+    }
+
+    return 1;
+}
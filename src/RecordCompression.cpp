@@ -0,0 +1,459 @@
+#include "RecordCompression.h"
+#include <cstring>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h> //Needed for _BitScanReverse() and _BitScanForward()
+#endif
+
+/**
+* Appends values of any bit length to a byte buffer, most significant bit first
+*/
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& buffer;
+
+    /**
+    * Bits not written to the buffer yet, aligned to the right
+    */
+    uint64_t pending = 0;
+
+    /**
+    * The number of bits in pending
+    */
+    int pending_count = 0;
+
+public:
+    BitWriter(std::vector<unsigned char>& buffer) : buffer(buffer)
+    {
+    }
+
+    /**
+    * Writes the lowest count bits of value
+    * @param value The bits to write
+    * @param count The number of bits to write, up to 64
+    */
+    void write(uint64_t value, int count)
+    {
+        //split large writes so pending never overflows
+        if (count > 32)
+        {
+            write(value >> 32, count - 32);
+            count = 32;
+        }
+
+        if (count < 64) value &= (1ULL << count) - 1;
+
+        pending = (pending << count) | value;
+        pending_count += count;
+
+        //move complete bytes to the buffer
+        while (pending_count >= 8)
+        {
+            pending_count -= 8;
+            buffer.push_back((unsigned char)(pending >> pending_count));
+        }
+    }
+
+    /**
+    * Writes the remaining bits padded with zeros to a full byte
+    */
+    void flush()
+    {
+        if (pending_count > 0)
+        {
+            buffer.push_back((unsigned char)(pending << (8 - pending_count)));
+            pending_count = 0;
+        }
+        pending = 0;
+    }
+};
+
+/**
+* Reads values of any bit length from a byte buffer, most significant bit first
+*/
+class BitReader
+{
+private:
+    const unsigned char* data;
+    size_t size;
+
+    /**
+    * The index of the next bit to read
+    */
+    size_t position = 0;
+
+public:
+    BitReader(const unsigned char* data, const size_t size) : data(data), size(size)
+    {
+    }
+
+    /**
+    * @return false if a read went past the end of the buffer
+    */
+    bool valid()
+    {
+        return position <= size * 8;
+    }
+
+    /**
+    * Reads count bits
+    * @param count The number of bits to read, up to 64
+    * @return The bits aligned to the right, zeros past the end of the buffer
+    */
+    uint64_t read(int count)
+    {
+        uint64_t value = 0;
+
+        //take as many bits as possible from the current byte each iteration
+        while (count > 0)
+        {
+            int bit_offset = (int)(position & 7);
+            int taken = 8 - bit_offset < count ? 8 - bit_offset : count;
+
+            unsigned int byte = position < size * 8 ? data[position >> 3] : 0;
+            unsigned int bits = (byte >> (8 - bit_offset - taken)) & ((1u << taken) - 1);
+
+            value = (value << taken) | bits;
+
+            position += taken;
+            count -= taken;
+        }
+
+        return value;
+    }
+};
+
+/**
+* Counts the zero bits above the highest set bit of a non zero value
+*/
+static int countLeadingZeros(const uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return 31 - (int)index;
+#else
+    return __builtin_clz(value);
+#endif
+}
+
+/**
+* Counts the zero bits below the lowest set bit of a non zero value
+*/
+static int countTrailingZeros(const uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+/**
+* Sign extends the lowest count bits of value
+*/
+static int64_t signExtend(const uint64_t value, const int count)
+{
+    if (count >= 64) return (int64_t)value;
+
+    uint64_t sign = 1ULL << (count - 1);
+    return (int64_t)((value ^ sign) - sign);
+}
+
+/**
+* Monotonic timestamps are in microseconds and a tick is usually a second apart with some scheduling jitter,
+* so the delta-of-delta buckets are wider than the ones in the original Gorilla paper
+* '0' -> same delta as the previous row
+* '10' -> 12 bits, '110' -> 20 bits, '1110' -> 32 bits, '1111' -> 64 bits
+*/
+static void encodeTimestamps(const std::vector<long long>& timestamps, const unsigned int rows, BitWriter& writer)
+{
+    if (rows == 0) return;
+
+    //the first timestamp is stored as is
+    writer.write((uint64_t)timestamps[0], 64);
+
+    int64_t previous_delta = 0;
+    for (unsigned int row = 1; row < rows; row++)
+    {
+        int64_t delta = timestamps[row] - timestamps[row - 1];
+        int64_t delta_of_delta = delta - previous_delta;
+        previous_delta = delta;
+
+        if (delta_of_delta == 0)
+        {
+            writer.write(0, 1);
+        }
+        else if (delta_of_delta >= -2048 && delta_of_delta < 2048)
+        {
+            writer.write(0b10, 2);
+            writer.write((uint64_t)delta_of_delta, 12);
+        }
+        else if (delta_of_delta >= -524288 && delta_of_delta < 524288)
+        {
+            writer.write(0b110, 3);
+            writer.write((uint64_t)delta_of_delta, 20);
+        }
+        else if (delta_of_delta >= INT32_MIN && delta_of_delta <= INT32_MAX)
+        {
+            writer.write(0b1110, 4);
+            writer.write((uint64_t)delta_of_delta, 32);
+        }
+        else
+        {
+            writer.write(0b1111, 4);
+            writer.write((uint64_t)delta_of_delta, 64);
+        }
+    }
+}
+
+static void decodeTimestamps(BitReader& reader, const unsigned int rows, std::vector<long long>& timestamps)
+{
+    timestamps.resize(rows);
+    if (rows == 0) return;
+
+    timestamps[0] = (long long)reader.read(64);
+
+    int64_t previous_delta = 0;
+    for (unsigned int row = 1; row < rows; row++)
+    {
+        int64_t delta_of_delta = 0;
+
+        //count the leading ones of the bucket prefix
+        if (reader.read(1))
+        {
+            if (!reader.read(1)) delta_of_delta = signExtend(reader.read(12), 12);
+            else if (!reader.read(1)) delta_of_delta = signExtend(reader.read(20), 20);
+            else if (!reader.read(1)) delta_of_delta = signExtend(reader.read(32), 32);
+            else delta_of_delta = (int64_t)reader.read(64);
+        }
+
+        previous_delta += delta_of_delta;
+        timestamps[row] = timestamps[row - 1] + previous_delta;
+    }
+}
+
+/**
+* Every value is XORed with the previous value of the same column
+* '0' -> same value as the previous row
+* '10' -> the meaningful bits fit in the window of the previous value, only they are stored
+* '11' -> 5 bits of leading zeros, 5 bits of meaningful bit count - 1, then the meaningful bits
+*/
+static void encodeColumn(const RecordBlock& block, const unsigned int column, BitWriter& writer)
+{
+    if (block.rows == 0) return;
+
+    uint32_t previous;
+    memcpy(&previous, &block.values[column], sizeof(previous));
+
+    //the first value is stored as is
+    writer.write(previous, 32);
+
+    int previous_leading = -1;
+    int previous_trailing = 0;
+
+    for (unsigned int row = 1; row < block.rows; row++)
+    {
+        uint32_t current;
+        memcpy(&current, &block.values[(size_t)row * block.columns + column], sizeof(current));
+
+        uint32_t xored = current ^ previous;
+        previous = current;
+
+        if (xored == 0)
+        {
+            writer.write(0, 1);
+            continue;
+        }
+
+        int leading = countLeadingZeros(xored);
+        int trailing = countTrailingZeros(xored);
+
+        //reuse the previous window if the meaningful bits fit in it
+        if (previous_leading != -1 && leading >= previous_leading && trailing >= previous_trailing)
+        {
+            writer.write(0b10, 2);
+            writer.write(xored >> previous_trailing, 32 - previous_leading - previous_trailing);
+        }
+        else
+        {
+            int meaningful = 32 - leading - trailing;
+
+            writer.write(0b11, 2);
+            writer.write(leading, 5);
+            writer.write(meaningful - 1, 5);
+            writer.write(xored >> trailing, meaningful);
+
+            previous_leading = leading;
+            previous_trailing = trailing;
+        }
+    }
+}
+
+static void decodeColumn(BitReader& reader, const unsigned int rows, std::vector<float>& values)
+{
+    values.resize(rows);
+    if (rows == 0) return;
+
+    uint32_t previous = (uint32_t)reader.read(32);
+    memcpy(&values[0], &previous, sizeof(previous));
+
+    int previous_leading = 0;
+    int previous_trailing = 0;
+
+    for (unsigned int row = 1; row < rows; row++)
+    {
+        if (reader.read(1))
+        {
+            uint32_t xored;
+
+            if (!reader.read(1))
+            {
+                xored = (uint32_t)reader.read(32 - previous_leading - previous_trailing) << previous_trailing;
+            }
+            else
+            {
+                previous_leading = (int)reader.read(5);
+                int meaningful = (int)reader.read(5) + 1;
+                previous_trailing = 32 - previous_leading - meaningful;
+
+                xored = (uint32_t)reader.read(meaningful) << previous_trailing;
+            }
+
+            previous ^= xored;
+        }
+
+        memcpy(&values[row], &previous, sizeof(previous));
+    }
+}
+
+void encodeCompressedBlock(const RecordBlock& block, std::vector<unsigned char>& encoded)
+{
+    encoded.clear();
+
+    //reserve room for the stream offsets, filled once every stream is written
+    //the wall clock times are stream 0 and column c is stream c + 1
+    unsigned int streams = block.columns + 1;
+    size_t table_size = sizeof(uint32_t) * streams;
+    encoded.resize(table_size);
+
+    BitWriter writer(encoded);
+
+    //the monotonic timestamps directly follow the table
+    encodeTimestamps(block.timestamps, block.rows, writer);
+    writer.flush();
+
+    //every stream starts on a byte boundary so it can be located through the offset table
+    for (unsigned int stream = 0; stream < streams; stream++)
+    {
+        uint32_t offset = (uint32_t)encoded.size();
+        memcpy(&encoded[sizeof(uint32_t) * stream], &offset, sizeof(offset));
+
+        if (stream == 0)
+        {
+            encodeTimestamps(block.wall_times, block.rows, writer);
+        }
+        else
+        {
+            encodeColumn(block, stream - 1, writer);
+        }
+        writer.flush();
+    }
+}
+
+/**
+* Gets the byte range of a stream in an encoded payload
+* @return false if the offset table is truncated or points outside the payload
+*/
+static bool getStreamRange(const unsigned char* data, const size_t size, const unsigned int streams, const unsigned int stream, size_t& begin, size_t& end)
+{
+    size_t table_size = sizeof(uint32_t) * streams;
+    if (size < table_size || stream >= streams) return 0;
+
+    uint32_t offset;
+    memcpy(&offset, data + sizeof(uint32_t) * stream, sizeof(offset));
+    begin = offset;
+
+    if (stream + 1 < streams)
+    {
+        memcpy(&offset, data + sizeof(uint32_t) * (stream + 1), sizeof(offset));
+        end = offset;
+    }
+    else
+    {
+        end = size;
+    }
+
+    return begin >= table_size && begin <= end && end <= size;
+}
+
+/**
+* Decodes the monotonic timestamps that sit between the offset table and the first stream
+* @return false if the payload is truncated
+*/
+static bool decodeMonotonicTimestamps(const unsigned char* data, const size_t size, const unsigned int rows, const unsigned int streams, std::vector<long long>& timestamps)
+{
+    size_t table_size = sizeof(uint32_t) * streams;
+    size_t begin, end;
+
+    if (!getStreamRange(data, size, streams, 0, begin, end)) return 0;
+
+    BitReader reader(data + table_size, begin - table_size);
+    decodeTimestamps(reader, rows, timestamps);
+
+    return reader.valid();
+}
+
+bool decodeCompressedBlock(const unsigned char* data, const size_t size, const unsigned int rows, const unsigned int columns, RecordBlock& block)
+{
+    unsigned int streams = columns + 1;
+    size_t begin, end;
+
+    block.rows = rows;
+    block.columns = columns;
+    block.values.resize((size_t)rows * columns);
+
+    if (!decodeMonotonicTimestamps(data, size, rows, streams, block.timestamps)) return 0;
+
+    //wall clock times
+    if (!getStreamRange(data, size, streams, 0, begin, end)) return 0;
+
+    BitReader wall_time_reader(data + begin, end - begin);
+    decodeTimestamps(wall_time_reader, rows, block.wall_times);
+    if (!wall_time_reader.valid()) return 0;
+
+    std::vector<float> column_values;
+    for (unsigned int column = 0; column < columns; column++)
+    {
+        if (!getStreamRange(data, size, streams, column + 1, begin, end)) return 0;
+
+        BitReader reader(data + begin, end - begin);
+        decodeColumn(reader, rows, column_values);
+        if (!reader.valid()) return 0;
+
+        for (unsigned int row = 0; row < rows; row++)
+        {
+            block.values[(size_t)row * columns + column] = column_values[row];
+        }
+    }
+
+    return 1;
+}
+
+bool decodeCompressedColumn(const unsigned char* data, const size_t size, const unsigned int rows, const unsigned int columns, const unsigned int column, std::vector<long long>& timestamps, std::vector<float>& values)
+{
+    unsigned int streams = columns + 1;
+    size_t begin, end;
+
+    if (column >= columns || !getStreamRange(data, size, streams, column + 1, begin, end)) return 0;
+
+    if (!decodeMonotonicTimestamps(data, size, rows, streams, timestamps)) return 0;
+
+    BitReader reader(data + begin, end - begin);
+    decodeColumn(reader, rows, values);
+
+    return reader.valid();
+}
@@ -0,0 +1,822 @@
+#include "RecordFormat.h"
+#include "RecordCompression.h"
+#include "ProcessRecord.h"
+#include <fstream>
+#include <algorithm>
+#include <iomanip> //Needed for setprecision()
+#include <chrono> //Needed for time functions
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <cstring>
+#include <unordered_map>
+#include <sstream>
+
+/**
+* Writes a plain value to a binary stream
+*/
+template <typename T>
+static void writeValue(std::ostream& stream, const T& value)
+{
+    stream.write((const char*)&value, sizeof(T));
+}
+
+/**
+* Reads a plain value from a binary stream
+* @return false if the stream ended before the value was read
+*/
+template <typename T>
+static bool readValue(std::istream& stream, T& value)
+{
+    stream.read((char*)&value, sizeof(T));
+    return stream.gcount() == sizeof(T);
+}
+
+/**
+* Checks that a stream has at least the given number of bytes left, used before a buffer is sized from a header field
+* A corrupted size would otherwise allocate far more than the file holds
+* @return false if the stream ends before that many bytes
+*/
+static bool fitsInStream(std::istream& stream, const unsigned long long size)
+{
+    std::streampos position = stream.tellg();
+    if (position < 0) return 0;
+
+    stream.seekg(0, std::ios::end);
+    std::streampos end = stream.tellg();
+    stream.seekg(position);
+
+    return end >= position && size <= (unsigned long long)(end - position);
+}
+
+/**
+* Writes raw bytes to a binary stream and adds them to the checksum of the block being written
+*/
+static void writeChecked(std::ostream& stream, const void* data, const size_t size, unsigned int& checksum)
+{
+    stream.write((const char*)data, size);
+    checksum = updateRecordChecksum(checksum, data, size);
+}
+
+/**
+* Writes a string to a binary stream prefixed by its length
+*/
+static void writeString(std::ostream& stream, const std::string& value)
+{
+    writeValue(stream, (unsigned int)value.size());
+    stream.write(value.data(), value.size());
+}
+
+/**
+* Reads a length prefixed string from a binary stream
+* @return false if the stream ended before the string was read
+*/
+static bool readString(std::istream& stream, std::string& value)
+{
+    unsigned int length = 0;
+    if (!readValue(stream, length) || !fitsInStream(stream, length)) return 0;
+
+    value.resize(length);
+    stream.read(&value[0], length);
+
+    return stream.gcount() == length;
+}
+
+unsigned int updateRecordChecksum(const unsigned int checksum, const void* data, const size_t size)
+{
+    //CRC-32 lookup table of the reflected 0xEDB88320 polynomial
+    static const std::vector<unsigned int> table = []()
+    {
+        std::vector<unsigned int> values(256);
+        for (unsigned int index = 0; index < 256; index++)
+        {
+            unsigned int value = index;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            values[index] = value;
+        }
+        return values;
+    }();
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    unsigned int crc = ~checksum;
+
+    for (size_t index = 0; index < size; index++)
+    {
+        crc = table[(crc ^ bytes[index]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+std::string getRecordFileExtension(const RecordFormat format)
+{
+    switch (format)
+    {
+    case RecordFormat::Binary:
+    case RecordFormat::CompressedBinary:
+        return ".sibrec";
+
+    case RecordFormat::CSV:
+    default:
+        return ".csv";
+    }
+}
+
+std::string formatWallTime(const long long wall_time)
+{
+    time_t seconds = (time_t)(wall_time / 1000);
+    int milliseconds = (int)(wall_time % 1000);
+
+    //split the time into its fields
+    tm fields = {};
+#ifdef _WIN32
+    gmtime_s(&fields, &seconds);
+#else
+    gmtime_r(&seconds, &fields);
+#endif
+
+    char text[32];
+    snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+        fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday, fields.tm_hour, fields.tm_min, fields.tm_sec, milliseconds);
+
+    return text;
+}
+
+void writeCsvHeader(std::ostream& stream, const RecordSchema& schema)
+{
+    //print the static information
+    stream << schema.static_info;
+
+    //every row starts with its time
+    stream << CsvWallTimeColumn << ',' << CsvMonotonicTimeColumn;
+    if (!schema.column_names.empty()) stream << ',';
+
+    //print the column headers
+    for (size_t column = 0; column < schema.column_names.size(); column++)
+    {
+        stream << schema.column_names[column];
+
+        //if not the final column print a comma to seperate the names
+        if (column != schema.column_names.size() - 1)
+        {
+            stream << ',';
+        }
+    }
+    stream << '\n';
+}
+
+void writeCsvBlock(std::ostream& stream, const RecordBlock& block)
+{
+    //iterate over the rows
+    for (unsigned int row = 0; row < block.rows; row++)
+    {
+        const float* values = block.values.data() + (size_t)row * block.columns;
+
+        //print the time of the row with microsecond precision
+        stream << formatWallTime(block.wall_times[row]) << ',';
+        stream << block.timestamps[row] / 1000000 << '.' << std::setw(6) << std::setfill('0') << block.timestamps[row] % 1000000 << std::setfill(' ');
+        if (block.columns > 0) stream << ',';
+
+        //iterate over the values
+        for (unsigned int column = 0; column < block.columns; column++)
+        {
+            //print the value to the stream
+            stream << values[column];
+
+            //if not the final sensor print a comma to seperate the values
+            if (column != block.columns - 1)
+            {
+                stream << ',';
+            }
+        }
+
+        stream << '\n';
+    }
+}
+
+void writeBinaryHeader(std::ostream& stream, const RecordSchema& schema)
+{
+    stream.write(BinaryRecordMagic, sizeof(BinaryRecordMagic));
+
+    writeValue(stream, schema.start_time);
+
+    writeString(stream, schema.static_info);
+
+    //column count followed by the column names
+    writeValue(stream, (unsigned int)schema.column_names.size());
+    for (const std::string& name : schema.column_names)
+    {
+        writeString(stream, name);
+    }
+}
+
+void writeBinaryBlock(std::ostream& stream, const RecordBlock& block)
+{
+    if (block.rows == 0) return;
+
+    unsigned int checksum = 0;
+
+    writeChecked(stream, &BinaryRecordBlockMarker, sizeof(BinaryRecordBlockMarker), checksum);
+    writeChecked(stream, &block.rows, sizeof(block.rows), checksum);
+    writeChecked(stream, &block.columns, sizeof(block.columns), checksum);
+
+    //the monotonic and wall clock times of all rows
+    writeChecked(stream, block.timestamps.data(), sizeof(long long) * block.rows, checksum);
+    writeChecked(stream, block.wall_times.data(), sizeof(long long) * block.rows, checksum);
+
+    //every column is written as one fixed width run so a reader can pick a single sensor out of a block
+    std::vector<float> column_values(block.rows);
+    for (unsigned int column = 0; column < block.columns; column++)
+    {
+        for (unsigned int row = 0; row < block.rows; row++)
+        {
+            column_values[row] = block.values[(size_t)row * block.columns + column];
+        }
+
+        writeChecked(stream, column_values.data(), sizeof(float) * block.rows, checksum);
+    }
+
+    writeValue(stream, checksum);
+}
+
+void writeCompressedBinaryBlock(std::ostream& stream, const RecordBlock& block, std::vector<unsigned char>& scratch)
+{
+    if (block.rows == 0) return;
+
+    encodeCompressedBlock(block, scratch);
+
+    unsigned int checksum = 0;
+    unsigned int payload_size = (unsigned int)scratch.size();
+
+    writeChecked(stream, &BinaryRecordCompressedBlockMarker, sizeof(BinaryRecordCompressedBlockMarker), checksum);
+    writeChecked(stream, &block.rows, sizeof(block.rows), checksum);
+    writeChecked(stream, &block.columns, sizeof(block.columns), checksum);
+    writeChecked(stream, &payload_size, sizeof(payload_size), checksum);
+    writeChecked(stream, scratch.data(), scratch.size(), checksum);
+
+    writeValue(stream, checksum);
+}
+
+void writeBinaryProcessBlock(std::ostream& stream, const RecordBlock& block, const std::vector<RecordProcess>& known_processes, std::vector<unsigned char>& scratch)
+{
+    if (block.rows == 0 || block.process_sample_counts.size() != block.rows) return;
+
+    encodeProcessBlock(block, known_processes, scratch);
+
+    unsigned int checksum = 0;
+    unsigned int payload_size = (unsigned int)scratch.size();
+
+    writeChecked(stream, &BinaryRecordProcessBlockMarker, sizeof(BinaryRecordProcessBlockMarker), checksum);
+    writeChecked(stream, &block.rows, sizeof(block.rows), checksum);
+    writeChecked(stream, &payload_size, sizeof(payload_size), checksum);
+    writeChecked(stream, scratch.data(), scratch.size(), checksum);
+
+    writeValue(stream, checksum);
+}
+
+void writeBinaryRollupBlock(std::ostream& stream, const RecordRollupBlock& block)
+{
+    if (block.rows == 0) return;
+
+    unsigned int checksum = 0;
+
+    writeChecked(stream, &BinaryRecordRollupBlockMarker, sizeof(BinaryRecordRollupBlockMarker), checksum);
+    writeChecked(stream, &block.rows, sizeof(block.rows), checksum);
+    writeChecked(stream, &block.columns, sizeof(block.columns), checksum);
+    writeChecked(stream, &block.tier, sizeof(block.tier), checksum);
+    writeChecked(stream, block.bucket_times.data(), sizeof(long long) * block.rows, checksum);
+
+    //every statistic of a column is one fixed width run like the columns of a raw block
+    std::vector<float> column_values(block.rows);
+    for (unsigned int column = 0; column < block.columns; column++)
+    {
+        for (const std::vector<float>* statistic : { &block.min, &block.max, &block.average, &block.last })
+        {
+            for (unsigned int row = 0; row < block.rows; row++)
+            {
+                column_values[row] = (*statistic)[(size_t)row * block.columns + column];
+            }
+
+            writeChecked(stream, column_values.data(), sizeof(float) * block.rows, checksum);
+        }
+    }
+
+    writeValue(stream, checksum);
+}
+
+bool readBinaryRollupBlock(std::istream& stream, RecordRollupBlock& block, const unsigned int schema_columns)
+{
+    std::streampos start = stream.tellg();
+
+    //marker, rows, columns and tier
+    unsigned int header[4];
+    stream.read((char*)header, sizeof(header));
+
+    if (stream.gcount() != sizeof(header) || header[0] != BinaryRecordRollupBlockMarker)
+    {
+        stream.clear();
+        stream.seekg(start);
+        return 0;
+    }
+
+    unsigned int rows = header[1], columns = header[2];
+
+    //a corrupted header must not size the body
+    unsigned long long body_size = sizeof(long long) * (unsigned long long)rows + 4 * sizeof(float) * (unsigned long long)rows * columns;
+    if (columns > schema_columns || !fitsInStream(stream, body_size)) return 0;
+
+    std::vector<unsigned char> body((size_t)body_size);
+    stream.read((char*)body.data(), body.size());
+    if (stream.gcount() != (std::streamsize)body.size()) return 0;
+
+    unsigned int stored_checksum = 0;
+    if (!readValue(stream, stored_checksum) || stored_checksum != updateRecordChecksum(updateRecordChecksum(0, header, sizeof(header)), body.data(), body.size())) return 0;
+
+    block.rows = rows;
+    block.columns = columns;
+    block.tier = header[3];
+
+    block.bucket_times.resize(rows);
+    memcpy(block.bucket_times.data(), body.data(), sizeof(long long) * rows);
+
+    //put the columns back in row major order
+    const float* column_values = (const float*)(body.data() + sizeof(long long) * rows);
+    for (std::vector<float>* statistic : { &block.min, &block.max, &block.average, &block.last })
+    {
+        statistic->resize((size_t)rows * columns);
+    }
+
+    for (unsigned int column = 0; column < columns; column++)
+    {
+        for (std::vector<float>* statistic : { &block.min, &block.max, &block.average, &block.last })
+        {
+            for (unsigned int row = 0; row < rows; row++)
+            {
+                memcpy(&(*statistic)[(size_t)row * columns + column], column_values + row, sizeof(float));
+            }
+            column_values += rows;
+        }
+    }
+
+    return 1;
+}
+
+void updateRecordSummary(const RecordBlock& block, std::vector<QuantileSketch>& sketches)
+{
+    if (sketches.size() < block.columns) sketches.resize(block.columns);
+
+    for (unsigned int row = 0; row < block.rows; row++)
+    {
+        const float* values = block.values.data() + (size_t)row * block.columns;
+
+        //missing values are skipped by the sketch
+        for (unsigned int column = 0; column < block.columns; column++)
+        {
+            sketches[column].add(values[column]);
+        }
+    }
+}
+
+void writeCsvSummary(std::ostream& stream, const RecordSchema& schema, const std::vector<QuantileSketch>& sketches)
+{
+    stream << CsvSummaryMarker << '\n';
+
+    //the percentiles are named without the fixed precision of the values
+    std::ostringstream header;
+    header << "Sensor,Count,Min,Max";
+    for (double percentile : RecordSummaryPercentiles)
+    {
+        header << ",P" << percentile;
+    }
+    stream << header.str() << '\n';
+
+    //one line for every column, columns without values only have their count
+    for (size_t column = 0; column < schema.column_names.size() && column < sketches.size(); column++)
+    {
+        const QuantileSketch& sketch = sketches[column];
+
+        stream << schema.column_names[column] << ',' << sketch.getCount();
+
+        if (sketch.getCount() == 0)
+        {
+            stream << std::string(3 + sizeof(RecordSummaryPercentiles) / sizeof(double), ',') << '\n';
+            continue;
+        }
+
+        stream << ',' << sketch.getMin() << ',' << sketch.getMax();
+        for (double percentile : RecordSummaryPercentiles)
+        {
+            stream << ',' << sketch.getQuantile(percentile / 100);
+        }
+        stream << '\n';
+    }
+}
+
+void writeBinarySummaryBlock(std::ostream& stream, const std::vector<QuantileSketch>& sketches, std::vector<unsigned char>& scratch)
+{
+    scratch.clear();
+    for (const QuantileSketch& sketch : sketches)
+    {
+        sketch.serialize(scratch);
+    }
+
+    unsigned int checksum = 0;
+    unsigned int columns = (unsigned int)sketches.size();
+    unsigned int payload_size = (unsigned int)scratch.size();
+
+    writeChecked(stream, &BinaryRecordSummaryBlockMarker, sizeof(BinaryRecordSummaryBlockMarker), checksum);
+    writeChecked(stream, &columns, sizeof(columns), checksum);
+    writeChecked(stream, &payload_size, sizeof(payload_size), checksum);
+    writeChecked(stream, scratch.data(), scratch.size(), checksum);
+
+    writeValue(stream, checksum);
+}
+
+bool readBinarySummaryBlock(std::istream& stream, std::vector<QuantileSketch>& sketches, const unsigned int schema_columns)
+{
+    std::streampos start = stream.tellg();
+
+    //marker, columns and payload size
+    unsigned int header[3];
+    stream.read((char*)header, sizeof(header));
+
+    if (stream.gcount() != sizeof(header) || header[0] != BinaryRecordSummaryBlockMarker)
+    {
+        stream.clear();
+        stream.seekg(start);
+        return 0;
+    }
+
+    if (header[1] > schema_columns || !fitsInStream(stream, header[2])) return 0;
+
+    std::vector<unsigned char> payload(header[2]);
+    stream.read((char*)payload.data(), payload.size());
+    if (stream.gcount() != (std::streamsize)payload.size()) return 0;
+
+    unsigned int stored_checksum = 0;
+    if (!readValue(stream, stored_checksum) || stored_checksum != updateRecordChecksum(updateRecordChecksum(0, header, sizeof(header)), payload.data(), payload.size())) return 0;
+
+    sketches.assign(header[1], QuantileSketch());
+
+    size_t offset = 0;
+    for (QuantileSketch& sketch : sketches)
+    {
+        if (!sketch.deserialize(payload.data(), payload.size(), offset)) return 0;
+    }
+
+    return 1;
+}
+
+bool readBinaryHeader(std::istream& stream, RecordSchema& schema)
+{
+    //check that this is a binary recording of a version we understand
+    char magic[sizeof(BinaryRecordMagic)];
+    stream.read(magic, sizeof(magic));
+    if (stream.gcount() != sizeof(magic) || !std::equal(magic, magic + sizeof(magic), BinaryRecordMagic)) return 0;
+
+    if (!readValue(stream, schema.start_time)) return 0;
+
+    if (!readString(stream, schema.static_info)) return 0;
+
+    //every column name takes at least its length
+    unsigned int column_count = 0;
+    if (!readValue(stream, column_count) || !fitsInStream(stream, sizeof(unsigned int) * (unsigned long long)column_count)) return 0;
+
+    schema.column_names.resize(column_count);
+    for (std::string& name : schema.column_names)
+    {
+        if (!readString(stream, name)) return 0;
+    }
+
+    return 1;
+}
+
+bool readBinaryBlock(std::istream& stream, RecordBlock& block, const unsigned int schema_columns)
+{
+    //rollups and summaries are only read by readBinaryRollupBlock() and readBinarySummaryBlock()
+    RecordRollupBlock rollup;
+    std::vector<QuantileSketch> summary;
+    while (readBinaryRollupBlock(stream, rollup, schema_columns) || readBinarySummaryBlock(stream, summary, schema_columns));
+    if (!stream) return 0;
+
+    //marker, rows and columns
+    unsigned int header[3];
+    stream.read((char*)header, sizeof(header));
+    if (stream.gcount() != sizeof(header)) return 0;
+
+    unsigned int marker = header[0];
+
+    block.processes.clear();
+    block.process_samples.clear();
+    block.process_sample_counts.clear();
+
+    //the processes come before the rows they belong to, the payload size takes the place of the column count
+    if (marker == BinaryRecordProcessBlockMarker)
+    {
+        unsigned int process_rows = header[1];
+        if (!fitsInStream(stream, header[2])) return 0;
+
+        std::vector<unsigned char> payload(header[2]);
+        stream.read((char*)payload.data(), payload.size());
+        if (stream.gcount() != (std::streamsize)payload.size()) return 0;
+
+        unsigned int stored_checksum = 0;
+        if (!readValue(stream, stored_checksum) || stored_checksum != updateRecordChecksum(updateRecordChecksum(0, header, sizeof(header)), payload.data(), payload.size())) return 0;
+
+        RecordBlock processes(0, 0);
+        if (!decodeProcessBlock(payload.data(), payload.size(), process_rows, processes)) return 0;
+
+        //the rows themselves
+        if (!readBinaryBlock(stream, block, schema_columns) || block.rows != process_rows) return 0;
+
+        block.processes.swap(processes.processes);
+        block.process_samples.swap(processes.process_samples);
+        block.process_sample_counts.swap(processes.process_sample_counts);
+
+        return 1;
+    }
+    if (marker != BinaryRecordBlockMarker && marker != BinaryRecordCompressedBlockMarker) return 0;
+
+    unsigned int checksum = updateRecordChecksum(0, header, sizeof(header));
+    unsigned int rows = header[1], columns = header[2];
+    if (columns > schema_columns) return 0;
+
+    //read the whole body of the block so it can be checked before it is decoded
+    unsigned long long body_size = 0;
+    if (marker == BinaryRecordCompressedBlockMarker)
+    {
+        unsigned int payload_size = 0;
+        if (!readValue(stream, payload_size)) return 0;
+
+        //every row takes at least a bit in the wall clock times and in every column, the decoded rows are sized from it
+        if ((unsigned long long)rows * (columns + 1) > 8ULL * payload_size) return 0;
+
+        checksum = updateRecordChecksum(checksum, &payload_size, sizeof(payload_size));
+        body_size = payload_size;
+    }
+    else
+    {
+        body_size = 2 * sizeof(long long) * (unsigned long long)rows + sizeof(float) * (unsigned long long)rows * columns;
+    }
+
+    //a corrupted header must not size the body
+    if (!fitsInStream(stream, body_size)) return 0;
+
+    std::vector<unsigned char> body((size_t)body_size);
+    stream.read((char*)body.data(), body.size());
+    if (stream.gcount() != (std::streamsize)body.size()) return 0;
+
+    //a block with a wrong checksum was not written completely
+    unsigned int stored_checksum = 0;
+    if (!readValue(stream, stored_checksum) || stored_checksum != updateRecordChecksum(checksum, body.data(), body.size())) return 0;
+
+    block.rows = rows;
+    block.columns = columns;
+
+    if (marker == BinaryRecordCompressedBlockMarker)
+    {
+        return decodeCompressedBlock(body.data(), body.size(), rows, columns, block);
+    }
+
+    const unsigned char* position = body.data();
+
+    block.timestamps.resize(rows);
+    memcpy(block.timestamps.data(), position, sizeof(long long) * rows);
+    position += sizeof(long long) * rows;
+
+    block.wall_times.resize(rows);
+    memcpy(block.wall_times.data(), position, sizeof(long long) * rows);
+    position += sizeof(long long) * rows;
+
+    //put the columns back in row major order
+    block.values.resize((size_t)rows * columns);
+    for (unsigned int column = 0; column < columns; column++)
+    {
+        const float* column_values = (const float*)position + (size_t)column * rows;
+
+        for (unsigned int row = 0; row < rows; row++)
+        {
+            memcpy(&block.values[(size_t)row * columns + column], column_values + row, sizeof(float));
+        }
+    }
+
+    return 1;
+}
+
+unsigned long long findRecoverableLength(std::istream& stream, const RecordFormat format)
+{
+    if (format == RecordFormat::CSV)
+    {
+        //keep everything up to the last complete line
+        unsigned long long offset = 0, length = 0;
+        char buffer[64 * 1024];
+
+        while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+        {
+            std::streamsize count = stream.gcount();
+            for (std::streamsize index = count; index > 0; index--)
+            {
+                if (buffer[index - 1] == '\n')
+                {
+                    length = offset + index;
+                    break;
+                }
+            }
+            offset += count;
+        }
+
+        return length;
+    }
+
+    //a file without a complete header can not be recovered
+    RecordSchema schema;
+    if (!readBinaryHeader(stream, schema)) return 0;
+
+    unsigned long long length = (unsigned long long)stream.tellg();
+
+    //keep every block up to the first one that is truncated or fails its checksum
+    RecordBlock block(0, 0);
+    RecordRollupBlock rollup;
+    std::vector<QuantileSketch> summary;
+    while (1)
+    {
+        if (readBinaryRollupBlock(stream, rollup, (unsigned int)schema.column_names.size()) || readBinarySummaryBlock(stream, summary, (unsigned int)schema.column_names.size()))
+        {
+            length = (unsigned long long)stream.tellg();
+        }
+        else if (stream && readBinaryBlock(stream, block, (unsigned int)schema.column_names.size()))
+        {
+            length = (unsigned long long)stream.tellg();
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return length;
+}
+
+bool exportBinaryRecordToCsv(const std::string& binaryFileName, const std::string& csvFileName)
+{
+    std::ifstream input(binaryFileName, std::ios::binary);
+    if (!input.is_open()) return 0;
+
+    RecordSchema schema;
+    if (!readBinaryHeader(input, schema)) return 0;
+
+    std::ofstream output(csvFileName);
+    if (!output.is_open()) return 0;
+
+    //same precision as the recorder uses for CSV recordings
+    output << std::fixed << std::setprecision(4);
+
+    writeCsvHeader(output, schema);
+
+    //the processes are only written if the recording has any
+    std::ofstream processesOutput;
+    std::unordered_map<unsigned int, RecordProcess> processes;
+
+    //the summary is built from the exported rows so recordings that ended without one still get it
+    std::vector<QuantileSketch> summary(schema.column_names.size());
+
+    RecordBlock block(0, 0);
+    while (readBinaryBlock(input, block, (unsigned int)schema.column_names.size()))
+    {
+        writeCsvBlock(output, block);
+        updateRecordSummary(block, summary);
+
+        if (block.process_sample_counts.empty()) continue;
+
+        if (!processesOutput.is_open())
+        {
+            std::string processesFileName = csvFileName;
+            size_t extension = processesFileName.rfind(getRecordFileExtension(RecordFormat::CSV));
+            if (extension != std::string::npos) processesFileName.erase(extension);
+
+            processesOutput.open(processesFileName + " - Processes" + getRecordFileExtension(RecordFormat::CSV));
+            if (!processesOutput.is_open()) return 0;
+
+            processesOutput << std::fixed << std::setprecision(1);
+            processesOutput << CsvWallTimeColumn << ',' << CsvMonotonicTimeColumn << ",PID,Name,CPU Usage,Memory Usage,Ended\n";
+        }
+
+        for (RecordProcess& process : block.processes)
+        {
+            processes[process.Key] = process;
+        }
+
+        //one line for every sample
+        size_t sample_index = 0;
+        for (unsigned int row = 0; row < block.rows; row++)
+        {
+            std::ostringstream timeStream;
+            timeStream << formatWallTime(block.wall_times[row]) << ',' << block.timestamps[row] / 1000000 << '.' << std::setw(6) << std::setfill('0') << block.timestamps[row] % 1000000;
+            std::string time = timeStream.str();
+
+            for (unsigned int sample = 0; sample < block.process_sample_counts[row]; sample++, sample_index++)
+            {
+                const RecordProcessSample& process_sample = block.process_samples[sample_index];
+                const RecordProcess& process = processes[process_sample.Key];
+
+                //names are quoted so commas in them do not add columns
+                processesOutput << time << ',' << process.ID << ",\"" << process.Name << "\",";
+
+                if (process_sample.Ended)
+                {
+                    processesOutput << ",,1\n";
+                    processes.erase(process_sample.Key);
+                }
+                else
+                {
+                    processesOutput << process_sample.CPUUsage << ',' << process_sample.MemoryUsage << ",0\n";
+                }
+            }
+        }
+    }
+
+    writeCsvSummary(output, schema, summary);
+
+    return 1;
+}
+
+void benchmarkRecordFormats(std::ostream& out, const unsigned int columns, const unsigned int rows)
+{
+    const unsigned int rows_per_block = 60;
+
+    //generate slowly changing values similar to real sensors
+    RecordSchema schema;
+    for (unsigned int column = 0; column < columns; column++)
+    {
+        schema.column_names.push_back("Hardware.Sensor" + std::to_string(column) + ".Temperature");
+    }
+
+    std::vector<RecordBlock> blocks;
+    for (unsigned int first_row = 0; first_row < rows; first_row += rows_per_block)
+    {
+        blocks.emplace_back(columns, rows_per_block);
+        RecordBlock& block = blocks.back();
+
+        for (unsigned int row = first_row; row < rows && row < first_row + rows_per_block; row++, block.rows++)
+        {
+            block.timestamps.push_back(row * 1000000LL);
+            block.wall_times.push_back(1700000000000LL + row * 1000LL);
+            for (unsigned int column = 0; column < columns; column++)
+            {
+                //sensors report with a fixed resolution, quantize to a quarter of a unit
+                block.values.push_back((float)(std::round((40.0 + column + 5 * std::sin(row * 0.001 + column)) * 4) / 4));
+            }
+        }
+    }
+
+    const RecordFormat formats[] = { RecordFormat::CSV, RecordFormat::Binary, RecordFormat::CompressedBinary };
+    const char* formatNames[] = { "CSV", "Binary", "Compressed binary" };
+    std::vector<unsigned char> scratch;
+
+    for (int format_index = 0; format_index < 3; format_index++)
+    {
+        RecordFormat format = formats[format_index];
+        std::string fileName = "benchmark" + getRecordFileExtension(format);
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        {
+            std::ofstream stream;
+
+            if (format != RecordFormat::CSV)
+            {
+                stream.open(fileName, std::ios::binary);
+                writeBinaryHeader(stream, schema);
+            }
+            else
+            {
+                stream.open(fileName);
+                stream << std::fixed << std::setprecision(4);
+                writeCsvHeader(stream, schema);
+            }
+
+            for (const RecordBlock& block : blocks)
+            {
+                if (format == RecordFormat::Binary) writeBinaryBlock(stream, block);
+                else if (format == RecordFormat::CompressedBinary) writeCompressedBinaryBlock(stream, block, scratch);
+                else writeCsvBlock(stream, block);
+            }
+        }
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end_time - start_time).count();
+
+        //get the size of the written file
+        std::ifstream written(fileName, std::ios::binary | std::ios::ate);
+        long long size = (long long)written.tellg();
+        written.close();
+
+        out << formatNames[format_index] << ": " << size << " bytes, "
+            << std::fixed << std::setprecision(0) << (seconds > 0 ? rows / seconds : 0) << " rows/s\n";
+
+        std::remove(fileName.c_str());
+    }
+}
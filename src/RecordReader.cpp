@@ -0,0 +1,689 @@
+#include "RecordReader.h"
+#include "RecordCompression.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+* Marks the line before the column headers of a CSV recording
+*/
+static const char CsvDynamicDataMarker[] = "==== Dynamic data ====";
+
+/**
+* Reads a plain value from the mapped file
+* @return false if the value is past the end of the file
+*/
+template <typename T>
+static bool readMappedValue(const unsigned char* data, const size_t size, const size_t offset, T& value)
+{
+    if (offset + sizeof(T) > size) return 0;
+
+    memcpy(&value, data + offset, sizeof(T));
+    return 1;
+}
+
+/**
+* Gets the monotonic time of a CSV row from its second field
+* @param row The beginning of the row
+* @param line_end The end of the row
+* @return The time in microseconds since the recording started
+*/
+static long long parseCsvRowTime(const char* row, const char* line_end)
+{
+    const char* comma = (const char*)memchr(row, ',', line_end - row);
+    if (comma == nullptr) return 0;
+
+    return (long long)std::llround(strtod(comma + 1, nullptr) * 1000000.0);
+}
+
+bool RecordReader::mapFile(const std::string& fileName)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 0;
+    }
+
+    this->file_handle = file;
+    this->mapping_handle = mapping;
+    this->data = (const unsigned char*)view;
+    this->size = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    if (file < 0) return 0;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        ::close(file);
+        return 0;
+    }
+
+    void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED) return 0;
+
+    this->data = (const unsigned char*)view;
+    this->size = (size_t)fileStat.st_size;
+#endif
+
+    return 1;
+}
+
+void RecordReader::unmapFile()
+{
+    if (this->data == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+    CloseHandle((HANDLE)this->mapping_handle);
+    CloseHandle((HANDLE)this->file_handle);
+#else
+    munmap((void*)this->data, this->size);
+#endif
+
+    this->data = nullptr;
+    this->size = 0;
+    this->file_handle = nullptr;
+    this->mapping_handle = nullptr;
+}
+
+bool RecordReader::indexBinary()
+{
+    size_t offset = sizeof(BinaryRecordMagic);
+
+    //start time
+    if (!readMappedValue(data, size, offset, schema.start_time)) return 0;
+    offset += sizeof(long long);
+
+    //static info
+    unsigned int length = 0;
+    if (!readMappedValue(data, size, offset, length) || offset + sizeof(length) + length > size) return 0;
+    schema.static_info.assign((const char*)data + offset + sizeof(length), length);
+    offset += sizeof(length) + length;
+
+    //column names
+    unsigned int column_count = 0;
+    if (!readMappedValue(data, size, offset, column_count)) return 0;
+    offset += sizeof(column_count);
+
+    schema.column_names.resize(column_count);
+    for (std::string& name : schema.column_names)
+    {
+        if (!readMappedValue(data, size, offset, length) || offset + sizeof(length) + length > size) return 0;
+        name.assign((const char*)data + offset + sizeof(length), length);
+        offset += sizeof(length) + length;
+    }
+
+    //walk the block headers, only the first and last timestamps of every block are touched
+    std::vector<long long> timestamps;
+    while (offset < size)
+    {
+        IndexEntry entry = {};
+        unsigned int marker = 0, columns = 0;
+
+        if (!readMappedValue(data, size, offset, marker)) break;
+        if (!readMappedValue(data, size, offset + 4, entry.Rows)) break;
+        if (!readMappedValue(data, size, offset + 8, columns)) break;
+
+        entry.Offset = offset;
+
+        if (marker == BinaryRecordBlockMarker)
+        {
+            //a block without rows has no first and last time, the data after it is not trusted
+            if (entry.Rows == 0) break;
+
+            //header, times, columns and the checksum
+            size_t block_size = 12 + 2 * (size_t)entry.Rows * sizeof(long long) + (size_t)entry.Rows * columns * sizeof(float) + sizeof(unsigned int);
+            if (offset + block_size > size) break;
+
+            entry.Compressed = 0;
+            readMappedValue(data, size, offset + 12, entry.FirstTime);
+            readMappedValue(data, size, offset + 12 + (size_t)(entry.Rows - 1) * sizeof(long long), entry.LastTime);
+
+            offset += block_size;
+        }
+        else if (marker == BinaryRecordCompressedBlockMarker)
+        {
+            unsigned int payload_size = 0;
+            if (!readMappedValue(data, size, offset + 12, payload_size) || offset + 16 + payload_size + sizeof(unsigned int) > size || entry.Rows == 0) break;
+
+            entry.Compressed = 1;
+            entry.PayloadSize = payload_size;
+
+            //decoding a column also decodes the timestamps, the first column is the cheapest to reach
+            std::vector<float> values;
+            if (columns == 0 || !decodeCompressedColumn(data + offset + 16, payload_size, entry.Rows, columns, 0, timestamps, values)) break;
+
+            entry.FirstTime = timestamps.front();
+            entry.LastTime = timestamps.back();
+
+            offset += 16 + (size_t)payload_size + sizeof(unsigned int);
+        }
+        else if (marker == BinaryRecordRollupBlockMarker)
+        {
+            //bucket times followed by four statistics of every column and the checksum
+            unsigned int tier = 0;
+            if (!readMappedValue(data, size, offset + 12, tier) || entry.Rows == 0) break;
+
+            size_t block_size = 16 + (size_t)entry.Rows * sizeof(long long) + 4 * (size_t)entry.Rows * columns * sizeof(float) + sizeof(unsigned int);
+            if (offset + block_size > size) break;
+
+            readMappedValue(data, size, offset + 16, entry.FirstTime);
+            readMappedValue(data, size, offset + 16 + (size_t)(entry.Rows - 1) * sizeof(long long), entry.LastTime);
+            entry.LastTime += tier * 1000000LL - 1;
+
+            if (columns == schema.column_names.size())
+            {
+                rollup_index[tier].push_back(entry);
+            }
+
+            offset += block_size;
+            continue;
+        }
+        else if (marker == BinaryRecordProcessBlockMarker)
+        {
+            //processes are not indexed, the payload size takes the place of the column count
+            size_t block_size = 12 + (size_t)columns + sizeof(unsigned int);
+            if (offset + block_size > size) break;
+
+            offset += block_size;
+            continue;
+        }
+        else if (marker == BinaryRecordSummaryBlockMarker)
+        {
+            //the summary is not indexed, the payload size follows the column count
+            unsigned int payload_size = 0;
+            if (!readMappedValue(data, size, offset + 8, payload_size)) break;
+
+            size_t block_size = 12 + (size_t)payload_size + sizeof(unsigned int);
+            if (offset + block_size > size) break;
+
+            offset += block_size;
+            continue;
+        }
+        else
+        {
+            //unknown or truncated data, stop at the last valid block
+            break;
+        }
+
+        if (entry.Rows > 0 && columns == schema.column_names.size())
+        {
+            index.push_back(entry);
+        }
+    }
+
+    return 1;
+}
+
+bool RecordReader::indexCsv()
+{
+    const char* text = (const char*)data;
+    const char* end = text + size;
+
+    //find the line that marks the beginning of the dynamic data
+    const char* marker = std::search(text, end, CsvDynamicDataMarker, CsvDynamicDataMarker + strlen(CsvDynamicDataMarker));
+    if (marker == end) return 0;
+
+    const char* header = (const char*)memchr(marker, '\n', end - marker);
+    if (header == nullptr) return 0;
+    header++;
+
+    schema.static_info.assign(text, header);
+
+    //split the column headers
+    const char* header_end = (const char*)memchr(header, '\n', end - header);
+    if (header_end == nullptr) header_end = end;
+
+    std::string header_line(header, header_end);
+    if (!header_line.empty() && header_line.back() == '\r') header_line.pop_back();
+
+    size_t start = 0;
+    while (start <= header_line.size())
+    {
+        size_t comma = header_line.find(',', start);
+        if (comma == std::string::npos) comma = header_line.size();
+
+        schema.column_names.push_back(header_line.substr(start, comma - start));
+        start = comma + 1;
+    }
+
+    //recordings made before the time columns were added have rows one sampling tick apart
+    csv_row_number_time = !(schema.column_names.size() >= 2 && schema.column_names[0] == CsvWallTimeColumn && schema.column_names[1] == CsvMonotonicTimeColumn);
+
+    //only the sensors are columns, the time columns are read separately
+    if (!csv_row_number_time)
+    {
+        schema.column_names.erase(schema.column_names.begin(), schema.column_names.begin() + 2);
+    }
+
+    //record the offset of every csv_index_stride rows
+    const char* row = header_end < end ? header_end + 1 : end;
+    unsigned long long row_number = 0;
+
+    while (row < end)
+    {
+        IndexEntry entry = {};
+        entry.Offset = row - text;
+        entry.FirstTime = (long long)row_number * 1000000LL;
+
+        const char* last_row = row;
+
+        while (row < end && entry.Rows < csv_index_stride)
+        {
+            const char* line_end = (const char*)memchr(row, '\n', end - row);
+
+            //a row without a line ending is still being written
+            if (line_end == nullptr) break;
+
+            //the summary follows the last row
+            if ((size_t)(line_end - row) >= strlen(CsvSummaryMarker) && memcmp(row, CsvSummaryMarker, strlen(CsvSummaryMarker)) == 0)
+            {
+                end = row;
+                break;
+            }
+
+            //only the first and last rows of the entry have their time parsed
+            if (entry.Rows == 0 && !csv_row_number_time) entry.FirstTime = parseCsvRowTime(row, line_end);
+
+            last_row = row;
+            row = line_end + 1;
+            entry.Rows++;
+            row_number++;
+        }
+
+        if (entry.Rows == 0) break;
+
+        if (csv_row_number_time)
+        {
+            entry.LastTime = (long long)(row_number - 1) * 1000000LL;
+        }
+        else
+        {
+            entry.LastTime = parseCsvRowTime(last_row, row - 1);
+        }
+
+        index.push_back(entry);
+    }
+
+    return 1;
+}
+
+bool RecordReader::open(const std::string& fileName)
+{
+    close();
+
+    if (!mapFile(fileName)) return 0;
+
+    bool indexed = 0;
+
+    //binary recordings start with the magic, anything else is treated as CSV
+    if (size >= sizeof(BinaryRecordMagic) && memcmp(data, BinaryRecordMagic, sizeof(BinaryRecordMagic)) == 0)
+    {
+        record_format = RecordFormat::Binary;
+        indexed = indexBinary();
+    }
+    else
+    {
+        record_format = RecordFormat::CSV;
+        indexed = indexCsv();
+    }
+
+    if (!indexed)
+    {
+        close();
+        return 0;
+    }
+
+    return 1;
+}
+
+void RecordReader::close()
+{
+    unmapFile();
+
+    schema = RecordSchema();
+    index.clear();
+    rollup_index.clear();
+    csv_row_number_time = 0;
+}
+
+const RecordSchema& RecordReader::getSchema()
+{
+    return schema;
+}
+
+int RecordReader::findColumn(const std::string& name)
+{
+    for (size_t column = 0; column < schema.column_names.size(); column++)
+    {
+        if (schema.column_names[column] == name) return (int)column;
+    }
+
+    return -1;
+}
+
+bool RecordReader::getTimeRange(long long& first, long long& last)
+{
+    if (index.empty()) return 0;
+
+    first = index.front().FirstTime;
+    last = index.back().LastTime;
+
+    return 1;
+}
+
+bool RecordReader::readBinaryColumn(const IndexEntry& entry, const unsigned int column, std::vector<long long>& timestamps, std::vector<float>& values)
+{
+    unsigned int columns = (unsigned int)schema.column_names.size();
+
+    if (entry.Compressed)
+    {
+        return decodeCompressedColumn(data + entry.Offset + 16, entry.PayloadSize, entry.Rows, columns, column, timestamps, values);
+    }
+
+    //uncompressed blocks store every column as a fixed width run so it can be copied directly
+    size_t timestamps_offset = entry.Offset + 12;
+    size_t column_offset = timestamps_offset + 2 * (size_t)entry.Rows * sizeof(long long) + (size_t)column * entry.Rows * sizeof(float);
+
+    timestamps.resize(entry.Rows);
+    values.resize(entry.Rows);
+
+    memcpy(timestamps.data(), data + timestamps_offset, (size_t)entry.Rows * sizeof(long long));
+    memcpy(values.data(), data + column_offset, (size_t)entry.Rows * sizeof(float));
+
+    return 1;
+}
+
+bool RecordReader::readCsvColumn(const IndexEntry& entry, const unsigned int column, std::vector<long long>& timestamps, std::vector<float>& values)
+{
+    const char* row = (const char*)data + entry.Offset;
+    const char* end = (const char*)data + size;
+
+    timestamps.resize(entry.Rows);
+    values.resize(entry.Rows);
+
+    for (unsigned int row_index = 0; row_index < entry.Rows; row_index++)
+    {
+        const char* line_end = (const char*)memchr(row, '\n', end - row);
+        if (line_end == nullptr) return 0;
+
+        //the sensors come after the two time columns
+        unsigned int field_index = column;
+
+        if (csv_row_number_time)
+        {
+            timestamps[row_index] = entry.FirstTime + (long long)row_index * 1000000LL;
+        }
+        else
+        {
+            timestamps[row_index] = parseCsvRowTime(row, line_end);
+            field_index += 2;
+        }
+
+        //skip to the requested column
+        const char* field = row;
+        for (unsigned int skipped = 0; skipped < field_index && field < line_end; skipped++)
+        {
+            const char* comma = (const char*)memchr(field, ',', line_end - field);
+            field = comma == nullptr ? line_end : comma + 1;
+        }
+
+        //missing fields and "nan" are treated as missing values
+        values[row_index] = field < line_end ? strtof(field, nullptr) : NAN;
+
+        row = line_end + 1;
+    }
+
+    return 1;
+}
+
+bool RecordReader::query(const unsigned int column, const long long from, const long long to, const std::vector<double>& percentiles, RecordQueryResult& result)
+{
+    result = RecordQueryResult();
+
+    if (data == nullptr || column >= schema.column_names.size()) return 0;
+
+    //the index is ordered by time so the first block that can overlap the range is found with a binary search
+    auto first_entry = std::lower_bound(index.begin(), index.end(), from, [](const IndexEntry& entry, const long long time)
+    {
+        return entry.LastTime < time;
+    });
+
+    std::vector<float> range_values;
+    std::vector<long long> timestamps;
+    std::vector<float> values;
+    double sum = 0;
+
+    for (auto entry = first_entry; entry != index.end() && entry->FirstTime <= to; entry++)
+    {
+        bool read = record_format == RecordFormat::CSV ? readCsvColumn(*entry, column, timestamps, values) : readBinaryColumn(*entry, column, timestamps, values);
+        if (!read) return 0;
+
+        for (unsigned int row = 0; row < entry->Rows; row++)
+        {
+            if (timestamps[row] < from || timestamps[row] > to || std::isnan(values[row])) continue;
+
+            range_values.push_back(values[row]);
+            sum += values[row];
+        }
+    }
+
+    result.Count = range_values.size();
+    if (result.Count == 0) return 1;
+
+    auto minmax = std::minmax_element(range_values.begin(), range_values.end());
+    result.Min = *minmax.first;
+    result.Max = *minmax.second;
+    result.Average = sum / result.Count;
+
+    //nearest rank percentiles
+    for (double percentile : percentiles)
+    {
+        size_t rank = (size_t)std::ceil(percentile / 100.0 * result.Count);
+        if (rank > 0) rank--;
+        if (rank >= result.Count) rank = result.Count - 1;
+
+        std::nth_element(range_values.begin(), range_values.begin() + rank, range_values.end());
+        result.Percentiles.push_back({ percentile, range_values[rank] });
+    }
+
+    return 1;
+}
+
+bool RecordReader::readRollupColumn(const IndexEntry& entry, const unsigned int column, std::vector<long long>& bucket_times, std::vector<float>& statistics)
+{
+    unsigned int columns = (unsigned int)schema.column_names.size();
+
+    //the minimum, maximum, average and last value runs of a column are next to each other
+    size_t times_offset = entry.Offset + 16;
+    size_t column_offset = times_offset + (size_t)entry.Rows * sizeof(long long) + 4 * (size_t)column * entry.Rows * sizeof(float);
+    if (column >= columns || column_offset + 4 * (size_t)entry.Rows * sizeof(float) > size) return 0;
+
+    bucket_times.resize(entry.Rows);
+    statistics.resize(4 * (size_t)entry.Rows);
+
+    memcpy(bucket_times.data(), data + times_offset, (size_t)entry.Rows * sizeof(long long));
+    memcpy(statistics.data(), data + column_offset, 4 * (size_t)entry.Rows * sizeof(float));
+
+    return 1;
+}
+
+bool RecordReader::readRawTrend(const unsigned int column, const long long from, const long long to, const long long bucket_size, std::vector<RecordTrendPoint>& points)
+{
+    auto first_entry = std::lower_bound(index.begin(), index.end(), from, [](const IndexEntry& entry, const long long time)
+    {
+        return entry.LastTime < time;
+    });
+
+    std::vector<long long> timestamps;
+    std::vector<float> values;
+
+    RecordTrendPoint bucket;
+    unsigned long long bucket_count = 0;
+
+    for (auto entry = first_entry; entry != index.end() && entry->FirstTime <= to; entry++)
+    {
+        bool read = record_format == RecordFormat::CSV ? readCsvColumn(*entry, column, timestamps, values) : readBinaryColumn(*entry, column, timestamps, values);
+        if (!read) return 0;
+
+        for (unsigned int row = 0; row < entry->Rows; row++)
+        {
+            if (timestamps[row] < from || timestamps[row] > to || std::isnan(values[row])) continue;
+
+            long long bucket_start = bucket_size == 0 ? timestamps[row] : from + (timestamps[row] - from) / bucket_size * bucket_size;
+
+            //a row past the end of the bucket finishes it
+            if (bucket_count != 0 && bucket_start != bucket.Time)
+            {
+                bucket.Average /= bucket_count;
+                points.push_back(bucket);
+                bucket_count = 0;
+            }
+
+            if (bucket_count == 0)
+            {
+                bucket.Time = bucket_start;
+                bucket.Min = bucket.Max = values[row];
+                bucket.Average = 0;
+            }
+
+            bucket.Min = std::min(bucket.Min, (double)values[row]);
+            bucket.Max = std::max(bucket.Max, (double)values[row]);
+            bucket.Average += values[row];
+            bucket.Last = values[row];
+            bucket_count++;
+        }
+    }
+
+    if (bucket_count != 0)
+    {
+        bucket.Average /= bucket_count;
+        points.push_back(bucket);
+    }
+
+    return 1;
+}
+
+bool RecordReader::queryTrend(const unsigned int column, long long from, long long to, const unsigned int max_points, std::vector<RecordTrendPoint>& points, unsigned int& tier)
+{
+    points.clear();
+    tier = 0;
+
+    if (data == nullptr || column >= schema.column_names.size() || max_points == 0) return 0;
+
+    //only the recorded part of the range matters for picking the resolution
+    long long first = 0, last = 0;
+    if (!getTimeRange(first, last)) return 1;
+
+    from = std::max(from, first);
+    to = std::min(to, last);
+    if (from > to) return 1;
+
+    //the raw rows are used as they are if there are few enough of them
+    unsigned long long raw_rows = 0;
+    std::vector<long long> timestamps;
+    std::vector<float> values;
+    for (const IndexEntry& entry : index)
+    {
+        if (entry.LastTime < from || entry.FirstTime > to) continue;
+
+        if (entry.FirstTime >= from && entry.LastTime <= to)
+        {
+            raw_rows += entry.Rows;
+            continue;
+        }
+
+        //only the entries at the edges of the range have their rows counted one by one
+        bool read = record_format == RecordFormat::CSV ? readCsvColumn(entry, column, timestamps, values) : readBinaryColumn(entry, column, timestamps, values);
+        if (!read) return 0;
+
+        raw_rows += std::count_if(timestamps.begin(), timestamps.end(), [from, to](const long long time)
+        {
+            return time >= from && time <= to;
+        });
+    }
+
+    if (raw_rows <= max_points) return readRawTrend(column, from, to, 0, points);
+
+    //without rollups the raw rows are grouped into as many buckets as requested
+    if (rollup_index.empty())
+    {
+        long long bucket_size = (to - from) / max_points + 1;
+        return readRawTrend(column, from, to, bucket_size, points);
+    }
+
+    //the finest tier that fits, the coarsest one if none does
+    auto rollup = rollup_index.begin();
+    for (; rollup != rollup_index.end(); rollup++)
+    {
+        if ((unsigned long long)((to - from) / (rollup->first * 1000000LL)) + 1 <= max_points) break;
+    }
+    if (rollup == rollup_index.end()) rollup--;
+
+    tier = rollup->first;
+    const std::vector<IndexEntry>& entries = rollup->second;
+
+    auto first_entry = std::lower_bound(entries.begin(), entries.end(), from, [](const IndexEntry& entry, const long long time)
+    {
+        return entry.LastTime < time;
+    });
+
+    std::vector<long long> bucket_times;
+    std::vector<float> statistics;
+
+    for (auto entry = first_entry; entry != entries.end() && entry->FirstTime <= to; entry++)
+    {
+        if (!readRollupColumn(*entry, column, bucket_times, statistics)) return 0;
+
+        for (unsigned int row = 0; row < entry->Rows; row++)
+        {
+            //buckets that overlap the range at all are included
+            if (bucket_times[row] + tier * 1000000LL <= from || bucket_times[row] > to) continue;
+
+            RecordTrendPoint point;
+            point.Time = bucket_times[row];
+            point.Min = statistics[row];
+            point.Max = statistics[entry->Rows + row];
+            point.Average = statistics[2 * entry->Rows + row];
+            point.Last = statistics[3 * entry->Rows + row];
+
+            //buckets without a value
+            if (std::isnan(point.Average)) continue;
+
+            points.push_back(point);
+        }
+    }
+
+    return 1;
+}
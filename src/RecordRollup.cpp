@@ -0,0 +1,146 @@
+#include "RecordRollup.h"
+#include <cmath>
+#include <limits>
+
+void RecordRollup::reset(const unsigned int columns)
+{
+    this->columns = columns;
+
+    this->tiers.clear();
+    this->finished.clear();
+
+    for (unsigned int tier_seconds : RecordRollupTiers)
+    {
+        Tier tier;
+        tier.BucketMicroseconds = tier_seconds * 1000000LL;
+        tier.BucketStart = -1;
+        this->tiers.push_back(tier);
+
+        RecordRollupBlock block;
+        block.tier = tier_seconds;
+        block.columns = columns;
+        this->finished.push_back(block);
+    }
+}
+
+void RecordRollup::openBucket(const size_t tier, const long long bucket_start)
+{
+    Tier& current = this->tiers[tier];
+
+    current.BucketStart = bucket_start;
+    current.Min.assign(this->columns, std::numeric_limits<float>::infinity());
+    current.Max.assign(this->columns, -std::numeric_limits<float>::infinity());
+    current.Sum.assign(this->columns, 0);
+    current.Count.assign(this->columns, 0);
+    current.Last.assign(this->columns, std::numeric_limits<float>::quiet_NaN());
+}
+
+void RecordRollup::addValue(const size_t tier, const unsigned int column, const float min, const float max, const double sum, const unsigned long long count, const float last)
+{
+    Tier& current = this->tiers[tier];
+
+    if (min < current.Min[column]) current.Min[column] = min;
+    if (max > current.Max[column]) current.Max[column] = max;
+    current.Sum[column] += sum;
+    current.Count[column] += count;
+    current.Last[column] = last;
+}
+
+void RecordRollup::closeBucket(const size_t tier)
+{
+    Tier& current = this->tiers[tier];
+    if (current.BucketStart < 0) return;
+
+    RecordRollupBlock& block = this->finished[tier];
+    block.bucket_times.push_back(current.BucketStart);
+    block.rows++;
+
+    const float missing = std::numeric_limits<float>::quiet_NaN();
+
+    for (unsigned int column = 0; column < this->columns; column++)
+    {
+        bool has_value = current.Count[column] != 0;
+
+        block.min.push_back(has_value ? current.Min[column] : missing);
+        block.max.push_back(has_value ? current.Max[column] : missing);
+        block.average.push_back(has_value ? (float)(current.Sum[column] / current.Count[column]) : missing);
+        block.last.push_back(current.Last[column]);
+    }
+
+    //the next tier is built from the finished buckets of this one
+    if (tier + 1 < this->tiers.size())
+    {
+        Tier& next = this->tiers[tier + 1];
+        long long next_start = current.BucketStart - current.BucketStart % next.BucketMicroseconds;
+
+        if (next.BucketStart != next_start)
+        {
+            closeBucket(tier + 1);
+            openBucket(tier + 1, next_start);
+        }
+
+        for (unsigned int column = 0; column < this->columns; column++)
+        {
+            if (current.Count[column] == 0) continue;
+
+            addValue(tier + 1, column, current.Min[column], current.Max[column], current.Sum[column], current.Count[column], current.Last[column]);
+        }
+    }
+
+    current.BucketStart = -1;
+}
+
+void RecordRollup::addBlock(const RecordBlock& block)
+{
+    if (this->tiers.empty() || block.columns != this->columns) return;
+
+    Tier& first = this->tiers.front();
+
+    for (unsigned int row = 0; row < block.rows; row++)
+    {
+        long long bucket_start = block.timestamps[row] - block.timestamps[row] % first.BucketMicroseconds;
+
+        //a row past the end of the open bucket finishes it
+        if (first.BucketStart != bucket_start)
+        {
+            closeBucket(0);
+            openBucket(0, bucket_start);
+        }
+
+        const float* values = block.values.data() + (size_t)row * block.columns;
+        for (unsigned int column = 0; column < this->columns; column++)
+        {
+            if (std::isnan(values[column])) continue;
+
+            addValue(0, column, values[column], values[column], values[column], 1, values[column]);
+        }
+    }
+}
+
+void RecordRollup::finish()
+{
+    //every tier is closed after the one before it so the last buckets reach every tier
+    for (size_t tier = 0; tier < this->tiers.size(); tier++)
+    {
+        closeBucket(tier);
+    }
+}
+
+void RecordRollup::takeFinished(std::vector<RecordRollupBlock>& blocks)
+{
+    blocks.clear();
+
+    for (RecordRollupBlock& block : this->finished)
+    {
+        if (block.rows == 0) continue;
+
+        blocks.push_back(block);
+
+        block.rows = 0;
+        block.bucket_times.clear();
+        block.min.clear();
+        block.max.clear();
+        block.average.clear();
+        block.last.clear();
+    }
+}
@@ -0,0 +1,363 @@
+#include "RecordWriter.h"
+#include <tuple>
+#include <algorithm> //Needed for sort()
+#include <iomanip> //Needed for setprecision()
+#include <direct.h> //Needed for _wmkdir()
+#include <cstdio>
+#include <cstring>
+
+DWORD WINAPI RecordWriter::writerThreadMain(LPVOID parameter)
+{
+    RecordWriter* writer = (RecordWriter*)parameter;
+
+    //create the file on this thread so a slow disk does not stall the caller
+    writer->init_stream();
+
+    //write blocks as they arrive until the queue is closed and drained
+    std::unique_ptr<RecordBlock> block;
+    while (writer->block_queue.waitPop(block))
+    {
+        //finish the segment and start the next one here so the sampling thread never waits on it
+        if (writer->segmentFull(*block))
+        {
+            writer->close_stream();
+            writer->enforceRetention(1);
+            writer->init_stream();
+        }
+
+        writer->writeBlock(*block);
+        block.reset();
+    }
+
+    writer->close_stream();
+    writer->enforceRetention(0);
+
+    return 0;
+}
+
+void RecordWriter::init_stream()
+{
+    //make direcotory
+    std::ignore = _wmkdir(L"Recordings");
+
+    this->segment_number++;
+    this->segment_rows = 0;
+
+    //every segment summarizes and rolls up its own rows
+    this->summary.assign(this->schema.column_names.size(), QuantileSketch());
+    this->rollup.reset((unsigned int)this->schema.column_names.size());
+
+    //segments are numbered so they sort in the order they were written
+    this->segment_file_name = this->record_stream_file_name;
+    if (this->rotation_policy.rotates())
+    {
+        char segmentNumber[16];
+        snprintf(segmentNumber, sizeof(segmentNumber), " - Part %04u", this->segment_number);
+        this->segment_file_name += segmentNumber;
+    }
+
+    //the file keeps the in progress suffix until it is finished so a crash can be detected on the next start
+    std::string fileName = this->segment_file_name + getRecordFileExtension(this->record_format) + RecordInProgressSuffix;
+
+    if (this->record_format != RecordFormat::CSV)
+    {
+        //create the file and write the header
+        this->record_stream.open(fileName, std::ios::binary);
+        writeBinaryHeader(this->record_stream, this->schema);
+    }
+    else
+    {
+        //create the file and open the stream
+        this->record_stream.open(fileName);
+
+        //set the precision of the decimal output
+        this->record_stream << std::fixed << std::setprecision(4);
+
+        //print the static information and column headers
+        writeCsvHeader(this->record_stream, this->schema);
+    }
+
+    this->record_stream.flush();
+}
+
+bool RecordWriter::segmentFull(const RecordBlock& block)
+{
+    //a segment always gets at least one block
+    if (!this->record_stream.is_open() || this->segment_rows == 0 || block.rows == 0) return 0;
+
+    if (this->rotation_policy.MaxSegmentBytes != 0 && (unsigned long long)this->record_stream.tellp() >= this->rotation_policy.MaxSegmentBytes)
+    {
+        return 1;
+    }
+
+    if (this->rotation_policy.MaxSegmentSeconds != 0 && block.timestamps.front() - this->segment_first_time >= this->rotation_policy.MaxSegmentSeconds * 1000000LL)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+void RecordWriter::enforceRetention(const unsigned int reserved_segments)
+{
+    //the segments about to be written are counted as full
+    unsigned long long reserved_bytes = reserved_segments * this->rotation_policy.MaxSegmentBytes;
+
+    while (!this->finished_segments.empty())
+    {
+        bool too_many = this->rotation_policy.MaxSegments != 0 && this->finished_segments.size() + reserved_segments > this->rotation_policy.MaxSegments;
+        bool too_large = this->rotation_policy.MaxTotalBytes != 0 && this->finished_segments_bytes + reserved_bytes > this->rotation_policy.MaxTotalBytes;
+
+        if (!too_many && !too_large) break;
+
+        //delete the oldest segment
+        std::ignore = remove(this->finished_segments.front().first.c_str());
+
+        this->finished_segments_bytes -= this->finished_segments.front().second;
+        this->finished_segments.pop_front();
+    }
+}
+
+void RecordWriter::endLiveProcesses(RecordBlock& block)
+{
+    if (this->live_processes.empty() || block.process_sample_counts.empty()) return;
+
+    //the forgotten processes have lower keys than the ones the block stores again, so ending them first keeps the row sorted by key
+    std::vector<RecordProcessSample> ended;
+    ended.reserve(this->live_processes.size());
+    for (const std::pair<const unsigned int, RecordProcess>& process : this->live_processes)
+    {
+        ended.push_back({ process.first, 0, 0, 1 });
+    }
+    std::sort(ended.begin(), ended.end(), [](const RecordProcessSample& first, const RecordProcessSample& second)
+    {
+        return first.Key < second.Key;
+    });
+
+    block.process_samples.insert(block.process_samples.begin(), ended.begin(), ended.end());
+    block.process_sample_counts.front() += (unsigned int)ended.size();
+}
+
+void RecordWriter::writeBlock(RecordBlock& block)
+{
+    if (!this->record_stream.is_open()) return;
+
+    //the processes the sampling thread forgot after a dropped block would never end otherwise
+    if (block.processes_reset) endLiveProcesses(block);
+
+    //a new segment stores the processes of earlier segments again so it can be read on its own
+    this->known_processes.clear();
+    if (this->segment_rows == 0)
+    {
+        for (const std::pair<const unsigned int, RecordProcess>& process : this->live_processes)
+        {
+            this->known_processes.push_back(process.second);
+        }
+    }
+
+    if (this->segment_rows == 0 && block.rows > 0)
+    {
+        this->segment_first_time = block.timestamps.front();
+    }
+    this->segment_rows += block.rows;
+
+    //the processes of the rows are written before them
+    if (this->record_format != RecordFormat::CSV)
+    {
+        writeBinaryProcessBlock(this->record_stream, block, this->known_processes, this->compression_scratch);
+    }
+
+    if (this->record_format == RecordFormat::Binary)
+    {
+        writeBinaryBlock(this->record_stream, block);
+    }
+    else if (this->record_format == RecordFormat::CompressedBinary)
+    {
+        writeCompressedBinaryBlock(this->record_stream, block, this->compression_scratch);
+    }
+    else
+    {
+        writeCsvBlock(this->record_stream, block);
+    }
+
+    //the rollup buckets the rows finished are written next to them
+    if (this->record_format != RecordFormat::CSV)
+    {
+        this->rollup.addBlock(block);
+        writeRollups();
+    }
+
+    updateRecordSummary(block, this->summary);
+
+    //every block is a checkpoint, a crash loses at most the blocks that were not handed over yet
+    this->record_stream.flush();
+
+    //keep track of the processes that are still running for the next segment
+    for (const RecordProcess& process : block.processes)
+    {
+        this->live_processes[process.Key] = process;
+    }
+    for (const RecordProcessSample& process_sample : block.process_samples)
+    {
+        if (process_sample.Ended) this->live_processes.erase(process_sample.Key);
+    }
+}
+
+void RecordWriter::writeRollups()
+{
+    this->rollup.takeFinished(this->rollup_blocks);
+
+    for (const RecordRollupBlock& rollup_block : this->rollup_blocks)
+    {
+        writeBinaryRollupBlock(this->record_stream, rollup_block);
+    }
+}
+
+void RecordWriter::close_stream()
+{
+    //if no stream to close then return
+    if (!record_stream.is_open()) return;
+
+    //the buckets that are still open end with the segment, the summary comes after them
+    if (this->record_format != RecordFormat::CSV)
+    {
+        this->rollup.finish();
+        writeRollups();
+
+        writeBinarySummaryBlock(this->record_stream, this->summary, this->compression_scratch);
+    }
+    else
+    {
+        writeCsvSummary(this->record_stream, this->schema, this->summary);
+    }
+
+    //get the current time to add to the name
+    SYSTEMTIME localTime;
+    GetLocalTime(&localTime);
+
+    //format it without characters that are invalid in file names
+    char currentTime[16];
+    snprintf(currentTime, sizeof(currentTime), "%02u-%02u-%02u", localTime.wHour, localTime.wMinute, localTime.wSecond);
+
+    //stores the new file name to replace the old one
+    std::string extension = getRecordFileExtension(this->record_format);
+    std::string newFileName = segment_file_name + " - " + currentTime + extension;
+
+    unsigned long long segmentSize = (unsigned long long)record_stream.tellp();
+
+    //close the stream to create the file if not created
+    record_stream.close();
+
+    //rename the file to the new name
+    if (rename((segment_file_name + extension + RecordInProgressSuffix).c_str(), newFileName.c_str()) != 0)
+    {
+        newFileName = segment_file_name + extension + RecordInProgressSuffix;
+    }
+
+    //remember the segment for the retention limits
+    this->finished_segments.emplace_back(newFileName, segmentSize);
+    this->finished_segments_bytes += segmentSize;
+}
+
+unsigned int RecordWriter::recoverRecordings(const std::string& directory)
+{
+    unsigned int recovered = 0;
+
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA((directory + "\\*" + RecordInProgressSuffix).c_str(), &findData);
+    if (find == INVALID_HANDLE_VALUE) return 0;
+
+    do
+    {
+        std::string fileName = directory + "\\" + findData.cFileName;
+
+        //the name of the finished file without the in progress suffix
+        std::string finishedName = fileName.substr(0, fileName.size() - strlen(RecordInProgressSuffix));
+        std::string extension = getRecordFileExtension(RecordFormat::CSV);
+        RecordFormat format = RecordFormat::CSV;
+
+        if (finishedName.size() < extension.size() || finishedName.compare(finishedName.size() - extension.size(), extension.size(), extension) != 0)
+        {
+            //binary and compressed binary recordings share the extension and the block framing
+            extension = getRecordFileExtension(RecordFormat::Binary);
+            format = RecordFormat::Binary;
+        }
+
+        //find the end of the last valid block
+        unsigned long long length = 0;
+        {
+            std::ifstream input(fileName, std::ios::binary);
+            if (!input.is_open()) continue;
+
+            length = findRecoverableLength(input, format);
+        }
+
+        //cut off the partially written data
+        HANDLE file = CreateFileA(fileName.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) continue;
+
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)length;
+        bool truncated = SetFilePointerEx(file, end, NULL, FILE_BEGIN) && SetEndOfFile(file);
+        CloseHandle(file);
+
+        if (!truncated) continue;
+
+        //finish the file like a recording that was stopped
+        std::string recoveredName = finishedName.substr(0, finishedName.size() - extension.size()) + " - Recovered" + extension;
+        if (rename(fileName.c_str(), recoveredName.c_str()) == 0) recovered++;
+
+    } while (FindNextFileA(find, &findData));
+
+    FindClose(find);
+
+    return recovered;
+}
+
+bool RecordWriter::start(const std::string& fileName, const RecordSchema& schema, const RecordFormat format, const RecordRotationPolicy& rotationPolicy)
+{
+    //already running
+    if (this->writer_thread != NULL) return 0;
+
+    this->record_stream_file_name = fileName;
+    this->schema = schema;
+    this->record_format = format;
+    this->rotation_policy = rotationPolicy;
+
+    this->segment_number = 0;
+    this->live_processes.clear();
+    this->finished_segments.clear();
+    this->finished_segments_bytes = 0;
+
+    //accept blocks again if the queue was closed by a previous stop()
+    this->block_queue.reopen();
+
+    this->writer_thread = CreateThread(NULL, 0, writerThreadMain, this, 0, NULL);
+
+    return this->writer_thread != NULL;
+}
+
+bool RecordWriter::submit(std::unique_ptr<RecordBlock>& block)
+{
+    if (this->writer_thread == NULL) return 0;
+
+    return this->block_queue.tryPush(block);
+}
+
+void RecordWriter::stop()
+{
+    if (this->writer_thread == NULL) return;
+
+    //let the writer thread drain the queue and close the file
+    this->block_queue.close();
+
+    WaitForSingleObject(this->writer_thread, INFINITE);
+    CloseHandle(this->writer_thread);
+
+    this->writer_thread = NULL;
+}
+
+bool RecordWriter::isRunning()
+{
+    return this->writer_thread != NULL;
+}
@@ -1,7 +1,7 @@
 #include "SessionRecorder.h"
 #include <tuple>
 #include <algorithm>
-#include <iomanip> //Needed for setprecision()
+#include <limits> //Needed for quiet_NaN()
 #include <msclr\marshal_cppstd.h> //Needed to convert between System::String and std:string
 #include "GlobalFunctions.h"
 
@@ -20,23 +20,107 @@ std::string getCurrentDateAndTimeInValidFormat()
     return dateTimeString;
 }
 
-void SessionRecorder::initBuffer(OpenHardwareMonitor::Hardware::Computer^ computer)
+void SessionRecorder::initBuffer(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation)
 {
-    //resize the hardware count in the session record buffer
-    this->record_buffer.resize(computer->Hardware->Length);
+    this->hardware_column_offset.resize(computer->Hardware->Length);
+    this->hardware_sensor_count.resize(computer->Hardware->Length);
+
+    this->column_count = 0;
 
     //iterate over all available hardware
     for (int hardware_index = 0; hardware_index < computer->Hardware->Length; hardware_index++)
     {
-        //resize the sensor count of the current hardware of session record buffer
-        this->record_buffer[hardware_index].resize(computer->Hardware[hardware_index]->Sensors->Length);
+        //the sensors of the hardware are stored next to each other in the same order as the column headers
+        this->hardware_column_offset[hardware_index] = this->column_count;
+        this->hardware_sensor_count[hardware_index] = computer->Hardware[hardware_index]->Sensors->Length;
+
+        this->column_count += computer->Hardware[hardware_index]->Sensors->Length;
+    }
+
+    //the metrics of the memory follow the sensors, the system first and every NUMA node after it
+    this->memory_node_column_offset.clear();
+    if (this->memory_activity != nullptr)
+    {
+        this->memory_column_offset = this->column_count;
+        this->column_count += MemoryMetricCount;
+
+        for (auto& node : this->memory_activity->Nodes)
+        {
+            this->memory_node_column_offset[node.first] = this->column_count;
+            this->column_count += NodeMemoryMetricCount;
+        }
+    }
+
+    //the activity metrics of every physical disk follow the memory
+    this->disk_column_offset.clear();
+    if (this->record_disk_activity)
+    {
+        for (auto& physicalDisk : storageInformation.PhysicalDisks)
+        {
+            this->disk_column_offset[physicalDisk.first] = this->column_count;
+            this->column_count += DiskMetricCount;
+        }
+    }
+
+    //the capacity metrics of every volume follow the disks
+    this->volume_column_offset.clear();
+    if (this->record_volume_space)
+    {
+        for (auto& drive : storageInformation.Drives)
+        {
+            this->volume_column_offset[drive.first] = this->column_count;
+            this->column_count += VolumeMetricCount;
+        }
+    }
+
+    //the traffic metrics of every network interface follow the volumes
+    this->interface_column_offset.clear();
+    if (this->network_activity != nullptr)
+    {
+        for (auto& networkInterface : this->network_activity->Interfaces)
+        {
+            this->interface_column_offset[networkInterface.first] = this->column_count;
+            this->column_count += InterfaceMetricCount;
+        }
+    }
+
+    //the socket counts follow the interfaces
+    if (this->record_sockets)
+    {
+        this->socket_column_offset = this->column_count;
+        this->column_count += SocketStateCount;
+    }
+
+    //the TCP health follows the socket counts
+    if (this->record_tcp_health)
+    {
+        this->tcp_health_column_offset = this->column_count;
+        this->column_count += TcpHealthMetricCount;
+    }
+
+    //the health metrics of every physical disk come last when they are sampled
+    this->disk_health_column_offset.clear();
+    if (this->record_disk_health)
+    {
+        for (auto& physicalDisk : storageInformation.PhysicalDisks)
+        {
+            this->disk_health_column_offset[physicalDisk.first] = this->column_count;
+            this->column_count += DiskHealthMetricCount;
+        }
     }
+
+    this->column_sketches.assign(this->column_count, QuantileSketch());
+
+    this->current_block = std::make_unique<RecordBlock>(this->column_count, this->rows_per_block);
+    this->row_open = 0;
 }
 
-void SessionRecorder::printColumnHeaders(OpenHardwareMonitor::Hardware::Computer^ computer)
+void SessionRecorder::printColumnHeaders(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation)
 {
     if (this->column_headers_printed) return;
 
+    this->record_schema.column_names.clear();
+
     //iterate over all available hardware
     for (int hardware_index = 0; hardware_index < computer->Hardware->Length; hardware_index++)
     {
@@ -50,146 +134,230 @@ void SessionRecorder::printColumnHeaders(OpenHardwareMonitor::Hardware::Computer
             //convert string and print it
             std::string SensorType = msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Sensors[sensor_index]->SensorType.ToString());
 
-            //construct final header
-            std::string columnHeader = HardwareName + "." + SensorName + "." + SensorType;
+            //construct final header and store it in the schema
+            this->record_schema.column_names.push_back(HardwareName + "." + SensorName + "." + SensorType);
+        }
+    }
 
-            //print column header to stream
-            this->record_stream << columnHeader;
+    if (this->memory_activity != nullptr)
+    {
+        for (const MemoryMetricInfo& metric : MemoryMetricInfos)
+        {
+            this->record_schema.column_names.push_back(std::string("Memory.") + metric.Name + "." + metric.Type);
+        }
 
-            //if not the final sensor print a comma to seperate the values
-            if (!(hardware_index == computer->Hardware->Length - 1 && sensor_index == computer->Hardware[hardware_index]->Sensors->Length - 1))
+        for (auto& node : this->memory_activity->Nodes)
+        {
+            std::string NodeName = "Memory Node " + std::to_string(node.first);
+
+            for (const NodeMemoryMetricInfo& metric : NodeMemoryMetricInfos)
             {
-                this->record_stream << ',';
+                this->record_schema.column_names.push_back(NodeName + "." + metric.Name + "." + metric.Type);
+            }
+        }
+    }
+
+    //the disks are named like hardware and their metrics like sensors, in the same order as initBuffer()
+    if (this->record_disk_activity)
+    {
+        for (auto& physicalDisk : storageInformation.PhysicalDisks)
+        {
+            std::string DiskName = std::string(physicalDisk.second.FriendlyName.begin(), physicalDisk.second.FriendlyName.end());
+
+            for (const DiskMetricInfo& metric : DiskMetricInfos)
+            {
+                this->record_schema.column_names.push_back(DiskName + "." + metric.Name + "." + metric.Type);
+            }
+        }
+    }
+
+    //the volumes are named by their key, a drive letter on Windows and a mount point on Linux
+    if (this->record_volume_space)
+    {
+        for (auto& drive : storageInformation.Drives)
+        {
+            std::string VolumeName = std::string(drive.first.begin(), drive.first.end());
+
+            for (const VolumeMetricInfo& metric : VolumeMetricInfos)
+            {
+                this->record_schema.column_names.push_back(VolumeName + "." + metric.Name + "." + metric.Type);
+            }
+        }
+    }
+
+    //the interfaces are named by their adapter
+    if (this->network_activity != nullptr)
+    {
+        for (auto& networkInterface : this->network_activity->Interfaces)
+        {
+            std::string InterfaceName = std::string(networkInterface.first.begin(), networkInterface.first.end());
+
+            for (const InterfaceMetricInfo& metric : InterfaceMetricInfos)
+            {
+                this->record_schema.column_names.push_back(InterfaceName + "." + metric.Name + "." + metric.Type);
+            }
+        }
+    }
+
+    if (this->record_sockets)
+    {
+        for (const char* state : SocketStateNames)
+        {
+            this->record_schema.column_names.push_back(std::string("Connections.") + state + ".Sockets");
+        }
+    }
+
+    if (this->record_tcp_health)
+    {
+        for (const TcpHealthMetricInfo& metric : TcpHealthMetricInfos)
+        {
+            this->record_schema.column_names.push_back(std::string("TCP.") + metric.Name + "." + metric.Type);
+        }
+    }
+
+    if (this->record_disk_health)
+    {
+        for (auto& physicalDisk : storageInformation.PhysicalDisks)
+        {
+            std::string DiskName = std::string(physicalDisk.second.FriendlyName.begin(), physicalDisk.second.FriendlyName.end());
+
+            for (const DiskHealthMetricInfo& metric : DiskHealthMetricInfos)
+            {
+                this->record_schema.column_names.push_back(DiskName + "." + metric.Name + "." + metric.Type);
             }
         }
     }
-    this->record_stream << '\n';
 
     this->column_headers_printed = 1;
 }
 
 void SessionRecorder::printStaticStorageInfo(StorageInformation& storageInformation)
 {
-    //if no stream open the return
-    if (!record_stream.is_open()) return;
-
     //Print physical disks info
 
-    record_stream << "==== Physical Disks info ====\n";
+    preamble_stream << "==== Physical Disks info ====\n";
+
+    //the disks are missing if they did not answer their probe in time
+    if (storageInformation.PhysicalDisksTimedOut) preamble_stream << "Status,Timed out\n";
 
     for (auto& PhysicalDisk : storageInformation.PhysicalDisks)
     {
-        record_stream << std::string(PhysicalDisk.second.MediaType.begin(), PhysicalDisk.second.MediaType.end()) << "====>\n";
+        preamble_stream << std::string(PhysicalDisk.second.MediaType.begin(), PhysicalDisk.second.MediaType.end()) << "====>\n";
 
-        record_stream << "Name," << std::string(PhysicalDisk.second.FriendlyName.begin(), PhysicalDisk.second.FriendlyName.end()) << '\n';
+        preamble_stream << "Name," << std::string(PhysicalDisk.second.FriendlyName.begin(), PhysicalDisk.second.FriendlyName.end()) << '\n';
 
-        record_stream << "Bus Type," << std::string(PhysicalDisk.second.BusType.begin(), PhysicalDisk.second.BusType.end()) << '\n';
+        preamble_stream << "Bus Type," << std::string(PhysicalDisk.second.BusType.begin(), PhysicalDisk.second.BusType.end()) << '\n';
 
-        record_stream << "Health Status," << std::string(PhysicalDisk.second.HealthStatus.begin(), PhysicalDisk.second.HealthStatus.end()) << '\n';
+        preamble_stream << "Health Status," << std::string(PhysicalDisk.second.HealthStatus.begin(), PhysicalDisk.second.HealthStatus.end()) << '\n';
 
-        record_stream << "Device ID," << std::string(PhysicalDisk.second.DeviceID.begin(), PhysicalDisk.second.DeviceID.end()) << '\n';
+        preamble_stream << "Device ID," << std::string(PhysicalDisk.second.DeviceID.begin(), PhysicalDisk.second.DeviceID.end()) << '\n';
 
-        record_stream << "Usage," << std::string(PhysicalDisk.second.Usage.begin(), PhysicalDisk.second.Usage.end()) << '\n';
+        preamble_stream << "Usage," << std::string(PhysicalDisk.second.Usage.begin(), PhysicalDisk.second.Usage.end()) << '\n';
 
-        record_stream << "Part Number," << std::string(PhysicalDisk.second.partNumber.begin(), PhysicalDisk.second.partNumber.end()) << '\n';
+        preamble_stream << "Part Number," << std::string(PhysicalDisk.second.partNumber.begin(), PhysicalDisk.second.partNumber.end()) << '\n';
 
-        record_stream << "Physical Sector Size," << PhysicalDisk.second.PhysicalSectorSize << '\n';
+        preamble_stream << "Physical Sector Size," << PhysicalDisk.second.PhysicalSectorSize << '\n';
 
-        record_stream << "Logical Sector Size," << PhysicalDisk.second.LogicalSectorSize << '\n';
+        preamble_stream << "Logical Sector Size," << PhysicalDisk.second.LogicalSectorSize << '\n';
 
-        record_stream << "Allocated Size," << PhysicalDisk.second.AllocatedSize << '\n';
+        preamble_stream << "Allocated Size," << PhysicalDisk.second.AllocatedSize << '\n';
 
-        record_stream << "Size," << PhysicalDisk.second.Size << '\n';
+        preamble_stream << "Size," << PhysicalDisk.second.Size << '\n';
     }
 
     //print drives info
 
-    record_stream << "==== Drives info ====\n";
+    preamble_stream << "==== Drives info ====\n";
 
     for (auto& Drive : storageInformation.Drives)
     {
-        record_stream << char(Drive.first - (L'a' - 'a')) << "====>\n";
+        preamble_stream << std::string(Drive.first.begin(), Drive.first.end()) << "====>\n";
+
+        preamble_stream << "Device," << std::string(Drive.second.Device.begin(), Drive.second.Device.end()) << '\n';
+
+        if (Drive.second.ProbeTimedOut) preamble_stream << "Status,Timed out\n";
+
+        preamble_stream << "File System," << std::string(Drive.second.FileSystem.begin(), Drive.second.FileSystem.end()) << '\n';
 
-        record_stream << "Volume Name," << std::string(Drive.second.VolumeName.begin(), Drive.second.VolumeName.end()) << '\n';
+        preamble_stream << "Volume Name," << std::string(Drive.second.VolumeName.begin(), Drive.second.VolumeName.end()) << '\n';
 
-        record_stream << "Volume Type," << std::string(Drive.second.VolumeType.begin(), Drive.second.VolumeType.end()) << '\n';
+        preamble_stream << "Volume Type," << std::string(Drive.second.VolumeType.begin(), Drive.second.VolumeType.end()) << '\n';
 
-        record_stream << "Bytes Per Sector," << Drive.second.BytesPerSector << '\n';
+        preamble_stream << "Bytes Per Sector," << Drive.second.BytesPerSector << '\n';
 
-        record_stream << "Sectors Per Track," << Drive.second.SectorsPerTrack << '\n';
+        preamble_stream << "Sectors Per Track," << Drive.second.SectorsPerTrack << '\n';
 
-        record_stream << "Tracks Per Cylinder," << Drive.second.TracksPerCylinder << '\n';
+        preamble_stream << "Tracks Per Cylinder," << Drive.second.TracksPerCylinder << '\n';
 
-        record_stream << "Volume Serial Number," << Drive.second.VolumeSerialNumber << '\n';
+        preamble_stream << "Volume Serial Number," << Drive.second.VolumeSerialNumber << '\n';
 
-        record_stream << "Cylinders Quad Part," << Drive.second.Cylinders_QuadPart << '\n';
+        preamble_stream << "Cylinders Quad Part," << Drive.second.Cylinders_QuadPart << '\n';
     }
 }
 
 void SessionRecorder::printStaticNetworkInfo(NetworkInformation& networkInformation)
 {
-    //if no stream open the return
-    if (!record_stream.is_open()) return;
-
     //Print physical disks info
 
-    record_stream << "==== Network adapters ====\n";
+    preamble_stream << "==== Network adapters ====\n";
 
     for (auto& Adapter : networkInformation.Adapters)
     {
-        record_stream << std::string(Adapter.Name.begin(), Adapter.Name.end()) << "====>\n";
+        preamble_stream << std::string(Adapter.Name.begin(), Adapter.Name.end()) << "====>\n";
+
+        preamble_stream << "Adapter Type," << std::string(Adapter.AdapterType.begin(), Adapter.AdapterType.end()) << '\n';
 
-        record_stream << "Adapter Type," << std::string(Adapter.AdapterType.begin(), Adapter.AdapterType.end()) << '\n';
+        preamble_stream << "Class," << AdapterClassNames[(unsigned int)Adapter.Class] << '\n';
 
-        record_stream << "Availability," << std::string(Adapter.Availability.begin(), Adapter.Availability.end()) << '\n';
+        preamble_stream << "Availability," << std::string(Adapter.Availability.begin(), Adapter.Availability.end()) << '\n';
 
-        record_stream << "Caption," << std::string(Adapter.Caption.begin(), Adapter.Caption.end()) << '\n';
+        preamble_stream << "Caption," << std::string(Adapter.Caption.begin(), Adapter.Caption.end()) << '\n';
 
-        record_stream << "Description," << std::string(Adapter.Description.begin(), Adapter.Description.end()) << '\n';
+        preamble_stream << "Description," << std::string(Adapter.Description.begin(), Adapter.Description.end()) << '\n';
 
-        record_stream << "Device ID," << std::string(Adapter.DeviceID.begin(), Adapter.DeviceID.end()) << '\n';
+        preamble_stream << "Device ID," << std::string(Adapter.DeviceID.begin(), Adapter.DeviceID.end()) << '\n';
 
-        record_stream << "GUID," << std::string(Adapter.GUID.begin(), Adapter.GUID.end()) << '\n';
+        preamble_stream << "GUID," << std::string(Adapter.GUID.begin(), Adapter.GUID.end()) << '\n';
 
-        record_stream << "Index," << Adapter.Index << '\n';
+        preamble_stream << "Index," << Adapter.Index << '\n';
 
-        record_stream << "Install Date," << std::string(Adapter.InstallDate.begin(), Adapter.InstallDate.end()) << '\n';
+        preamble_stream << "Install Date," << std::string(Adapter.InstallDate.begin(), Adapter.InstallDate.end()) << '\n';
 
-        record_stream << "Installed," << Adapter.Installed << '\n';
+        preamble_stream << "Installed," << Adapter.Installed << '\n';
 
-        record_stream << "Interface Index," << Adapter.InterfaceIndex << '\n';
+        preamble_stream << "Interface Index," << Adapter.InterfaceIndex << '\n';
 
-        record_stream << "MAC Address," << std::string(Adapter.MACAddress.begin(), Adapter.MACAddress.end()) << '\n';
+        preamble_stream << "MAC Address," << std::string(Adapter.MACAddress.begin(), Adapter.MACAddress.end()) << '\n';
 
-        record_stream << "Manufacturer," << std::string(Adapter.Manufacturer.begin(), Adapter.Manufacturer.end()) << '\n';
+        preamble_stream << "Manufacturer," << std::string(Adapter.Manufacturer.begin(), Adapter.Manufacturer.end()) << '\n';
 
-        record_stream << "Max Number Controlled," << Adapter.MaxNumberControlled << '\n';
+        preamble_stream << "Max Number Controlled," << Adapter.MaxNumberControlled << '\n';
 
-        record_stream << "Max Speed," << Adapter.MaxSpeed << '\n';
+        preamble_stream << "Max Speed," << Adapter.MaxSpeed << '\n';
 
-        record_stream << "Net Connection ID," << std::string(Adapter.NetConnectionID.begin(), Adapter.NetConnectionID.end()) << '\n';
+        preamble_stream << "Net Connection ID," << std::string(Adapter.NetConnectionID.begin(), Adapter.NetConnectionID.end()) << '\n';
 
-        record_stream << "Net Connection Status," << Adapter.NetConnectionStatus << '\n';
+        preamble_stream << "Net Connection Status," << Adapter.NetConnectionStatus << '\n';
 
-        record_stream << "Net Enabled," << Adapter.NetEnabled << '\n';
+        preamble_stream << "Net Enabled," << Adapter.NetEnabled << '\n';
 
-        record_stream << "Permanent Address," << std::string(Adapter.PermanentAddress.begin(), Adapter.PermanentAddress.end()) << '\n';
+        preamble_stream << "Permanent Address," << std::string(Adapter.PermanentAddress.begin(), Adapter.PermanentAddress.end()) << '\n';
 
-        record_stream << "Physical Adapter," << Adapter.PhysicalAdapter << '\n';
+        preamble_stream << "Physical Adapter," << Adapter.PhysicalAdapter << '\n';
 
-        record_stream << "PNP Device ID," << std::string(Adapter.PNPDeviceID.begin(), Adapter.PNPDeviceID.end()) << '\n';
+        preamble_stream << "PNP Device ID," << std::string(Adapter.PNPDeviceID.begin(), Adapter.PNPDeviceID.end()) << '\n';
 
-        record_stream << "Power Management Supported," << Adapter.PowerManagementSupported << '\n';
+        preamble_stream << "Power Management Supported," << Adapter.PowerManagementSupported << '\n';
 
-        record_stream << "Product Name," << std::string(Adapter.ProductName.begin(), Adapter.ProductName.end()) << '\n';
+        preamble_stream << "Product Name," << std::string(Adapter.ProductName.begin(), Adapter.ProductName.end()) << '\n';
 
-        record_stream << "Service Name," << std::string(Adapter.ServiceName.begin(), Adapter.ServiceName.end()) << '\n';
+        preamble_stream << "Service Name," << std::string(Adapter.ServiceName.begin(), Adapter.ServiceName.end()) << '\n';
 
-        record_stream << "Speed," << Adapter.Speed << '\n';
+        preamble_stream << "Speed," << Adapter.Speed << '\n';
 
-        record_stream << "Status," << std::string(Adapter.Status.begin(), Adapter.Status.end()) << '\n';
+        preamble_stream << "Status," << std::string(Adapter.Status.begin(), Adapter.Status.end()) << '\n';
 
-        record_stream << "Time Of Last Reset," << std::string(Adapter.TimeOfLastReset.begin(), Adapter.TimeOfLastReset.end()) << '\n';
+        preamble_stream << "Time Of Last Reset," << std::string(Adapter.TimeOfLastReset.begin(), Adapter.TimeOfLastReset.end()) << '\n';
     }
 }
 
@@ -200,7 +368,7 @@ void SessionRecorder::printStaticInfo(StorageInformation& storageInformation, Ne
     this->printStaticNetworkInfo(networkInformation);
 
     //mark the beginning of the dynamic data
-    this->record_stream << "==== Dynamic data ====\n";
+    this->preamble_stream << "==== Dynamic data ====\n";
 }
 
 bool SessionRecorder::isRecording()
@@ -208,7 +376,76 @@ bool SessionRecorder::isRecording()
     return this->recording_active;
 }
 
-void SessionRecorder::startRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation)
+bool SessionRecorder::isRecordingProcesses()
+{
+    return this->recording_active && this->processes_active;
+}
+
+unsigned long long SessionRecorder::getDroppedRows()
+{
+    return this->dropped_rows;
+}
+
+void SessionRecorder::setRotationPolicy(const RecordRotationPolicy& policy)
+{
+    this->rotation_policy = policy;
+}
+
+void SessionRecorder::setOutputFileName(const std::string& fileName)
+{
+    this->output_file_name = fileName;
+}
+
+void SessionRecorder::setProcessRecording(const bool enabled, const unsigned int top_count)
+{
+    this->record_processes = enabled;
+    this->process_tracker.setTopCount(top_count);
+}
+
+void SessionRecorder::setDiskHealthRecording(const bool enabled)
+{
+    this->record_disk_health = enabled;
+}
+
+void SessionRecorder::setMemoryRecording(const MemoryActivity* memoryActivity)
+{
+    this->memory_activity = memoryActivity;
+}
+
+void SessionRecorder::setNetworkActivityRecording(const NetworkActivity* networkActivity)
+{
+    this->network_activity = networkActivity;
+}
+
+void SessionRecorder::setSocketRecording(const bool enabled)
+{
+    this->record_sockets = enabled;
+}
+
+void SessionRecorder::setTcpHealthRecording(const bool enabled)
+{
+    this->record_tcp_health = enabled;
+}
+
+void SessionRecorder::setDiskActivityRecording(const bool enabled)
+{
+    this->record_disk_activity = enabled;
+}
+
+void SessionRecorder::setVolumeSpaceRecording(const bool enabled)
+{
+    this->record_volume_space = enabled;
+}
+
+void SessionRecorder::setCheckpointRows(const unsigned int rows)
+{
+    //the block size is fixed while a recording is running
+    if (this->recording_active || rows == 0) return;
+
+    this->rows_per_block = rows;
+}
+
+void SessionRecorder::startRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation, const RecordFormat format)
 {
     //if recording is already active then return
     if (this->recording_active) return;
@@ -216,20 +453,43 @@ void SessionRecorder::startRecording(OpenHardwareMonitor::Hardware::Computer^ co
     //initialize variables
     initRecordingVariables();
 
-    //if the stream is not open initialize it
-    if (!this->record_stream.is_open())
+    //initialize the row layout
+    initBuffer(computer, storageInformation);
+
+    //print all static information to the preamble
+    printStaticInfo(storageInformation, networkInformation);
+    this->record_schema.static_info = this->preamble_stream.str();
+
+    //store the column headers for the dynamic data
+    printColumnHeaders(computer, storageInformation);
+
+    //mark the start of the recording, row timestamps are relative to it
+    this->record_schema.start_time = getWallTimeMilliseconds();
+    QueryPerformanceCounter(&this->start_counter);
+
+    //get current date and time to name the file with unless a name was given
+    std::string fileName = "Recordings\\" + getCurrentDateAndTimeInValidFormat();
+    if (!this->output_file_name.empty())
     {
-        this->init_stream();
+        //the writer adds the extension itself
+        std::string extension = getRecordFileExtension(format);
+        fileName = this->output_file_name;
+
+        if (fileName.size() > extension.size() && fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0)
+        {
+            fileName.erase(fileName.size() - extension.size());
+        }
     }
 
-    //mark that the recording is active
-    this->recording_active = 1;
+    //start the writer thread, it creates the file and writes the schema to every segment
+    if (!this->record_writer.start(fileName, this->record_schema, format, this->rotation_policy)) return;
 
-    //print all static information in the file
-    printStaticInfo(storageInformation, networkInformation);
+    //the CSV layout has no place for the process table
+    this->processes_active = this->record_processes && format != RecordFormat::CSV;
+    this->process_tracker.reset();
 
-    //print the column headers for the dynamic data
-    printColumnHeaders(computer);
+    //mark that the recording is active
+    this->recording_active = 1;
 }
 
 void SessionRecorder::stopRecording()
@@ -237,14 +497,16 @@ void SessionRecorder::stopRecording()
     //return if recording is not active
     if (!this->recording_active) return;
 
-    //close the stream if it is open
-    if (this->record_stream.is_open())
-    {
-        this->close_stream();
-    }
+    //hand the remaining rows to the writer thread
+    this->flush_buffer();
+
+    //wait for the writer thread to write everything and close the file
+    this->record_writer.stop();
+
+    this->recording_active = 0;
 }
 
-void SessionRecorder::toggleRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation)
+void SessionRecorder::toggleRecording(OpenHardwareMonitor::Hardware::Computer^ computer, StorageInformation& storageInformation, NetworkInformation& networkInformation, const RecordFormat format)
 {
     //if recording is active then stop recording else if it is not stop the recording
     if (this->recording_active)
@@ -253,123 +515,284 @@ void SessionRecorder::toggleRecording(OpenHardwareMonitor::Hardware::Computer^ c
     }
     else
     {
-        this->startRecording(computer, storageInformation, networkInformation);
+        this->startRecording(computer, storageInformation, networkInformation, format);
     }
 }
 
-void SessionRecorder::init_stream()
+long long SessionRecorder::getElapsedMicroseconds()
 {
-    //make direcotory
-    std::ignore = _wmkdir(L"Recordings");
+    LARGE_INTEGER now_counter, frequency;
+    QueryPerformanceCounter(&now_counter);
+    QueryPerformanceFrequency(&frequency);
 
-    //get current dat and time
-    std::string fileName = "Recordings\\" + getCurrentDateAndTimeInValidFormat();
+    long long elapsed = now_counter.QuadPart - this->start_counter.QuadPart;
+
+    //split the division to avoid overflowing on long recordings
+    return (elapsed / frequency.QuadPart) * 1000000LL + (elapsed % frequency.QuadPart) * 1000000LL / frequency.QuadPart;
+}
 
-    //add the file extension
-    fileName += ".csv";
+long long SessionRecorder::getWallTimeMilliseconds()
+{
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
 
-    //create the file and open the stream
-    this->record_stream.open(fileName);
+    //FILETIME counts 100 nanosecond intervals since 1601-01-01
+    long long ticks = ((long long)now.dwHighDateTime << 32) | now.dwLowDateTime;
+    return (ticks - 116444736000000000LL) / 10000LL;
+}
 
-    //store the file name without the extension
-    this->record_stream_file_name = fileName.substr(0, fileName.size() - 4);
+void SessionRecorder::beginRow()
+{
+    if (!this->recording_active || this->row_open) return;
 
-    //set the precision of the decimal output
-    this->record_stream << std::fixed << std::setprecision(4);
+    //start a new row with all values missing so every row has the same columns
+    this->current_block->values.resize(this->current_block->values.size() + this->column_count, std::numeric_limits<float>::quiet_NaN());
+    this->current_block->timestamps.push_back(getElapsedMicroseconds());
+    this->current_block->wall_times.push_back(getWallTimeMilliseconds());
+    this->row_open = 1;
 }
 
-void SessionRecorder::flush_buffer()
+void SessionRecorder::recordValue(const int hardware_index, const int sensor_index, const float value)
 {
-    //if no output file is open to write to create one
-    if (!record_stream.is_open())
+    if (!this->recording_active) return;
+
+    //ignore hardware and sensors that are not part of the recorded columns
+    if (hardware_index >= this->hardware_column_offset.size() || sensor_index >= this->hardware_sensor_count[hardware_index]) return;
+
+    //values recorded without beginRow() start their own row
+    if (!this->row_open) beginRow();
+
+    storeValue(this->hardware_column_offset[hardware_index] + sensor_index, value);
+}
+
+void SessionRecorder::storeValue(const size_t column, const float value)
+{
+    //store the value in its column of the current row
+    size_t row_start = (size_t)this->current_block->rows * this->column_count;
+    this->current_block->values[row_start + column] = value;
+
+    this->column_sketches[column].add(value);
+}
+
+void SessionRecorder::recordMemory(MemoryActivity& memoryActivity)
+{
+    if (!this->recording_active || this->memory_activity == nullptr) return;
+
+    if (!this->row_open) beginRow();
+
+    for (unsigned int metric = 0; metric < MemoryMetricCount; metric++)
     {
-        this->init_stream();
+        storeValue(this->memory_column_offset + metric, (float)(memoryActivity.System.*MemoryMetricInfos[metric].Value));
     }
 
-    //marks if the buffer is empty or not
-    bool buffer_not_empty = 1;
-
-    do
+    for (auto& node : memoryActivity.Nodes)
     {
-        buffer_not_empty = 0;
+        auto offset = this->memory_node_column_offset.find(node.first);
+        if (offset == this->memory_node_column_offset.end()) continue;
+
+        for (unsigned int metric = 0; metric < NodeMemoryMetricCount; metric++)
+        {
+            storeValue(offset->second + metric, (float)(node.second.*NodeMemoryMetricInfos[metric].Value));
+        }
+    }
+}
+
+void SessionRecorder::recordDiskActivity(DiskActivity& diskActivity)
+{
+    if (!this->recording_active) return;
 
-        std::vector<float> values;
+    if (!this->row_open) beginRow();
+
+    for (auto& disk : diskActivity.Disks)
+    {
+        //disks that were not there when the recording started have no columns
+        auto offset = this->disk_column_offset.find(disk.first);
+        if (offset == this->disk_column_offset.end()) continue;
 
-        //iterate over all available sensors
-        for (int hardware_index = 0; hardware_index < record_buffer.size(); hardware_index++)
+        for (unsigned int metric = 0; metric < DiskMetricCount; metric++)
         {
-            for (int sensor_index = 0; sensor_index < record_buffer[hardware_index].size(); sensor_index++)
-            {
-                //if the queue is not empty
-                if (!record_buffer[hardware_index][sensor_index].empty())
-                {
-                    //mark the buffer as not empty
-                    buffer_not_empty = 1;
+            storeValue(offset->second + metric, (float)(disk.second.*DiskMetricInfos[metric].Value));
+        }
+    }
+}
 
-                    //write value to the stream
-                    values.push_back(record_buffer[hardware_index][sensor_index].front());
+void SessionRecorder::recordVolumeSpace(VolumeSpace& volumeSpace)
+{
+    if (!this->recording_active) return;
 
-                    //pop the value from the queue
-                    record_buffer[hardware_index][sensor_index].pop();
+    if (!this->row_open) beginRow();
 
-                }
-            }
+    //the last sample is recorded every tick, a repeated value costs almost nothing once compressed
+    for (auto& volume : volumeSpace.Volumes)
+    {
+        //volumes that were mounted after the recording started have no columns
+        auto offset = this->volume_column_offset.find(volume.first);
+        if (offset == this->volume_column_offset.end()) continue;
+
+        for (unsigned int metric = 0; metric < VolumeMetricCount; metric++)
+        {
+            storeValue(offset->second + metric, (float)(volume.second.*VolumeMetricInfos[metric].Value));
         }
+    }
+}
 
-        //if there are values then print them
-        if (values.size())
+void SessionRecorder::recordNetworkActivity(NetworkActivity& networkActivity)
+{
+    if (!this->recording_active || this->network_activity == nullptr) return;
+
+    if (!this->row_open) beginRow();
+
+    for (auto& networkInterface : networkActivity.Interfaces)
+    {
+        auto offset = this->interface_column_offset.find(networkInterface.first);
+        if (offset == this->interface_column_offset.end()) continue;
+
+        for (unsigned int metric = 0; metric < InterfaceMetricCount; metric++)
         {
-            //iterate over the values
-            for (int value_index = 0; value_index < values.size(); value_index++)
-            {
-                //print the value to the stream
-                this->record_stream << values[value_index];
-
-                //if not the final sensor print a comma to seperate the values
-                if (value_index != values.size() - 1)
-                {
-                    this->record_stream << ',';
-                }
-            }
+            storeValue(offset->second + metric, (float)(networkInterface.second.*InterfaceMetricInfos[metric].Value));
         }
+    }
+}
 
-        //end the row if anything was printed
-        if (buffer_not_empty)
+void SessionRecorder::recordSockets(SocketTable& socketTable)
+{
+    if (!this->recording_active || !this->record_sockets) return;
+
+    if (!this->row_open) beginRow();
+
+    for (unsigned int state = 0; state < SocketStateCount; state++)
+    {
+        storeValue(this->socket_column_offset + state, (float)socketTable.getStateCount((SocketState)state));
+    }
+}
+
+void SessionRecorder::recordTcpHealth(const TcpHealth& tcpHealth)
+{
+    if (!this->recording_active || !this->record_tcp_health) return;
+
+    if (!this->row_open) beginRow();
+
+    for (unsigned int metric = 0; metric < TcpHealthMetricCount; metric++)
+    {
+        storeValue(this->tcp_health_column_offset + metric, (float)(tcpHealth.System.*TcpHealthMetricInfos[metric].Value));
+    }
+}
+
+void SessionRecorder::recordDiskHealth(DiskHealth& diskHealth)
+{
+    if (!this->recording_active) return;
+
+    if (!this->row_open) beginRow();
+
+    //the health is read every few minutes, the last read is recorded every tick like the volumes
+    for (auto& disk : diskHealth.Disks)
+    {
+        auto offset = this->disk_health_column_offset.find(disk.first);
+        if (offset == this->disk_health_column_offset.end()) continue;
+
+        for (unsigned int metric = 0; metric < DiskHealthMetricCount; metric++)
         {
-            this->record_stream << '\n';
+            storeValue(offset->second + metric, (float)(disk.second.*DiskHealthMetricInfos[metric].Value));
         }
+    }
+}
+
+const QuantileSketch* SessionRecorder::getSensorSketch(const int hardware_index, const int sensor_index)
+{
+    if (!this->recording_active) return nullptr;
 
-    } while (buffer_not_empty);
+    if (hardware_index >= this->hardware_column_offset.size() || sensor_index >= this->hardware_sensor_count[hardware_index]) return nullptr;
+
+    return &this->column_sketches[this->hardware_column_offset[hardware_index] + sensor_index];
 }
 
-void SessionRecorder::close_stream()
+void SessionRecorder::recordProcesses(ProcessesInformation& processesInformation)
 {
-    //if no stream to close then return
-    if (!record_stream.is_open()) return;
+    if (!this->isRecordingProcesses()) return;
 
-    //flush the remaining contents of the buffer before closing
-    this->flush_buffer();
+    if (!this->row_open) beginRow();
 
-    //stores the new file name to replace the old one
-    std::string newFileName = record_stream_file_name;
+    //only one set of process samples per row
+    if (this->current_block->process_sample_counts.size() > this->current_block->rows) return;
 
-    //get the current time to add to the name
-    System::DateTime dateTime = System::DateTime::Now;
+    for (auto& process : processesInformation.processes)
+    {
+        //processes that could not be opened have no usage to record
+        if (process.second.CPUUsage < 0) continue;
+
+        this->process_tracker.addProcess(process.first, process.second.StartTime, process.second.Name, (float)process.second.CPUUsage, process.second.MemoryUsage);
+    }
+
+    //the processes the row adds to the table are removed with it if the row is dropped
+    this->row_process_table_size = this->current_block->processes.size();
+
+    this->process_tracker.endTick(*this->current_block);
+}
+
+void SessionRecorder::commitRow()
+{
+    if (!this->recording_active || !this->row_open) return;
+
+    //rows without process samples still need a count to keep the process rows aligned
+    if (this->processes_active && this->current_block->process_sample_counts.size() == this->current_block->rows)
+    {
+        this->current_block->process_sample_counts.push_back(0);
+    }
+
+    this->current_block->rows++;
+    this->row_open = 0;
+
+    //hand the block to the writer thread once it is full
+    if (this->current_block->rows >= this->rows_per_block)
+    {
+        this->flush_buffer();
+    }
+}
+
+void SessionRecorder::flush_buffer()
+{
+    if (!this->recording_active || !this->current_block || this->current_block->rows == 0) return;
+
+    //drop any partially filled row
+    this->current_block->values.resize((size_t)this->current_block->rows * this->column_count);
+    this->current_block->timestamps.resize(this->current_block->rows);
+    this->current_block->wall_times.resize(this->current_block->rows);
+
+    //the processes of a dropped row are removed from the table with its samples, the tracker still counts them and the processes it ended so it starts over
+    bool processes_dropped = this->current_block->process_sample_counts.size() > this->current_block->rows;
+    if (processes_dropped)
+    {
+        this->current_block->process_samples.resize(this->current_block->process_samples.size() - this->current_block->process_sample_counts.back());
+        this->current_block->process_sample_counts.pop_back();
+        this->current_block->processes.resize(this->row_process_table_size);
+        this->process_tracker.reset();
+    }
+    this->row_open = 0;
 
-    //convert current time to std::string
-    std::string currentTime = msclr::interop::marshal_as<std::string>(dateTime.ToLongTimeString());
+    unsigned int rows = this->current_block->rows;
+
+    //never wait for the writer thread, if it is behind count the rows as dropped and reuse the block
+    if (!this->record_writer.submit(this->current_block))
+    {
+        this->dropped_rows += rows;
 
-    //replace invalid file naming character to valid ones
-    std::replace(currentTime.begin(), currentTime.end(), ':', '-');
+        this->current_block->rows = 0;
+        this->current_block->values.clear();
+        this->current_block->timestamps.clear();
+        this->current_block->wall_times.clear();
+        this->current_block->processes.clear();
+        this->current_block->process_samples.clear();
+        this->current_block->process_sample_counts.clear();
 
-    //add a dash and the file extension
-    newFileName += " - " + currentTime + ".csv";
+        //the process table of the dropped block is lost, store every process again and have the writer end the ones it already wrote
+        this->process_tracker.reset();
+        this->current_block->processes_reset = 1;
 
-    //close the stream to create the file if not created
-    record_stream.close();
+        return;
+    }
 
-    //rename the file to the new name
-    std::ignore = rename((record_stream_file_name + ".csv").c_str(), newFileName.c_str());
+    this->current_block = std::make_unique<RecordBlock>(this->column_count, this->rows_per_block);
+    this->current_block->processes_reset = processes_dropped;
 }
 
 void SessionRecorder::initRecordingVariables()
@@ -377,4 +800,10 @@ void SessionRecorder::initRecordingVariables()
     this->recording_active = 0;
 
     this->column_headers_printed = 0;
-}
\ No newline at end of file
+
+    this->dropped_rows = 0;
+
+    //clear the text of any previous recording
+    this->preamble_stream.str("");
+    this->preamble_stream.clear();
+}
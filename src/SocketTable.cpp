@@ -0,0 +1,507 @@
+#include "SocketTable.h"
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#endif
+
+/**
+* An empty name for the processes whose name could not be read
+*/
+static const std::wstring NoName;
+
+bool SocketTable::SocketKey::operator==(const SocketKey& other) const
+{
+    return this->Protocol == other.Protocol && this->Family == other.Family && this->LocalPort == other.LocalPort && this->RemotePort == other.RemotePort &&
+        this->Cookie == other.Cookie && memcmp(this->LocalAddress, other.LocalAddress, sizeof(this->LocalAddress)) == 0 && memcmp(this->RemoteAddress, other.RemoteAddress, sizeof(this->RemoteAddress)) == 0;
+}
+
+size_t SocketTable::SocketKeyHash::operator()(const SocketKey& key) const
+{
+    //FNV-1a over the fields, the addresses of most sockets only differ in the last bytes
+    unsigned long long hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, const size_t length)
+    {
+        for (size_t index = 0; index < length; index++)
+        {
+            hash = (hash ^ ((const unsigned char*)data)[index]) * 1099511628211ull;
+        }
+    };
+
+    add(&key.Protocol, sizeof(key.Protocol));
+    add(&key.LocalPort, sizeof(key.LocalPort));
+    add(&key.RemotePort, sizeof(key.RemotePort));
+    add(key.LocalAddress, sizeof(key.LocalAddress));
+    add(key.RemoteAddress, sizeof(key.RemoteAddress));
+    add(&key.Cookie, sizeof(key.Cookie));
+
+    return (size_t)hash;
+}
+
+void SocketTable::countSocket(const Socket& socket, const int change)
+{
+    this->state_counts[(unsigned int)socket.State] += change;
+
+    if (socket.ProcessID == 0) return;
+
+    ProcessSockets& process = this->processes[socket.ProcessID];
+    process.Sockets += change;
+    if (socket.State == SocketState::Established) process.Established += change;
+    if (socket.State == SocketState::Listen) process.Listening += change;
+
+    if (process.Sockets == 0) this->processes.erase(socket.ProcessID);
+}
+
+void SocketTable::addSocket(const SocketKey& key, const SocketState state, const unsigned int receiveQueue, const unsigned int sendQueue, const unsigned int processID, const unsigned long long inode)
+{
+    auto found = this->sockets.find(key);
+    if (found == this->sockets.end())
+    {
+        Socket& socket = this->sockets[key];
+        socket.State = state;
+        socket.ReceiveQueue = receiveQueue;
+        socket.SendQueue = sendQueue;
+        socket.ProcessID = processID;
+        socket.Inode = inode;
+        socket.Generation = this->generation;
+
+        countSocket(socket, 1);
+        return;
+    }
+
+    Socket& socket = found->second;
+
+    //only a socket that changed its state or owner moves between the counts
+    if (socket.State != state || socket.ProcessID != processID)
+    {
+        countSocket(socket, -1);
+        socket.State = state;
+        socket.ProcessID = processID;
+        countSocket(socket, 1);
+    }
+
+    socket.ReceiveQueue = receiveQueue;
+    socket.SendQueue = sendQueue;
+    socket.Inode = inode;
+    socket.Generation = this->generation;
+}
+
+void SocketTable::startSnapshot()
+{
+    this->generation++;
+}
+
+void SocketTable::finishSnapshot(const bool complete)
+{
+    //a dump that failed leaves the sockets it did not get, they are not removed as closed
+    for (auto socket = this->sockets.begin(); complete && socket != this->sockets.end();)
+    {
+        if (socket->second.Generation == this->generation)
+        {
+            socket++;
+            continue;
+        }
+
+        countSocket(socket->second, -1);
+        socket = this->sockets.erase(socket);
+    }
+
+#ifndef _WIN32
+    findOwners();
+#endif
+}
+
+const std::unordered_map<SocketTable::SocketKey, SocketTable::Socket, SocketTable::SocketKeyHash>& SocketTable::getSockets() const
+{
+    return this->sockets;
+}
+
+unsigned int SocketTable::getStateCount(const SocketState state) const
+{
+    return this->state_counts[(unsigned int)state];
+}
+
+const SocketTable::ProcessSockets* SocketTable::findProcess(const unsigned int processID) const
+{
+    auto process = this->processes.find(processID);
+    return process != this->processes.end() ? &process->second : nullptr;
+}
+
+std::vector<std::pair<unsigned int, unsigned int>> SocketTable::getTopProcesses(const size_t count) const
+{
+    std::vector<std::pair<unsigned int, unsigned int>> top;
+    top.reserve(this->processes.size());
+
+    for (auto& process : this->processes)
+    {
+        top.push_back(std::make_pair(process.first, process.second.Sockets));
+    }
+
+    //only the first count are sorted, a host has far more processes than are shown
+    size_t shown = std::min(count, top.size());
+    std::partial_sort(top.begin(), top.begin() + shown, top.end(), [](const std::pair<unsigned int, unsigned int>& first, const std::pair<unsigned int, unsigned int>& second)
+    {
+        return first.second != second.second ? first.second > second.second : first.first < second.first;
+    });
+    top.resize(shown);
+
+    return top;
+}
+
+const std::wstring& SocketTable::getProcessName(const unsigned int processID)
+{
+    auto found = this->processes.find(processID);
+    if (found == this->processes.end()) return NoName;
+
+    ProcessSockets& process = found->second;
+    if (process.NameRead) return process.Name;
+    process.NameRead = 1;
+
+#ifdef _WIN32
+    //the limited right is enough for the image name and is granted for most processes of other users
+    HANDLE handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID);
+    if (handle == NULL) return process.Name;
+
+    wchar_t path[MAX_PATH];
+    DWORD length = MAX_PATH;
+    if (QueryFullProcessImageNameW(handle, 0, path, &length))
+    {
+        std::wstring image(path, length);
+        size_t separator = image.find_last_of(L'\\');
+        process.Name = separator != std::wstring::npos ? image.substr(separator + 1) : image;
+    }
+
+    CloseHandle(handle);
+#else
+    std::string path = this->proc_root + "/" + std::to_string(processID) + "/comm";
+    int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) return process.Name;
+
+    char buffer[64];
+    ssize_t length = read(file, buffer, sizeof(buffer));
+    close(file);
+
+    if (length > 0)
+    {
+        if (buffer[length - 1] == '\n') length--;
+        process.Name = std::wstring(buffer, buffer + length);
+    }
+#endif
+
+    return process.Name;
+}
+
+#ifdef _WIN32
+/**
+* The state of a TCP socket from its MIB_TCP_STATE
+*/
+static SocketState getTcpState(const DWORD state)
+{
+    switch (state)
+    {
+    case MIB_TCP_STATE_LISTEN: return SocketState::Listen;
+    case MIB_TCP_STATE_SYN_SENT: return SocketState::SynSent;
+    case MIB_TCP_STATE_SYN_RCVD: return SocketState::SynReceived;
+    case MIB_TCP_STATE_ESTAB: return SocketState::Established;
+    case MIB_TCP_STATE_FIN_WAIT1: return SocketState::FinWait1;
+    case MIB_TCP_STATE_FIN_WAIT2: return SocketState::FinWait2;
+    case MIB_TCP_STATE_CLOSE_WAIT: return SocketState::CloseWait;
+    case MIB_TCP_STATE_CLOSING: return SocketState::Closing;
+    case MIB_TCP_STATE_LAST_ACK: return SocketState::LastAck;
+    case MIB_TCP_STATE_TIME_WAIT: return SocketState::TimeWait;
+    default: return SocketState::Closed;
+    }
+}
+
+void SocketTable::update()
+{
+    startSnapshot();
+
+    std::vector<unsigned char>& buffer = this->table_buffer;
+
+    SocketKey key;
+
+    if (PlatformSessions::readTable(buffer, [](void* table, DWORD* size) { return GetExtendedTcpTable(table, size, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0); }))
+    {
+        const MIB_TCPTABLE_OWNER_PID* table = (const MIB_TCPTABLE_OWNER_PID*)buffer.data();
+        for (DWORD row = 0; row < table->dwNumEntries; row++)
+        {
+            const MIB_TCPROW_OWNER_PID& entry = table->table[row];
+
+            memset(&key, 0, sizeof(key));
+            key.Protocol = IPPROTO_TCP;
+            key.Family = AF_INET;
+            key.LocalPort = ntohs((unsigned short)entry.dwLocalPort);
+            key.RemotePort = ntohs((unsigned short)entry.dwRemotePort);
+            memcpy(key.LocalAddress, &entry.dwLocalAddr, 4);
+            memcpy(key.RemoteAddress, &entry.dwRemoteAddr, 4);
+            key.Cookie = entry.dwOwningPid;
+
+            addSocket(key, getTcpState(entry.dwState), 0, 0, entry.dwOwningPid, 0);
+        }
+    }
+
+    if (PlatformSessions::readTable(buffer, [](void* table, DWORD* size) { return GetExtendedTcpTable(table, size, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_ALL, 0); }))
+    {
+        const MIB_TCP6TABLE_OWNER_PID* table = (const MIB_TCP6TABLE_OWNER_PID*)buffer.data();
+        for (DWORD row = 0; row < table->dwNumEntries; row++)
+        {
+            const MIB_TCP6ROW_OWNER_PID& entry = table->table[row];
+
+            memset(&key, 0, sizeof(key));
+            key.Protocol = IPPROTO_TCP;
+            key.Family = AF_INET6;
+            key.LocalPort = ntohs((unsigned short)entry.dwLocalPort);
+            key.RemotePort = ntohs((unsigned short)entry.dwRemotePort);
+            memcpy(key.LocalAddress, entry.ucLocalAddr, 16);
+            memcpy(key.RemoteAddress, entry.ucRemoteAddr, 16);
+            key.Cookie = entry.dwOwningPid;
+
+            addSocket(key, getTcpState(entry.dwState), 0, 0, entry.dwOwningPid, 0);
+        }
+    }
+
+    if (PlatformSessions::readTable(buffer, [](void* table, DWORD* size) { return GetExtendedUdpTable(table, size, FALSE, AF_INET, UDP_TABLE_OWNER_PID, 0); }))
+    {
+        const MIB_UDPTABLE_OWNER_PID* table = (const MIB_UDPTABLE_OWNER_PID*)buffer.data();
+        for (DWORD row = 0; row < table->dwNumEntries; row++)
+        {
+            const MIB_UDPROW_OWNER_PID& entry = table->table[row];
+
+            memset(&key, 0, sizeof(key));
+            key.Protocol = IPPROTO_UDP;
+            key.Family = AF_INET;
+            key.LocalPort = ntohs((unsigned short)entry.dwLocalPort);
+            memcpy(key.LocalAddress, &entry.dwLocalAddr, 4);
+            key.Cookie = entry.dwOwningPid;
+
+            addSocket(key, SocketState::Udp, 0, 0, entry.dwOwningPid, 0);
+        }
+    }
+
+    if (PlatformSessions::readTable(buffer, [](void* table, DWORD* size) { return GetExtendedUdpTable(table, size, FALSE, AF_INET6, UDP_TABLE_OWNER_PID, 0); }))
+    {
+        const MIB_UDP6TABLE_OWNER_PID* table = (const MIB_UDP6TABLE_OWNER_PID*)buffer.data();
+        for (DWORD row = 0; row < table->dwNumEntries; row++)
+        {
+            const MIB_UDP6ROW_OWNER_PID& entry = table->table[row];
+
+            memset(&key, 0, sizeof(key));
+            key.Protocol = IPPROTO_UDP;
+            key.Family = AF_INET6;
+            key.LocalPort = ntohs((unsigned short)entry.dwLocalPort);
+            memcpy(key.LocalAddress, entry.ucLocalAddr, 16);
+            key.Cookie = entry.dwOwningPid;
+
+            addSocket(key, SocketState::Udp, 0, 0, entry.dwOwningPid, 0);
+        }
+    }
+
+    finishSnapshot(1);
+}
+#else
+/**
+* The TCP states of the kernel in the order of TCP_ESTABLISHED and the ones after it
+*/
+static const SocketState KernelTcpStates[] =
+{
+    SocketState::Established, SocketState::SynSent, SocketState::SynReceived, SocketState::FinWait1, SocketState::FinWait2, SocketState::TimeWait,
+    SocketState::Closed, SocketState::CloseWait, SocketState::LastAck, SocketState::Listen, SocketState::Closing, SocketState::SynReceived
+};
+
+static double getMonotonicMilliseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+bool SocketTable::dumpSockets(const int netlink_socket, const unsigned char family, const unsigned char protocol)
+{
+    struct
+    {
+        nlmsghdr            Header;
+        inet_diag_req_v2    Request;
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.Header.nlmsg_len = sizeof(request);
+    request.Header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.Request.sdiag_family = family;
+    request.Request.sdiag_protocol = protocol;
+    request.Request.idiag_states = 0xFFFFFFFF;
+
+    return this->sessions.dumpNetlink(netlink_socket, &request.Header, this->sequence, this->netlink_buffer, [this, protocol](const char* buffer, const size_t length)
+    {
+        return parseDiagMessages(buffer, length, protocol, this->sequence);
+    });
+}
+
+bool SocketTable::parseDiagMessages(const char* buffer, const size_t length, const unsigned char protocol, const unsigned int sequence)
+{
+    unsigned int remaining = (unsigned int)length;
+    SocketKey key;
+
+    for (const nlmsghdr* message = (const nlmsghdr*)buffer; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining))
+    {
+        //the rest of an earlier dump that timed out
+        if (sequence != 0 && message->nlmsg_seq != sequence) continue;
+
+        if (message->nlmsg_type == NLMSG_DONE || message->nlmsg_type == NLMSG_ERROR) return 0;
+        if (message->nlmsg_type != SOCK_DIAG_BY_FAMILY || message->nlmsg_len < NLMSG_LENGTH(sizeof(inet_diag_msg))) continue;
+
+        const inet_diag_msg* diag = (const inet_diag_msg*)NLMSG_DATA(message);
+
+        memset(&key, 0, sizeof(key));
+        key.Protocol = protocol;
+        key.Family = diag->idiag_family;
+        key.LocalPort = ntohs(diag->id.idiag_sport);
+        key.RemotePort = ntohs(diag->id.idiag_dport);
+        memcpy(key.LocalAddress, diag->id.idiag_src, diag->idiag_family == AF_INET ? 4 : 16);
+        memcpy(key.RemoteAddress, diag->id.idiag_dst, diag->idiag_family == AF_INET ? 4 : 16);
+        key.Cookie = ((unsigned long long)diag->id.idiag_cookie[1] << 32) | diag->id.idiag_cookie[0];
+
+        SocketState state = SocketState::Udp;
+        if (protocol == IPPROTO_TCP)
+        {
+            unsigned int kernel_state = diag->idiag_state;
+            state = kernel_state >= 1 && kernel_state <= sizeof(KernelTcpStates) / sizeof(KernelTcpStates[0]) ? KernelTcpStates[kernel_state - 1] : SocketState::Closed;
+        }
+
+        //the owner is only known once the file descriptors were scanned after the socket was opened
+        unsigned int process_id = 0;
+        if (diag->idiag_inode != 0)
+        {
+            auto owner = this->inode_owners.find(diag->idiag_inode);
+            if (owner != this->inode_owners.end()) process_id = owner->second;
+        }
+
+        addSocket(key, state, diag->idiag_rqueue, diag->idiag_wqueue, process_id, diag->idiag_inode);
+    }
+
+    return 1;
+}
+
+void SocketTable::scanOwners()
+{
+    this->inode_owners.clear();
+
+    int proc_directory = this->sessions.getDirectory(this->proc_root);
+    if (proc_directory < 0) return;
+
+    //the descriptor of the sessions is shared, a duplicate is read so its position is left alone
+    int listing = openat(proc_directory, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* processes_directory = listing >= 0 ? fdopendir(listing) : nullptr;
+    if (processes_directory == nullptr)
+    {
+        if (listing >= 0) close(listing);
+        return;
+    }
+
+    static const char SocketPrefix[] = "socket:[";
+    char target[64];
+
+    while (dirent* process_entry = readdir(processes_directory))
+    {
+        if (process_entry->d_name[0] < '1' || process_entry->d_name[0] > '9') continue;
+
+        unsigned int process_id = (unsigned int)strtoul(process_entry->d_name, nullptr, 10);
+
+        //the processes of other users cannot be looked into without root, their sockets stay without an owner
+        int fd_directory = openat(proc_directory, (std::string(process_entry->d_name) + "/fd").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd_directory < 0) continue;
+
+        DIR* descriptors = fdopendir(fd_directory);
+        if (descriptors == nullptr)
+        {
+            close(fd_directory);
+            continue;
+        }
+
+        while (dirent* descriptor = readdir(descriptors))
+        {
+            if (descriptor->d_name[0] == '.') continue;
+
+            ssize_t length = readlinkat(fd_directory, descriptor->d_name, target, sizeof(target) - 1);
+            if (length <= (ssize_t)sizeof(SocketPrefix) - 1 || memcmp(target, SocketPrefix, sizeof(SocketPrefix) - 1) != 0) continue;
+
+            target[length] = '\0';
+
+            //a socket shared after a fork belongs to the first process that has it
+            this->inode_owners.emplace(strtoull(target + sizeof(SocketPrefix) - 1, nullptr, 10), process_id);
+        }
+
+        closedir(descriptors);
+    }
+
+    closedir(processes_directory);
+}
+
+void SocketTable::update()
+{
+    startSnapshot();
+
+    int netlink_socket = this->sessions.getNetlinkSocket(NETLINK_SOCK_DIAG);
+    if (netlink_socket < 0) return;
+
+    bool complete = dumpSockets(netlink_socket, AF_INET, IPPROTO_TCP);
+    complete &= dumpSockets(netlink_socket, AF_INET6, IPPROTO_TCP);
+    complete &= dumpSockets(netlink_socket, AF_INET, IPPROTO_UDP);
+    complete &= dumpSockets(netlink_socket, AF_INET6, IPPROTO_UDP);
+
+    finishSnapshot(complete);
+}
+
+void SocketTable::findOwners()
+{
+    //only scan for owners when a socket with a file has none, and not more often than the interval
+    double now = getMonotonicMilliseconds();
+    if (this->last_owner_scan >= 0 && now - this->last_owner_scan < this->owner_scan_interval) return;
+
+    bool unknown_owners = 0;
+    for (auto& socket : this->sockets)
+    {
+        if (socket.second.Inode != 0 && socket.second.ProcessID == 0 && this->unowned_inodes.find(socket.second.Inode) == this->unowned_inodes.end())
+        {
+            unknown_owners = 1;
+            break;
+        }
+    }
+
+    if (!unknown_owners) return;
+
+    scanOwners();
+    this->last_owner_scan = now;
+    this->unowned_inodes.clear();
+
+    for (auto& socket : this->sockets)
+    {
+        if (socket.second.Inode == 0 || socket.second.ProcessID != 0) continue;
+
+        auto owner = this->inode_owners.find(socket.second.Inode);
+        if (owner == this->inode_owners.end())
+        {
+            this->unowned_inodes.insert(socket.second.Inode);
+            continue;
+        }
+
+        countSocket(socket.second, -1);
+        socket.second.ProcessID = owner->second;
+        countSocket(socket.second, 1);
+    }
+}
+#endif
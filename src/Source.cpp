@@ -4,25 +4,184 @@
 #include <chrono> //Needed for time functions
 #include <iomanip> //Needed for setprecision()
 #include <sstream> //Needed for stringstream
+#include <limits> //Needed for quiet_NaN()
+#include <csignal> //Needed for signal()
+#include <cstdio> //Needed for snprintf()
+#include <cmath> //Needed for fabs() and isnan()
+#include <climits> //Needed for INT_MIN
 #include <curses.h> //to display the info
 #include <msclr\marshal_cppstd.h> //Needed to convert between System::String and std:string
 #include "SessionRecorder.h"
 #include "StorageInformation.h"
+#include "StorageWatcher.h"
+#include "CollectorRegistry.h"
 #include "GlobalFunctions.h"
 #include "NetworkInformation.h"
+#include "RecordReader.h"
+
+/**
+* The row of a value that is not in view
+*/
+const int NotOnScreen = INT_MIN;
 
 /**
 * A map used to store what row is the hardware sensor on
-* Initialized by printStaticHarwareInfo() and used by updateAndPrintSensorData()
+* Filled by drawScreen() with the sensors in view and used by printSensorData()
 * @key a pair of the hardware index and sensor index
 * @value row number on screen
 */
 std::map<std::pair<int, int>, int> sensor_screen_row;
 
 /**
-* Stores what hardware index and sensor index the free ram sensor is
+* A map used to store the row of the first activity metric of every physical disk
+* Filled by drawScreen() with the disks in view and used by printDiskActivity()
+* @key the key of the disk in StorageInformation::PhysicalDisks
+* @value row number on screen
+*/
+std::map<std::wstring, int> disk_activity_screen_row;
+
+/**
+* A map used to store the row of the first capacity metric of every volume
+* Filled by drawScreen() with the volumes in view and used by printVolumeSpace()
+* @key the key of the volume in StorageInformation::Drives
+* @value row number on screen
+*/
+std::map<std::wstring, int> volume_screen_row;
+
+/**
+* A map used to store the row of the first health metric of every physical disk
+* Filled by drawScreen() with the disks in view when the disk health is sampled and used by printDiskHealth()
+* @key the key of the disk in StorageInformation::PhysicalDisks
+* @value row number on screen
+*/
+std::map<std::wstring, int> disk_health_screen_row;
+
+/**
+* A map used to store the row of the first traffic metric of every network adapter
+* Filled by drawScreen() with the adapters in view and used by printNetworkActivity()
+* @key the name of the adapter
+* @value row number on screen
+*/
+std::map<std::wstring, int> interface_screen_row;
+
+/**
+* Marks the classes of network adapters that are printed in full, the others only get a summary row
+* Toggled with the number keys, only the physical adapters are expanded at first as a host can have hundreds of virtual ones
+*/
+bool expanded_adapter_classes[AdapterClassCount] = { 1, 0, 0, 0, 0 };
+
+/**
+* The row of the first metric of the system memory, NotOnScreen if the memory is not in view or not sampled
+* Set by drawScreen() and used by printMemory()
+*/
+int memory_screen_row = NotOnScreen;
+
+/**
+* A map used to store the row of the first metric of every NUMA node
+* Filled by drawScreen() with the nodes in view and used by printMemory()
+* @key the number of the node
+* @value row number on screen
+*/
+std::map<unsigned int, int> memory_node_screen_row;
+
+/**
+* The row of the first socket state and of the first process that owns the most sockets, NotOnScreen if the sockets are not in view or not sampled
+* Set by drawScreen() and used by printSockets()
+*/
+int socket_screen_row = NotOnScreen;
+int socket_process_screen_row = NotOnScreen;
+
+/**
+* The number of processes with the most sockets that are shown
 */
-std::pair<int, int> free_ram_index;
+const unsigned int SocketTopProcessCount = 10;
+
+/**
+* The row of the first TCP health metric, of the first remote address and of the first process with the most connections, NotOnScreen if the TCP health is not in view or not sampled
+* Set by drawScreen() and used by printTcpHealth()
+*/
+int tcp_health_screen_row = NotOnScreen;
+int tcp_endpoint_screen_row = NotOnScreen;
+int tcp_process_screen_row = NotOnScreen;
+
+/**
+* The number of remote addresses and processes with the most connections whose health is shown
+*/
+const unsigned int TcpHealthTopCount = 5;
+
+/**
+* The kinds of blocks of rows the screen is made of
+*/
+enum class ScreenBlockKind
+{
+    Hardware,
+    Memory,
+    Sockets,
+    TcpHealth,
+    StorageHeader,
+    PhysicalDisk,
+    DrivesHeader,
+    Drive,
+    NetworkHeader,
+    AdapterClass,
+    Adapter
+};
+
+/**
+* A block of rows of the screen, a hardware, a device or the header of a section
+* Only the number of rows of a block is known until it comes into view, its rows are printed when it is drawn
+*/
+struct ScreenBlock
+{
+    ScreenBlockKind     Kind;
+
+    /**
+    * The hardware index of a hardware and of the sensors of a physical disk (-1 for a disk without sensors), the index of an adapter and the class of a summary row
+    */
+    int                 Index;
+
+    /**
+    * The key of a physical disk or a drive
+    */
+    std::wstring        Key;
+
+    /**
+    * The text of the summary row of a class of adapters, counted when the screen is laid out
+    */
+    std::string         Summary;
+
+    /**
+    * The row of the whole screen the block starts at and the number of rows it takes
+    */
+    int                 FirstRow;
+    int                 Rows;
+};
+
+/**
+* Every block of the screen in order, laid out by layoutScreen() and drawn by drawScreen()
+*/
+std::vector<ScreenBlock> screen_blocks;
+
+/**
+* The samplers and the information the screen is printed from, a sampler is nullptr when its collector is disabled
+*/
+struct ScreenSources
+{
+    StorageInformation*     Storage;
+    NetworkInformation*     Network;
+    MemoryActivity*         Memory;
+    DiskActivity*           Disks;
+    VolumeSpace*            Volumes;
+    DiskHealth*             Health;
+    NetworkActivity*        Interfaces;
+    SocketTable*            Sockets;
+    TcpHealth*              Tcp;
+};
+
+/**
+* Volumes projected to be full in less than this many hours are highlighted
+*/
+const double VolumeFullWarningHours = 24;
 
 /**
 * The object that manages the recording of the session
@@ -30,589 +189,1997 @@ std::pair<int, int> free_ram_index;
 SessionRecorder sessionRecorder;
 
 /**
-* Updates and prints all sensors data from the computer object on the window object
-* Uses the sensor_screen_row map to know what row the sensor value should be printed on
-* @see printStaticHarwareInfo()
-* @param computer The computer object to get the hardware info from
+* Knows which collectors are enabled and when they are due, and owns the sessions they share
+*/
+CollectorRegistry collectorRegistry;
+
+/**
+* The collectors of the sensors of every kind of hardware
+*/
+const char* const SensorCollectors[] = { "sensors.cpu", "sensors.gpu", "sensors.ram", "sensors.mainboard", "sensors.fan-controller", "sensors.hdd" };
+
+/**
+* Gets the collector the sensors of a kind of hardware belong to
+* @param type The type of the hardware
+* @return The name of the collector
+*/
+const char* getSensorCollector(OpenHardwareMonitor::Hardware::HardwareType type)
+{
+    switch (type)
+    {
+    case OpenHardwareMonitor::Hardware::HardwareType::CPU: return "sensors.cpu";
+    case OpenHardwareMonitor::Hardware::HardwareType::GpuNvidia: return "sensors.gpu";
+    case OpenHardwareMonitor::Hardware::HardwareType::GpuAti: return "sensors.gpu";
+    case OpenHardwareMonitor::Hardware::HardwareType::RAM: return "sensors.ram";
+    case OpenHardwareMonitor::Hardware::HardwareType::HDD: return "sensors.hdd";
+    case OpenHardwareMonitor::Hardware::HardwareType::TBalancer: return "sensors.fan-controller";
+    case OpenHardwareMonitor::Hardware::HardwareType::Heatmaster: return "sensors.fan-controller";
+    default: return "sensors.mainboard";
+    }
+}
+
+/**
+* Checks which sensor collectors are due this tick, the hardware of the others is not updated and keeps its last values
+* @return If every sensor collector is due by its name
+*/
+std::map<std::string, bool> getDueSensorCollectors()
+{
+    std::map<std::string, bool> due;
+    for (const char* name : SensorCollectors)
+    {
+        due[name] = collectorRegistry.isDue(name);
+    }
+
+    return due;
+}
+
+/**
+* Checks if a row of the window is in view, the rows of a block that starts above the window are negative
+* @param window The Curses window the row is printed on
+* @param row The row of the window
+*/
+bool isRowInView(WINDOW* window, const int row)
+{
+    return row >= 0 && row < getmaxy(window);
+}
+
+/**
+* Checks if any row of a range of rows of the window is in view
+* @param window The Curses window the rows are printed on
+* @param first_row The first row of the range
+* @param rows The number of rows in the range
+*/
+bool isRangeInView(WINDOW* window, const int first_row, const int rows)
+{
+    return first_row < getmaxy(window) && first_row + rows > 0;
+}
+
+/**
+* Prints the values of the sensors that are in view
+* Uses the sensor_screen_row map to know what row the sensor value should be printed on, the sensors that are not in view are not in it
+* @see drawScreen()
+* @param computer The computer object to get the sensor values from
 * @param window The Curses window to print the info on
 */
-void updateAndPrintSensorData(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window, bool add_to_buffer = 0)
+void printSensorData(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window)
 {
-    //Iterate over all of the available hardware
-    for (int hardware_index = 0; hardware_index < computer->Hardware->Length; hardware_index++)
+    for (auto& sensor_row : sensor_screen_row)
     {
-        //Update hardware data
-        computer->Hardware[hardware_index]->Update();
+        OpenHardwareMonitor::Hardware::ISensor^ sensor = computer->Hardware[sensor_row.first.first]->Sensors[sensor_row.first.second];
+
+        //if has value set it else set it to "NULL" text
+        std::string value = sensor->Value.HasValue ? toString(sensor->Value.Value) : "NULL";
 
-        //Iterate over all available sensors
-        for (int sesnor_index = 0; sesnor_index < computer->Hardware[hardware_index]->Sensors->Length; sesnor_index++) {
+        //print data
+        mvwprintw(window, sensor_row.second, 50, value.c_str());
 
-            //If there is not a row assigned to the current sensor do not print it
-            if (sensor_screen_row.find(std::make_pair(hardware_index, sesnor_index)) == sensor_screen_row.end())
+        //while recording the percentiles of the sensor so far are shown next to its value
+        const QuantileSketch* sketch = sessionRecorder.getSensorSketch(sensor_row.first.first, sensor_row.first.second);
+        if (sketch != nullptr && sketch->getCount() != 0)
+        {
+            //the same percentiles as the summary written at the end of the recording
+            std::string percentiles;
+            for (double percentile : RecordSummaryPercentiles)
             {
-                continue;
+                char label[32] = "";
+                snprintf(label, sizeof(label), "p%g %-10.2f ", percentile, sketch->getQuantile(percentile / 100));
+                percentiles += label;
             }
+            mvwprintw(window, sensor_row.second, 65, "%-48s", percentiles.c_str());
+        }
+    }
+}
+
+/**
+* Prints the activity of the physical disks that are in view
+* Uses the disk_activity_screen_row map to know what row the metrics of a disk should be printed on
+* @param diskActivity The disk activity object to get the metrics from
+* @param window The Curses window to print the info on
+*/
+void printDiskActivity(DiskActivity& diskActivity, WINDOW* window)
+{
+    for (auto& disk_row : disk_activity_screen_row)
+    {
+        auto disk = diskActivity.Disks.find(disk_row.first);
+        if (disk == diskActivity.Disks.end()) continue;
 
-            std::string value; //stores the value to print
+        for (unsigned int metric = 0; metric < DiskMetricCount; metric++)
+        {
+            if (!isRowInView(window, disk_row.second + metric)) continue;
 
-            //if add_to_buffer or in other terms if the session is being recorded then add the values to the buffer
-            if (sessionRecorder.isRecording())
-            {
-                sessionRecorder.record_buffer[hardware_index][sesnor_index].push(computer->Hardware[hardware_index]->Sensors[sesnor_index]->Value.Value);
-            }
+            std::string value = toString((float)(disk->second.*DiskMetricInfos[metric].Value), 2) + " " + DiskMetricInfos[metric].Unit;
+            mvwprintw(window, disk_row.second + metric, 50, "%-15s", value.c_str());
+        }
+    }
+}
 
-            //Error handling
-            //if has value set it else set it to "NULL" text
-            if (computer->Hardware[hardware_index]->Sensors[sesnor_index]->Value.HasValue) {
-                value = toString(computer->Hardware[hardware_index]->Sensors[sesnor_index]->Value.Value);
+/**
+* Formats a volume or disk health metric, sizes and rates in bytes are scaled to the largest unit that keeps them above 1
+* @param value The value of the metric
+* @param unit The unit of the metric
+* @return The formatted value, "-" if the metric has no value
+*/
+std::string formatMetric(double value, std::string unit)
+{
+    if (std::isnan(value)) return "-";
 
-            }
-            else 
-            {
-                value = "NULL";
-            }
+    if (!unit.empty() && unit[0] == 'B')
+    {
+        const char* const prefixes[] = { "", "K", "M", "G", "T", "P" };
+        int prefix = 0;
 
-            //print data
-            mvwprintw(window, sensor_screen_row[std::make_pair(hardware_index, sesnor_index)], 50, value.c_str());
+        while (fabs(value) >= 1024 && prefix < 5)
+        {
+            value /= 1024;
+            prefix++;
         }
-        //if add_to_buffer or in other terms if the session is being recorded then add the values to the buffer
-        if (sessionRecorder.isRecording())
+
+        unit = prefixes[prefix] + unit;
+    }
+
+    return toString((float)value, 2) + " " + unit;
+}
+
+/**
+* Prints the traffic of the network adapters that are in view
+* Uses the interface_screen_row map to know what row the metrics of an adapter should be printed on
+* @param networkActivity The network activity object to get the metrics from
+* @param window The Curses window to print the info on
+*/
+void printNetworkActivity(NetworkActivity& networkActivity, WINDOW* window)
+{
+    for (auto& interface_row : interface_screen_row)
+    {
+        auto networkInterface = networkActivity.Interfaces.find(interface_row.first);
+        if (networkInterface == networkActivity.Interfaces.end()) continue;
+
+        for (unsigned int metric = 0; metric < InterfaceMetricCount; metric++)
         {
-            //check if we exceeded the maximum buffer size, if yes then flush the buffer
-            double free_memory = computer->Hardware[free_ram_index.first]->Sensors[free_ram_index.second]->Value.Value;
-                
-            //if the size of the buffer exceeds the 5% of the current available memory then flush it
-            if (sizeof(sessionRecorder.record_buffer) >= (free_memory * 1024LL * 1024 * 1024) * 0.05)
-            {
-                sessionRecorder.flush_buffer();
-            }
+            if (!isRowInView(window, interface_row.second + metric)) continue;
+
+            std::string value = formatMetric(networkInterface->second.*InterfaceMetricInfos[metric].Value, InterfaceMetricInfos[metric].Unit);
+            mvwprintw(window, interface_row.second + metric, 50, "%-15s", value.c_str());
         }
     }
 }
 
 /**
-* Prints the physical disk info from the PhysicalDisks std::map from the storageInformation parameter
-* @param window The curses window to print the information on
-* @param name The physical disk name
-* @param current_display_row The current current row we are printing on in the curses window object
-* @param storageInformation A StorageInformation object to get the info of the physical disk from
+* Prints the counts of sockets per state with the processes that own the most sockets if they are in view
+* Uses socket_screen_row and socket_process_screen_row to know what row the counts and processes should be printed on, only the rows in view are formatted
+* @param socketTable The socket table to get the counts from
+* @param window The Curses window to print the info on
 */
-void PrintPhysicalDiskInfo(WINDOW* window, const std::wstring name, int &current_display_row, StorageInformation& storageInformation)
+void printSockets(SocketTable& socketTable, WINDOW* window)
 {
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Device ID");
-    
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].DeviceID.begin(), storageInformation.PhysicalDisks[name].DeviceID.end()).c_str());
-    current_display_row++;
+    for (unsigned int state = 0; socket_screen_row != NotOnScreen && state < SocketStateCount; state++)
+    {
+        if (!isRowInView(window, socket_screen_row + state)) continue;
 
+        mvwprintw(window, socket_screen_row + state, 50, "%-15s", toString((unsigned long long)socketTable.getStateCount((SocketState)state)).c_str());
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Bus Type");
-    
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].BusType.begin(), storageInformation.PhysicalDisks[name].BusType.end()).c_str());
-    current_display_row++;
+    if (socket_process_screen_row == NotOnScreen) return;
 
+    std::vector<std::pair<unsigned int, unsigned int>> top = socketTable.getTopProcesses(SocketTopProcessCount);
+    for (unsigned int index = 0; index < top.size(); index++)
+    {
+        int row = socket_process_screen_row + index;
+        if (!isRowInView(window, row)) continue;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Media Type");
+        const std::wstring& name = socketTable.getProcessName(top[index].first);
+        const SocketTable::ProcessSockets* process = socketTable.findProcess(top[index].first);
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].MediaType.begin(), storageInformation.PhysicalDisks[name].MediaType.end()).c_str());
-    current_display_row++;
+        mvwprintw(window, row, 15, "%-19.19s", std::string(name.begin(), name.end()).c_str());
+        mvwprintw(window, row, 35, "%-15s", ("PID " + toString((unsigned long long)top[index].first)).c_str());
+        mvwprintw(window, row, 50, "%-45s", (toString((unsigned long long)process->Sockets) + " sockets, " + toString((unsigned long long)process->Established) + " established, " + toString((unsigned long long)process->Listening) + " listening").c_str());
+    }
+}
 
+/**
+* Prints the connections, round trip time and retransmits of a remote address or process on a row of the TCP health
+*/
+void PrintTcpHealthRow(WINDOW* window, const int row, const std::string& name, const std::string& detail, const TcpHealthMetrics& metrics)
+{
+    mvwprintw(window, row, 15, "%-19.19s", name.c_str());
+    mvwprintw(window, row, 35, "%-15s", detail.c_str());
+    mvwprintw(window, row, 50, "%-45s", (toString((unsigned long long)metrics.Connections) + " connections, RTT " + formatMetric(metrics.AverageRtt, "ms") + ", " + formatMetric(metrics.RetransmitRatio, "%") + " retransmitted").c_str());
+}
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Part Number");
+/**
+* Prints the health of the TCP connections with the remote addresses and processes that have the most connections if they are in view
+* Uses tcp_health_screen_row, tcp_endpoint_screen_row and tcp_process_screen_row to know what row the metrics, addresses and processes should be printed on, only the rows in view are formatted
+* @param tcpHealth The TCP health sampler to get the metrics from
+* @param socketTable The socket table to get the names of the processes from, nullptr if the sockets are not sampled
+* @param window The Curses window to print the info on
+*/
+void printTcpHealth(TcpHealth& tcpHealth, SocketTable* socketTable, WINDOW* window)
+{
+    for (unsigned int metric = 0; tcp_health_screen_row != NotOnScreen && metric < TcpHealthMetricCount; metric++)
+    {
+        if (!isRowInView(window, tcp_health_screen_row + metric)) continue;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].partNumber.begin(), storageInformation.PhysicalDisks[name].partNumber.end()).c_str());
-    current_display_row++;
+        std::string value = formatMetric(tcpHealth.System.*TcpHealthMetricInfos[metric].Value, TcpHealthMetricInfos[metric].Unit);
+        mvwprintw(window, tcp_health_screen_row + metric, 50, "%-15s", value.c_str());
+    }
 
+    //the top addresses and processes are only worked out when their rows are in view
+    if (tcp_endpoint_screen_row != NotOnScreen)
+    {
+        std::vector<TcpHealth::EndpointHealth> endpoints = tcpHealth.getTopEndpoints(TcpHealthTopCount);
+        for (unsigned int index = 0; index < endpoints.size(); index++)
+        {
+            if (!isRowInView(window, tcp_endpoint_screen_row + index)) continue;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Health Status");
+            PrintTcpHealthRow(window, tcp_endpoint_screen_row + index, endpoints[index].Address, "max " + formatMetric(endpoints[index].Metrics.MaxRtt, "ms"), endpoints[index].Metrics);
+        }
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].HealthStatus.begin(), storageInformation.PhysicalDisks[name].HealthStatus.end()).c_str());
-    current_display_row++;
+    if (tcp_process_screen_row == NotOnScreen) return;
 
+    std::vector<TcpHealth::ProcessHealth> processes = tcpHealth.getTopProcesses(TcpHealthTopCount);
+    for (unsigned int index = 0; index < processes.size(); index++)
+    {
+        if (!isRowInView(window, tcp_process_screen_row + index)) continue;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Size");
+        std::wstring name = socketTable != nullptr ? socketTable->getProcessName(processes[index].ProcessID) : std::wstring();
+        PrintTcpHealthRow(window, tcp_process_screen_row + index, std::string(name.begin(), name.end()), "PID " + toString((unsigned long long)processes[index].ProcessID), processes[index].Metrics);
+    }
+}
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].Size).c_str());
-    current_display_row++;
+/**
+* Prints the memory of the system and of the NUMA nodes that are in view
+* Uses memory_screen_row and the memory_node_screen_row map to know what row the metrics should be printed on, only the rows in view are formatted
+* @param memoryActivity The memory activity object to get the metrics from
+* @param window The Curses window to print the info on
+*/
+void printMemory(MemoryActivity& memoryActivity, WINDOW* window)
+{
+    for (unsigned int metric = 0; memory_screen_row != NotOnScreen && metric < MemoryMetricCount; metric++)
+    {
+        if (!isRowInView(window, memory_screen_row + metric)) continue;
 
+        std::string value = formatMetric(memoryActivity.System.*MemoryMetricInfos[metric].Value, MemoryMetricInfos[metric].Unit);
+        mvwprintw(window, memory_screen_row + metric, 50, "%-15s", value.c_str());
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Allocated Size");
-    
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].AllocatedSize).c_str());
-    current_display_row++;
+    for (auto& node_row : memory_node_screen_row)
+    {
+        auto node = memoryActivity.Nodes.find(node_row.first);
+        if (node == memoryActivity.Nodes.end()) continue;
 
+        for (unsigned int metric = 0; metric < NodeMemoryMetricCount; metric++)
+        {
+            if (!isRowInView(window, node_row.second + metric)) continue;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Logical Sector Size");
+            std::string value = formatMetric(node->second.*NodeMemoryMetricInfos[metric].Value, NodeMemoryMetricInfos[metric].Unit);
+            mvwprintw(window, node_row.second + metric, 50, "%-15s", value.c_str());
+        }
+    }
+}
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].LogicalSectorSize).c_str());
-    current_display_row++;
+/**
+* Prints the capacity of the volumes that are in view
+* Uses the volume_screen_row map to know what row the metrics of a volume should be printed on
+* @param volumeSpace The volume space object to get the metrics from
+* @param window The Curses window to print the info on
+*/
+void printVolumeSpace(VolumeSpace& volumeSpace, WINDOW* window)
+{
+    for (auto& volume_row : volume_screen_row)
+    {
+        auto volume = volumeSpace.Volumes.find(volume_row.first);
+        if (volume == volumeSpace.Volumes.end()) continue;
 
+        for (unsigned int metric = 0; metric < VolumeMetricCount; metric++)
+        {
+            if (!isRowInView(window, volume_row.second + metric)) continue;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Physical Sector Size");
+            std::string value = formatMetric(volume->second.*VolumeMetricInfos[metric].Value, VolumeMetricInfos[metric].Unit);
+            mvwprintw(window, volume_row.second + metric, 50, "%-15s", value.c_str());
+        }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].PhysicalSectorSize).c_str());
-    current_display_row++;
+        //a volume that will soon be full is marked next to its projection
+        if (volume->second.HoursToFull < VolumeFullWarningHours && isRowInView(window, volume_row.second + VolumeMetricCount - 1)) mvwprintw(window, volume_row.second + VolumeMetricCount - 1, 65, "Filling up");
+    }
 }
 
-void PrintNetworkAdapterInfo(WINDOW* window, const int index, int& current_display_row, NetworkInformation& networkInformation)
+/**
+* Prints the health of the physical disks that are in view, as it was last read
+* Uses the disk_health_screen_row map to know what row the metrics of a disk should be printed on
+* @param diskHealth The disk health object to get the metrics from
+* @param window The Curses window to print the info on
+*/
+void printDiskHealth(DiskHealth& diskHealth, WINDOW* window)
 {
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Adapter Type");
-
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].AdapterType.begin(), networkInformation.Adapters[index].AdapterType.end()).c_str());
-    current_display_row++;
+    for (auto& disk_row : disk_health_screen_row)
+    {
+        auto disk = diskHealth.Disks.find(disk_row.first);
+        if (disk == diskHealth.Disks.end()) continue;
 
+        for (unsigned int metric = 0; metric < DiskHealthMetricCount; metric++)
+        {
+            if (!isRowInView(window, disk_row.second + metric)) continue;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Availability");
+            std::string value = formatMetric(disk->second.*DiskHealthMetricInfos[metric].Value, DiskHealthMetricInfos[metric].Unit);
+            mvwprintw(window, disk_row.second + metric, 50, "%-15s", value.c_str());
+        }
+    }
+}
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Availability.begin(), networkInformation.Adapters[index].Availability.end()).c_str());
+/**
+* Prints the names of the metrics of the system memory and of every NUMA node and stores the rows they start at
+* @param window The curses window to print the information on
+* @param memoryActivity The memory activity object to get the NUMA nodes from
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintMemoryNames(WINDOW* window, MemoryActivity& memoryActivity, int& current_display_row)
+{
+    //Print category name
+    mvwprintw(window, current_display_row, 0, "Memory");
     current_display_row++;
 
+    if (isRangeInView(window, current_display_row, MemoryMetricCount)) memory_screen_row = current_display_row;
+
+    for (const MemoryMetricInfo& metric : MemoryMetricInfos)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, metric.Name);
+            mvwprintw(window, current_display_row, 35, metric.Type);
+        }
+        current_display_row++;
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Caption");
+    for (auto& node : memoryActivity.Nodes)
+    {
+        current_display_row++;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Caption.begin(), networkInformation.Adapters[index].Caption.end()).c_str());
-    current_display_row++;
+        //Print node name
+        if (isRowInView(window, current_display_row)) mvwprintw(window, current_display_row, 5, ("Node " + std::to_string(node.first)).c_str());
+        current_display_row++;
 
+        if (isRangeInView(window, current_display_row, NodeMemoryMetricCount)) memory_node_screen_row[node.first] = current_display_row;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Description");
+        for (const NodeMemoryMetricInfo& metric : NodeMemoryMetricInfos)
+        {
+            if (isRowInView(window, current_display_row))
+            {
+                mvwprintw(window, current_display_row, 15, metric.Name);
+                mvwprintw(window, current_display_row, 35, metric.Type);
+            }
+            current_display_row++;
+        }
+    }
+}
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Description.begin(), networkInformation.Adapters[index].Description.end()).c_str());
-    current_display_row++;
+/**
+* Prints the names of the health metrics of a physical disk and stores the row they start at
+* @param window The curses window to print the information on
+* @param name The physical disk key
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintDiskHealthNames(WINDOW* window, const std::wstring& name, int& current_display_row)
+{
+    //only a group with rows in view is stored, its values are printed from the first row even if it starts above the window
+    if (isRangeInView(window, current_display_row, DiskHealthMetricCount)) disk_health_screen_row[name] = current_display_row;
+
+    for (const DiskHealthMetricInfo& metric : DiskHealthMetricInfos)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, metric.Name);
+            mvwprintw(window, current_display_row, 35, metric.Type);
+        }
+        current_display_row++;
+    }
+}
 
+/**
+* Prints the names of the capacity metrics of a volume and stores the row they start at
+* @param window The curses window to print the information on
+* @param Volume The volume key
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintVolumeSpaceNames(WINDOW* window, const std::wstring& Volume, int& current_display_row)
+{
+    if (isRangeInView(window, current_display_row, VolumeMetricCount)) volume_screen_row[Volume] = current_display_row;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Device ID");
+    for (const VolumeMetricInfo& metric : VolumeMetricInfos)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, metric.Name);
+            mvwprintw(window, current_display_row, 35, metric.Type);
+        }
+        current_display_row++;
+    }
+}
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].DeviceID.begin(), networkInformation.Adapters[index].DeviceID.end()).c_str());
+/**
+* Prints the names of the socket states and the rows of the processes that own the most sockets and stores the rows they start at
+* @param window The curses window to print the information on
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintSocketNames(WINDOW* window, int& current_display_row)
+{
+    //Print category name
+    mvwprintw(window, current_display_row, 0, "Connections");
     current_display_row++;
 
+    if (isRangeInView(window, current_display_row, SocketStateCount)) socket_screen_row = current_display_row;
+
+    for (const char* state : SocketStateNames)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, state);
+            mvwprintw(window, current_display_row, 35, "Sockets");
+        }
+        current_display_row++;
+    }
+
+    current_display_row++;
+
+    //the processes change every snapshot, only their rows are reserved here
+    mvwprintw(window, current_display_row, 5, "Top processes by sockets");
+    current_display_row++;
+
+    if (isRangeInView(window, current_display_row, SocketTopProcessCount)) socket_process_screen_row = current_display_row;
+    current_display_row += SocketTopProcessCount;
+}
+
+/**
+* Prints the names of the TCP health metrics and the rows of the remote addresses and processes with the most connections and stores the rows they start at
+* @param window The curses window to print the information on
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintTcpHealthNames(WINDOW* window, int& current_display_row)
+{
+    //Print category name
+    mvwprintw(window, current_display_row, 0, "TCP health");
+    current_display_row++;
+
+    if (isRangeInView(window, current_display_row, TcpHealthMetricCount)) tcp_health_screen_row = current_display_row;
+
+    for (const TcpHealthMetricInfo& metric : TcpHealthMetricInfos)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, metric.Name);
+            mvwprintw(window, current_display_row, 35, metric.Type);
+        }
+        current_display_row++;
+    }
+
+    current_display_row++;
+
+    //the addresses and processes change every sample, only their rows are reserved here
+    mvwprintw(window, current_display_row, 5, "Top remote addresses by connections");
+    current_display_row++;
+
+    if (isRangeInView(window, current_display_row, TcpHealthTopCount)) tcp_endpoint_screen_row = current_display_row;
+    current_display_row += TcpHealthTopCount + 1;
+
+    mvwprintw(window, current_display_row, 5, "Top processes by connections");
+    current_display_row++;
+
+    if (isRangeInView(window, current_display_row, TcpHealthTopCount)) tcp_process_screen_row = current_display_row;
+    current_display_row += TcpHealthTopCount;
+}
+
+/**
+* Prints the names of the activity metrics of a physical disk and stores the row they start at
+* @param window The curses window to print the information on
+* @param name The physical disk key
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintDiskActivityNames(WINDOW* window, const std::wstring& name, int& current_display_row)
+{
+    if (isRangeInView(window, current_display_row, DiskMetricCount)) disk_activity_screen_row[name] = current_display_row;
+
+    for (const DiskMetricInfo& metric : DiskMetricInfos)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, metric.Name);
+            mvwprintw(window, current_display_row, 35, metric.Type);
+        }
+        current_display_row++;
+    }
+}
+
+/**
+* Prints the names of the traffic metrics of a network adapter and stores the row they start at
+* @param window The curses window to print the information on
+* @param name The name of the adapter
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintInterfaceActivityNames(WINDOW* window, const std::wstring& name, int& current_display_row)
+{
+    if (isRangeInView(window, current_display_row, InterfaceMetricCount)) interface_screen_row[name] = current_display_row;
+
+    for (const InterfaceMetricInfo& metric : InterfaceMetricInfos)
+    {
+        if (isRowInView(window, current_display_row))
+        {
+            mvwprintw(window, current_display_row, 15, metric.Name);
+            mvwprintw(window, current_display_row, 35, metric.Type);
+        }
+        current_display_row++;
+    }
+}
+
+/**
+* The number of rows PrintPhysicalDiskInfo() takes
+*/
+const int PhysicalDiskInfoRows = 9;
+
+/**
+* Prints the physical disk info from the PhysicalDisks std::map from the storageInformation parameter
+* @param window The curses window to print the information on
+* @param name The physical disk name
+* @param current_display_row The current current row we are printing on in the curses window object
+* @param storageInformation A StorageInformation object to get the info of the physical disk from
+*/
+void PrintPhysicalDiskInfo(WINDOW* window, const std::wstring name, int &current_display_row, StorageInformation& storageInformation)
+{
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Device ID");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].DeviceID.begin(), storageInformation.PhysicalDisks[name].DeviceID.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Bus Type");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].BusType.begin(), storageInformation.PhysicalDisks[name].BusType.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Media Type");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].MediaType.begin(), storageInformation.PhysicalDisks[name].MediaType.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Part Number");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].partNumber.begin(), storageInformation.PhysicalDisks[name].partNumber.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Health Status");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.PhysicalDisks[name].HealthStatus.begin(), storageInformation.PhysicalDisks[name].HealthStatus.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Size");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].Size).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Allocated Size");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].AllocatedSize).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Logical Sector Size");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].LogicalSectorSize).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Physical Sector Size");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.PhysicalDisks[name].PhysicalSectorSize).c_str());
+    }
+    current_display_row++;
+}
+
+/**
+* The number of rows PrintNetworkAdapterInfo() takes
+*/
+const int NetworkAdapterInfoRows = 26;
+
+void PrintNetworkAdapterInfo(WINDOW* window, const int index, int& current_display_row, NetworkInformation& networkInformation)
+{
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Adapter Type");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].AdapterType.begin(), networkInformation.Adapters[index].AdapterType.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Availability");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Availability.begin(), networkInformation.Adapters[index].Availability.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Caption");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Caption.begin(), networkInformation.Adapters[index].Caption.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Description");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Description.begin(), networkInformation.Adapters[index].Description.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Device ID");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].DeviceID.begin(), networkInformation.Adapters[index].DeviceID.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "GUID");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].GUID.begin(), networkInformation.Adapters[index].GUID.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Index");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(networkInformation.Adapters[index].Index).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Install Date");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].InstallDate.begin(), networkInformation.Adapters[index].InstallDate.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Installed");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].Installed).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Interface Index");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(networkInformation.Adapters[index].InterfaceIndex).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "MAC Address");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].MACAddress.begin(), networkInformation.Adapters[index].MACAddress.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Manufacturer");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Manufacturer.begin(), networkInformation.Adapters[index].Manufacturer.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Max Number Controlled");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(networkInformation.Adapters[index].MaxNumberControlled).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Max Speed");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((unsigned long long)networkInformation.Adapters[index].MaxSpeed).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Net Connection ID");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].NetConnectionID.begin(), networkInformation.Adapters[index].NetConnectionID.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Net Connection Status");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].NetConnectionStatus).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Net Enabled");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].NetEnabled).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Permanent Address");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].PermanentAddress.begin(), networkInformation.Adapters[index].PermanentAddress.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Physical Adapter");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].PhysicalAdapter).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "PNP Device ID");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].PNPDeviceID.begin(), networkInformation.Adapters[index].PNPDeviceID.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Power Management Supported");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].PowerManagementSupported).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Product Name");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].ProductName.begin(), networkInformation.Adapters[index].ProductName.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Service Name");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].ServiceName.begin(), networkInformation.Adapters[index].ServiceName.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Net Enabled");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString((unsigned long long)networkInformation.Adapters[index].Speed).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Status");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Status.begin(), networkInformation.Adapters[index].Status.end()).c_str());
+    }
+    current_display_row++;
+
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Time Of Last Reset");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].TimeOfLastReset.begin(), networkInformation.Adapters[index].TimeOfLastReset.end()).c_str());
+    }
+    current_display_row++;
+}
+
+/**
+* The number of rows PrintDriveInfo() takes
+*/
+const int DriveInfoRows = 9;
+
+/**
+* Prints the drive info from the Drives std::map from the storageInformation parameter
+* @param window The curses window to print the information on
+* @param Volume The volume key of the drive
+* @param current_display_row The current current row we are printing on in the curses window object
+* @param storageInformation A StorageInformation object to get the info of the drive from
+*/
+void PrintDriveInfo(WINDOW* window, const std::wstring& Volume, int& current_display_row, StorageInformation& storageInformation)
+{
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Device");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.Drives[Volume].Device.begin(), storageInformation.Drives[Volume].Device.end()).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "File System");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.Drives[Volume].FileSystem.begin(), storageInformation.Drives[Volume].FileSystem.end()).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Bytes Per Sector");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[Volume].BytesPerSector).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Sectors Per Track");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[Volume].SectorsPerTrack).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Tracks Per Cylinder");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[Volume].TracksPerCylinder).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Volume Serial Number");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[Volume].VolumeSerialNumber).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Cylinders Quad Part");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[Volume].Cylinders_QuadPart).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "VolumeType");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.Drives[Volume].VolumeType.begin(), storageInformation.Drives[Volume].VolumeType.end()).c_str());
+    }
+    current_display_row++;
+
+    if (isRowInView(window, current_display_row))
+    {
+        //Print name
+        mvwprintw(window, current_display_row, 15, "Volume Name");
+
+        //print value
+        mvwprintw(window, current_display_row, 50, std::string(storageInformation.Drives[Volume].VolumeName.begin(), storageInformation.Drives[Volume].VolumeName.end()).c_str());
+    }
+    current_display_row++;
+}
+
+/**
+* Prints a drive with the names of its capacity metrics and its static info
+* @param window The curses window to print the information on
+* @param Volume The volume key
+* @param current_display_row The current current row we are printing on in the curses window object
+* @param storageInformation A StorageInformation object to get the info of the drive from
+*/
+void PrintDrive(WINDOW* window, const std::wstring& Volume, int& current_display_row, StorageInformation& storageInformation)
+{
+    if (isRowInView(window, current_display_row))
+    {
+        //Print the volume, the drive letter or the mount point
+        mvwprintw(window, current_display_row, 5, std::string(Volume.begin(), Volume.end()).c_str());
+
+        //a drive that did not answer its probe in time is marked until it does, a drive that was just plugged in until it answers
+        const char* status = "";
+        if (storageInformation.Drives[Volume].ProbeTimedOut) status = "Timed out";
+        else if (storageInformation.isProbing(Volume)) status = "Probing";
+
+        mvwprintw(window, current_display_row, 50, "%-15s", status);
+    }
+    current_display_row++;
+
+    //Print the names of the capacity metrics, their values are updated every sample
+    if (collectorRegistry.isEnabled("volume-space")) PrintVolumeSpaceNames(window, Volume, current_display_row);
+
+    //Print all static info of the disk
+    PrintDriveInfo(window, Volume, current_display_row, storageInformation);
+}
+
+/**
+* Prints the sensors of a given hardware that are in view and moves the current row past all of them
+* @param computer The computer object to get the hardware info from
+* @param window The curses window to print the info on
+* @param hardware_index The index of the hardware to print the sesnors of
+* @param current_display_row The current current row we are printing on in the curses window object
+*/
+void PrintHardwareSensors(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window, unsigned int hardware_index, int& current_display_row)
+{
+    int sensor_count = computer->Hardware[hardware_index]->Sensors->Length;
+
+    //only the sensors in view are printed, a hardware can have more of them than fit on the screen
+    int first_sensor = current_display_row < 0 ? std::min(-current_display_row, sensor_count) : 0;
+    int last_sensor = std::min(sensor_count, getmaxy(window) - current_display_row);
+
+    //Iterate over the sensors in view
+    for (int sensor_index = first_sensor; sensor_index < last_sensor; sensor_index++) {
+
+        int row = current_display_row + sensor_index;
+
+        //convert string and print it
+        std::string SensorName = msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Sensors[sensor_index]->Name);
+        mvwprintw(window, row, 15, std::string(SensorName.begin(), SensorName.end()).c_str());
+
+        //convert string and print it
+        std::string SensorType = msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Sensors[sensor_index]->SensorType.ToString());
+        mvwprintw(window, row, 35, SensorType.c_str());
+
+        //save the position of this sensor to be used in printing the dynamic sensor data
+        sensor_screen_row[std::make_pair(hardware_index, sensor_index)] = row;
+    }
+
+    current_display_row += sensor_count;
+}
+
+/**
+* Prints a network adapter with the names of its traffic metrics and all of its static info
+* @param window The curses window to print the information on
+* @param index The index of the adapter in the Adapters vector
+* @param current_display_row The current current row we are printing on in the curses window object
+* @param networkInformation A NetworkInformation object to get the info of the adapter from
+*/
+void PrintNetworkAdapter(WINDOW* window, const int index, int& current_display_row, NetworkInformation& networkInformation)
+{
+    //print name
+    if (isRowInView(window, current_display_row)) mvwprintw(window, current_display_row, 5, std::string(networkInformation.Adapters[index].Name.begin(), networkInformation.Adapters[index].Name.end()).c_str());
+    current_display_row++;
+
+    //Print the names of the traffic metrics, their values are updated every tick
+    if (collectorRegistry.isEnabled("network-activity")) PrintInterfaceActivityNames(window, networkInformation.Adapters[index].Name, current_display_row);
+
+    //print all static info of the adapter
+    PrintNetworkAdapterInfo(window, index, current_display_row, networkInformation);
+
+    //leave a blank line
+    current_display_row += 2;
+}
+
+/**
+* Adds a block to the end of the screen
+* @param current_display_row The row the block starts at, moved past it
+*/
+void addScreenBlock(const ScreenBlockKind kind, const int index, const std::wstring& key, const int rows, int& current_display_row)
+{
+    ScreenBlock block;
+    block.Kind = kind;
+    block.Index = index;
+    block.Key = key;
+    block.FirstRow = current_display_row;
+    block.Rows = rows;
+
+    screen_blocks.push_back(block);
+    current_display_row += rows;
+}
+
+/**
+* Lays out the blocks the screen is made of, nothing is printed and only the number of rows of every block is worked out
+* Called at the start and again when a device is added or removed or a class of adapters is expanded or collapsed
+* @see drawScreen()
+* @param computer The computer object to get the hardware and sensors from
+* @param sources The samplers and information the blocks are printed from
+* @return The number of rows of the whole screen
+*/
+int layoutScreen(OpenHardwareMonitor::Hardware::Computer^ computer, const ScreenSources& sources)
+{
+    screen_blocks.clear();
+
+    int current_display_row = 0; //keeps track of what row the next block starts at
+
+    //stores the index of OpenHardwareMonitor storage devices with its name as the key and index as the value
+    std::map<std::string, int> storageDevices;
+
+    //every hardware is its name, its sensors and a blank line, the storage devices are shown with the physical disks
+    for (int hardware_index = 0; hardware_index < computer->Hardware->Length; hardware_index++)
+    {
+        if (computer->Hardware[hardware_index]->HardwareType == OpenHardwareMonitor::Hardware::HardwareType::HDD)
+        {
+            storageDevices[msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Name)] = hardware_index;
+            continue;
+        }
+
+        addScreenBlock(ScreenBlockKind::Hardware, hardware_index, L"", 1 + computer->Hardware[hardware_index]->Sensors->Length + 2, current_display_row);
+    }
+
+    //the memory, the sockets and the TCP health come after the hardware sensors
+    if (sources.Memory != nullptr)
+    {
+        addScreenBlock(ScreenBlockKind::Memory, 0, L"", 1 + MemoryMetricCount + (int)sources.Memory->Nodes.size() * (2 + NodeMemoryMetricCount) + 2, current_display_row);
+    }
+
+    if (sources.Sockets != nullptr)
+    {
+        addScreenBlock(ScreenBlockKind::Sockets, 0, L"", 1 + SocketStateCount + 2 + SocketTopProcessCount + 1, current_display_row);
+    }
+
+    if (sources.Tcp != nullptr)
+    {
+        addScreenBlock(ScreenBlockKind::TcpHealth, 0, L"", 1 + TcpHealthMetricCount + 2 + TcpHealthTopCount + 2 + TcpHealthTopCount + 1, current_display_row);
+    }
+
+    addScreenBlock(ScreenBlockKind::StorageHeader, 0, L"", 2, current_display_row);
+
+    for (auto& physicalDisk : sources.Storage->PhysicalDisks)
+    {
+        //the sensors of a disk that is recognized by the OpenHardwareMonitor::Computer object are shown under it
+        auto device = storageDevices.find(std::string(physicalDisk.second.FriendlyName.begin(), physicalDisk.second.FriendlyName.end()));
+        int hardware_index = device != storageDevices.end() ? device->second : -1;
+
+        int rows = 1 + PhysicalDiskInfoRows + 2;
+        if (hardware_index >= 0) rows += computer->Hardware[hardware_index]->Sensors->Length;
+        if (collectorRegistry.isEnabled("disk-activity")) rows += DiskMetricCount;
+        if (collectorRegistry.isEnabled("disk-health")) rows += DiskHealthMetricCount;
+
+        addScreenBlock(ScreenBlockKind::PhysicalDisk, hardware_index, physicalDisk.first, rows, current_display_row);
+    }
+
+    addScreenBlock(ScreenBlockKind::DrivesHeader, 0, L"", 2, current_display_row);
+
+    for (auto& Drive : sources.Storage->Drives)
+    {
+        int rows = 1 + DriveInfoRows + 2;
+        if (collectorRegistry.isEnabled("volume-space")) rows += VolumeMetricCount;
+
+        addScreenBlock(ScreenBlockKind::Drive, 0, Drive.first, rows, current_display_row);
+    }
+
+    addScreenBlock(ScreenBlockKind::NetworkHeader, 0, L"", 2, current_display_row);
+
+    int adapter_rows = 1 + NetworkAdapterInfoRows + 2;
+    if (collectorRegistry.isEnabled("network-activity")) adapter_rows += InterfaceMetricCount;
+
+    for (unsigned int adapter_class = 0; adapter_class < AdapterClassCount; adapter_class++)
+    {
+        size_t up = 0;
+        size_t count = sources.Network->countAdapters((AdapterClass)adapter_class, up);
+        if (count == 0) continue;
+
+        //a collapsed class only takes its summary row, its counts are kept so drawing it never goes through the adapters
+        addScreenBlock(ScreenBlockKind::AdapterClass, (int)adapter_class, L"", 2, current_display_row);
+        screen_blocks.back().Summary = toString((unsigned long long)count) + " adapters, " + toString((unsigned long long)up) + " up";
+
+        if (!expanded_adapter_classes[adapter_class]) continue;
+
+        for (int adapter_index = 0; adapter_index < sources.Network->Adapters.size(); adapter_index++)
+        {
+            if (sources.Network->Adapters[adapter_index].Class != (AdapterClass)adapter_class) continue;
+
+            addScreenBlock(ScreenBlockKind::Adapter, adapter_index, L"", adapter_rows, current_display_row);
+        }
+    }
+
+    return current_display_row;
+}
+
+/**
+* Prints the names and static info of a block, only the rows in view are formatted and stored in the row maps
+* @param computer The computer object to get the hardware info from
+* @param window The Curses window to print the info on
+* @param block The block to print
+* @param current_display_row The row of the window the block starts at, negative if it starts above the window
+* @param sources The samplers and information the block is printed from
+*/
+void printScreenBlock(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window, const ScreenBlock& block, int current_display_row, const ScreenSources& sources)
+{
+    switch (block.Kind)
+    {
+    case ScreenBlockKind::Hardware:
+        //print hardware name
+        if (isRowInView(window, current_display_row)) mvwprintw(window, current_display_row, 0, msclr::interop::marshal_as<std::string>(computer->Hardware[block.Index]->Name).c_str());
+        current_display_row++;
+
+        //Print all available sensors of the device
+        PrintHardwareSensors(computer, window, block.Index, current_display_row);
+        break;
+
+    case ScreenBlockKind::Memory:
+        PrintMemoryNames(window, *sources.Memory, current_display_row);
+        break;
+
+    case ScreenBlockKind::Sockets:
+        PrintSocketNames(window, current_display_row);
+        break;
+
+    case ScreenBlockKind::TcpHealth:
+        PrintTcpHealthNames(window, current_display_row);
+        break;
+
+    case ScreenBlockKind::StorageHeader:
+        //Print category name
+        mvwprintw(window, current_display_row, 0, "Storage Devices");
+
+        //the disks are left out if they did not answer in time
+        if (sources.Storage->PhysicalDisksTimedOut) mvwprintw(window, current_display_row, 50, "Timed out");
+        break;
+
+    case ScreenBlockKind::PhysicalDisk:
+        //Print disk name
+        if (isRowInView(window, current_display_row)) mvwprintw(window, current_display_row, 5, std::string(block.Key.begin(), block.Key.end()).c_str());
+        current_display_row++;
+
+        //Print all available sensors of the device
+        if (block.Index >= 0) PrintHardwareSensors(computer, window, block.Index, current_display_row);
+
+        //Print the names of the activity metrics, their values are printed from the last sample
+        if (collectorRegistry.isEnabled("disk-activity")) PrintDiskActivityNames(window, block.Key, current_display_row);
+
+        //Print the names of the health metrics, their values are printed from the last read
+        if (collectorRegistry.isEnabled("disk-health")) PrintDiskHealthNames(window, block.Key, current_display_row);
+
+        //Print all static info of the disk
+        PrintPhysicalDiskInfo(window, block.Key, current_display_row, *sources.Storage);
+        break;
+
+    case ScreenBlockKind::DrivesHeader:
+        //Print category name
+        mvwprintw(window, current_display_row, 0, "Drives");
+        break;
+
+    case ScreenBlockKind::Drive:
+        PrintDrive(window, block.Key, current_display_row, *sources.Storage);
+        break;
+
+    case ScreenBlockKind::NetworkHeader:
+        //Print category name
+        mvwprintw(window, current_display_row, 0, "Network adapters");
+        break;
+
+    case ScreenBlockKind::AdapterClass:
+        if (!isRowInView(window, current_display_row)) break;
+
+        mvwprintw(window, current_display_row, 5, (std::string(expanded_adapter_classes[block.Index] ? "[-] " : "[+] ") + AdapterClassNames[block.Index] + " adapters").c_str());
+        mvwprintw(window, current_display_row, 35, ("Press " + toString(block.Index + 1)).c_str());
+        mvwprintw(window, current_display_row, 50, block.Summary.c_str());
+        break;
+
+    case ScreenBlockKind::Adapter:
+        PrintNetworkAdapter(window, block.Index, current_display_row, *sources.Network);
+        break;
+    }
+}
+
+/**
+* Draws the rows of the screen that are in view, only the blocks in view are printed and only their values are looked up
+* The cost of a draw depends on the size of the window and not on how many sensors, devices and adapters there are
+* @see layoutScreen()
+* @param computer The computer object to get the hardware info from
+* @param window The Curses window to print the info on, as big as the part of the terminal it is shown in
+* @param first_row The row of the whole screen shown at the top of the window
+* @param sources The samplers and information the rows are printed from
+*/
+void drawScreen(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window, const int first_row, const ScreenSources& sources)
+{
+    werase(window);
+
+    //forget the rows of everything that was in view before
+    sensor_screen_row.clear();
+    disk_activity_screen_row.clear();
+    volume_screen_row.clear();
+    disk_health_screen_row.clear();
+    interface_screen_row.clear();
+    memory_node_screen_row.clear();
+    memory_screen_row = NotOnScreen;
+    socket_screen_row = NotOnScreen;
+    socket_process_screen_row = NotOnScreen;
+    tcp_health_screen_row = NotOnScreen;
+    tcp_endpoint_screen_row = NotOnScreen;
+    tcp_process_screen_row = NotOnScreen;
+
+    int window_rows = getmaxy(window);
+
+    //the first block in view is the last one that starts at or above the top row
+    auto block = std::upper_bound(screen_blocks.begin(), screen_blocks.end(), first_row, [](const int row, const ScreenBlock& screenBlock) { return row < screenBlock.FirstRow; });
+    if (block != screen_blocks.begin()) block--;
+
+    for (; block != screen_blocks.end() && block->FirstRow < first_row + window_rows; block++)
+    {
+        printScreenBlock(computer, window, *block, block->FirstRow - first_row, sources);
+    }
+
+    //the values are printed on the rows that the blocks in view stored
+    printSensorData(computer, window);
+    if (sources.Memory != nullptr) printMemory(*sources.Memory, window);
+    if (sources.Sockets != nullptr) printSockets(*sources.Sockets, window);
+    if (sources.Tcp != nullptr) printTcpHealth(*sources.Tcp, sources.Sockets, window);
+    if (sources.Disks != nullptr) printDiskActivity(*sources.Disks, window);
+    if (sources.Health != nullptr) printDiskHealth(*sources.Health, window);
+    if (sources.Volumes != nullptr) printVolumeSpace(*sources.Volumes, window);
+    if (sources.Interfaces != nullptr) printNetworkActivity(*sources.Interfaces, window);
+}
+
+/**
+* Merges the drives that answered their probe late and the devices that were plugged in or removed, and updates the samplers to match
+* Every watcher and sampler is nullptr when its collector is disabled
+* @param storageWatcher The watcher that tells which devices changed
+* @return What changed in the storage devices
+*/
+StorageInformation::StorageChanges refreshStorage(StorageInformation& storageInformation, StorageWatcher* storageWatcher, DiskActivity* diskActivity, VolumeSpace* volumeSpace, DiskHealth* diskHealth)
+{
+    StorageInformation::StorageChanges changes = storageInformation.collectLateProbes();
+
+    //only the side that changed is read again
+    unsigned int watched_changes = storageWatcher != nullptr && collectorRegistry.isDue("storage-watcher") ? storageWatcher->poll() : 0;
+    if (watched_changes & StorageWatcher::DrivesChanged) changes.append(storageInformation.refreshDrives());
+    if (watched_changes & StorageWatcher::DisksChanged) changes.append(storageInformation.refreshPhysicalDisks());
+
+    if (changes.empty()) return changes;
+
+    //the devices that did not change keep their baselines and histories
+    if (diskActivity != nullptr) diskActivity->refresh(storageInformation, changes);
+    if (volumeSpace != nullptr) volumeSpace->refresh(storageInformation, changes);
+    if (diskHealth != nullptr) diskHealth->refresh(storageInformation, changes);
+
+    return changes;
+}
+
+/**
+* Prints the guide menu to the curses screen
+* @param window A curses window to print the info on
+*/
+void printGuide(WINDOW* window)
+{
+    //print the title
+    mvwprintw(window, 0, 20, "Guide");
+
+    //store the menu options
+    std::string options[5] = {
+        "r -> Toggles session recording",
+        "b -> Toggles binary session recording",
+        "c -> Toggles compressed binary session recording",
+        "1-5 -> Expands or collapses a class of adapters",
+        "Mouse Scroll -> Scrolls through the data"
+    };
+
+    //print menu options
+    for (int i = 0; i < 5; i++)
+    {
+        //i + 2 to leave a blank line between from the title
+        mvwprintw(window, i + 2, 0, options[i].c_str());
+    }
+
+    //print the final buffer
+    prefresh(window, 0, 0, 0, 151, getmaxy(stdscr) - 1, getmaxx(stdscr) - 1);
+}
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "GUID");
+/**
+* Prints the statistics of a sensor in a recording over a time range
+* Usage: --query <recording> [sensor] [from seconds] [to seconds], lists the sensors if no sensor is given
+* @return The process exit code
+*/
+int queryRecording(int argc, char* argv[])
+{
+    RecordReader reader;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].GUID.begin(), networkInformation.Adapters[index].GUID.end()).c_str());
-    current_display_row++;
+    if (!reader.open(argv[2]))
+    {
+        std::cerr << "Could not open " << argv[2] << '\n';
+        return 1;
+    }
 
+    //list the available sensors
+    if (argc < 4)
+    {
+        for (const std::string& column : reader.getSchema().column_names)
+        {
+            std::cout << column << '\n';
+        }
+        return 0;
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Index");
+    int column = reader.findColumn(argv[3]);
+    if (column == -1)
+    {
+        std::cerr << "Unknown sensor " << argv[3] << '\n';
+        return 1;
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(networkInformation.Adapters[index].Index).c_str());
-    current_display_row++;
+    //default to the whole recording
+    long long from = 0, to = 0;
+    reader.getTimeRange(from, to);
 
+    if (argc >= 5) from = (long long)(std::stod(argv[4]) * 1000000);
+    if (argc >= 6) to = (long long)(std::stod(argv[5]) * 1000000);
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Install Date");
+    RecordQueryResult result;
+    if (!reader.query(column, from, to, { 50, 90, 95, 99 }, result))
+    {
+        std::cerr << "Could not read " << argv[2] << '\n';
+        return 1;
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].InstallDate.begin(), networkInformation.Adapters[index].InstallDate.end()).c_str());
-    current_display_row++;
+    std::cout << "Count," << result.Count << '\n';
+    if (result.Count == 0) return 0;
 
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "Min," << result.Min << '\n';
+    std::cout << "Max," << result.Max << '\n';
+    std::cout << "Average," << result.Average << '\n';
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Installed");
+    for (auto& percentile : result.Percentiles)
+    {
+        std::cout << "P" << (int)percentile.first << ',' << percentile.second << '\n';
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].Installed).c_str());
-    current_display_row++;
+    return 0;
+}
 
+/**
+* Creates the computer object with the hardware whose sensor collectors are enabled and starts its session
+* @return The opened computer object
+*/
+OpenHardwareMonitor::Hardware::Computer^ openComputer()
+{
+    OpenHardwareMonitor::Hardware::Computer^ computer = gcnew OpenHardwareMonitor::Hardware::Computer();
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Interface Index");
+    //Tell the library what hardware we want to monitor, hardware that is not enabled is never opened
+    computer->CPUEnabled = collectorRegistry.isEnabled("sensors.cpu");
+    computer->GPUEnabled = collectorRegistry.isEnabled("sensors.gpu");
+    computer->HDDEnabled = collectorRegistry.isEnabled("sensors.hdd");
+    computer->RAMEnabled = collectorRegistry.isEnabled("sensors.ram");
+    computer->MainboardEnabled = collectorRegistry.isEnabled("sensors.mainboard");
+    computer->FanControllerEnabled = collectorRegistry.isEnabled("sensors.fan-controller");
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(networkInformation.Adapters[index].InterfaceIndex).c_str());
-    current_display_row++;
+    //Start the session
+    computer->Open();
 
+    return computer;
+}
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "MAC Address");
+/**
+* Updates all sensors and adds their values to the recording without formatting them for display
+* @param computer The computer object to get the sensor values from
+*/
+void recordSensorData(OpenHardwareMonitor::Hardware::Computer^ computer)
+{
+    //every tick is a single row of the recording
+    sessionRecorder.beginRow();
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].MACAddress.begin(), networkInformation.Adapters[index].MACAddress.end()).c_str());
-    current_display_row++;
+    std::map<std::string, bool> due = getDueSensorCollectors();
 
+    for (int hardware_index = 0; hardware_index < computer->Hardware->Length; hardware_index++)
+    {
+        if (due[getSensorCollector(computer->Hardware[hardware_index]->HardwareType)]) computer->Hardware[hardware_index]->Update();
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Manufacturer");
+        for (int sensor_index = 0; sensor_index < computer->Hardware[hardware_index]->Sensors->Length; sensor_index++)
+        {
+            OpenHardwareMonitor::Hardware::ISensor^ sensor = computer->Hardware[hardware_index]->Sensors[sensor_index];
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Manufacturer.begin(), networkInformation.Adapters[index].Manufacturer.end()).c_str());
-    current_display_row++;
+            sessionRecorder.recordValue(hardware_index, sensor_index, sensor->Value.HasValue ? sensor->Value.Value : std::numeric_limits<float>::quiet_NaN());
+        }
+    }
 
+    sessionRecorder.commitRow();
+}
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Max Number Controlled");
+/**
+* Samples the processes into the row of the current tick if the recording records them
+* @param processesInfo The processes information, created the first time it is needed
+*/
+void recordProcesses(std::unique_ptr<ProcessesInformation>& processesInfo)
+{
+    if (!sessionRecorder.isRecordingProcesses() || !collectorRegistry.isDue("processes")) return;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(networkInformation.Adapters[index].MaxNumberControlled).c_str());
-    current_display_row++;
+    if (!processesInfo) processesInfo = std::make_unique<ProcessesInformation>();
 
+    processesInfo->fetchProcesses();
+    processesInfo->updateProcessesDynamicInfo();
+    sessionRecorder.recordProcesses(*processesInfo);
+}
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Max Speed");
+/**
+* The inventories and the samplers of a session, shared by the UI and the headless recording
+* A sampler is nullptr when its collector is disabled, the inventories are empty when theirs is
+* The inventories are declared first so they outlive the samplers that keep references to them
+*/
+struct Collectors
+{
+    StorageInformation                      Storage;
+    NetworkInformation                      Network;
+
+    std::unique_ptr<StorageWatcher>         Watcher;
+    std::unique_ptr<MemoryActivity>         Memory;
+    std::unique_ptr<DiskActivity>           Disks;
+    std::unique_ptr<VolumeSpace>            Volumes;
+    std::unique_ptr<DiskHealth>             Health;
+    std::unique_ptr<NetworkActivity>        Interfaces;
+    std::unique_ptr<SocketTable>            Sockets;
+    std::unique_ptr<TcpHealth>              Tcp;
+
+    /**
+    * The processes are only fetched once a recording needs them
+    */
+    std::unique_ptr<ProcessesInformation>   Processes;
+
+    Collectors() = default;
+    Collectors(const Collectors&) = delete;
+    Collectors& operator=(const Collectors&) = delete;
+
+    /**
+    * Reads the inventories and creates the samplers whose collectors are enabled
+    * The memory and network samplers are given to the recorder, their NUMA nodes and adapters get their columns when a recording starts
+    */
+    void createCollectors()
+    {
+        if (collectorRegistry.isEnabled("storage")) this->Storage = StorageInformation(collectorRegistry.getSessions());
+        if (collectorRegistry.isEnabled("network")) this->Network = NetworkInformation(*collectorRegistry.getSessions());
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((unsigned long long)networkInformation.Adapters[index].MaxSpeed).c_str());
-    current_display_row++;
+        if (collectorRegistry.isEnabled("storage-watcher")) this->Watcher = std::make_unique<StorageWatcher>(*collectorRegistry.getSessions());
+        if (collectorRegistry.isEnabled("disk-activity")) this->Disks = std::make_unique<DiskActivity>(this->Storage);
+        if (collectorRegistry.isEnabled("volume-space")) this->Volumes = std::make_unique<VolumeSpace>(this->Storage, collectorRegistry.getCadence("volume-space"));
+        if (collectorRegistry.isEnabled("disk-health")) this->Health = std::make_unique<DiskHealth>(this->Storage, collectorRegistry.getCadence("disk-health"));
 
+        if (collectorRegistry.isEnabled("memory")) this->Memory = std::make_unique<MemoryActivity>();
+        sessionRecorder.setMemoryRecording(this->Memory.get());
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Net Connection ID");
+        if (collectorRegistry.isEnabled("network-activity")) this->Interfaces = std::make_unique<NetworkActivity>(this->Network);
+        sessionRecorder.setNetworkActivityRecording(this->Interfaces.get());
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].NetConnectionID.begin(), networkInformation.Adapters[index].NetConnectionID.end()).c_str());
-    current_display_row++;
+        //the socket table takes its first snapshot on the first tick, the TCP health sampler takes the owners of the connections from it
+        if (collectorRegistry.isEnabled("sockets")) this->Sockets = std::make_unique<SocketTable>(*collectorRegistry.getSessions());
+        if (collectorRegistry.isEnabled("tcp-health")) this->Tcp = std::make_unique<TcpHealth>(*collectorRegistry.getSessions(), this->Sockets.get());
+    }
 
+    /**
+    * @return Everything the screen is drawn from
+    */
+    ScreenSources getScreenSources()
+    {
+        return { &this->Storage, &this->Network, this->Memory.get(), this->Disks.get(), this->Volumes.get(), this->Health.get(), this->Interfaces.get(), this->Sockets.get(), this->Tcp.get() };
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Net Connection Status");
+    /**
+    * Samples every collector that is due into the row of this tick and ends the row with the sensors
+    * Devices plugged in after a recording started are sampled but have no columns
+    * @param computer The computer object to get the sensor values from
+    * @return What changed in the storage devices, the screen is laid out again when something did
+    */
+    StorageInformation::StorageChanges sampleTick(OpenHardwareMonitor::Hardware::Computer^ computer)
+    {
+        recordProcesses(this->Processes);
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].NetConnectionStatus).c_str());
-    current_display_row++;
+        StorageInformation::StorageChanges changes = refreshStorage(this->Storage, this->Watcher.get(), this->Disks.get(), this->Volumes.get(), this->Health.get());
 
+        if (this->Memory && collectorRegistry.isDue("memory"))
+        {
+            this->Memory->update();
+            sessionRecorder.recordMemory(*this->Memory);
+        }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Net Enabled");
+        if (this->Disks && collectorRegistry.isDue("disk-activity"))
+        {
+            this->Disks->update();
+            sessionRecorder.recordDiskActivity(*this->Disks);
+        }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].NetEnabled).c_str());
-    current_display_row++;
+        if (this->Interfaces && collectorRegistry.isDue("network-activity"))
+        {
+            this->Interfaces->update();
+            sessionRecorder.recordNetworkActivity(*this->Interfaces);
+        }
 
+        if (this->Sockets && collectorRegistry.isDue("sockets"))
+        {
+            this->Sockets->update();
+            sessionRecorder.recordSockets(*this->Sockets);
+        }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Permanent Address");
+        if (this->Tcp && collectorRegistry.isDue("tcp-health"))
+        {
+            this->Tcp->update();
+            sessionRecorder.recordTcpHealth(*this->Tcp);
+        }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].PermanentAddress.begin(), networkInformation.Adapters[index].PermanentAddress.end()).c_str());
-    current_display_row++;
+        //the capacity of the volumes is only read again every few seconds, in the background
+        if (this->Volumes)
+        {
+            this->Volumes->update();
+            sessionRecorder.recordVolumeSpace(*this->Volumes);
+        }
 
+        //take the disk health that was read since the last tick
+        if (this->Health)
+        {
+            this->Health->update();
+            sessionRecorder.recordDiskHealth(*this->Health);
+        }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Physical Adapter");
+        recordSensorData(computer);
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].PhysicalAdapter).c_str());
-    current_display_row++;
+        return changes;
+    }
+};
 
+#pragma managed(push, off)
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "PNP Device ID");
+/**
+* Signaled to stop a headless recording, and by the recording once everything is written
+*/
+static HANDLE headless_stop_event = NULL;
+static HANDLE headless_finished_event = NULL;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].PNPDeviceID.begin(), networkInformation.Adapters[index].PNPDeviceID.end()).c_str());
-    current_display_row++;
+/**
+* Stops the headless recording on Ctrl+C, Ctrl+Break, closing the console and shutdown
+*/
+static BOOL WINAPI headlessConsoleHandler(DWORD ctrlType)
+{
+    SetEvent(headless_stop_event);
 
+    //the process is ended as soon as the handler returns for these, wait for the recording to be written first
+    if (ctrlType == CTRL_CLOSE_EVENT || ctrlType == CTRL_LOGOFF_EVENT || ctrlType == CTRL_SHUTDOWN_EVENT)
+    {
+        WaitForSingleObject(headless_finished_event, 5000);
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Power Management Supported");
+    return TRUE;
+}
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((int)networkInformation.Adapters[index].PowerManagementSupported).c_str());
-    current_display_row++;
+/**
+* Stops the headless recording on SIGTERM and SIGINT
+*/
+static void headlessSignalHandler(int signalNumber)
+{
+    SetEvent(headless_stop_event);
+}
 
+#pragma managed(pop)
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Product Name");
+/**
+* Records the session without the UI, sampling starts right away
+* @param format The format to write the recording in
+* @param poll_delay The time between samples in milliseconds
+* @param duration The number of seconds to record for, 0 to record until stopped
+* @return The process exit code
+*/
+int runHeadless(const RecordFormat format, const int poll_delay, const long long duration)
+{
+    headless_stop_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    headless_finished_event = CreateEventW(NULL, TRUE, FALSE, NULL);
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].ProductName.begin(), networkInformation.Adapters[index].ProductName.end()).c_str());
-    current_display_row++;
+    SetConsoleCtrlHandler(headlessConsoleHandler, TRUE);
+    signal(SIGTERM, headlessSignalHandler);
+    signal(SIGINT, headlessSignalHandler);
 
+    OpenHardwareMonitor::Hardware::Computer^ computer = openComputer();
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Service Name");
+    //the samplers have to exist before the recording starts to know the NUMA nodes and adapters it makes columns for
+    Collectors collectors;
+    collectors.createCollectors();
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].ServiceName.begin(), networkInformation.Adapters[index].ServiceName.end()).c_str());
-    current_display_row++;
+    sessionRecorder.startRecording(computer, collectors.Storage, collectors.Network, format);
+    if (!sessionRecorder.isRecording())
+    {
+        std::cerr << "Could not start the recording\n";
+        computer->Close();
+        return 1;
+    }
 
+    std::cerr << "Recording, stop with Ctrl+C\n";
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Net Enabled");
+    ULONGLONG start_time = GetTickCount64();
+    ULONGLONG next_tick = start_time;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString((unsigned long long)networkInformation.Adapters[index].Speed).c_str());
-    current_display_row++;
+    while (duration == 0 || GetTickCount64() - start_time < (ULONGLONG)duration * 1000)
+    {
+        collectors.sampleTick(computer);
 
+        //keep a steady rate, if sampling took longer than the interval start the next tick right away
+        next_tick += poll_delay;
+        ULONGLONG now = GetTickCount64();
+        if (next_tick < now) next_tick = now;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Status");
+        if (WaitForSingleObject(headless_stop_event, (DWORD)(next_tick - now)) == WAIT_OBJECT_0) break;
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].Status.begin(), networkInformation.Adapters[index].Status.end()).c_str());
-    current_display_row++;
+    //write everything that is still buffered before exiting
+    sessionRecorder.stopRecording();
+    computer->Close();
 
+    std::cerr << "Recording stopped";
+    if (sessionRecorder.getDroppedRows()) std::cerr << ", " << sessionRecorder.getDroppedRows() << " rows were dropped";
+    std::cerr << '\n';
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Time Of Last Reset");
+    SetEvent(headless_finished_event);
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(networkInformation.Adapters[index].TimeOfLastReset.begin(), networkInformation.Adapters[index].TimeOfLastReset.end()).c_str());
-    current_display_row++;
+    return 0;
 }
 
 /**
-* Prints the drive info from the Drives std::map from the storageInformation parameter
-* @param window The curses window to print the information on
-* @param name The drive name
-* @param current_display_row The current current row we are printing on in the curses window object
-* @param storageInformation A StorageInformation object to get the info of the drive from
+* Prints the trend of a sensor in a recording over a time range, using the rollups of the recording if it has them
+* Usage: --trend <recording> <sensor> [from seconds] [to seconds] [points]
+* @return The process exit code
 */
-void PrintDriveInfo(WINDOW* window, const wchar_t DriveLetter, int& current_display_row, StorageInformation& storageInformation)
+int trendRecording(int argc, char* argv[])
 {
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Bytes Per Sector");
-
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[DriveLetter].BytesPerSector).c_str());
-    current_display_row++;
-
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Sectors Per Track");
-
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[DriveLetter].SectorsPerTrack).c_str());
-    current_display_row++;
+    RecordReader reader;
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Tracks Per Cylinder");
-
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[DriveLetter].TracksPerCylinder).c_str());
-    current_display_row++;
+    if (!reader.open(argv[2]))
+    {
+        std::cerr << "Could not open " << argv[2] << '\n';
+        return 1;
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Volume Serial Number");
+    int column = reader.findColumn(argv[3]);
+    if (column == -1)
+    {
+        std::cerr << "Unknown sensor " << argv[3] << '\n';
+        return 1;
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[DriveLetter].VolumeSerialNumber).c_str());
-    current_display_row++;
+    //default to the whole recording
+    long long from = 0, to = 0;
+    reader.getTimeRange(from, to);
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Cylinders Quad Part");
+    if (argc >= 5) from = (long long)(std::stod(argv[4]) * 1000000);
+    if (argc >= 6) to = (long long)(std::stod(argv[5]) * 1000000);
+    unsigned int points = argc >= 7 ? std::stoul(argv[6]) : 1000;
 
-    //print value
-    mvwprintw(window, current_display_row, 50, toString(storageInformation.Drives[DriveLetter].Cylinders_QuadPart).c_str());
-    current_display_row++;
+    std::vector<RecordTrendPoint> trend;
+    unsigned int tier = 0;
+    if (!reader.queryTrend(column, from, to, points, trend, tier))
+    {
+        std::cerr << "Could not read " << argv[2] << '\n';
+        return 1;
+    }
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "VolumeType");
+    std::cerr << "Resolution," << (tier == 0 ? std::string("raw") : std::to_string(tier) + " s") << '\n';
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.Drives[DriveLetter].VolumeType.begin(), storageInformation.Drives[DriveLetter].VolumeType.end()).c_str());
-    current_display_row++;
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "Time,Min,Max,Average,Last\n";
 
-    //Print name
-    mvwprintw(window, current_display_row, 15, "Volume Name");
+    for (const RecordTrendPoint& point : trend)
+    {
+        std::cout << point.Time / 1000000.0 << ',' << point.Min << ',' << point.Max << ',' << point.Average << ',' << point.Last << '\n';
+    }
 
-    //print value
-    mvwprintw(window, current_display_row, 50, std::string(storageInformation.Drives[DriveLetter].VolumeName.begin(), storageInformation.Drives[DriveLetter].VolumeName.end()).c_str());
-    current_display_row++;
+    return 0;
 }
 
-/**
-* Prints all available sensors of a given hardware
-* @param computer The computer object to get the hardware info from
-* @param window The curses window to print the info on
-* @param hardware_index The index of the hardware to print the sesnors of
-* @param current_display_row The current current row we are printing on in the curses window object
-*/
-void PrintHardwareSensors(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window, unsigned int hardware_index, int& current_display_row)
+int main(int argc, char* argv[])
 {
-    //Iterate over all available sensors
-    for (int sensor_index = 0; sensor_index < computer->Hardware[hardware_index]->Sensors->Length; sensor_index++, current_display_row++) {
+    //answer a query about a recording and exit
+    if (argc >= 3 && std::string(argv[1]) == "--query")
+    {
+        return queryRecording(argc, argv);
+    }
 
-        //convert string and print it
-        std::string SensorName = msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Sensors[sensor_index]->Name);
-        mvwprintw(window, current_display_row, 15, std::string(SensorName.begin(), SensorName.end()).c_str());
+    //print the trend of a sensor and exit
+    if (argc >= 4 && std::string(argv[1]) == "--trend")
+    {
+        return trendRecording(argc, argv);
+    }
 
-        if (SensorName == "Available Memory")
+    //convert a binary recording to CSV and exit
+    if (argc == 4 && std::string(argv[1]) == "--export")
+    {
+        if (!exportBinaryRecordToCsv(argv[2], argv[3]))
         {
-            free_ram_index = { hardware_index, sensor_index };
+            std::cerr << "Could not export " << argv[2] << '\n';
+            return 1;
         }
+        return 0;
+    }
 
-        //convert string and print it
-        std::string SensorType = msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Sensors[sensor_index]->SensorType.ToString());
-        mvwprintw(window, current_display_row, 35, SensorType.c_str());
+    //compare the recording formats and exit
+    if (argc >= 2 && std::string(argv[1]) == "--benchmark-recording")
+    {
+        unsigned int columns = argc >= 3 ? std::stoul(argv[2]) : 100;
+        unsigned int rows = argc >= 4 ? std::stoul(argv[3]) : 100000;
 
-        //save the position of this sensor to be used in updating the sensor value in printing the dynamic sensor data
-        sensor_screen_row[std::make_pair(hardware_index, sensor_index)] = current_display_row;
+        benchmarkRecordFormats(std::cout, columns, rows);
+        return 0;
     }
-}
-
-/**
-* Prints the Hardware name and sensor name and data type once as they do not need to be updated
-* @see updateAndPrintSensorData()
-* @param computer The computer object to get the hardware info from
-* @param window The Curses window to print the info on
-* @return The number of rows taken to print all of the info
-*/
-int printStaticHarwareInfo(OpenHardwareMonitor::Hardware::Computer^ computer, WINDOW* window, StorageInformation& storageInformation, NetworkInformation& networkInformation)
-{
-    int current_display_row = 0; //keeps track of what row we are displaying on
 
-    //resize the hardware count in the session record buffer
-    sessionRecorder.record_buffer.resize(computer->Hardware->Length);
+    //options of the recording, split long recordings into segments and limit how many are kept
+    RecordRotationPolicy rotationPolicy;
+    RecordFormat headlessFormat = RecordFormat::CSV;
+    std::string outputFileName;
+    long long duration = 0;
+    int poll_delay = 1000;
+    bool headless = 0;
 
-    //stores the index of OpenHardwareMonitor storage devices with its name as the key and index as the value
-    std::map<std::string, int> storageDevices;
+    //the collectors are configured from the file first, the options on the command line override it
+    std::string configPath;
+    bool list_collectors = 0;
+    std::vector<std::pair<std::string, std::string>> collectorSettings;
 
-    //iterate over all available hardware
-    for (int hardware_index = 0; hardware_index < computer->Hardware->Length; hardware_index++, current_display_row += 2)
+    for (int arg = 1; arg < argc; arg++)
     {
-        //resize the sensor count of the current hardware of session record buffer
-        sessionRecorder.record_buffer[hardware_index].resize(computer->Hardware[hardware_index]->Sensors->Length);
-
-        //convert hardware name and store it
-        std::string HardwareName = msclr::interop::marshal_as<std::string>(computer->Hardware[hardware_index]->Name);
+        std::string option = argv[arg];
 
-        //If device is a storage device then store its index and continue to be used when printing the physical disks
-        if (computer->Hardware[hardware_index]->HardwareType == OpenHardwareMonitor::Hardware::HardwareType::HDD)
+        //the only options without a value
+        if (option == "--headless")
         {
-            //store its index
-            storageDevices[HardwareName] = hardware_index;
-
-            //cancel out the blank lines that gets printed between different hardware because we did not print any hardware
-            current_display_row -= 2;
+            headless = 1;
+            continue;
+        }
 
+        if (option == "--list-collectors")
+        {
+            list_collectors = 1;
             continue;
         }
-        
-        //print hardware name
-        mvwprintw(window, current_display_row, 0, HardwareName.c_str());
 
-        current_display_row++; //go to the next row
+        if (arg + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << '\n';
+            return 1;
+        }
 
-        //Print all available sensors of the device
-        PrintHardwareSensors(computer, window, hardware_index, current_display_row);
+        std::string value = argv[++arg];
+
+        if (option == "--segment-mb") rotationPolicy.MaxSegmentBytes = std::stoull(value) * 1024 * 1024;
+        else if (option == "--segment-minutes") rotationPolicy.MaxSegmentSeconds = std::stoll(value) * 60;
+        else if (option == "--keep-mb") rotationPolicy.MaxTotalBytes = std::stoull(value) * 1024 * 1024;
+        else if (option == "--keep-segments") rotationPolicy.MaxSegments = std::stoul(value);
+        else if (option == "--record-processes") sessionRecorder.setProcessRecording(1, std::stoul(value));
+        else if (option == "--checkpoint-rows") sessionRecorder.setCheckpointRows(std::stoul(value));
+        else if (option == "--duration") duration = std::stoll(value);
+        else if (option == "--interval") poll_delay = std::stoi(value);
+        else if (option == "--output") outputFileName = value;
+        else if (option == "--disk-health")
+        {
+            //reading the disk health is off unless it is asked for
+            collectorSettings.push_back({ "disk-health", "on" });
+            collectorSettings.push_back({ "disk-health.cadence", std::to_string(std::stoll(value) * 60000) });
+        }
+        else if (option == "--enable") collectorSettings.push_back({ value, "on" });
+        else if (option == "--disable") collectorSettings.push_back({ value, "off" });
+        else if (option == "--config") configPath = value;
+        else if (option == "--format" && value == "csv") headlessFormat = RecordFormat::CSV;
+        else if (option == "--format" && value == "binary") headlessFormat = RecordFormat::Binary;
+        else if (option == "--format" && value == "compressed") headlessFormat = RecordFormat::CompressedBinary;
+        else
+        {
+            std::cerr << "Unknown option " << option << ' ' << value << '\n';
+            return 1;
+        }
     }
 
-    //Print category name
-    mvwprintw(window, current_display_row, 0, "Storage Devices");
-    current_display_row+=2;
+    if (poll_delay <= 0)
+    {
+        std::cerr << "The interval has to be at least 1 millisecond\n";
+        return 1;
+    }
 
-    //Print all physcial disks info
-    for (auto& physicalDisk : storageInformation.PhysicalDisks)
+    //the default configuration file is optional, one that was given has to exist
+    std::string configError;
+    if (!collectorRegistry.loadConfig(configPath.empty() ? CollectorRegistry::DefaultConfigPath : configPath, configError, !configPath.empty()))
     {
-        //Print disk name
-        mvwprintw(window, current_display_row, 5, std::string(physicalDisk.first.begin(), physicalDisk.first.end()).c_str());
-        current_display_row++;
+        std::cerr << configError << '\n';
+        return 1;
+    }
 
-        //If current disk is recognized by the OpenHardwareMonitor::Computer object
-        if (storageDevices.find(std::string(physicalDisk.second.FriendlyName.begin(), physicalDisk.second.FriendlyName.end())) != storageDevices.end())
+    for (auto& setting : collectorSettings)
+    {
+        if (!collectorRegistry.set(setting.first, setting.second, configError))
         {
-            //Print all available sensors of the device
-            PrintHardwareSensors(computer, window, storageDevices[std::string(physicalDisk.second.FriendlyName.begin(), physicalDisk.second.FriendlyName.end())], current_display_row);
+            std::cerr << configError << '\n';
+            return 1;
         }
-        
-        //Print all static info of the disk
-        PrintPhysicalDiskInfo(window, physicalDisk.first, current_display_row, storageInformation);
-
-        current_display_row+=2;
     }
 
-    //Print category name
-    mvwprintw(window, current_display_row, 0, "Drives");
-    current_display_row += 2;
-
-    //Print all physcial disks info
-    for (auto& Drive : storageInformation.Drives)
+    //show what would run and exit
+    if (list_collectors)
     {
-        //Print drive letter
-
-        //convert character to std::wstring
-        std::wstring DriveLetterWstr;
-        DriveLetterWstr.push_back(Drive.first);
-        DriveLetterWstr.push_back(L':');
-
-        //print it
-        mvwprintw(window, current_display_row, 5, std::string(DriveLetterWstr.begin(), DriveLetterWstr.end()).c_str());
-        current_display_row++;
-
-        //Print all static info of the disk
-        PrintDriveInfo(window, Drive.first, current_display_row, storageInformation);
-
-        current_display_row += 2;
+        collectorRegistry.print(std::cout);
+        return 0;
     }
 
-    //Print category name
-    mvwprintw(window, current_display_row, 0, "Network adapters");
-    current_display_row += 2;
-
-    for (int adapter_index = 0; adapter_index < networkInformation.Adapters.size(); adapter_index++)
+    sessionRecorder.setRotationPolicy(rotationPolicy);
+    sessionRecorder.setDiskHealthRecording(collectorRegistry.isEnabled("disk-health"));
+    sessionRecorder.setDiskActivityRecording(collectorRegistry.isEnabled("disk-activity"));
+    sessionRecorder.setVolumeSpaceRecording(collectorRegistry.isEnabled("volume-space"));
+    sessionRecorder.setSocketRecording(collectorRegistry.isEnabled("sockets"));
+    sessionRecorder.setTcpHealthRecording(collectorRegistry.isEnabled("tcp-health"));
+    sessionRecorder.setOutputFileName(outputFileName);
+
+    //finish the recordings a crash left behind before new ones are started
+    RecordWriter::recoverRecordings("Recordings");
+    if (!outputFileName.empty())
     {
-        //print name
-        mvwprintw(window, current_display_row, 5, std::string(networkInformation.Adapters[adapter_index].Name.begin(), networkInformation.Adapters[adapter_index].Name.end()).c_str());
-        current_display_row++;
-    
-        //print all static info of the adapter
-        PrintNetworkAdapterInfo(window, adapter_index, current_display_row, networkInformation);
-
-        //leave a blank line
-        current_display_row += 2;
+        size_t separator = outputFileName.find_last_of("\\/");
+        RecordWriter::recoverRecordings(separator == std::string::npos ? "." : outputFileName.substr(0, separator));
     }
 
-    return current_display_row;
-}
-
-/**
-* Prints the guide menu to the curses screen
-* @param window A curses window to print the info on
-*/
-void printGuide(WINDOW* window)
-{
-    //print the title
-    mvwprintw(window, 0, 20, "Guide");
-
-    //store the menu options
-    std::string options[2] = {
-        "r -> Toggles session recording",
-        "Mouse Scroll -> Scrolls through the data"
-    };
-
-    //print menu options
-    for (int i = 0; i < 2; i++)
+    //record without the UI until the duration ends or the process is asked to stop
+    if (headless)
     {
-        //i + 2 to leave a blank line between from the title
-        mvwprintw(window, i + 2, 0, options[i].c_str());
+        return runHeadless(headlessFormat, poll_delay, duration);
     }
 
-    //print the final buffer
-    prefresh(window, 0, 0, 0, 151, getmaxy(stdscr) - 1, getmaxx(stdscr) - 1);
-}
-
-int main()
-{
     //set locale for curses
     setlocale(LC_ALL, "");
 
@@ -626,19 +2193,8 @@ int main()
     printw("Loading...... Please wait.");
     refresh();
     
-    //Initialize main object
-    OpenHardwareMonitor::Hardware::Computer^ computer = gcnew OpenHardwareMonitor::Hardware::Computer();
-
-    //Tell the library what hardware we want to monitor
-    computer->CPUEnabled = true;
-    computer->GPUEnabled = true;
-    computer->HDDEnabled = true;
-    computer->RAMEnabled = true;
-    computer->MainboardEnabled = true;
-    computer->FanControllerEnabled = true;
-
-    //Start the session
-    computer->Open();
+    //Initialize main object and start the session
+    OpenHardwareMonitor::Hardware::Computer^ computer = openComputer();
 
     //turn off cursor
     curs_set(0);
@@ -646,46 +2202,47 @@ int main()
     //Enable all mouse events
     mousemask(ALL_MOUSE_EVENTS, NULL);
 
-    //create pad that is needed to be able to print as much data as we want and scroll in it
-    WINDOW* pad = newpad(1000, 150);
+    //get max rows and cols of the terminal to be used later in displaying the updating info
+    int mxrows = 0, mxcols = 0;
+    getmaxyx(stdscr, mxrows, mxcols);
+
+    //create the window the data is drawn in, it is only as big as the part of the terminal it is shown in and the rows in view are drawn again as it scrolls
+    WINDOW* view = newwin(mxrows, std::min(mxcols, 150), 0, 0);
 
     //enable keypad keys input
-    keypad(pad, TRUE);
+    keypad(view, TRUE);
 
     //set timeout period for the wgetch() function and therefor limit the update rate of the program
-    wtimeout(pad, 5);
-
-    //get max rows and cols of the terminal to be used later in displaying the updating info
-    int mxrows = 0, mxcols = 0;
-    getmaxyx(stdscr, mxrows, mxcols);
+    wtimeout(view, 5);
 
     //Clear the waiting text from the display to start displaying the data
     clear();
 
-    //Initialize static storage information object
-    StorageInformation storageInfo = StorageInformation();
+    //Initialize the inventories and the samplers, only the enabled ones are created
+    Collectors collectors;
+    collectors.createCollectors();
 
-    //Initialize static netwrok information object
-    NetworkInformation networkInfo = NetworkInformation();
-    
-    //display the static information that does not get updated by time
-    int totalRows = printStaticHarwareInfo(computer, pad, storageInfo, networkInfo);
+    //everything the screen is drawn from
+    ScreenSources sources = collectors.getScreenSources();
+
+    //lay out the blocks of the screen, they are only printed once they are in view
+    int totalRows = layoutScreen(computer, sources);
 
     //display guide
     WINDOW* guidePad = newpad(60, 50);
     printGuide(guidePad);
 
-    //keeps track of what row of the pad we are on
-    int mypadpos = 0;
+    //keeps track of what row of the screen is at the top of the window
+    int view_row = 0;
+
+    //marks that the rows in view have to be drawn again, set when the values were sampled, the view scrolled or the screen was laid out again
+    bool redraw = 1;
     
     //keeps track of the last time we polled the data to be used in limiting the poll rate
     auto prev_time = std::chrono::high_resolution_clock::now();
 
     //makrs if it is our time polling the data to avoid waiting for the poll rate limit the first time
     bool first_poll = 1;
-
-    //the delay for the poll rate of the data in milliseconds
-    int poll_delay = 1000;
     
     //main runtime loop
     while (1)
@@ -702,18 +2259,39 @@ int main()
             //update last data poll time
             prev_time = now_time;
 
-            //Call updating and printing function
-            updateAndPrintSensorData(computer, pad);
+            //sample every collector that is due into the row of this tick, the screen is laid out again when a drive answered late or a device was plugged in or removed
+            if (!collectors.sampleTick(computer).empty())
+            {
+                totalRows = layoutScreen(computer, sources);
+
+                //keep the view inside the screen if it got shorter
+                int last_position = totalRows - (mxrows > totalRows ? totalRows : mxrows);
+                if (view_row > last_position) view_row = last_position;
+            }
+
+            redraw = 1;
+
+            //inform the user if the writer thread could not keep up and rows were dropped
+            if (sessionRecorder.isRecording() && sessionRecorder.getDroppedRows())
+            {
+                mvwprintw(guidePad, 58, 18, ("Dropped rows: " + toString(sessionRecorder.getDroppedRows())).c_str());
+                prefresh(guidePad, 0, 0, 0, 151, mxrows - 1, mxcols - 1);
+            }
         }
 
-        //update pad within the window
-        prefresh(pad, mypadpos, 0, 0, 0, mxrows - 1, mxcols - guidePad->_maxx - 1);
+        //only the rows in view are drawn
+        if (redraw)
+        {
+            drawScreen(computer, view, view_row, sources);
+            wrefresh(view);
+            redraw = 0;
+        }
         
         //mouse event to be used to determine what mouse button was pressed
         MEVENT event;
 
         //get input form user
-        char ch = wgetch(pad);
+        char ch = wgetch(view);
 
         //check if input is a mouse input
         switch (ch)
@@ -723,22 +2301,32 @@ int main()
             if (nc_getmouse(&event) == OK)
             {
                 //check mouse wheel up
-                if ((event.bstate & BUTTON4_PRESSED) && mypadpos > 0)
+                if ((event.bstate & BUTTON4_PRESSED) && view_row > 0)
                 {
-                    mypadpos--;
+                    view_row--;
+                    redraw = 1;
                 }
                 //check mouse wheel down
                 else if ((event.bstate & BUTTON5_PRESSED) &&
-                    mypadpos < totalRows - (mxrows > totalRows ? totalRows : mxrows))
+                    view_row < totalRows - (mxrows > totalRows ? totalRows : mxrows))
                 {
-                    mypadpos++;
+                    view_row++;
+                    redraw = 1;
                 }
             }
             break;
 
         case 'r':
+        case 'b':
+        case 'c':
+        {
+            //pick the format based on the pressed key
+            RecordFormat format = RecordFormat::CSV;
+            if (ch == 'b') format = RecordFormat::Binary;
+            else if (ch == 'c') format = RecordFormat::CompressedBinary;
+
             //toggle recording
-            sessionRecorder.toggleRecording(computer, storageInfo, networkInfo);
+            sessionRecorder.toggleRecording(computer, collectors.Storage, collectors.Network, format);
 
             //display/hide recording text to inform user
             if (sessionRecorder.isRecording())
@@ -748,11 +2336,31 @@ int main()
             else
             {
                 mvwprintw(guidePad, 59, 18, "                          ");
+                mvwprintw(guidePad, 58, 18, "                              ");
             }
 
             //update the pad to show the text
             prefresh(guidePad, 0, 0, 0, 151, mxrows - 1, mxcols - 1);
             break;
+        }
+
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        {
+            //laid out again right away, the values of the rows that moved are printed from the last sample
+            expanded_adapter_classes[ch - '1'] = !expanded_adapter_classes[ch - '1'];
+            totalRows = layoutScreen(computer, sources);
+
+            //keep the view inside the screen if it got shorter
+            int last_position = totalRows - (mxrows > totalRows ? totalRows : mxrows);
+            if (view_row > last_position) view_row = last_position;
+
+            redraw = 1;
+            break;
+        }
 
     #ifdef DEBUG
         case 'f':
@@ -1,15 +1,13 @@
 #include "StorageInformation.h"
+#ifdef _WIN32
 #include <comdef.h>
 #include <Wbemidl.h>
 #include <Windows.h>
 
-void StorageInformation::InitDiskGeometry(const wchar_t DriveLetter)
+void StorageInformation::InitDiskGeometry(const std::wstring& Volume, Drive& drive)
 {
-    //Put the letter in the appropriate format for the CreateFileW function
-    std::wstring rootPath;
-    rootPath += L"\\\\.\\";
-    rootPath.push_back(DriveLetter);
-    rootPath += L":";
+    //Put the volume in the appropriate format for the CreateFileW function
+    std::wstring rootPath = L"\\\\.\\" + Volume;
 
     //Open a handle to the drive using CreateFile
     HANDLE hDevice = CreateFileW(
@@ -39,10 +37,10 @@ void StorageInformation::InitDiskGeometry(const wchar_t DriveLetter)
         )) {
 
             //copy the information to the corresponding object
-            this->Drives[DriveLetter].BytesPerSector = diskGeometry.BytesPerSector;
-            this->Drives[DriveLetter].SectorsPerTrack = diskGeometry.SectorsPerTrack;
-            this->Drives[DriveLetter].TracksPerCylinder = diskGeometry.TracksPerCylinder;
-            this->Drives[DriveLetter].Cylinders_QuadPart = diskGeometry.Cylinders.QuadPart;
+            drive.BytesPerSector = diskGeometry.BytesPerSector;
+            drive.SectorsPerTrack = diskGeometry.SectorsPerTrack;
+            drive.TracksPerCylinder = diskGeometry.TracksPerCylinder;
+            drive.Cylinders_QuadPart = diskGeometry.Cylinders.QuadPart;
 
             // Close the handle to the drive
             CloseHandle(hDevice);
@@ -50,13 +48,10 @@ void StorageInformation::InitDiskGeometry(const wchar_t DriveLetter)
     }
 }
 
-void StorageInformation::InitDriveType(const wchar_t DriveLetter)
+void StorageInformation::InitDriveType(const std::wstring& Volume, Drive& drive)
 {
-    //Put the letter in the appropriate format for the GetDriveTypeW function
-    std::wstring rootPath;
-    rootPath += L"\\\\.\\";
-    rootPath.push_back(DriveLetter);
-    rootPath += L":\\";
+    //Put the volume in the appropriate format for the GetDriveTypeW function
+    std::wstring rootPath = L"\\\\.\\" + Volume + L"\\";
 
     //Fetch drive type
     UINT driveType = GetDriveTypeW(rootPath.c_str());
@@ -67,42 +62,40 @@ void StorageInformation::InitDriveType(const wchar_t DriveLetter)
         switch (driveType) 
         {
         case DRIVE_REMOVABLE:
-            this->Drives[DriveLetter].VolumeType = L"Removable Drive";
+            drive.VolumeType = L"Removable Drive";
             break;
 
         case DRIVE_FIXED:
-            this->Drives[DriveLetter].VolumeType = L"Fixed Drive";
+            drive.VolumeType = L"Fixed Drive";
             break;
 
         case DRIVE_CDROM:
-            this->Drives[DriveLetter].VolumeType = L"CD-ROM Drive";
+            drive.VolumeType = L"CD-ROM Drive";
             break;
 
         case DRIVE_REMOTE:
-            this->Drives[DriveLetter].VolumeType = L"Network Drive";
+            drive.VolumeType = L"Network Drive";
             break;
 
         case DRIVE_RAMDISK:
-            this->Drives[DriveLetter].VolumeType = L"RAM Disk";
+            drive.VolumeType = L"RAM Disk";
             break;
 
         default:
-            this->Drives[DriveLetter].VolumeType = L"Unknown";
+            drive.VolumeType = L"Unknown";
             break;
         }
     }
 }
 
-void StorageInformation::InitVolumeInfo(const wchar_t DriveLetter)
+void StorageInformation::InitVolumeInfo(const std::wstring& Volume, Drive& drive)
 {
-    //Put the letter in the appropriate format for the GetDriveTypeW function
-    std::wstring rootPath;
-    rootPath += L"\\\\.\\";
-    rootPath.push_back(DriveLetter);
-    rootPath += L":\\";
+    //Put the volume in the appropriate format for the GetDriveTypeW function
+    std::wstring rootPath = L"\\\\.\\" + Volume + L"\\";
 
     //Variables to be passed to the function to store the data in
     wchar_t VolumeName[MAX_PATH];
+    wchar_t FileSystemName[MAX_PATH];
     DWORD SerialNumber;
     DWORD maxComponentLength;
     DWORD fileSystemFlags;
@@ -115,112 +108,90 @@ void StorageInformation::InitVolumeInfo(const wchar_t DriveLetter)
         &SerialNumber,
         &maxComponentLength,
         &fileSystemFlags,
-        NULL,
-        0
+        FileSystemName,
+        MAX_PATH
     )) 
     {
         //Assign values to our object
-        this->Drives[DriveLetter].VolumeName = VolumeName;
-        this->Drives[DriveLetter].VolumeSerialNumber = SerialNumber;
+        drive.VolumeName = VolumeName;
+        drive.VolumeSerialNumber = SerialNumber;
+        drive.FileSystem = FileSystemName;
     }
 }
 
-void StorageInformation::InitDrives()
+void StorageInformation::ReadDriveList(std::map<std::wstring, Drive>& drives)
 {
     //Get the drives mask
-    DWORD drives = GetLogicalDrives();
+    DWORD logicalDrives = GetLogicalDrives();
     DWORD mask = 1;
 
     for (char driveLetter = 'A'; driveLetter <= 'Z'; driveLetter++)
     {
         //If there is a drive attached to the current letter
-        if (drives & mask)
+        if (logicalDrives & mask)
         {
-            //Initalize the data based on current letter
-
-            InitDiskGeometry(driveLetter);
-
-            InitDriveType(driveLetter);
-
-            InitVolumeInfo(driveLetter);
+            //the volume key is the letter followed by a colon
+            std::wstring volume;
+            volume.push_back(driveLetter);
+            volume.push_back(L':');
+
+            //the rest is asked from the drive by its probe, a sleeping or disconnected drive can take long to answer
+            drives[volume] = Drive();
+            drives[volume].Device = L"\\\\.\\" + volume;
         }
 
         mask <<= 1;
     }
 }
 
-void StorageInformation::InitPhysicalDisks()
+void StorageInformation::ProbeDrive(const std::wstring& Volume, Drive& drive)
 {
-    #pragma comment(lib, "wbemuuid.lib")
+    InitDiskGeometry(Volume, drive);
 
-    HRESULT hres = CoInitializeEx(0, COINIT_MULTITHREADED);
+    InitDriveType(Volume, drive);
 
-    //Error checking
-    if (FAILED(hres)) {
-        //Failed to initialize COM library. Error code:hres
-        return;
-    }
-
-    // Initialize the COM interface pointer
-    IWbemLocator* pLoc = nullptr;
-    hres = CoCreateInstance(
-        CLSID_WbemLocator,           // CLSID of the object
-        0,                          // Reserved
-        CLSCTX_INPROC_SERVER,       // Context
-        IID_IWbemLocator,           // Interface ID
-        (LPVOID*)&pLoc              // Interface pointer
-    );
+    InitVolumeInfo(Volume, drive);
+}
 
-    //Error checking
-    if (FAILED(hres)) {
-        //Failed to create IWbemLocator object. Error code: hres
-        CoUninitialize();
-        return;
+StorageInformation::StorageChanges StorageInformation::refreshPhysicalDisks()
+{
+    //a query that is still running may have missed the change, it is queried again once it finishes
+    if (this->probed_physical_disks.Result)
+    {
+        this->physical_disks_changed = 1;
+        return StorageChanges();
     }
 
-    // Connect to WMI through the IWbemLocator::ConnectServer method
-    IWbemServices* pSvc = nullptr;
+    //WMI asks every disk for its properties, the query stalls on a disk that does not respond
+    std::shared_ptr<PhysicalDiskQuery> query = std::make_shared<PhysicalDiskQuery>();
+    this->probed_physical_disks.Result = query;
 
-    BSTR nmespace = SysAllocString(L"root\\Microsoft\\Windows\\Storage");
+    //the physical disks are reported by an empty key, no volume has one
+    std::shared_ptr<PlatformSessions> sessions = this->sessions;
+    this->probed_physical_disks.ID = this->probes.start(L"", [sessions, query]() { query->Succeeded = QueryPhysicalDisks(*sessions, query->PhysicalDisks); });
 
-    hres = pLoc->ConnectServer(
-        nmespace, // Namespace
-        nullptr,                               // User
-        nullptr,                               // Password
-        0,                                     // Locale
-        NULL,                                  // Security flags
-        0,                                     // Authority
-        0,                                     // Context
-        &pSvc                                 // IWbemServices pointer
-    );
+    //the disks that were added or removed are known once the query finishes
+    return StorageChanges();
+}
+
+bool StorageInformation::QueryPhysicalDisks(PlatformSessions& sessions, std::map<std::wstring, PhysicalDisk>& physicalDisks)
+{
+    HRESULT hres = CoInitializeEx(0, COINIT_MULTITHREADED);
 
     //Error checking
     if (FAILED(hres)) {
-        //Could not connect to WMI namespace. Error code: hres
-        pLoc->Release();
-        CoUninitialize();
-        return;
+        //Failed to initialize COM library. Error code:hres
+        return 0;
     }
 
-    // Set security levels on the proxy
-    hres = CoSetProxyBlanket(
-        pSvc,                        // IWbemServices pointer
-        RPC_C_AUTHN_WINNT,           // Authentication service
-        RPC_C_AUTHZ_NONE,            // Authorization service
-        NULL,                        // Server principal name
-        RPC_C_AUTHN_LEVEL_CALL,      // Authentication level
-        RPC_C_IMP_LEVEL_IMPERSONATE, // Impersonation level
-        NULL,                        // Authentication info
-        EOAC_NONE                    // Additional capabilities
-    );
+    //the connection to the storage namespace is made once and shared with every later query
+    IWbemServices* pSvc = sessions.getWmiServices(L"root\\Microsoft\\Windows\\Storage");
 
     //Error checking
-    if (FAILED(hres)) {
-        //Could not set proxy blanket. Error code: hres
-        pSvc->Release();
-        pLoc->Release();
+    if (pSvc == nullptr) {
+        //Could not connect to WMI namespace
         CoUninitialize();
-        return;
+        return 0;
     }
 
     //Init parameters
@@ -241,27 +212,32 @@ void StorageInformation::InitPhysicalDisks()
     if (FAILED(hres)) {
         //Query for MSFT_PhysicalDisk failed. Error code: hres
         pSvc->Release();
-        pLoc->Release();
         CoUninitialize();
-        return;
+        return 0;
     }
 
     // Retrieve data from the query
     IWbemClassObject* pclsObj = nullptr;
     ULONG uReturn = 0;
 
+    //a query that fails part way did not list every disk
+    bool succeeded = 1;
+
     //Iterate over all returned records
     while (pEnumerator) {
         hres = pEnumerator->Next(WBEM_INFINITE, 1, &pclsObj, &uReturn);
 
+        //Error checking
+        if (FAILED(hres)) {
+            succeeded = 0;
+            break;
+        }
+
         //Break if there are no records left
         if (0 == uReturn) {
             break;
         }
 
-        //Add new PhysicalDisk object to the PhysicalDisks std::vector
-        //this->PhysicalDisks.push_back(PhysicalDisk());
-
         //Stores the return values
         VARIANT vtProp;
 
@@ -273,7 +249,7 @@ void StorageInformation::InitPhysicalDisks()
         {
             DiskName = std::wstring(vtProp.bstrVal, SysStringLen(vtProp.bstrVal));
             
-            this->PhysicalDisks[DiskName].FriendlyName = DiskName;
+            physicalDisks[DiskName].FriendlyName = DiskName;
             
             VariantClear(&vtProp);
         }
@@ -282,7 +258,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"DeviceID", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres)) 
         {
-            this->PhysicalDisks[DiskName].DeviceID = std::wstring(vtProp.bstrVal, SysStringLen(vtProp.bstrVal));
+            physicalDisks[DiskName].DeviceID = std::wstring(vtProp.bstrVal, SysStringLen(vtProp.bstrVal));
             VariantClear(&vtProp);
         }
 
@@ -293,55 +269,55 @@ void StorageInformation::InitPhysicalDisks()
             switch (vtProp.uintVal)
             {
             case 0:
-                this->PhysicalDisks[DiskName].BusType = L"Unknown";
+                physicalDisks[DiskName].BusType = L"Unknown";
                 break;
             case 1:
-                this->PhysicalDisks[DiskName].BusType = L"SCSI";
+                physicalDisks[DiskName].BusType = L"SCSI";
                 break;
             case 2:
-                this->PhysicalDisks[DiskName].BusType = L"ATAPI";
+                physicalDisks[DiskName].BusType = L"ATAPI";
                 break;
             case 3:
-                this->PhysicalDisks[DiskName].BusType = L"ATA";
+                physicalDisks[DiskName].BusType = L"ATA";
                 break;
             case 4:
-                this->PhysicalDisks[DiskName].BusType = L"1394";
+                physicalDisks[DiskName].BusType = L"1394";
                 break;
             case 5:
-                this->PhysicalDisks[DiskName].BusType = L"SSA";
+                physicalDisks[DiskName].BusType = L"SSA";
                 break;
             case 6:
-                this->PhysicalDisks[DiskName].BusType = L"Fibre Channel";
+                physicalDisks[DiskName].BusType = L"Fibre Channel";
                 break;
             case 7:
-                this->PhysicalDisks[DiskName].BusType = L"USB";
+                physicalDisks[DiskName].BusType = L"USB";
                 break;
             case 8:
-                this->PhysicalDisks[DiskName].BusType = L"RAID";
+                physicalDisks[DiskName].BusType = L"RAID";
                 break;
             case 9:
-                this->PhysicalDisks[DiskName].BusType = L"iSCSI";
+                physicalDisks[DiskName].BusType = L"iSCSI";
                 break;
             case 10:
-                this->PhysicalDisks[DiskName].BusType = L"SAS";
+                physicalDisks[DiskName].BusType = L"SAS";
                 break;
             case 11:
-                this->PhysicalDisks[DiskName].BusType = L"SATA";
+                physicalDisks[DiskName].BusType = L"SATA";
                 break;
             case 12:
-                this->PhysicalDisks[DiskName].BusType = L"SD";
+                physicalDisks[DiskName].BusType = L"SD";
                 break;
             case 13:
-                this->PhysicalDisks[DiskName].BusType = L"MMC";
+                physicalDisks[DiskName].BusType = L"MMC";
                 break;
             case 15:
-                this->PhysicalDisks[DiskName].BusType = L"File Backed Virtual";
+                physicalDisks[DiskName].BusType = L"File Backed Virtual";
                 break;
             case 16:
-                this->PhysicalDisks[DiskName].BusType = L"Storage Spaces";
+                physicalDisks[DiskName].BusType = L"Storage Spaces";
                 break;
             case 17:
-                this->PhysicalDisks[DiskName].BusType = L"NVMe";
+                physicalDisks[DiskName].BusType = L"NVMe";
                 break;
             default:
                 break;
@@ -356,16 +332,16 @@ void StorageInformation::InitPhysicalDisks()
             switch (vtProp.uintVal)
             {
             case 0:
-                this->PhysicalDisks[DiskName].MediaType = L"Unspecified";
+                physicalDisks[DiskName].MediaType = L"Unspecified";
                 break;
             case 3:
-                this->PhysicalDisks[DiskName].MediaType = L"HDD";
+                physicalDisks[DiskName].MediaType = L"HDD";
                 break;
             case 4:
-                this->PhysicalDisks[DiskName].MediaType = L"SSD";
+                physicalDisks[DiskName].MediaType = L"SSD";
                 break;
             case 5:
-                this->PhysicalDisks[DiskName].MediaType = L"SCM";
+                physicalDisks[DiskName].MediaType = L"SCM";
                 break;
             default:
                 break;
@@ -377,7 +353,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"partNumber", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres))
         {
-            this->PhysicalDisks[DiskName].partNumber = std::wstring(vtProp.bstrVal, SysStringLen(vtProp.bstrVal));
+            physicalDisks[DiskName].partNumber = std::wstring(vtProp.bstrVal, SysStringLen(vtProp.bstrVal));
             VariantClear(&vtProp);
         }
 
@@ -388,16 +364,16 @@ void StorageInformation::InitPhysicalDisks()
             switch (vtProp.uintVal)
             {
             case 0:
-                this->PhysicalDisks[DiskName].HealthStatus = L"Healthy";
+                physicalDisks[DiskName].HealthStatus = L"Healthy";
                 break;
             case 1:
-                this->PhysicalDisks[DiskName].HealthStatus = L"Warning";
+                physicalDisks[DiskName].HealthStatus = L"Warning";
                 break;
             case 2:
-                this->PhysicalDisks[DiskName].HealthStatus = L"Unhealthy";
+                physicalDisks[DiskName].HealthStatus = L"Unhealthy";
                 break;
             case 5:
-                this->PhysicalDisks[DiskName].HealthStatus = L"Unknown";
+                physicalDisks[DiskName].HealthStatus = L"Unknown";
                 break;
             default:
                 break;
@@ -412,22 +388,22 @@ void StorageInformation::InitPhysicalDisks()
             switch (vtProp.uintVal)
             {
             case 0:
-                this->PhysicalDisks[DiskName].Usage = L"Unknown";
+                physicalDisks[DiskName].Usage = L"Unknown";
                 break;
             case 1:
-                this->PhysicalDisks[DiskName].Usage = L"Auto-Select";
+                physicalDisks[DiskName].Usage = L"Auto-Select";
                 break;
             case 2:
-                this->PhysicalDisks[DiskName].Usage = L"Manual-Select";
+                physicalDisks[DiskName].Usage = L"Manual-Select";
                 break;
             case 3:
-                this->PhysicalDisks[DiskName].Usage = L"Hot Spare";
+                physicalDisks[DiskName].Usage = L"Hot Spare";
                 break;
             case 4:
-                this->PhysicalDisks[DiskName].Usage = L"Retired";
+                physicalDisks[DiskName].Usage = L"Retired";
                 break;
             case 5:
-                this->PhysicalDisks[DiskName].Usage = L"Journal";
+                physicalDisks[DiskName].Usage = L"Journal";
                 break;
             default:
                 break;
@@ -439,7 +415,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"PhysicalSectorSize", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres))
         {
-            this->PhysicalDisks[DiskName].PhysicalSectorSize = vtProp.ullVal;
+            physicalDisks[DiskName].PhysicalSectorSize = vtProp.ullVal;
             VariantClear(&vtProp);
         }
 
@@ -447,7 +423,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"LogicalSectorSize", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres))
         {
-            this->PhysicalDisks[DiskName].LogicalSectorSize = vtProp.ullVal;
+            physicalDisks[DiskName].LogicalSectorSize = vtProp.ullVal;
             VariantClear(&vtProp);
         }
 
@@ -455,7 +431,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"AllocatedSize", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres))
         {
-            this->PhysicalDisks[DiskName].AllocatedSize = vtProp.ullVal;
+            physicalDisks[DiskName].AllocatedSize = vtProp.ullVal;
             VariantClear(&vtProp);
         }
 
@@ -463,7 +439,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"SpindleSpeed", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres))
         {
-            this->PhysicalDisks[DiskName].SpindleSpeed = vtProp.uintVal;
+            physicalDisks[DiskName].SpindleSpeed = vtProp.uintVal;
             VariantClear(&vtProp);
         }
 
@@ -471,7 +447,7 @@ void StorageInformation::InitPhysicalDisks()
         hres = pclsObj->Get(L"Size", 0, &vtProp, 0, 0);
         if (SUCCEEDED(hres))
         {
-            this->PhysicalDisks[DiskName].Size = vtProp.ullVal;
+            physicalDisks[DiskName].Size = vtProp.ullVal;
             VariantClear(&vtProp);
         }
 
@@ -480,7 +456,9 @@ void StorageInformation::InitPhysicalDisks()
 
     //Cleanup
     pSvc->Release();
-    pLoc->Release();
     pEnumerator->Release();
     CoUninitialize();
-}
\ No newline at end of file
+
+    return succeeded;
+}
+#endif
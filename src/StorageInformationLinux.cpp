@@ -0,0 +1,288 @@
+#include "StorageInformation.h"
+#ifndef _WIN32
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cctype>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/statfs.h>
+
+/**
+* File systems that are served over the network, they have no block device but are still drives
+*/
+static const char* const NetworkFileSystems[] = { "nfs", "nfs4", "cifs", "smb3", "smbfs", "9p", "ceph", "glusterfs", "fuse.sshfs", "fuse.glusterfs" };
+
+/**
+* Widens a string the same way the rest of the program narrows them
+*/
+static std::wstring toWide(const std::string& text)
+{
+    return std::wstring(text.begin(), text.end());
+}
+
+/**
+* Reads the first line of a sysfs attribute without the trailing whitespace
+* @param directory The sysfs directory descriptor the path is relative to
+* @param path The path of the attribute relative to the root of sysfs
+* @return The value, empty if the attribute does not exist
+*/
+static std::string readAttribute(const int directory, const std::string& path)
+{
+    int file = openat(directory, path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) return std::string();
+
+    //attributes are a single short line
+    char buffer[256];
+    ssize_t length = read(file, buffer, sizeof(buffer));
+    close(file);
+
+    if (length <= 0) return std::string();
+
+    std::string value(buffer, (size_t)length);
+    size_t line_end = value.find('\n');
+    if (line_end != std::string::npos) value.erase(line_end);
+
+    while (!value.empty() && isspace((unsigned char)value.back())) value.pop_back();
+
+    return value;
+}
+
+/**
+* Reads a numeric sysfs attribute
+* @return The value, 0 if the attribute does not exist
+*/
+static unsigned long long readNumericAttribute(const int directory, const std::string& path)
+{
+    return strtoull(readAttribute(directory, path).c_str(), nullptr, 10);
+}
+
+/**
+* Checks if a path relative to the sysfs directory descriptor exists
+*/
+static bool pathExists(const int directory, const std::string& path)
+{
+    return faccessat(directory, path.c_str(), F_OK, 0) == 0;
+}
+
+/**
+* Decodes the octal escapes mountinfo uses for spaces, tabs, newlines and backslashes in paths
+*/
+static std::string unescapeMountPath(const std::string& path)
+{
+    std::string result;
+    result.reserve(path.size());
+
+    for (size_t index = 0; index < path.size(); index++)
+    {
+        if (path[index] == '\\' && index + 3 < path.size() && isdigit((unsigned char)path[index + 1]) && isdigit((unsigned char)path[index + 2]) && isdigit((unsigned char)path[index + 3]))
+        {
+            result += (char)((path[index + 1] - '0') * 64 + (path[index + 2] - '0') * 8 + (path[index + 3] - '0'));
+            index += 3;
+        }
+        else
+        {
+            result += path[index];
+        }
+    }
+
+    return result;
+}
+
+/**
+* Gets the transport a disk is attached through from its name and the path of its device in sysfs
+* @param name The kernel name of the disk
+* @param device_path The resolved path of the disk in sysfs, it goes through the controller the disk is attached to
+* @param directory The sysfs directory descriptor
+* @param block_path The path of the disk in the block directory of sysfs relative to its root
+*/
+static std::wstring getBusType(const std::string& name, const std::string& device_path, const int directory, const std::string& block_path)
+{
+    if (name.compare(0, 4, "nvme") == 0) return L"NVMe";
+
+    if (name.compare(0, 6, "mmcblk") == 0)
+    {
+        //SD cards and eMMC share the driver
+        return readAttribute(directory, block_path + "/device/type") == "SD" ? L"SD" : L"MMC";
+    }
+
+    if (name.compare(0, 2, "vd") == 0) return L"Virtio";
+    if (name.compare(0, 3, "xvd") == 0) return L"Xen";
+
+    //SCSI disks are named the same whatever transport they are on, the controllers in the path tell them apart
+    if (device_path.find("/usb") != std::string::npos) return L"USB";
+    if (device_path.find("/ata") != std::string::npos) return L"SATA";
+    if (device_path.find("/end_device-") != std::string::npos) return L"SAS";
+    if (device_path.find("/session") != std::string::npos) return L"iSCSI";
+    if (device_path.find("/rport-") != std::string::npos) return L"Fibre Channel";
+    if (device_path.find("/virtio") != std::string::npos) return L"Virtio";
+
+    if (name.compare(0, 2, "sd") == 0 || name.compare(0, 2, "sr") == 0) return L"SCSI";
+
+    return L"Unknown";
+}
+
+void StorageInformation::InitBlockDeviceInfo(Drive& drive, const std::string& DeviceNumber)
+{
+    //sysfs links every block device by its number, partitions keep the queue and the removable flag in their disk
+    std::string device_path = "dev/block/" + DeviceNumber;
+    if (!pathExists(this->sysfs_directory, device_path)) return;
+
+    std::string disk_path = pathExists(this->sysfs_directory, device_path + "/partition") ? device_path + "/.." : device_path;
+
+    drive.BytesPerSector = (unsigned long)readNumericAttribute(this->sysfs_directory, disk_path + "/queue/logical_block_size");
+
+    //device mapper volumes like LVM are named after what they were configured as
+    std::string mapped_name = readAttribute(this->sysfs_directory, device_path + "/dm/name");
+    if (!mapped_name.empty()) drive.VolumeName = toWide(mapped_name);
+
+    if (readAttribute(this->sysfs_directory, disk_path + "/removable") == "1")
+    {
+        drive.VolumeType = (drive.FileSystem == L"iso9660" || drive.FileSystem == L"udf") ? L"CD-ROM Drive" : L"Removable Drive";
+    }
+}
+
+void StorageInformation::ReadDriveList(std::map<std::wstring, Drive>& drives)
+{
+    std::ifstream mountinfo(this->mountinfo_path);
+    std::string line;
+
+    while (std::getline(mountinfo, line))
+    {
+        //ID, parent ID, major:minor, root, mount point, options, optional fields ending at "-", file system type, source, super options
+        std::istringstream fields(line);
+        std::string id, parent, device_number, root, mount_point, options, field;
+
+        if (!(fields >> id >> parent >> device_number >> root >> mount_point >> options)) continue;
+
+        while (fields >> field && field != "-");
+
+        std::string file_system, source;
+        if (!(fields >> file_system >> source)) continue;
+
+        source = unescapeMountPath(source);
+        mount_point = unescapeMountPath(mount_point);
+
+        bool network = 0;
+        for (const char* network_file_system : NetworkFileSystems)
+        {
+            network |= file_system == network_file_system;
+        }
+
+        //only block devices and network shares hold data, everything else is a pseudo file system
+        bool device_backed = source.compare(0, 5, "/dev/") == 0;
+        if (!device_backed && !network) continue;
+
+        //a later mount on the same point hides the earlier one
+        std::wstring volume = toWide(mount_point);
+        Drive& drive = drives[volume];
+        drive = Drive();
+
+        drive.Device = toWide(source);
+        drive.FileSystem = toWide(file_system);
+        drive.VolumeType = network ? L"Network Drive" : L"Fixed Drive";
+
+        //file systems like btrfs report an anonymous device number that has no entry in sysfs
+        if (device_backed && device_number.compare(0, 2, "0:") != 0) InitBlockDeviceInfo(drive, device_number);
+    }
+}
+
+void StorageInformation::ProbeDrive(const std::wstring& Volume, Drive& drive)
+{
+    //the file system ID takes the place of the volume serial number, mount points of a fake tree do not exist
+    struct statfs status;
+    if (statfs(std::string(Volume.begin(), Volume.end()).c_str(), &status) == 0)
+    {
+        int fsid[2];
+        memcpy(fsid, &status.f_fsid, sizeof(fsid));
+        drive.VolumeSerialNumber = (unsigned long)(unsigned int)fsid[0];
+    }
+}
+
+void StorageInformation::InitPhysicalDisk(const std::string& name, PhysicalDisk& disk)
+{
+    std::string block_path = "block/" + name;
+
+    disk = PhysicalDisk();
+
+    //the size is always counted in 512 byte sectors
+    disk.Size = readNumericAttribute(this->sysfs_directory, block_path + "/size") * 512;
+    disk.AllocatedSize = disk.Size;
+    disk.LogicalSectorSize = readNumericAttribute(this->sysfs_directory, block_path + "/queue/logical_block_size");
+    disk.PhysicalSectorSize = readNumericAttribute(this->sysfs_directory, block_path + "/queue/physical_block_size");
+
+    disk.MediaType = readAttribute(this->sysfs_directory, block_path + "/queue/rotational") == "1" ? L"HDD" : L"SSD";
+    if (name.compare(0, 2, "sr") == 0) disk.MediaType = L"Unspecified";
+
+    disk.DeviceID = toWide(name);
+
+    //disks without a model name are shown by their kernel name
+    std::string model = readAttribute(this->sysfs_directory, block_path + "/device/model");
+    disk.FriendlyName = toWide(model.empty() ? name : model);
+
+    disk.partNumber = toWide(readAttribute(this->sysfs_directory, block_path + "/device/serial"));
+    disk.Usage = readAttribute(this->sysfs_directory, block_path + "/removable") == "1" ? L"Removable" : L"Fixed";
+    disk.HealthStatus = L"Unknown";
+
+    //the real path goes through the controllers the disk is attached to
+    char resolved[PATH_MAX];
+    std::string full_path = this->sysfs_root + "/" + block_path;
+    std::string device_path = realpath(full_path.c_str(), resolved) != nullptr ? resolved : full_path;
+    disk.BusType = getBusType(name, device_path, this->sysfs_directory, block_path);
+}
+
+StorageInformation::StorageChanges StorageInformation::refreshPhysicalDisks()
+{
+    StorageChanges changes;
+
+    //sysfs is kept by the kernel, listing it never waits on a disk so there is nothing to probe
+    std::map<std::wstring, std::string> present;
+
+    //the listing owns its own descriptor of the block directory, the one of the sysfs root stays open
+    int block_directory = openat(this->sysfs_directory, "block", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* directory = block_directory >= 0 ? fdopendir(block_directory) : nullptr;
+    if (directory == nullptr && block_directory >= 0) close(block_directory);
+
+    //the disks that are known are kept if sysfs could not be listed
+    if (directory == nullptr) return changes;
+
+    while (dirent* entry = readdir(directory))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        //loop, ram, zram, device mapper and software RAID devices have no hardware behind them
+        if (!pathExists(this->sysfs_directory, "block/" + name + "/device")) continue;
+
+        present[toWide(name)] = name;
+    }
+
+    closedir(directory);
+
+    for (auto disk = this->PhysicalDisks.begin(); disk != this->PhysicalDisks.end();)
+    {
+        if (present.find(disk->first) != present.end())
+        {
+            disk++;
+            continue;
+        }
+
+        changes.RemovedDisks.push_back(disk->first);
+        disk = this->PhysicalDisks.erase(disk);
+    }
+
+    //only the disks that were not known yet are read
+    for (auto& name : present)
+    {
+        if (this->PhysicalDisks.find(name.first) != this->PhysicalDisks.end()) continue;
+
+        InitPhysicalDisk(name.second, this->PhysicalDisks[name.first]);
+        changes.AddedDisks.push_back(name.first);
+    }
+
+    return changes;
+}
+#endif
@@ -0,0 +1,168 @@
+#include "StorageInformation.h"
+
+bool StorageInformation::StorageChanges::empty() const
+{
+    return this->AddedDrives.empty() && this->RemovedDrives.empty() && this->UpdatedDrives.empty() && this->AddedDisks.empty() && this->RemovedDisks.empty();
+}
+
+void StorageInformation::StorageChanges::append(const StorageChanges& changes)
+{
+    this->AddedDrives.insert(this->AddedDrives.end(), changes.AddedDrives.begin(), changes.AddedDrives.end());
+    this->RemovedDrives.insert(this->RemovedDrives.end(), changes.RemovedDrives.begin(), changes.RemovedDrives.end());
+    this->UpdatedDrives.insert(this->UpdatedDrives.end(), changes.UpdatedDrives.begin(), changes.UpdatedDrives.end());
+    this->AddedDisks.insert(this->AddedDisks.end(), changes.AddedDisks.begin(), changes.AddedDisks.end());
+    this->RemovedDisks.insert(this->RemovedDisks.end(), changes.RemovedDisks.begin(), changes.RemovedDisks.end());
+}
+
+void StorageInformation::init()
+{
+#ifndef _WIN32
+    this->sysfs_directory = this->sessions->getDirectory(this->sysfs_root);
+#endif
+
+    refreshDrives();
+    refreshPhysicalDisks();
+    waitForProbes();
+}
+
+void StorageInformation::startDriveProbe(const std::wstring& Volume)
+{
+    //the probe fills its own copy of the drive, it is only merged into Drives once it finished
+    std::shared_ptr<Drive> drive = std::make_shared<Drive>(this->Drives[Volume]);
+
+    RunningProbe<Drive>& probe = this->probed_drives[Volume];
+    probe.Result = drive;
+
+    //the probe keeps its own copy of the function, it can outlive this object
+    std::function<void(const std::wstring&, Drive&)> drive_probe = this->drive_probe;
+    probe.ID = this->probes.start(Volume, [Volume, drive, drive_probe]() { drive_probe(Volume, *drive); });
+}
+
+StorageInformation::StorageChanges StorageInformation::refreshDrives()
+{
+    StorageChanges changes;
+
+    std::map<std::wstring, Drive> drives;
+    ReadDriveList(drives);
+
+    for (auto drive = this->Drives.begin(); drive != this->Drives.end();)
+    {
+        auto current = drives.find(drive->first);
+
+        //a volume that is now a different device or file system is removed and added again
+        if (current != drives.end() && current->second.Device == drive->second.Device && current->second.FileSystem == drive->second.FileSystem)
+        {
+            drive++;
+            continue;
+        }
+
+        //the probe of a drive that is gone can still finish, its result is dropped
+        this->probed_drives.erase(drive->first);
+
+        changes.RemovedDrives.push_back(drive->first);
+        drive = this->Drives.erase(drive);
+    }
+
+    //only the drives that were not known yet are probed
+    for (auto& drive : drives)
+    {
+        if (this->Drives.find(drive.first) != this->Drives.end()) continue;
+
+        this->Drives[drive.first] = drive.second;
+        startDriveProbe(drive.first);
+
+        changes.AddedDrives.push_back(drive.first);
+    }
+
+    return changes;
+}
+
+void StorageInformation::mergeFinishedProbes(StorageChanges& changes)
+{
+    for (const DeviceProbes::FinishedProbe& finished : this->probes.takeFinished())
+    {
+        //the physical disks are reported by an empty key
+        if (finished.Key.empty())
+        {
+            if (!this->probed_physical_disks.Result || this->probed_physical_disks.ID != finished.ID) continue;
+
+            const PhysicalDiskQuery& query = *this->probed_physical_disks.Result;
+
+            //a failed query lists no disk or only some of them, the disks that are known are kept until a query succeeds
+            if (query.Succeeded)
+            {
+                for (auto disk = this->PhysicalDisks.begin(); disk != this->PhysicalDisks.end();)
+                {
+                    if (query.PhysicalDisks.find(disk->first) != query.PhysicalDisks.end())
+                    {
+                        disk++;
+                        continue;
+                    }
+
+                    changes.RemovedDisks.push_back(disk->first);
+                    disk = this->PhysicalDisks.erase(disk);
+                }
+
+                for (auto& disk : query.PhysicalDisks)
+                {
+                    if (this->PhysicalDisks.find(disk.first) == this->PhysicalDisks.end()) changes.AddedDisks.push_back(disk.first);
+
+                    this->PhysicalDisks[disk.first] = disk.second;
+                }
+            }
+
+            this->probed_physical_disks.Result.reset();
+            this->PhysicalDisksTimedOut = 0;
+
+            //the disks changed again while they were being queried
+            if (this->physical_disks_changed)
+            {
+                this->physical_disks_changed = 0;
+                refreshPhysicalDisks();
+            }
+
+            continue;
+        }
+
+        //a drive that was removed and added again while its first probe was running only takes the result of the last probe
+        auto drive = this->probed_drives.find(finished.Key);
+        if (drive == this->probed_drives.end() || drive->second.ID != finished.ID) continue;
+
+        this->Drives[finished.Key] = *drive->second.Result;
+        this->Drives[finished.Key].ProbeTimedOut = 0;
+        this->probed_drives.erase(drive);
+
+        changes.UpdatedDrives.push_back(finished.Key);
+    }
+}
+
+void StorageInformation::waitForProbes()
+{
+    this->probes.wait(this->probe_timeout);
+
+    StorageChanges changes;
+    mergeFinishedProbes(changes);
+
+    //whatever did not answer in time is shown as timed out instead of blocking the startup
+    for (auto& drive : this->probed_drives)
+    {
+        this->Drives[drive.first].ProbeTimedOut = 1;
+    }
+
+    if (this->probed_physical_disks.Result) this->PhysicalDisksTimedOut = 1;
+}
+
+StorageInformation::StorageChanges StorageInformation::collectLateProbes()
+{
+    StorageChanges changes;
+
+    //nothing to do once every probe answered
+    if (this->probes.getPendingCount() != 0) mergeFinishedProbes(changes);
+
+    return changes;
+}
+
+bool StorageInformation::isProbing(const std::wstring& Volume) const
+{
+    return this->probed_drives.find(Volume) != this->probed_drives.end();
+}
@@ -0,0 +1,162 @@
+#include "StorageWatcher.h"
+#include <cstring>
+#include <cerrno>
+#ifdef _WIN32
+#include <windows.h>
+#include <initguid.h>
+#include <winioctl.h>
+#include <cfgmgr32.h>
+#pragma comment(lib, "cfgmgr32.lib")
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <fcntl.h>
+#endif
+
+#ifdef _WIN32
+/**
+* Called on a system thread whenever a disk or a volume interface arrives or is removed
+* @param context The pending changes of the watcher
+*/
+static DWORD CALLBACK deviceNotificationCallback(HCMNOTIFICATION notification, PVOID context, CM_NOTIFY_ACTION action, PCM_NOTIFY_EVENT_DATA eventData, DWORD eventDataSize)
+{
+    if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL || action == CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL)
+    {
+        long change = IsEqualGUID(eventData->u.DeviceInterface.ClassGuid, GUID_DEVINTERFACE_DISK) ? StorageWatcher::DisksChanged : StorageWatcher::DrivesChanged;
+        InterlockedOr((long*)context, change);
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/**
+* Registers for the arrival and removal of a device interface class
+* @return The notification handle, nullptr if it could not be registered
+*/
+static void* registerDeviceNotification(const GUID& interfaceClass, long* pending_changes)
+{
+    CM_NOTIFY_FILTER filter = {};
+    filter.cbSize = sizeof(filter);
+    filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+    filter.u.DeviceInterface.ClassGuid = interfaceClass;
+
+    HCMNOTIFICATION notification = NULL;
+    if (CM_Register_Notification(&filter, pending_changes, deviceNotificationCallback, &notification) != CR_SUCCESS) return nullptr;
+
+    return notification;
+}
+#endif
+
+StorageWatcher::StorageWatcher(PlatformSessions& sessions)
+{
+#ifdef _WIN32
+    this->logical_drives = GetLogicalDrives();
+
+    this->disk_notification = registerDeviceNotification(GUID_DEVINTERFACE_DISK, &this->pending_changes);
+    this->volume_notification = registerDeviceNotification(GUID_DEVINTERFACE_VOLUME, &this->pending_changes);
+#else
+    //the kernel sends every device event to the first multicast group, no privileges are needed to listen
+    this->uevent_socket = sessions.getNetlinkSocket(NETLINK_KOBJECT_UEVENT, 1);
+
+    this->uevent_buffer.resize(8192);
+
+    this->mountinfo_file = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+StorageWatcher::~StorageWatcher()
+{
+#ifdef _WIN32
+    //unregistering waits for the callbacks that are running
+    if (this->disk_notification != nullptr) CM_Unregister_Notification((HCMNOTIFICATION)this->disk_notification);
+    if (this->volume_notification != nullptr) CM_Unregister_Notification((HCMNOTIFICATION)this->volume_notification);
+#else
+    //the uevent socket is closed with the sessions
+    if (this->mountinfo_file >= 0) close(this->mountinfo_file);
+#endif
+}
+
+unsigned int StorageWatcher::parseDeviceEvent(const char* message, const size_t size)
+{
+    //udev forwards the events with its own header, only the ones straight from the kernel start with the action
+    const char* end = message + size;
+    const char* separator = (const char*)memchr(message, '@', size);
+    if (separator == nullptr) return 0;
+
+    bool added = 0, removed = 0, block = 0, disk = 0;
+
+    const char* field = message;
+    while (field < end)
+    {
+        size_t length = strnlen(field, end - field);
+
+        if (length == 10 && memcmp(field, "ACTION=add", 10) == 0) added = 1;
+        else if (length == 13 && memcmp(field, "ACTION=remove", 13) == 0) removed = 1;
+        else if (length == 15 && memcmp(field, "SUBSYSTEM=block", 15) == 0) block = 1;
+        else if (length == 12 && memcmp(field, "DEVTYPE=disk", 12) == 0) disk = 1;
+
+        field += length + 1;
+    }
+
+    //partitions come and go with their disk, the drives on them change when they are mounted
+    if (block && disk && (added || removed)) return DisksChanged;
+
+    return 0;
+}
+
+#ifndef _WIN32
+unsigned int StorageWatcher::readDeviceEvents()
+{
+    unsigned int changes = 0;
+    if (this->uevent_socket < 0) return changes;
+
+    while (1)
+    {
+        ssize_t length = recv(this->uevent_socket, this->uevent_buffer.data(), this->uevent_buffer.size(), MSG_DONTWAIT);
+
+        //the socket overflowed and events were lost, anything could have changed
+        if (length < 0 && errno == ENOBUFS)
+        {
+            changes |= DisksChanged;
+            continue;
+        }
+
+        if (length <= 0) break;
+
+        changes |= parseDeviceEvent(this->uevent_buffer.data(), (size_t)length);
+    }
+
+    return changes;
+}
+
+bool StorageWatcher::mountsChanged()
+{
+    if (this->mountinfo_file < 0) return 0;
+
+    pollfd file = { this->mountinfo_file, POLLPRI, 0 };
+    if (::poll(&file, 1, 0) <= 0) return 0;
+
+    return (file.revents & (POLLPRI | POLLERR)) != 0;
+}
+#endif
+
+unsigned int StorageWatcher::poll()
+{
+#ifdef _WIN32
+    unsigned int changes = (unsigned int)InterlockedExchange(&this->pending_changes, 0);
+
+    //a drive letter can be assigned a while after its volume arrived
+    unsigned long logicalDrives = GetLogicalDrives();
+    if (logicalDrives != this->logical_drives) changes |= DrivesChanged;
+    this->logical_drives = logicalDrives;
+
+    return changes;
+#else
+    unsigned int changes = readDeviceEvents();
+    if (mountsChanged()) changes |= DrivesChanged;
+
+    return changes;
+#endif
+}
@@ -0,0 +1,407 @@
+#include "TcpHealth.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#include <tcpestats.h>
+#pragma comment(lib, "iphlpapi.lib")
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/tcp.h>
+#endif
+
+static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+bool TcpHealth::EndpointKey::operator==(const EndpointKey& other) const
+{
+    return this->Family == other.Family && memcmp(this->Address, other.Address, sizeof(this->Address)) == 0;
+}
+
+size_t TcpHealth::EndpointKeyHash::operator()(const EndpointKey& key) const
+{
+    //FNV-1a, the addresses of most hosts only differ in the last bytes
+    unsigned long long hash = 14695981039346656037ull;
+    hash = (hash ^ key.Family) * 1099511628211ull;
+    for (unsigned char byte : key.Address)
+    {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+
+    return (size_t)hash;
+}
+
+void TcpHealth::Aggregate::add(const ConnectionSample& sample)
+{
+    this->Connections++;
+
+    if (!std::isnan(sample.Rtt))
+    {
+        this->RttConnections++;
+        this->RttSum += sample.Rtt;
+        this->RttMax = std::max(this->RttMax, sample.Rtt);
+        this->RttVariationSum += sample.RttVariation;
+    }
+
+    this->Retransmits += sample.Retransmits;
+    if (sample.SegmentsSent != 0)
+    {
+        this->SegmentsSent += sample.SegmentsSent;
+        this->RatioRetransmits += sample.Retransmits;
+    }
+
+    this->CongestionWindowSum += sample.CongestionWindow;
+}
+
+void TcpHealth::Aggregate::merge(const Aggregate& other)
+{
+    this->Connections += other.Connections;
+    this->RttConnections += other.RttConnections;
+    this->RttSum += other.RttSum;
+    this->RttMax = std::max(this->RttMax, other.RttMax);
+    this->RttVariationSum += other.RttVariationSum;
+    this->Retransmits += other.Retransmits;
+    this->SegmentsSent += other.SegmentsSent;
+    this->RatioRetransmits += other.RatioRetransmits;
+    this->CongestionWindowSum += other.CongestionWindowSum;
+}
+
+TcpHealthMetrics TcpHealth::Aggregate::getMetrics() const
+{
+    TcpHealthMetrics metrics;
+    metrics.Connections = this->Connections;
+    if (this->Connections == 0) return metrics;
+
+    if (this->RttConnections != 0)
+    {
+        metrics.AverageRtt = this->RttSum / this->RttConnections;
+        metrics.MaxRtt = this->RttMax;
+        metrics.RttVariation = this->RttVariationSum / this->RttConnections;
+    }
+
+    metrics.Retransmits = (double)this->Retransmits;
+    if (this->SegmentsSent != 0) metrics.RetransmitRatio = this->RatioRetransmits * 100.0 / this->SegmentsSent;
+
+    metrics.AverageCongestionWindow = this->CongestionWindowSum / this->Connections;
+
+    return metrics;
+}
+
+void TcpHealth::addConnection(const unsigned char family, const unsigned char* remoteAddress, const unsigned int processID, const ConnectionSample& sample)
+{
+    this->system.add(sample);
+
+    EndpointKey endpoint;
+    memset(&endpoint, 0, sizeof(endpoint));
+    endpoint.Family = family;
+    memcpy(endpoint.Address, remoteAddress, family == AF_INET ? 4 : 16);
+    this->endpoints.add(endpoint, sample);
+
+    if (processID != 0) this->processes.add(processID, sample);
+}
+
+std::vector<TcpHealth::EndpointHealth> TcpHealth::getTopEndpoints(const size_t count) const
+{
+    const auto& slots = this->endpoints.getSlots();
+
+    std::vector<size_t> order(slots.size());
+    for (size_t index = 0; index < order.size(); index++) order[index] = index;
+
+    size_t shown = std::min(count, order.size());
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&slots](const size_t first, const size_t second)
+    {
+        return slots[first].Sums.Connections > slots[second].Sums.Connections;
+    });
+
+    std::vector<EndpointHealth> top(shown);
+    for (size_t index = 0; index < shown; index++)
+    {
+        const auto& slot = slots[order[index]];
+
+        char address[INET6_ADDRSTRLEN] = {};
+        inet_ntop(slot.Group.Family, (void*)slot.Group.Address, address, sizeof(address));
+
+        top[index].Address = address;
+        top[index].Metrics = slot.Sums.getMetrics();
+    }
+
+    return top;
+}
+
+std::vector<TcpHealth::ProcessHealth> TcpHealth::getTopProcesses(const size_t count) const
+{
+    const auto& slots = this->processes.getSlots();
+
+    std::vector<size_t> order(slots.size());
+    for (size_t index = 0; index < order.size(); index++) order[index] = index;
+
+    size_t shown = std::min(count, order.size());
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&slots](const size_t first, const size_t second)
+    {
+        return slots[first].Sums.Connections != slots[second].Sums.Connections ? slots[first].Sums.Connections > slots[second].Sums.Connections : slots[first].Group < slots[second].Group;
+    });
+
+    std::vector<ProcessHealth> top(shown);
+    for (size_t index = 0; index < shown; index++)
+    {
+        top[index].ProcessID = slots[order[index]].Group;
+        top[index].Metrics = slots[order[index]].Sums.getMetrics();
+    }
+
+    return top;
+}
+
+TcpHealthMetrics TcpHealth::getOtherEndpoints() const
+{
+    return this->endpoints.Other.getMetrics();
+}
+
+void TcpHealth::startSample()
+{
+    this->system = Aggregate();
+    this->endpoints.clear();
+    this->processes.clear();
+}
+
+void TcpHealth::finishSample()
+{
+    this->System = this->system.getMetrics();
+}
+
+#ifdef _WIN32
+static ULONG getConnectionStats(MIB_TCPROW* row, const TCP_ESTATS_TYPE type, void* rw, const ULONG rwSize, void* rod, const ULONG rodSize)
+{
+    return GetPerTcpConnectionEStats(row, type, (PUCHAR)rw, 0, rwSize, nullptr, 0, 0, (PUCHAR)rod, 0, rodSize);
+}
+
+static ULONG getConnectionStats(MIB_TCP6ROW* row, const TCP_ESTATS_TYPE type, void* rw, const ULONG rwSize, void* rod, const ULONG rodSize)
+{
+    return GetPerTcp6ConnectionEStats(row, type, (PUCHAR)rw, 0, rwSize, nullptr, 0, 0, (PUCHAR)rod, 0, rodSize);
+}
+
+static ULONG setConnectionStats(MIB_TCPROW* row, const TCP_ESTATS_TYPE type, void* rw, const ULONG rwSize)
+{
+    return SetPerTcpConnectionEStats(row, type, (PUCHAR)rw, 0, rwSize, 0);
+}
+
+static ULONG setConnectionStats(MIB_TCP6ROW* row, const TCP_ESTATS_TYPE type, void* rw, const ULONG rwSize)
+{
+    return SetPerTcp6ConnectionEStats(row, type, (PUCHAR)rw, 0, rwSize, 0);
+}
+
+/**
+* Reads the extended statistics of a connection, switching them on if they are not collected yet
+* @return false if the statistics are not collected yet or could not be read
+*/
+template <typename Row>
+static bool readConnectionStats(Row* row, TcpHealth::ConnectionSample& sample)
+{
+    TCP_ESTATS_PATH_RW_v0 path_switch = {};
+    TCP_ESTATS_PATH_ROD_v0 path = {};
+    ULONG result = getConnectionStats(row, TcpConnectionEstatsPath, &path_switch, sizeof(path_switch), &path, sizeof(path));
+
+    //the statistics of a connection are off until something asks for them, they are counted from the next sample
+    if (result == NO_ERROR && !path_switch.EnableCollection)
+    {
+        TCP_ESTATS_PATH_RW_v0 path_on = { TRUE };
+        TCP_ESTATS_SND_CONG_RW_v0 congestion_on = { TRUE };
+        TCP_ESTATS_DATA_RW_v0 data_on = { TRUE };
+        setConnectionStats(row, TcpConnectionEstatsPath, &path_on, sizeof(path_on));
+        setConnectionStats(row, TcpConnectionEstatsSndCong, &congestion_on, sizeof(congestion_on));
+        setConnectionStats(row, TcpConnectionEstatsData, &data_on, sizeof(data_on));
+        return 0;
+    }
+
+    if (result != NO_ERROR) return 0;
+
+    TCP_ESTATS_SND_CONG_ROD_v0 congestion = {};
+    TCP_ESTATS_DATA_ROD_v0 data = {};
+    getConnectionStats(row, TcpConnectionEstatsSndCong, nullptr, 0, &congestion, sizeof(congestion));
+    getConnectionStats(row, TcpConnectionEstatsData, nullptr, 0, &data, sizeof(data));
+
+    sample.Rtt = path.SmoothedRtt;
+    sample.RttVariation = path.RttVar;
+    sample.Retransmits = path.PktsRetrans;
+    sample.SegmentsSent = data.SegsOut;
+    sample.CongestionWindow = congestion.CurCwnd;
+
+    return 1;
+}
+
+/**
+* @return If a connection has statistics, the ones that are closed or waiting out TIME_WAIT have none
+*/
+static bool hasConnectionStats(const DWORD state)
+{
+    return state != MIB_TCP_STATE_TIME_WAIT && state != MIB_TCP_STATE_CLOSED && state != MIB_TCP_STATE_DELETE_TCB;
+}
+
+void TcpHealth::update()
+{
+    startSample();
+
+    std::vector<unsigned char>& buffer = this->table_buffer;
+    TcpHealth::ConnectionSample sample;
+
+    //the connection tables leave the listening sockets out
+    if (PlatformSessions::readTable(buffer, [](void* table, DWORD* size) { return GetExtendedTcpTable(table, size, FALSE, AF_INET, TCP_TABLE_OWNER_PID_CONNECTIONS, 0); }))
+    {
+        const MIB_TCPTABLE_OWNER_PID* table = (const MIB_TCPTABLE_OWNER_PID*)buffer.data();
+        for (DWORD index = 0; index < table->dwNumEntries; index++)
+        {
+            const MIB_TCPROW_OWNER_PID& entry = table->table[index];
+            if (!hasConnectionStats(entry.dwState)) continue;
+
+            MIB_TCPROW row;
+            row.dwState = entry.dwState;
+            row.dwLocalAddr = entry.dwLocalAddr;
+            row.dwLocalPort = entry.dwLocalPort;
+            row.dwRemoteAddr = entry.dwRemoteAddr;
+            row.dwRemotePort = entry.dwRemotePort;
+
+            if (!readConnectionStats(&row, sample)) continue;
+
+            addConnection(AF_INET, (const unsigned char*)&entry.dwRemoteAddr, entry.dwOwningPid, sample);
+        }
+    }
+
+    if (PlatformSessions::readTable(buffer, [](void* table, DWORD* size) { return GetExtendedTcpTable(table, size, FALSE, AF_INET6, TCP_TABLE_OWNER_PID_CONNECTIONS, 0); }))
+    {
+        const MIB_TCP6TABLE_OWNER_PID* table = (const MIB_TCP6TABLE_OWNER_PID*)buffer.data();
+        for (DWORD index = 0; index < table->dwNumEntries; index++)
+        {
+            const MIB_TCP6ROW_OWNER_PID& entry = table->table[index];
+            if (!hasConnectionStats(entry.dwState)) continue;
+
+            MIB_TCP6ROW row;
+            row.State = (MIB_TCP_STATE)entry.dwState;
+            memcpy(&row.LocalAddr, entry.ucLocalAddr, 16);
+            row.dwLocalScopeId = entry.dwLocalScopeId;
+            row.dwLocalPort = entry.dwLocalPort;
+            memcpy(&row.RemoteAddr, entry.ucRemoteAddr, 16);
+            row.dwRemoteScopeId = entry.dwRemoteScopeId;
+            row.dwRemotePort = entry.dwRemotePort;
+
+            if (!readConnectionStats(&row, sample)) continue;
+
+            addConnection(AF_INET6, entry.ucRemoteAddr, entry.dwOwningPid, sample);
+        }
+    }
+
+    finishSample();
+}
+#else
+/**
+* The kernel TCP states that have a connection to measure: established, SYN sent, FIN wait 1 and 2, CLOSE_WAIT, last ACK and closing
+* The listening sockets, the ones in TIME_WAIT and the half open requests have no tcp_info
+*/
+static const unsigned int ConnectionStates = (1 << 1) | (1 << 2) | (1 << 4) | (1 << 5) | (1 << 8) | (1 << 9) | (1 << 11);
+
+bool TcpHealth::dumpConnections(const int netlink_socket, const unsigned char family)
+{
+    struct
+    {
+        nlmsghdr            Header;
+        inet_diag_req_v2    Request;
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.Header.nlmsg_len = sizeof(request);
+    request.Header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.Request.sdiag_family = family;
+    request.Request.sdiag_protocol = IPPROTO_TCP;
+    request.Request.idiag_states = ConnectionStates;
+    request.Request.idiag_ext = 1 << (INET_DIAG_INFO - 1);
+
+    return this->sessions.dumpNetlink(netlink_socket, &request.Header, this->sequence, this->netlink_buffer, [this](const char* buffer, const size_t length)
+    {
+        return parseDiagMessages(buffer, length, this->sequence);
+    });
+}
+
+bool TcpHealth::parseDiagMessages(const char* buffer, const size_t length, const unsigned int sequence)
+{
+    unsigned int remaining = (unsigned int)length;
+    SocketTable::SocketKey key;
+    ConnectionSample sample;
+
+    for (const nlmsghdr* message = (const nlmsghdr*)buffer; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining))
+    {
+        //the rest of an earlier dump that timed out
+        if (sequence != 0 && message->nlmsg_seq != sequence) continue;
+
+        if (message->nlmsg_type == NLMSG_DONE || message->nlmsg_type == NLMSG_ERROR) return 0;
+        if (message->nlmsg_type != SOCK_DIAG_BY_FAMILY || message->nlmsg_len < NLMSG_LENGTH(sizeof(inet_diag_msg))) continue;
+
+        const inet_diag_msg* diag = (const inet_diag_msg*)NLMSG_DATA(message);
+
+        //older kernels send a shorter tcp_info, the fields they do not know stay 0
+        tcp_info info;
+        memset(&info, 0, sizeof(info));
+        bool has_info = 0;
+
+        unsigned int attributes_length = message->nlmsg_len - NLMSG_LENGTH(sizeof(inet_diag_msg));
+        for (const rtattr* attribute = (const rtattr*)(diag + 1); RTA_OK(attribute, attributes_length); attribute = RTA_NEXT(attribute, attributes_length))
+        {
+            if (attribute->rta_type != INET_DIAG_INFO) continue;
+
+            memcpy(&info, RTA_DATA(attribute), std::min((size_t)RTA_PAYLOAD(attribute), sizeof(info)));
+            has_info = 1;
+        }
+
+        if (!has_info) continue;
+
+        //the round trip time is in microseconds and 0 until the first one was measured
+        sample.Rtt = info.tcpi_rtt != 0 ? info.tcpi_rtt / 1000.0 : NaN;
+        sample.RttVariation = info.tcpi_rttvar / 1000.0;
+        sample.Retransmits = info.tcpi_total_retrans;
+        sample.SegmentsSent = info.tcpi_segs_out;
+        sample.CongestionWindow = (double)info.tcpi_snd_cwnd * info.tcpi_snd_mss;
+
+        //the owner is the one the socket table found for the same socket
+        unsigned int process_id = 0;
+        if (this->socket_table != nullptr && diag->idiag_inode != 0)
+        {
+            memset(&key, 0, sizeof(key));
+            key.Protocol = IPPROTO_TCP;
+            key.Family = diag->idiag_family;
+            key.LocalPort = ntohs(diag->id.idiag_sport);
+            key.RemotePort = ntohs(diag->id.idiag_dport);
+            memcpy(key.LocalAddress, diag->id.idiag_src, diag->idiag_family == AF_INET ? 4 : 16);
+            memcpy(key.RemoteAddress, diag->id.idiag_dst, diag->idiag_family == AF_INET ? 4 : 16);
+            key.Cookie = ((unsigned long long)diag->id.idiag_cookie[1] << 32) | diag->id.idiag_cookie[0];
+
+            auto socket = this->socket_table->getSockets().find(key);
+            if (socket != this->socket_table->getSockets().end()) process_id = socket->second.ProcessID;
+        }
+
+        addConnection(diag->idiag_family, (const unsigned char*)diag->id.idiag_dst, process_id, sample);
+    }
+
+    return 1;
+}
+
+void TcpHealth::update()
+{
+    startSample();
+
+    int netlink_socket = this->sessions.getNetlinkSocket(NETLINK_SOCK_DIAG);
+    if (netlink_socket >= 0)
+    {
+        //a dump that failed leaves out the connections it did not get
+        dumpConnections(netlink_socket, AF_INET);
+        dumpConnections(netlink_socket, AF_INET6);
+    }
+
+    finishSample();
+}
+#endif
@@ -0,0 +1,215 @@
+#include "VolumeSpace.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/statvfs.h>
+#include <time.h>
+#endif
+
+/**
+* The fill rate is not projected before the samples cover this many milliseconds, a few samples close together are mostly noise
+*/
+static const double MinimumFillRateSpan = 60000;
+
+VolumeSpace::VolumeSpace(StorageInformation& storageInformation, const double sample_interval, const double window_length) : sample_interval(sample_interval), window_length(window_length)
+{
+    for (auto& drive : storageInformation.Drives)
+    {
+        //a file system that did not answer its probe would stall every sample the same way
+        if (drive.second.ProbeTimedOut) continue;
+
+        addVolume(drive.first);
+    }
+}
+
+void VolumeSpace::addVolume(const std::wstring& key)
+{
+    WatchedVolume volume;
+    volume.Key = key;
+
+#ifdef _WIN32
+    //the free space functions take the root directory of the volume
+    volume.RootPath = key + L"\\";
+#else
+    volume.RootPath = key;
+#endif
+
+    this->watched_volumes.push_back(volume);
+    this->Volumes[volume.Key] = VolumeMetrics();
+}
+
+bool VolumeSpace::refresh(StorageInformation& storageInformation, const StorageInformation::StorageChanges& changes)
+{
+    bool changed = 0;
+
+    //a volume that was unmounted, or mounted again on something else, loses its history
+    for (auto volume = this->watched_volumes.begin(); volume != this->watched_volumes.end();)
+    {
+        auto drive = storageInformation.Drives.find(volume->Key);
+        bool removed = std::find(changes.RemovedDrives.begin(), changes.RemovedDrives.end(), volume->Key) != changes.RemovedDrives.end();
+
+        if (!removed && drive != storageInformation.Drives.end() && !drive->second.ProbeTimedOut)
+        {
+            volume++;
+            continue;
+        }
+
+        this->Volumes.erase(volume->Key);
+        volume = this->watched_volumes.erase(volume);
+        changed = 1;
+    }
+
+    //a drive is only sampled once its probe answered, new volumes are sampled right away
+    for (auto& drive : storageInformation.Drives)
+    {
+        if (drive.second.ProbeTimedOut || storageInformation.isProbing(drive.first) || this->Volumes.find(drive.first) != this->Volumes.end()) continue;
+
+        addVolume(drive.first);
+        changed = 1;
+    }
+
+    if (changed) this->last_sample_time = -1;
+
+    return changed;
+}
+
+double VolumeSpace::getTimeMilliseconds()
+{
+#ifdef _WIN32
+    return (double)GetTickCount64();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+bool VolumeSpace::readVolume(const std::wstring& rootPath, VolumeMetrics& metrics)
+{
+#ifdef _WIN32
+    ULARGE_INTEGER available, total, free;
+    if (!GetDiskFreeSpaceExW(rootPath.c_str(), &available, &total, &free)) return 0;
+
+    //NTFS has no fixed number of file records
+    metrics.TotalBytes = (double)total.QuadPart;
+    metrics.FreeBytes = (double)available.QuadPart;
+    metrics.UsedBytes = (double)(total.QuadPart - free.QuadPart);
+    metrics.UsedInodes = 0;
+    metrics.FreeInodes = 0;
+#else
+    struct statvfs status;
+    if (statvfs(std::string(rootPath.begin(), rootPath.end()).c_str(), &status) != 0) return 0;
+
+    //the free space is what an ordinary user can still write, the blocks reserved for root count as neither free nor used
+    double block_size = (double)status.f_frsize;
+    metrics.TotalBytes = status.f_blocks * block_size;
+    metrics.FreeBytes = status.f_bavail * block_size;
+    metrics.UsedBytes = (status.f_blocks - status.f_bfree) * block_size;
+
+    //file systems that allocate inodes on demand report 0 of them
+    metrics.UsedInodes = (double)(status.f_files - status.f_ffree);
+    metrics.FreeInodes = (double)status.f_favail;
+#endif
+
+    return 1;
+}
+
+double VolumeSpace::estimateFillRate(const std::deque<UsageSample>& history)
+{
+    if (history.size() < 2 || history.back().TimeMilliseconds - history.front().TimeMilliseconds < MinimumFillRateSpan) return 0;
+
+    //the times and sizes are taken relative to the first sample so the sums keep their precision
+    double origin_time = history.front().TimeMilliseconds;
+    double origin_used = history.front().UsedBytes;
+    double count = (double)history.size();
+    double sum_time = 0, sum_used = 0, sum_time_squared = 0, sum_time_used = 0;
+
+    for (const UsageSample& sample : history)
+    {
+        double time = (sample.TimeMilliseconds - origin_time) / 3600000;
+        double used = sample.UsedBytes - origin_used;
+
+        sum_time += time;
+        sum_used += used;
+        sum_time_squared += time * time;
+        sum_time_used += time * used;
+    }
+
+    double denominator = count * sum_time_squared - sum_time * sum_time;
+    if (denominator <= 0) return 0;
+
+    return (count * sum_time_used - sum_time * sum_used) / denominator;
+}
+
+void VolumeSpace::startRead(WatchedVolume& volume, const double time)
+{
+    std::shared_ptr<VolumeRead> result = std::make_shared<VolumeRead>();
+    std::wstring rootPath = volume.RootPath;
+
+    volume.Result = result;
+    volume.ReadTime = time;
+    volume.Reading = 1;
+
+    volume.ReadID = this->reads.start(volume.Key, [result, rootPath]() {
+        result->Succeeded = readVolume(rootPath, result->Metrics);
+    });
+}
+
+void VolumeSpace::addSample(WatchedVolume& volume, const VolumeRead& read)
+{
+    VolumeMetrics& metrics = this->Volumes[volume.Key];
+    metrics = read.Metrics;
+
+    volume.History.push_back({ volume.ReadTime, metrics.UsedBytes });
+    while (volume.ReadTime - volume.History.front().TimeMilliseconds > this->window_length) volume.History.pop_front();
+
+    metrics.FillRate = estimateFillRate(volume.History);
+
+    if (metrics.FillRate > 0)
+    {
+        metrics.HoursToFull = metrics.FreeBytes / metrics.FillRate;
+    }
+    else
+    {
+        metrics.HoursToFull = std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+bool VolumeSpace::update()
+{
+    bool changed = 0;
+
+    //take the results of the reads that finished since the last update
+    for (const DeviceProbes::FinishedProbe& finished : this->reads.takeFinished())
+    {
+        //a volume that was removed, or removed and mounted again, only takes the result of its last read
+        auto volume = std::find_if(this->watched_volumes.begin(), this->watched_volumes.end(), [&finished](const WatchedVolume& watched) { return watched.Key == finished.Key; });
+        if (volume == this->watched_volumes.end() || volume->ReadID != finished.ID) continue;
+
+        volume->Reading = 0;
+
+        //a volume that could not be read, like a disconnected network share, keeps its last metrics
+        if (!volume->Result->Succeeded) continue;
+
+        addSample(*volume, *volume->Result);
+        changed = 1;
+    }
+
+    double time = getTimeMilliseconds();
+    if (this->last_sample_time >= 0 && time - this->last_sample_time < this->sample_interval) return changed;
+
+    this->last_sample_time = time;
+
+    for (WatchedVolume& volume : this->watched_volumes)
+    {
+        //a volume that is still answering the last read, like a hung NFS mount, is not asked again
+        if (volume.Reading) continue;
+
+        startRead(volume, time);
+    }
+
+    return changed;
+}
@@ -0,0 +1,123 @@
+#include "TestSupport.h"
+#include "DiskActivity.h"
+#include <time.h>
+#include <unistd.h>
+
+/**
+* The directory the /proc/diskstats snapshots are read from
+* The second snapshot was taken after sda read 150 times and wrote 50 times, nvme0n1 was idle
+*/
+static const std::string FixtureDirectory = "tests/fixtures/diskstats/";
+
+/**
+* The time between the two samples, long enough that the bounds on it stay tight
+*/
+static const unsigned int SampleMilliseconds = 500;
+
+static double monotonicMilliseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+/**
+* Replaces the content of the fake /proc/diskstats in place, the collector keeps the file open
+*/
+static bool copyFixture(const std::string& fixture, const std::string& path)
+{
+	std::vector<unsigned char> data;
+	if (!readFixture(FixtureDirectory + fixture, data))
+	{
+		check(0, "the fixture " + fixture + " can be read");
+		return 0;
+	}
+
+	writeFile(path, std::string(data.begin(), data.end()));
+	return 1;
+}
+
+/**
+* Checks that a rate is the difference of its counter over a time that is only known to be between the given bounds
+*/
+static void checkRate(const double rate, const double difference, const double shortest_seconds, const double longest_seconds, const std::string& description)
+{
+	bool passed = rate >= difference / longest_seconds - 1e-9 && rate <= difference / shortest_seconds + 1e-9;
+	check(passed, description + " is " + std::to_string(rate) + ", expected between " + std::to_string(difference / longest_seconds) + " and " + std::to_string(difference / shortest_seconds));
+}
+
+/**
+* Checks that every metric of a disk is 0
+*/
+static bool isIdle(const DiskMetrics& metrics)
+{
+	for (const DiskMetricInfo& info : DiskMetricInfos)
+	{
+		if (metrics.*info.Value != 0) return 0;
+	}
+
+	return 1;
+}
+
+int main()
+{
+	std::string directory = makeTemporaryDirectory();
+	std::string path = directory + "/diskstats";
+	if (directory.empty() || !copyFixture("diskstats-1", path)) return 1;
+
+	//sdc is not in the snapshots, the partitions and the LVM volume of the disks are not watched
+	StorageInformation storageInformation;
+	storageInformation.PhysicalDisks[L"0"].DeviceID = L"sda";
+	storageInformation.PhysicalDisks[L"1"].DeviceID = L"nvme0n1";
+	storageInformation.PhysicalDisks[L"2"].DeviceID = L"sdc";
+
+	DiskActivity diskActivity(storageInformation, path);
+
+	//the first sample is only the baseline
+	double first_start = monotonicMilliseconds();
+	diskActivity.update();
+	double first_end = monotonicMilliseconds();
+
+	check(diskActivity.Disks.size() == 3, "every physical disk has metrics");
+	check(isIdle(diskActivity.Disks[L"0"]) && isIdle(diskActivity.Disks[L"1"]), "the metrics are 0 after the first sample");
+
+	usleep(SampleMilliseconds * 1000);
+
+	copyFixture("diskstats-2", path);
+	double second_start = monotonicMilliseconds();
+	diskActivity.update();
+	double second_end = monotonicMilliseconds();
+
+	//the collector reads its clock somewhere within each update
+	double shortest = (second_start - first_end) / 1000, longest = (second_end - first_start) / 1000;
+
+	const DiskMetrics& sda = diskActivity.Disks[L"0"];
+	checkRate(sda.ReadBytesPerSecond, 12000 * 512, shortest, longest, "the read rate of sda");
+	checkRate(sda.WriteBytesPerSecond, 4000 * 512, shortest, longest, "the write rate of sda");
+	checkRate(sda.ReadsPerSecond, 150, shortest, longest, "the reads per second of sda");
+	checkRate(sda.WritesPerSecond, 50, shortest, longest, "the writes per second of sda");
+
+	//300 ms reading and 200 ms writing spread over 200 operations
+	check(sda.AverageLatency == 2.5, "the average latency of sda is 2.5 ms, got " + std::to_string(sda.AverageLatency));
+
+	//1000 ms of weighted time in the queue and 250 ms busy
+	checkRate(sda.QueueDepth, 1, shortest, longest, "the queue depth of sda");
+	checkRate(sda.Utilization, 25, shortest, longest, "the utilization of sda");
+
+	check(isIdle(diskActivity.Disks[L"1"]), "the metrics of the idle nvme0n1 are 0");
+	check(isIdle(diskActivity.Disks[L"2"]), "the metrics of sdc that is not in /proc/diskstats are 0");
+
+	//the counters of sda going back to the first snapshot means it was reset
+	copyFixture("diskstats-1", path);
+	diskActivity.update();
+	check(isIdle(diskActivity.Disks[L"0"]), "a counter that went backwards zeroes the metrics of sda");
+
+	//the reset sample is the new baseline
+	usleep(SampleMilliseconds * 1000);
+	copyFixture("diskstats-2", path);
+	diskActivity.update();
+	check(diskActivity.Disks[L"0"].ReadsPerSecond > 0 && diskActivity.Disks[L"0"].AverageLatency == 2.5, "the sample after a reset is measured from it");
+
+	if (failed_checks == 0) printf("DiskActivityTests passed\n");
+	return failed_checks;
+}
@@ -0,0 +1,85 @@
+#include "TestSupport.h"
+#include "DiskHealth.h"
+#include <cmath>
+
+/**
+* The directory the log pages are read from
+*/
+static const std::string FixtureDirectory = "tests/fixtures/disk-health/";
+
+/**
+* The metrics a log page is expected to parse to, NaN for the ones it does not have
+*/
+struct ExpectedHealth
+{
+	const char*		Fixture;
+	bool			Nvme;
+	double			Temperature;
+	double			PercentageUsed;
+	double			AvailableSpare;
+	double			MediaErrors;
+	double			PowerOnHours;
+	double			UnsafeShutdowns;
+};
+
+static const double Missing = std::numeric_limits<double>::quiet_NaN();
+
+/**
+* The log pages are laid out as the drives return them: the 512 byte NVMe SMART / Health Information log page and the 512 byte response of ATA SMART READ DATA
+*/
+static const ExpectedHealth ExpectedHealths[] =
+{
+	//an NVMe drive early in its life, 310 K composite temperature
+	{ "nvme-smart-log.bin", 1, 37, 3, 100, 0, 6699, 42 },
+
+	//an NVMe drive past its rated endurance with media errors and its spare almost used up
+	{ "nvme-smart-log-worn.bin", 1, 58, 112, 4, 7, 41250, 187 },
+
+	//a SATA SSD, wear from the wear leveling count (177), errors from the reported uncorrectable count (187), unsafe shutdowns from the unexpected power loss count (174)
+	{ "ata-smart-ssd.bin", 0, 34, 5, 99, 3, 12345, 17 },
+
+	//a hard drive, the temperature (194) wins over the airflow temperature (190), the minutes in the upper bytes of the power on hours (9) are left out,
+	//errors from the offline uncorrectable count (198) and unsafe shutdowns from the emergency retracts (192), no wear or spare
+	{ "ata-smart-hdd.bin", 0, 33, Missing, Missing, 2, 30000, 250 },
+};
+
+/**
+* Checks that a metric has the expected value, or is NaN when none is expected
+*/
+static void checkMetric(const std::string& fixture, const char* name, const double value, const double expected)
+{
+	bool passed = std::isnan(expected) ? std::isnan(value) : value == expected;
+	check(passed, fixture + ": " + name + " is " + std::to_string(value) + ", expected " + std::to_string(expected));
+}
+
+int main()
+{
+	for (const ExpectedHealth& expected : ExpectedHealths)
+	{
+		std::vector<unsigned char> page;
+		if (!readFixture(FixtureDirectory + expected.Fixture, page))
+		{
+			check(0, std::string("the fixture ") + expected.Fixture + " can be read");
+			continue;
+		}
+
+		DiskHealthMetrics metrics;
+		bool parsed = expected.Nvme ? DiskHealth::parseNvmeHealthLog(page.data(), page.size(), metrics) : DiskHealth::parseAtaSmartData(page.data(), page.size(), metrics);
+		check(parsed, std::string(expected.Fixture) + " is parsed");
+
+		checkMetric(expected.Fixture, "the temperature", metrics.Temperature, expected.Temperature);
+		checkMetric(expected.Fixture, "the wear", metrics.PercentageUsed, expected.PercentageUsed);
+		checkMetric(expected.Fixture, "the available spare", metrics.AvailableSpare, expected.AvailableSpare);
+		checkMetric(expected.Fixture, "the media errors", metrics.MediaErrors, expected.MediaErrors);
+		checkMetric(expected.Fixture, "the power on hours", metrics.PowerOnHours, expected.PowerOnHours);
+		checkMetric(expected.Fixture, "the unsafe shutdowns", metrics.UnsafeShutdowns, expected.UnsafeShutdowns);
+
+		//a page that was cut short is rejected instead of read past its end
+		DiskHealthMetrics truncated;
+		bool truncated_parsed = expected.Nvme ? DiskHealth::parseNvmeHealthLog(page.data(), 100, truncated) : DiskHealth::parseAtaSmartData(page.data(), 100, truncated);
+		check(!truncated_parsed, std::string(expected.Fixture) + " cut to 100 bytes is rejected");
+	}
+
+	if (failed_checks == 0) printf("DiskHealthTests passed\n");
+	return failed_checks;
+}
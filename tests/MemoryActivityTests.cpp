@@ -0,0 +1,220 @@
+#include "TestSupport.h"
+#include "MemoryActivity.h"
+#include <cmath>
+#include <time.h>
+#include <unistd.h>
+
+/**
+* The directory the /proc and /sys snapshots are read from
+* The second snapshots were taken after a burst of paging, MemFree got a digit wider and Cached a digit narrower in between
+*/
+static const std::string FixtureDirectory = "tests/fixtures/memory/";
+
+/**
+* The time between the samples that have rates, long enough that the bounds on it stay tight
+*/
+static const unsigned int SampleMilliseconds = 500;
+
+static double monotonicMilliseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+/**
+* Replaces the content of a fake file in place, the collector keeps the files open
+*/
+static void copyFixture(const std::string& fixture, const std::string& path)
+{
+	std::vector<unsigned char> data;
+	check(readFixture(FixtureDirectory + fixture, data), "the fixture " + fixture + " can be read");
+
+	writeFile(path, std::string(data.begin(), data.end()));
+}
+
+/**
+* Checks that a metric has the expected value exactly, the values are whole kB
+*/
+static void checkValue(const double value, const double expected, const std::string& description)
+{
+	check(value == expected, description + " is " + std::to_string(value) + ", expected " + std::to_string(expected));
+}
+
+/**
+* Checks that a rate is the difference of its counter over a time that is only known to be between the given bounds
+*/
+static void checkRate(const double rate, const double difference, const double shortest_seconds, const double longest_seconds, const std::string& description)
+{
+	bool passed = rate >= difference / longest_seconds - 1e-9 && rate <= difference / shortest_seconds + 1e-9;
+	check(passed, description + " is " + std::to_string(rate) + ", expected between " + std::to_string(difference / longest_seconds) + " and " + std::to_string(difference / shortest_seconds));
+}
+
+/**
+* Checks the system wide usage read from meminfo-1
+*/
+static void checkFirstMeminfo(const MemoryMetrics& system, const std::string& sample)
+{
+	checkValue(system.TotalBytes, 263842856.0 * 1024, sample + ": the total memory");
+	checkValue(system.AvailableBytes, 187654321.0 * 1024, sample + ": the available memory");
+	checkValue(system.UsedBytes, (263842856.0 - 187654321.0) * 1024, sample + ": the used memory");
+	checkValue(system.CachedBytes, (2345678.0 + 123456789.0) * 1024, sample + ": the buffers and cache");
+	checkValue(system.DirtyBytes, 968.0 * 1024, sample + ": the dirty memory");
+	checkValue(system.CommittedBytes, 67890123.0 * 1024, sample + ": the committed memory");
+	checkValue(system.SwapTotalBytes, 8388604.0 * 1024, sample + ": the total swap");
+	checkValue(system.SwapUsedBytes, (8388604.0 - 8123456.0) * 1024, sample + ": the used swap");
+}
+
+/**
+* A KeyScanner keeps reading the right values when the keys change their order or go away
+*/
+static void testKeyScanner()
+{
+	KeyScanner scanner({ "alpha", "beta", "gamma", "delta" });
+	double values[4] = { -1, -1, -1, -1 };
+
+	std::string text = "alpha 1\nbeta: 2\nalphabet 9\ngamma\t3\n";
+	check(scanner.scan(text.data(), text.size(), values) == 3 && values[0] == 1 && values[1] == 2 && values[2] == 3 && values[3] == -1, "the keys are found and a key that is a prefix of another line is not confused with it");
+
+	//every key swapped places, the scanner finds them all again instead of recursing forever
+	text = "gamma 30\nbeta 20\nalpha 10\n";
+	check(scanner.scan(text.data(), text.size(), values) == 3 && values[0] == 10 && values[1] == 20 && values[2] == 30, "keys that changed their order are found again");
+
+	//a key that went away is left as it was
+	text = "gamma 300\nalpha 100\n";
+	values[1] = -1;
+	check(scanner.scan(text.data(), text.size(), values) == 2 && values[0] == 100 && values[1] == -1 && values[2] == 300, "a key that is gone is not read");
+
+	//a value cut off by the end of the buffer still ends the line
+	text = "gamma 3000\nalpha 1000";
+	check(scanner.scan(text.data(), text.size(), values) == 2 && values[0] == 1000 && values[2] == 3000, "the last line does not need a line ending");
+}
+
+/**
+* A machine with two NUMA nodes sampled three times, the last time after vmstat changed the order of its counters
+*/
+static void testTwoNodes(const std::string& directory)
+{
+	std::string proc = directory + "/two-nodes/proc", sys = directory + "/two-nodes/sys";
+	std::string node_root = sys + "/devices/system/node";
+
+	copyFixture("meminfo-1", proc + "/meminfo");
+	copyFixture("vmstat-1", proc + "/vmstat");
+	copyFixture("node0-meminfo", node_root + "/node0/meminfo");
+	copyFixture("node0-numastat-1", node_root + "/node0/numastat");
+	copyFixture("node1-meminfo", node_root + "/node1/meminfo");
+	copyFixture("node1-numastat-1", node_root + "/node1/numastat");
+
+	//the files next to the nodes are not nodes
+	writeFile(node_root + "/online", "0-1\n");
+	writeFile(node_root + "/has_memory", "0-1\n");
+	makeDirectories(node_root + "/power");
+
+	MemoryActivity memoryActivity(proc, sys);
+	check(memoryActivity.Nodes.size() == 2 && memoryActivity.Nodes.count(0) && memoryActivity.Nodes.count(1), "both nodes are found");
+
+	double first_start = monotonicMilliseconds();
+	memoryActivity.update();
+	double first_end = monotonicMilliseconds();
+
+	checkFirstMeminfo(memoryActivity.System, "the first sample");
+	check(std::isnan(memoryActivity.System.PageFaultsPerSecond) && std::isnan(memoryActivity.System.ReclaimScansPerSecond), "the rates are NaN after the first sample");
+	check(std::isnan(memoryActivity.Nodes[0].LocalAllocations) && std::isnan(memoryActivity.Nodes[1].MissesPerSecond), "the node rates are NaN after the first sample");
+
+	const NodeMemoryMetrics& node0 = memoryActivity.Nodes[0];
+	checkValue(node0.TotalBytes, 131921428.0 * 1024, "the total memory of node 0");
+	checkValue(node0.FreeBytes, 49382716.0 * 1024, "the free memory of node 0");
+	checkValue(node0.UsedBytes, (131921428.0 - 49382716.0) * 1024, "the used memory of node 0");
+	checkValue(node0.FilePagesBytes, 60123456.0 * 1024, "the file pages of node 0");
+	checkValue(node0.AnonymousBytes, 20123456.0 * 1024, "the anonymous pages of node 0");
+	checkValue(memoryActivity.Nodes[1].TotalBytes, 132121428.0 * 1024, "the total memory of node 1");
+
+	usleep(SampleMilliseconds * 1000);
+
+	copyFixture("meminfo-2", proc + "/meminfo");
+	copyFixture("vmstat-2", proc + "/vmstat");
+	copyFixture("node0-numastat-2", node_root + "/node0/numastat");
+	copyFixture("node1-numastat-2", node_root + "/node1/numastat");
+
+	double second_start = monotonicMilliseconds();
+	memoryActivity.update();
+	double second_end = monotonicMilliseconds();
+
+	//the collector reads its clock somewhere within each update
+	double shortest = (second_start - first_end) / 1000, longest = (second_end - first_start) / 1000;
+
+	//every line after MemFree moved, the ones after Cached moved back
+	const MemoryMetrics& system = memoryActivity.System;
+	checkValue(system.AvailableBytes, 190123456.0 * 1024, "the available memory after MemFree got wider");
+	checkValue(system.CachedBytes, (2345678.0 + 99999999.0) * 1024, "the buffers and cache after MemFree got wider");
+	checkValue(system.DirtyBytes, 123456.0 * 1024, "the dirty memory after the lines moved");
+	checkValue(system.SwapUsedBytes, (8388604.0 - 8000000.0) * 1024, "the used swap after the lines moved");
+	checkValue(system.CommittedBytes, 68000000.0 * 1024, "the committed memory after the lines moved");
+
+	double page_size = (double)sysconf(_SC_PAGESIZE);
+	checkRate(system.PageFaultsPerSecond, 50000, shortest, longest, "the page faults per second");
+	checkRate(system.MajorFaultsPerSecond, 120, shortest, longest, "the major faults per second");
+	checkRate(system.SwapInBytesPerSecond, 256 * page_size, shortest, longest, "the swap in rate");
+	checkRate(system.SwapOutBytesPerSecond, 512 * page_size, shortest, longest, "the swap out rate");
+	checkRate(system.ReclaimScansPerSecond, 3000 + 1000, shortest, longest, "the reclaim scans of kswapd and direct reclaim");
+	checkRate(system.ReclaimedPerSecond, 2500 + 500, shortest, longest, "the reclaimed pages of kswapd and direct reclaim");
+
+	//node 0 allocated 9000 pages for itself and 1000 for node 1, node 1 3000 and 1000 with 400 misses
+	checkValue(memoryActivity.Nodes[0].LocalAllocations, 90, "the local allocations of node 0");
+	checkValue(memoryActivity.Nodes[0].MissesPerSecond, 0, "the misses of node 0");
+	checkValue(memoryActivity.Nodes[1].LocalAllocations, 75, "the local allocations of node 1");
+	checkRate(memoryActivity.Nodes[1].MissesPerSecond, 400, shortest, longest, "the misses of node 1");
+
+	//the counters did not change but the scan, steal and fault counters swapped places
+	copyFixture("vmstat-reordered", proc + "/vmstat");
+	copyFixture("meminfo-1", proc + "/meminfo");
+	memoryActivity.update();
+
+	check(system.PageFaultsPerSecond == 0 && system.MajorFaultsPerSecond == 0 && system.SwapInBytesPerSecond == 0 && system.SwapOutBytesPerSecond == 0 &&
+		system.ReclaimScansPerSecond == 0 && system.ReclaimedPerSecond == 0, "the counters are read from their new places after vmstat changed its order");
+	checkFirstMeminfo(system, "the sample after MemFree got narrower again");
+	checkValue(memoryActivity.Nodes[1].LocalAllocations, 75, "a node that allocated nothing keeps its share of local allocations");
+}
+
+/**
+* A machine with a single node running a kernel from before MemAvailable was added
+*/
+static void testOldKernel(const std::string& directory)
+{
+	std::string proc = directory + "/old-kernel/proc", sys = directory + "/old-kernel/sys";
+
+	copyFixture("meminfo-3.13", proc + "/meminfo");
+	copyFixture("vmstat-1", proc + "/vmstat");
+	copyFixture("node0-meminfo", sys + "/devices/system/node/node0/meminfo");
+	copyFixture("node0-numastat-1", sys + "/devices/system/node/node0/numastat");
+
+	MemoryActivity memoryActivity(proc, sys);
+	check(memoryActivity.Nodes.empty(), "a single node is not broken down");
+
+	memoryActivity.update();
+
+	//the free memory, buffers and cache take the place of the available memory
+	const MemoryMetrics& system = memoryActivity.System;
+	checkValue(system.TotalBytes, 8062340.0 * 1024, "the total memory without MemAvailable");
+	checkValue(system.AvailableBytes, (1234560.0 + 234560.0 + 3456780.0) * 1024, "the available memory without MemAvailable");
+	checkValue(system.UsedBytes, (8062340.0 - 1234560.0 - 234560.0 - 3456780.0) * 1024, "the used memory without MemAvailable");
+	checkValue(system.SwapUsedBytes, 0, "the used swap without MemAvailable");
+	checkValue(system.CommittedBytes, 5123456.0 * 1024, "the committed memory without MemAvailable");
+}
+
+int main()
+{
+	std::string directory = makeTemporaryDirectory();
+	if (directory.empty())
+	{
+		printf("FAILED: could not create a temporary directory\n");
+		return 1;
+	}
+
+	testKeyScanner();
+	testTwoNodes(directory);
+	testOldKernel(directory);
+
+	if (failed_checks == 0) printf("MemoryActivityTests passed\n");
+	return failed_checks;
+}
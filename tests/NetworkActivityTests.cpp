@@ -0,0 +1,150 @@
+#include "TestSupport.h"
+#include "NetworkActivity.h"
+#include <cmath>
+#include <time.h>
+#include <unistd.h>
+
+/**
+* The directory the /proc/net/dev snapshots are read from
+* Between the two snapshots the receive counters of eth0 wrapped around its 32 bits, the driver of eth1 reset its counters and wlan0 went away
+*/
+static const std::string FixtureDirectory = "tests/fixtures/netdev/";
+
+/**
+* The time between the two samples, long enough that the bounds on it stay tight
+*/
+static const unsigned int SampleMilliseconds = 500;
+
+static double monotonicMilliseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+/**
+* Replaces the content of the fake /proc/net/dev in place, the collector keeps the file open
+*/
+static void copyFixture(const std::string& fixture, const std::string& path)
+{
+	std::vector<unsigned char> data;
+	check(readFixture(FixtureDirectory + fixture, data), "the fixture " + fixture + " can be read");
+
+	writeFile(path, std::string(data.begin(), data.end()));
+}
+
+/**
+* Checks that a rate is the difference of its counter over a time that is only known to be between the given bounds
+*/
+static void checkRate(const double rate, const double difference, const double shortest_seconds, const double longest_seconds, const std::string& description)
+{
+	bool passed = rate >= difference / longest_seconds - 1e-9 && rate <= difference / shortest_seconds + 1e-9;
+	check(passed, description + " is " + std::to_string(rate) + ", expected between " + std::to_string(difference / longest_seconds) + " and " + std::to_string(difference / shortest_seconds));
+}
+
+/**
+* Checks that every metric of an interface is NaN
+*/
+static bool hasNoRates(const InterfaceMetrics& metrics)
+{
+	for (const InterfaceMetricInfo& info : InterfaceMetricInfos)
+	{
+		if (!std::isnan(metrics.*info.Value)) return 0;
+	}
+
+	return 1;
+}
+
+/**
+* Adds an adapter like the inventory lists it
+*/
+static void addAdapter(NetworkInformation& network, const std::wstring& name, const int interfaceIndex)
+{
+	network.Adapters.emplace_back();
+
+	auto& adapter = network.Adapters.back();
+	adapter.Name = name;
+	adapter.InterfaceIndex = interfaceIndex;
+}
+
+int main()
+{
+	std::string directory = makeTemporaryDirectory();
+	if (directory.empty())
+	{
+		printf("FAILED: could not create a temporary directory\n");
+		return 1;
+	}
+
+	std::string path = directory + "/dev";
+	copyFixture("netdev-1", path);
+
+	NetworkInformation network;
+	addAdapter(network, L"lo", 1);
+	addAdapter(network, L"eth0", 2);
+	addAdapter(network, L"eth1", 3);
+	addAdapter(network, L"veth0123456789a", 4);
+	addAdapter(network, L"wlan0", 5);
+
+	//an adapter without an interface and a second adapter with a name that is taken are not sampled
+	addAdapter(network, L"Kernel Debug Network Adapter", 0);
+	addAdapter(network, L"eth0", 6);
+	network.indexAdapters();
+
+	NetworkActivity networkActivity(network, path);
+	check(networkActivity.Interfaces.size() == 5 && networkActivity.Interfaces.count(L"Kernel Debug Network Adapter") == 0, "every adapter with an interface and its own name has metrics");
+
+	//the first sample is only the baseline
+	double first_start = monotonicMilliseconds();
+	networkActivity.update();
+	double first_end = monotonicMilliseconds();
+
+	check(hasNoRates(networkActivity.Interfaces[L"eth0"]) && hasNoRates(networkActivity.Interfaces[L"wlan0"]), "the rates are NaN after the first sample");
+
+	usleep(SampleMilliseconds * 1000);
+
+	copyFixture("netdev-2", path);
+	double second_start = monotonicMilliseconds();
+	networkActivity.update();
+	double second_end = monotonicMilliseconds();
+
+	//the collector reads its clock somewhere within each update
+	double shortest = (second_start - first_end) / 1000, longest = (second_end - first_start) / 1000;
+
+	const InterfaceMetrics& loopback = networkActivity.Interfaces[L"lo"];
+	checkRate(loopback.ReceiveBytesPerSecond, 20000, shortest, longest, "the receive rate of lo");
+	checkRate(loopback.TransmitPacketsPerSecond, 200, shortest, longest, "the packets sent by lo");
+	check(loopback.ReceiveErrorsPerSecond == 0 && loopback.TransmitDropsPerSecond == 0, "lo has no errors or drops");
+
+	//the receive counters of eth0 went past 2^32 - 1 and started over
+	const InterfaceMetrics& wrapped = networkActivity.Interfaces[L"eth0"];
+	checkRate(wrapped.ReceiveBytesPerSecond, 1000, shortest, longest, "the receive rate of eth0 after its byte counter wrapped");
+	checkRate(wrapped.ReceivePacketsPerSecond, 16, shortest, longest, "the packets received by eth0 after its packet counter wrapped");
+	checkRate(wrapped.ReceiveErrorsPerSecond, 2, shortest, longest, "the receive errors of eth0");
+	checkRate(wrapped.ReceiveDropsPerSecond, 4, shortest, longest, "the receive drops of eth0");
+	checkRate(wrapped.TransmitBytesPerSecond, 3000000, shortest, longest, "the send rate of eth0 past 32 bits");
+	checkRate(wrapped.TransmitPacketsPerSecond, 2000, shortest, longest, "the packets sent by eth0");
+	checkRate(wrapped.TransmitDropsPerSecond, 1, shortest, longest, "the send drops of eth0");
+
+	//the counters of eth1 went backwards from where no 32 bit counter wraps
+	const InterfaceMetrics& reset = networkActivity.Interfaces[L"eth1"];
+	check(std::isnan(reset.ReceiveBytesPerSecond) && std::isnan(reset.ReceivePacketsPerSecond) && std::isnan(reset.TransmitBytesPerSecond) && std::isnan(reset.TransmitPacketsPerSecond),
+		"the rates of the counters of eth1 that were reset are NaN");
+	check(reset.ReceiveErrorsPerSecond == 0 && reset.TransmitErrorsPerSecond == 0, "the counters of eth1 that stayed 0 have a rate of 0");
+
+	//a name of 15 characters leaves no space between its colon and the first counter
+	const InterfaceMetrics& long_name = networkActivity.Interfaces[L"veth0123456789a"];
+	checkRate(long_name.ReceiveBytesPerSecond, 150000, shortest, longest, "the receive rate of the interface with the longest name");
+	checkRate(long_name.ReceivePacketsPerSecond, 100, shortest, longest, "the packets received by the interface with the longest name");
+	checkRate(long_name.TransmitBytesPerSecond, 50000, shortest, longest, "the send rate of the interface with the longest name");
+
+	check(hasNoRates(networkActivity.Interfaces[L"wlan0"]), "the rates of wlan0 that went away are NaN");
+
+	//wlan0 comes back with the counters it had before it went away, they are a new baseline and not a difference of 0
+	copyFixture("netdev-1", path);
+	networkActivity.update();
+	check(hasNoRates(networkActivity.Interfaces[L"wlan0"]), "wlan0 starts from a new baseline when it comes back");
+
+	if (failed_checks == 0) printf("NetworkActivityTests passed\n");
+	return failed_checks;
+}
@@ -0,0 +1,153 @@
+#include "TestSupport.h"
+#include "NetworkInformation.h"
+#include <algorithm>
+
+/**
+* The directory the recorded dumps are read from
+* They were recorded in a network namespace with the loopback, a bridge br0, 12 veth pairs ve0-ve11 / pe0-pe11 of which only ve0 and pe0 are up and ve0 is in br0, and a tun device tun0 that is down
+* The link dump came in 4 reads with NLMSG_DONE on its own in the last one, the address dump in 2
+*/
+static const std::string FixtureDirectory = "tests/fixtures/rtnetlink/";
+
+/**
+* Reads every part of a recorded dump, the parts are numbered from 1 in the order they were received
+* @param name The name of the dump, "links" or "addresses"
+*/
+static std::vector<std::vector<unsigned char>> readDump(const std::string& name)
+{
+	std::vector<std::vector<unsigned char>> parts;
+
+	std::vector<unsigned char> part;
+	while (readFixture(FixtureDirectory + name + "-" + std::to_string(parts.size() + 1) + ".bin", part))
+	{
+		parts.push_back(part);
+	}
+
+	return parts;
+}
+
+/**
+* Replays the parts of a dump like they were received from the socket
+* @return If every part but the last asked for more and the last one ended the dump
+*/
+static bool replayDump(NetworkInformation& network, const std::vector<std::vector<unsigned char>>& parts)
+{
+	bool ended_last = !parts.empty();
+
+	for (size_t index = 0; index < parts.size(); index++)
+	{
+		bool more = network.parseNetlinkMessages((const char*)parts[index].data(), parts[index].size());
+		ended_last &= more == (index + 1 < parts.size());
+	}
+
+	return ended_last;
+}
+
+/**
+* Finds an adapter by its name
+* @return The adapter, nullptr if there is none with the name
+*/
+template <typename Adapter>
+static const Adapter* findAdapter(const std::vector<Adapter>& adapters, const std::wstring& name)
+{
+	for (const Adapter& adapter : adapters)
+	{
+		if (adapter.Name == name) return &adapter;
+	}
+
+	return nullptr;
+}
+
+/**
+* Checks if an adapter has an address
+*/
+template <typename Adapter>
+static bool hasAddress(const Adapter* adapter, const std::wstring& address)
+{
+	return adapter != nullptr && std::find(adapter->NetworkAddresses.begin(), adapter->NetworkAddresses.end(), address) != adapter->NetworkAddresses.end();
+}
+
+/**
+* The links and addresses of every part of the dumps are added, and the dumps end at NLMSG_DONE
+*/
+static void testReplay(const std::vector<std::vector<unsigned char>>& links, const std::vector<std::vector<unsigned char>>& addresses)
+{
+	NetworkInformation network;
+
+	check(links.size() > 1, "the link dump is in more than one part");
+	check(replayDump(network, links), "the link dump asks for more until NLMSG_DONE ends it");
+	check(replayDump(network, addresses), "the address dump asks for more until NLMSG_DONE ends it");
+
+	check(network.Adapters.size() == 27, "every link of every part is added, got " + std::to_string(network.Adapters.size()));
+
+	const auto* loopback = findAdapter(network.Adapters, L"lo");
+	check(loopback != nullptr && loopback->AdapterType == L"Loopback" && loopback->Status == L"Up", "the loopback is up");
+	check(hasAddress(loopback, L"127.0.0.1/8") && hasAddress(loopback, L"::1/128"), "the loopback has its IPv4 and IPv6 addresses");
+
+	const auto* bridge = findAdapter(network.Adapters, L"br0");
+	check(bridge != nullptr && bridge->ProductName == L"bridge" && bridge->MACAddress == L"02:00:00:00:01:00" && bridge->NetEnabled, "the bridge has its kind and MAC address and is enabled");
+	check(hasAddress(bridge, L"10.20.0.1/24") && hasAddress(bridge, L"fd00:20::1/64") && hasAddress(bridge, L"fe80::ff:fe00:100/64"), "the bridge has its addresses");
+
+	const auto* up = findAdapter(network.Adapters, L"ve0");
+	check(up != nullptr && up->ProductName == L"veth" && up->MACAddress == L"02:00:00:00:10:00" && up->Status == L"Up" && up->NetConnectionStatus == 2, "the veth that is up is connected");
+
+	//the links in the last part with links
+	const auto* down = findAdapter(network.Adapters, L"pe11");
+	check(down != nullptr && down->MACAddress == L"02:00:00:00:20:0B" && down->Status == L"Down" && down->NetConnectionStatus == 7 && !down->NetEnabled, "the veth that is down is off line");
+	check(down != nullptr && down->NetworkAddresses.empty(), "the veth that is down has no address");
+
+	const auto* tunnel = findAdapter(network.Adapters, L"tun0");
+	check(tunnel != nullptr && tunnel->ProductName == L"tun" && tunnel->MACAddress.empty(), "the tun device has its kind and no MAC address");
+
+	//a link that is dumped again is updated in place
+	network.parseNetlinkMessages((const char*)links[1].data(), links[1].size());
+	check(network.Adapters.size() == 27, "a link dumped again is not added twice");
+	check(network.findByInterfaceIndex(bridge != nullptr ? bridge->InterfaceIndex : -1) == bridge, "the links are found by their interface index");
+
+	//the recorded links have no sysfs device, only their type and kind tell what they are
+	network.indexAdapters();
+	check(loopback != nullptr && loopback->Class == AdapterClass::Loopback, "lo is a loopback");
+	check(bridge != nullptr && bridge->Class == AdapterClass::Virtual, "br0 is virtual");
+	check(up != nullptr && up->Class == AdapterClass::Container && down != nullptr && down->Class == AdapterClass::Container, "the veths are container adapters");
+	check(tunnel != nullptr && tunnel->Class == AdapterClass::Tunnel, "tun0 is a tunnel");
+	check(network.findByName(L"pe11") == down, "the links are found by their name");
+	check(network.findByMACAddress(L"02:00:00:00:01:00") == bridge && network.findByMACAddress(L"00:00:00:00:00:00") == nullptr, "the links are found by their MAC address, the all zero address of the loopback is not indexed");
+
+	size_t up_count = 0;
+	check(network.countAdapters(AdapterClass::Container, up_count) == 24 && up_count == 2, "the 24 veths are counted with the 2 of them that are up, got " + std::to_string(up_count));
+}
+
+/**
+* Nothing after NLMSG_DONE is read, and addresses of links that were not dumped are left out
+*/
+static void testDone(const std::vector<std::vector<unsigned char>>& links, const std::vector<std::vector<unsigned char>>& addresses)
+{
+	NetworkInformation network;
+
+	std::vector<unsigned char> buffer = links.back();
+	buffer.insert(buffer.end(), links.front().begin(), links.front().end());
+
+	check(!network.parseNetlinkMessages((const char*)buffer.data(), buffer.size()), "NLMSG_DONE ends the dump");
+	check(network.Adapters.empty(), "the links after NLMSG_DONE are not read");
+
+	replayDump(network, addresses);
+	check(network.Adapters.empty(), "the addresses of links that were not dumped are left out");
+}
+
+int main()
+{
+	std::vector<std::vector<unsigned char>> links = readDump("links");
+	std::vector<std::vector<unsigned char>> addresses = readDump("addresses");
+
+	if (links.empty() || addresses.empty())
+	{
+		check(0, "the recorded dumps can be read");
+		return failed_checks;
+	}
+
+	testReplay(links, addresses);
+	testDone(links, addresses);
+
+	if (failed_checks == 0) printf("NetworkInformationTests passed\n");
+	return failed_checks;
+}
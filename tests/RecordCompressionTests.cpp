@@ -0,0 +1,236 @@
+#include "TestSupport.h"
+#include "RecordCompression.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+/**
+* Checks that a block comes back from its encoded payload bit for bit, NaNs included
+* @param block The block to encode
+* @param description What the block holds
+* @param encoded Receives the encoded payload
+*/
+static void checkRoundTrip(const RecordBlock& block, const std::string& description, std::vector<unsigned char>& encoded)
+{
+	encodeCompressedBlock(block, encoded);
+
+	RecordBlock decoded(0, 0);
+	if (!decodeCompressedBlock(encoded.data(), encoded.size(), block.rows, block.columns, decoded))
+	{
+		check(0, description + " can be decoded");
+		return;
+	}
+
+	check(decoded.timestamps == block.timestamps, description + " keeps its monotonic timestamps");
+	check(decoded.wall_times == block.wall_times, description + " keeps its wall clock times");
+	check(decoded.values.size() == block.values.size() && memcmp(decoded.values.data(), block.values.data(), sizeof(float) * block.values.size()) == 0, description + " keeps every value bit for bit");
+
+	//a single column decodes to the same values as the whole block
+	std::vector<long long> timestamps;
+	std::vector<float> values;
+	unsigned int column = block.columns / 2;
+	bool column_decoded = decodeCompressedColumn(encoded.data(), encoded.size(), block.rows, block.columns, column, timestamps, values);
+
+	bool column_matches = column_decoded && timestamps == block.timestamps && values.size() == block.rows;
+	for (unsigned int row = 0; column_matches && row < block.rows; row++)
+	{
+		column_matches = memcmp(&values[row], &block.values[(size_t)row * block.columns + column], sizeof(float)) == 0;
+	}
+	check(column_matches, description + " decodes a single column like the whole block");
+}
+
+/**
+* Adds a row to a block
+*/
+static void addRow(RecordBlock& block, const long long timestamp, const long long wall_time, const std::vector<float>& values)
+{
+	block.timestamps.push_back(timestamp);
+	block.wall_times.push_back(wall_time);
+	block.values.insert(block.values.end(), values.begin(), values.end());
+	block.rows++;
+}
+
+/**
+* Blocks of random sizes with random bit patterns, NaNs, infinities and jittered timestamps
+*/
+static void testRandomBlocks()
+{
+	std::mt19937_64 random(20240611);
+	std::vector<unsigned char> encoded;
+
+	for (int index = 0; index < 200; index++)
+	{
+		unsigned int columns = 1 + (unsigned int)(random() % 40);
+		unsigned int rows = 1 + (unsigned int)(random() % 120);
+		RecordBlock block(columns, rows);
+
+		long long timestamp = (long long)(random() % 1000000000);
+		long long wall_time = 1700000000000LL + (long long)(random() % 1000000);
+
+		for (unsigned int row = 0; row < rows; row++)
+		{
+			std::vector<float> values(columns);
+			for (unsigned int column = 0; column < columns; column++)
+			{
+				switch (random() % 5)
+				{
+				case 0:
+				{
+					//any 32 bits, signalling NaNs and denormals included
+					unsigned int bits = (unsigned int)random();
+					memcpy(&values[column], &bits, sizeof(bits));
+					break;
+				}
+				case 1:
+					values[column] = std::numeric_limits<float>::quiet_NaN();
+					break;
+				case 2:
+					values[column] = row > 0 ? block.values[(size_t)(row - 1) * columns + column] : 0;
+					break;
+				case 3:
+					values[column] = (random() % 2) ? std::numeric_limits<float>::infinity() : -0.0f;
+					break;
+				default:
+					values[column] = (float)(random() % 10000) / 4;
+					break;
+				}
+			}
+
+			addRow(block, timestamp, wall_time, values);
+
+			//a second with scheduling jitter, now and then a long stall
+			timestamp += 1000000 + (long long)(random() % 4001) - 2000;
+			if (random() % 20 == 0) timestamp += (long long)(random() % 100000000);
+			wall_time += 1000 + (long long)(random() % 21) - 10;
+		}
+
+		checkRoundTrip(block, "random block " + std::to_string(index), encoded);
+	}
+}
+
+/**
+* Jumps in the timestamps that only fit the 64 bit delta-of-delta bucket, and every smaller bucket at its edges
+*/
+static void testTimestampJumps()
+{
+	std::vector<unsigned char> encoded;
+	RecordBlock block(2, 0);
+
+	const long long deltas[] = { 1000000, 1000000, 1000000 + 2047, 1000000 - 2048, 1000000 + 2048, 1000000 + 524287, 1000000 - 524288, 1000000 + 524288,
+		1000000LL + INT32_MAX, 1000000LL + INT32_MIN, 1000000LL + INT32_MAX + 1, 1LL << 40, -(1LL << 40), 1LL << 62, -(1LL << 62), 0, 1000000 };
+
+	long long timestamp = 0, wall_time = -5000;
+	addRow(block, timestamp, wall_time, { 1, 2 });
+	for (long long delta : deltas)
+	{
+		timestamp += delta;
+		wall_time -= delta / 1000;
+		addRow(block, timestamp, wall_time, { 1, 2 });
+	}
+
+	checkRoundTrip(block, "a block with timestamp jumps", encoded);
+
+	//the most extreme first timestamps are stored as they are
+	RecordBlock extremes(1, 0);
+	addRow(extremes, std::numeric_limits<long long>::min(), std::numeric_limits<long long>::max(), { 0 });
+	addRow(extremes, std::numeric_limits<long long>::min() + 1, std::numeric_limits<long long>::max() - 1, { 0 });
+	checkRoundTrip(extremes, "a block with the extreme timestamps", encoded);
+}
+
+/**
+* A column of NaNs and one that changes between NaN and values on every row
+*/
+static void testNaNs()
+{
+	std::vector<unsigned char> encoded;
+	RecordBlock block(3, 0);
+
+	float nan = std::numeric_limits<float>::quiet_NaN();
+	for (unsigned int row = 0; row < 60; row++)
+	{
+		addRow(block, row * 1000000LL, 1700000000000LL + row * 1000, { nan, row % 2 ? nan : 40.25f + row, -nan });
+	}
+
+	checkRoundTrip(block, "a block with NaNs", encoded);
+}
+
+/**
+* Sensors that change slowly cost a few bits per value, the payload is less than a tenth of the fixed width binary block
+*/
+static void testCompressionRatio()
+{
+	const unsigned int columns = 50, rows = 60;
+	std::vector<unsigned char> encoded;
+	size_t compressed_size = 0, raw_size = 0;
+
+	for (unsigned int first_row = 0; first_row < 3600; first_row += rows)
+	{
+		RecordBlock block(columns, rows);
+
+		for (unsigned int row = first_row; row < first_row + rows; row++)
+		{
+			std::vector<float> values(columns);
+			for (unsigned int column = 0; column < columns; column++)
+			{
+				//sensors report with a fixed resolution, quantized to a quarter of a unit
+				values[column] = (float)(std::round((40.0 + column + 5 * std::sin(row * 0.001 + column)) * 4) / 4);
+			}
+
+			addRow(block, row * 1000000LL + (row % 3) * 150, 1700000000000LL + row * 1000LL, values);
+		}
+
+		checkRoundTrip(block, "a block of slowly changing sensors from row " + std::to_string(first_row), encoded);
+
+		compressed_size += encoded.size();
+		raw_size += (2 * sizeof(long long) + sizeof(float) * columns) * rows;
+	}
+
+	double ratio = (double)raw_size / compressed_size;
+	check(ratio >= 10, "slowly changing sensors compress at least 10 times, got " + std::to_string(ratio));
+}
+
+/**
+* A payload that lost any of its bytes is rejected instead of decoded into made up values
+*/
+static void testTruncatedPayload()
+{
+	std::vector<unsigned char> encoded;
+	RecordBlock block(4, 0);
+
+	for (unsigned int row = 0; row < 30; row++)
+	{
+		addRow(block, row * 1000003LL, 1700000000000LL + row * 997, { (float)row, 1.5f * row, -2.0f * row, 100.0f - row });
+	}
+
+	encodeCompressedBlock(block, encoded);
+
+	bool every_truncation_rejected = 1;
+	for (size_t size = 0; size < encoded.size(); size++)
+	{
+		RecordBlock decoded(0, 0);
+		if (decodeCompressedBlock(encoded.data(), size, block.rows, block.columns, decoded))
+		{
+			every_truncation_rejected = 0;
+			printf("a payload truncated to %zu of %zu bytes was decoded\n", size, encoded.size());
+		}
+	}
+	check(every_truncation_rejected, "a truncated payload is not decoded");
+
+	std::vector<long long> timestamps;
+	std::vector<float> values;
+	check(!decodeCompressedColumn(encoded.data(), encoded.size() - 1, block.rows, block.columns, block.columns - 1, timestamps, values), "the last column of a truncated payload is not decoded");
+	check(!decodeCompressedColumn(encoded.data(), encoded.size(), block.rows, block.columns, block.columns, timestamps, values), "a column past the last one is not decoded");
+}
+
+int main()
+{
+	testRandomBlocks();
+	testTimestampJumps();
+	testNaNs();
+	testCompressionRatio();
+	testTruncatedPayload();
+
+	if (failed_checks == 0) printf("RecordCompressionTests passed\n");
+	return failed_checks;
+}
@@ -0,0 +1,387 @@
+#include "TestSupport.h"
+#include "RecordReader.h"
+#include "RecordCompression.h"
+#include "RecordRollup.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+* The recording every test reads, three hours of rows a second apart in blocks of a minute
+*/
+const unsigned int test_columns = 3;
+const unsigned int test_rows = 3 * 3600;
+const unsigned int test_block_rows = 60;
+
+static const char* test_column_names[test_columns] = { "CPU.Load.Load", "GPU.Temperature.Temperature", "Disk.Activity.Load" };
+
+/**
+* Gets the time of a row in microseconds since the recording started, with a little scheduling jitter
+*/
+static long long rowTime(const unsigned int row)
+{
+	return row * 1000000LL + (row % 7) * 37;
+}
+
+/**
+* Gets the value of a column in a row, quantized to a quarter so CSV recordings keep it exactly
+* The second column is missing every fifth row
+*/
+static float rowValue(const unsigned int row, const unsigned int column)
+{
+	if (column == 1 && row % 5 == 0) return std::numeric_limits<float>::quiet_NaN();
+
+	return (float)(std::round((50.0 + 20 * column + 30 * std::sin(row * 0.0013 * (column + 1)) + (row * 7919 % 13) * 0.5) * 4) / 4);
+}
+
+/**
+* Builds the rows of a block
+*/
+static RecordBlock makeBlock(const unsigned int first_row)
+{
+	RecordBlock block(test_columns, test_block_rows);
+
+	for (unsigned int row = first_row; row < first_row + test_block_rows && row < test_rows; row++)
+	{
+		block.timestamps.push_back(rowTime(row));
+		block.wall_times.push_back(1700000000000LL + row * 1000LL);
+		for (unsigned int column = 0; column < test_columns; column++)
+		{
+			block.values.push_back(rowValue(row, column));
+		}
+		block.rows++;
+	}
+
+	return block;
+}
+
+static RecordSchema makeSchema()
+{
+	RecordSchema schema;
+	schema.start_time = 1700000000000LL;
+	schema.static_info = "Storage\nDrive 0,Test Drive\n==== Dynamic data ====\n";
+	schema.column_names.assign(test_column_names, test_column_names + test_columns);
+
+	return schema;
+}
+
+/**
+* Writes the recording in the binary format, raw and compressed blocks take turns and the rollups are written as their buckets finish
+*/
+static void writeBinaryRecording(const std::string& path)
+{
+	std::ofstream stream(path, std::ios::binary);
+	writeBinaryHeader(stream, makeSchema());
+
+	RecordRollup rollup;
+	rollup.reset(test_columns);
+
+	std::vector<unsigned char> scratch;
+	std::vector<RecordRollupBlock> rollups;
+
+	for (unsigned int first_row = 0; first_row < test_rows; first_row += test_block_rows)
+	{
+		RecordBlock block = makeBlock(first_row);
+
+		if ((first_row / test_block_rows) % 2 == 0)
+		{
+			writeBinaryBlock(stream, block);
+		}
+		else
+		{
+			writeCompressedBinaryBlock(stream, block, scratch);
+		}
+
+		rollup.addBlock(block);
+		rollup.takeFinished(rollups);
+		for (const RecordRollupBlock& finished : rollups)
+		{
+			writeBinaryRollupBlock(stream, finished);
+		}
+	}
+
+	rollup.finish();
+	rollup.takeFinished(rollups);
+	for (const RecordRollupBlock& finished : rollups)
+	{
+		writeBinaryRollupBlock(stream, finished);
+	}
+}
+
+/**
+* Writes the recording in the CSV format followed by a summary
+*/
+static void writeCsvRecording(const std::string& path)
+{
+	std::ofstream stream(path, std::ios::binary);
+	writeCsvHeader(stream, makeSchema());
+
+	for (unsigned int first_row = 0; first_row < test_rows; first_row += test_block_rows)
+	{
+		writeCsvBlock(stream, makeBlock(first_row));
+	}
+
+	stream << CsvSummaryMarker << "\nSensor,Min,Max\n";
+}
+
+/**
+* Checks the statistics of a column over a time range against every value of the range sorted
+*/
+static void checkQuery(RecordReader& reader, const unsigned int column, const long long from, const long long to, const std::string& description)
+{
+	const std::vector<double> percentiles = { 0, 1, 50, 95, 99, 100 };
+
+	std::vector<float> expected;
+	double sum = 0;
+	for (unsigned int row = 0; row < test_rows; row++)
+	{
+		float value = rowValue(row, column);
+		if (rowTime(row) < from || rowTime(row) > to || std::isnan(value)) continue;
+
+		expected.push_back(value);
+		sum += value;
+	}
+	std::sort(expected.begin(), expected.end());
+
+	RecordQueryResult result;
+	if (!reader.query(column, from, to, percentiles, result))
+	{
+		check(0, description + " can be queried");
+		return;
+	}
+
+	check(result.Count == expected.size(), description + " counts " + std::to_string(expected.size()) + " values, got " + std::to_string(result.Count));
+	if (expected.empty() || result.Count != expected.size()) return;
+
+	check(result.Min == expected.front() && result.Max == expected.back(), description + " has the minimum and maximum of the range");
+	check(std::fabs(result.Average - sum / expected.size()) < 1e-6, description + " has the average of the range");
+
+	bool percentiles_match = result.Percentiles.size() == percentiles.size();
+	for (size_t index = 0; percentiles_match && index < percentiles.size(); index++)
+	{
+		//nearest rank
+		size_t rank = (size_t)std::ceil(percentiles[index] / 100.0 * expected.size());
+		rank = std::min(std::max(rank, (size_t)1), expected.size()) - 1;
+
+		percentiles_match = result.Percentiles[index].first == percentiles[index] && result.Percentiles[index].second == expected[rank];
+		if (!percentiles_match) printf("percentile %g is %g, expected %g\n", percentiles[index], result.Percentiles[index].second, expected[rank]);
+	}
+	check(percentiles_match, description + " has the nearest rank percentiles of the range");
+}
+
+/**
+* Checks the points of a trend against the rows grouped by hand into buckets of the given size
+* @param bucket_start The time the buckets are aligned to
+* @param bucket_size The size of a bucket in microseconds
+* @param whole_buckets Marks that the buckets include their rows outside the range, like rollup buckets do
+*/
+static void checkTrendPoints(const std::vector<RecordTrendPoint>& points, const unsigned int column, const long long from, const long long to, const long long bucket_start, const long long bucket_size, const bool whole_buckets, const std::string& description)
+{
+	std::vector<RecordTrendPoint> expected;
+	std::vector<unsigned long long> counts;
+
+	for (unsigned int row = 0; row < test_rows; row++)
+	{
+		float value = rowValue(row, column);
+		if (std::isnan(value)) continue;
+
+		long long start = bucket_start + (rowTime(row) - bucket_start) / bucket_size * bucket_size;
+		if (start + bucket_size <= from || start > to) continue;
+
+		if (!whole_buckets && (rowTime(row) < from || rowTime(row) > to)) continue;
+
+		if (expected.empty() || expected.back().Time != start)
+		{
+			RecordTrendPoint point;
+			point.Time = start;
+			point.Min = point.Max = value;
+			expected.push_back(point);
+			counts.push_back(0);
+		}
+
+		RecordTrendPoint& point = expected.back();
+		point.Min = std::min(point.Min, (double)value);
+		point.Max = std::max(point.Max, (double)value);
+		point.Average += value;
+		point.Last = value;
+		counts.back()++;
+	}
+
+	bool points_match = points.size() == expected.size();
+	for (size_t index = 0; points_match && index < points.size(); index++)
+	{
+		double average = expected[index].Average / counts[index];
+
+		points_match = points[index].Time == expected[index].Time && points[index].Min == expected[index].Min && points[index].Max == expected[index].Max &&
+			std::fabs(points[index].Average - average) < 1e-3 && points[index].Last == expected[index].Last;
+	}
+	check(points_match, description + " has " + std::to_string(expected.size()) + " points with the statistics of their rows, got " + std::to_string(points.size()));
+}
+
+/**
+* Gets the tier a trend should use, the finest one whose buckets fit, the coarsest one if none does
+*/
+static unsigned int expectedTier(const long long from, const long long to, const unsigned int max_points)
+{
+	for (unsigned int tier : RecordRollupTiers)
+	{
+		if ((to - from) / (tier * 1000000LL) + 1 <= max_points) return tier;
+	}
+
+	return RecordRollupTiers[sizeof(RecordRollupTiers) / sizeof(RecordRollupTiers[0]) - 1];
+}
+
+/**
+* A binary recording of raw and compressed blocks with rollups
+*/
+static void testBinaryRecording(const std::string& directory)
+{
+	std::string path = directory + "/recording.sibrec";
+	writeBinaryRecording(path);
+
+	RecordReader reader;
+	if (!reader.open(path))
+	{
+		check(0, "the binary recording can be opened");
+		return;
+	}
+
+	check(reader.getSchema().column_names.size() == test_columns && reader.findColumn(test_column_names[2]) == 2, "the binary recording has the columns it was written with");
+
+	long long first = 0, last = 0;
+	check(reader.getTimeRange(first, last) && first == rowTime(0) && last == rowTime(test_rows - 1), "the binary recording covers every row");
+
+	for (unsigned int column = 0; column < test_columns; column++)
+	{
+		std::string name = "column " + std::to_string(column) + " of the binary recording";
+
+		checkQuery(reader, column, 0, last, name);
+		checkQuery(reader, column, rowTime(61), rowTime(61), name + " at a single row");
+		checkQuery(reader, column, rowTime(59) + 1, rowTime(1234), name + " across raw and compressed blocks");
+		checkQuery(reader, column, rowTime(5000) - 1, rowTime(9000) + 1, name + " in the middle of the recording");
+	}
+
+	RecordQueryResult result;
+	check(reader.query(0, last + 1, last + 1000000, { 50 }, result) && result.Count == 0 && result.Percentiles.empty(), "a range past the end of the binary recording has no values");
+	check(!reader.query(test_columns, 0, last, { 50 }, result), "a column past the last one of the binary recording cannot be queried");
+
+	//few enough rows are returned as they are
+	std::vector<RecordTrendPoint> points;
+	unsigned int tier = 99;
+	long long from = rowTime(100), to = rowTime(399);
+	check(reader.queryTrend(1, from, to, 300, points, tier) && tier == 0, "300 rows of the binary recording fit 300 points without a rollup");
+	checkTrendPoints(points, 1, from, to, 0, 1, 0, "the raw trend of the binary recording");
+
+	//every other range picks the finest tier that fits
+	const unsigned int max_points[] = { 299, 180, 179, 60, 10, 3, 2, 1 };
+	for (unsigned int points_limit : max_points)
+	{
+		std::string name = "a trend of the binary recording with at most " + std::to_string(points_limit) + " points";
+
+		check(reader.queryTrend(1, 0, last, points_limit, points, tier), name + " can be read");
+		check(tier == expectedTier(first, last, points_limit), name + " uses the " + std::to_string(expectedTier(first, last, points_limit)) + " second tier, got " + std::to_string(tier));
+		checkTrendPoints(points, 1, first, last, 0, tier * 1000000LL, 1, name);
+	}
+}
+
+/**
+* A binary recording whose last block claims to have no rows, the blocks after it are not trusted
+*/
+static void testEmptyBlocks(const std::string& directory)
+{
+	std::string path = directory + "/empty-blocks.sibrec";
+	writeBinaryRecording(path);
+
+	//a compressed block header with 0 rows in front of a valid payload, then a valid block that must not be reached
+	RecordBlock last_block = makeBlock(test_rows - test_block_rows);
+	for (long long& timestamp : last_block.timestamps) timestamp += 3600 * 1000000LL;
+
+	std::vector<unsigned char> payload;
+	encodeCompressedBlock(last_block, payload);
+
+	std::ofstream stream(path, std::ios::binary | std::ios::app);
+	unsigned int header[] = { BinaryRecordCompressedBlockMarker, 0, test_columns, (unsigned int)payload.size() };
+	unsigned int checksum = 0;
+	stream.write((const char*)header, sizeof(header));
+	stream.write((const char*)payload.data(), payload.size());
+	stream.write((const char*)&checksum, sizeof(checksum));
+
+	writeBinaryBlock(stream, last_block);
+	stream.close();
+
+	RecordReader reader;
+	long long first = 0, last = 0;
+	check(reader.open(path) && reader.getTimeRange(first, last) && last == rowTime(test_rows - 1), "a compressed block without rows ends the binary recording");
+
+	//the same for a raw block
+	path = directory + "/empty-raw-block.sibrec";
+	writeBinaryRecording(path);
+
+	stream.open(path, std::ios::binary | std::ios::app);
+	header[0] = BinaryRecordBlockMarker;
+	stream.write((const char*)header, 3 * sizeof(unsigned int));
+	stream.write((const char*)&checksum, sizeof(checksum));
+
+	writeBinaryBlock(stream, last_block);
+	stream.close();
+
+	check(reader.open(path) && reader.getTimeRange(first, last) && last == rowTime(test_rows - 1), "a raw block without rows ends the binary recording");
+	checkQuery(reader, 0, 0, std::numeric_limits<long long>::max(), "a binary recording that ends in a block without rows");
+}
+
+/**
+* A CSV recording of the same rows followed by its summary
+*/
+static void testCsvRecording(const std::string& directory)
+{
+	std::string path = directory + "/recording.csv";
+	writeCsvRecording(path);
+
+	RecordReader reader;
+	if (!reader.open(path))
+	{
+		check(0, "the CSV recording can be opened");
+		return;
+	}
+
+	check(reader.getSchema().column_names.size() == test_columns && reader.findColumn(test_column_names[1]) == 1, "the CSV recording has the columns it was written with");
+
+	long long first = 0, last = 0;
+	check(reader.getTimeRange(first, last) && first == rowTime(0) && last == rowTime(test_rows - 1), "the CSV recording covers every row and stops at the summary");
+
+	for (unsigned int column = 0; column < test_columns; column++)
+	{
+		std::string name = "column " + std::to_string(column) + " of the CSV recording";
+
+		checkQuery(reader, column, 0, last, name);
+		checkQuery(reader, column, rowTime(1023), rowTime(1025), name + " across two index entries");
+		checkQuery(reader, column, rowTime(7000) + 1, rowTime(10000) - 1, name + " at the end of the recording");
+	}
+
+	//without rollups the rows are grouped into as many buckets as fit
+	std::vector<RecordTrendPoint> points;
+	unsigned int tier = 99;
+	check(reader.queryTrend(2, first, last, 100, points, tier) && tier == 0 && points.size() <= 100, "a trend of the CSV recording is built from the raw rows");
+	checkTrendPoints(points, 2, first, last, first, (last - first) / 100 + 1, 0, "the bucketed trend of the CSV recording");
+
+	long long from = rowTime(3000), to = rowTime(3049);
+	check(reader.queryTrend(2, from, to, 50, points, tier) && tier == 0, "50 rows of the CSV recording fit 50 points");
+	checkTrendPoints(points, 2, from, to, 0, 1, 0, "the raw trend of the CSV recording");
+}
+
+int main()
+{
+	std::string directory = makeTemporaryDirectory();
+	if (directory.empty())
+	{
+		printf("FAILED: could not create a temporary directory\n");
+		return 1;
+	}
+
+	testBinaryRecording(directory);
+	testEmptyBlocks(directory);
+	testCsvRecording(directory);
+
+	if (failed_checks == 0) printf("RecordReaderTests passed\n");
+	return failed_checks;
+}
@@ -0,0 +1,234 @@
+#include "TestSupport.h"
+#include "SocketTable.h"
+#include <unistd.h>
+#include <netinet/in.h>
+
+/**
+* The directory the recorded dumps are read from
+* They were recorded in a network namespace with a server listening on 127.0.0.1:8080 and [::1]:8443, clients connected to it from 127.0.0.1:40000, 127.0.0.1:40001 and [::1]:40002,
+* and UDP sockets on 127.0.0.1:5353 and [::1]:5353
+* Between the two snapshots the client on port 40001 closed its connection, both UDP sockets were closed and a UDP socket on 127.0.0.1:5354 was opened
+* Every dump came in 2 reads with NLMSG_DONE on its own in the last one, except the empty UDP over IPv6 dump of the second snapshot
+*/
+static const std::string FixtureDirectory = "tests/fixtures/sock-diag/";
+
+/**
+* The sequence numbers the dumps were recorded with, in the order TCP, TCP over IPv6, UDP and UDP over IPv6
+*/
+static const unsigned int FirstSnapshotSequences[] = { 1, 2, 3, 4 };
+static const unsigned int SecondSnapshotSequences[] = { 7, 8, 9, 10 };
+
+/**
+* The inodes the sockets had when they were recorded
+*/
+static const unsigned long long Listener = 118822, Listener6 = 118823;
+static const unsigned long long Client = 118824, Accepted = 118825, ClosingClient = 118826, ClosingAccepted = 118827, Client6 = 118828, Accepted6 = 118829;
+static const unsigned long long Udp = 118830, Udp6 = 118831, NewUdp = 118832;
+
+/**
+* Reads every part of a recorded dump, the parts are numbered from 1 in the order they were received
+* @param name The name of the dump, like "snapshot1-tcp4"
+*/
+static std::vector<std::vector<unsigned char>> readDump(const std::string& name)
+{
+	std::vector<std::vector<unsigned char>> parts;
+
+	std::vector<unsigned char> part;
+	while (readFixture(FixtureDirectory + name + "-" + std::to_string(parts.size() + 1) + ".bin", part))
+	{
+		parts.push_back(part);
+	}
+
+	return parts;
+}
+
+/**
+* Replays the parts of a dump like they were received from the socket
+* @return If every part but the last asked for more and the last one ended the dump
+*/
+static bool replayDump(SocketTable& table, const std::string& name, const unsigned char protocol, const unsigned int sequence)
+{
+	std::vector<std::vector<unsigned char>> parts = readDump(name);
+	bool ended_last = !parts.empty();
+
+	for (size_t index = 0; index < parts.size(); index++)
+	{
+		bool more = table.parseDiagMessages((const char*)parts[index].data(), parts[index].size(), protocol, sequence);
+		ended_last &= more == (index + 1 < parts.size());
+	}
+
+	return ended_last;
+}
+
+/**
+* Replays the four dumps of a snapshot like update() asks for them
+*/
+static void replaySnapshot(SocketTable& table, const std::string& snapshot, const unsigned int* sequences)
+{
+	table.startSnapshot();
+
+	bool complete = replayDump(table, snapshot + "-tcp4", IPPROTO_TCP, sequences[0]);
+	complete &= replayDump(table, snapshot + "-tcp6", IPPROTO_TCP, sequences[1]);
+	complete &= replayDump(table, snapshot + "-udp4", IPPROTO_UDP, sequences[2]);
+	complete &= replayDump(table, snapshot + "-udp6", IPPROTO_UDP, sequences[3]);
+	check(complete, "every dump of " + snapshot + " ends at NLMSG_DONE");
+
+	table.finishSnapshot(complete);
+}
+
+/**
+* Finds a socket by its protocol and ports, the ports of the recorded sockets tell them apart
+* @return The socket, nullptr if there is none with the ports
+*/
+static const SocketTable::Socket* findSocket(const SocketTable& table, const unsigned char protocol, const unsigned short localPort, const unsigned short remotePort)
+{
+	for (auto& socket : table.getSockets())
+	{
+		if (socket.first.Protocol == protocol && socket.first.LocalPort == localPort && socket.first.RemotePort == remotePort) return &socket.second;
+	}
+
+	return nullptr;
+}
+
+/**
+* Checks the sockets of a process
+*/
+static void checkProcess(const SocketTable& table, const unsigned int processID, const unsigned int sockets, const unsigned int established, const unsigned int listening, const std::string& description)
+{
+	const SocketTable::ProcessSockets* process = table.findProcess(processID);
+	check(process != nullptr && process->Sockets == sockets && process->Established == established && process->Listening == listening,
+		description + ": process " + std::to_string(processID) + " has " + std::to_string(sockets) + " sockets, " + std::to_string(established) + " established and " + std::to_string(listening) + " listening");
+}
+
+/**
+* Checks the number of sockets in every state
+* @param counts The expected counts in the order of SocketState
+*/
+static void checkStateCounts(const SocketTable& table, const std::vector<unsigned int>& counts, const std::string& description)
+{
+	for (unsigned int state = 0; state < SocketStateCount; state++)
+	{
+		unsigned int count = table.getStateCount((SocketState)state);
+		check(count == counts[state], description + ": " + SocketStateNames[state] + " has " + std::to_string(count) + " sockets, expected " + std::to_string(counts[state]));
+	}
+}
+
+/**
+* Adds a process to the fake /proc with the given sockets open and a file that is not a socket
+*/
+static void addProcess(const std::string& proc, const unsigned int processID, const std::string& name, const std::vector<unsigned long long>& inodes)
+{
+	std::string process = proc + "/" + std::to_string(processID);
+	writeFile(process + "/comm", name + "\n");
+	makeDirectories(process + "/fd");
+
+	symlink("/dev/null", (process + "/fd/0").c_str());
+	for (size_t index = 0; index < inodes.size(); index++)
+	{
+		symlink(("socket:[" + std::to_string(inodes[index]) + "]").c_str(), (process + "/fd/" + std::to_string(index + 3)).c_str());
+	}
+}
+
+/**
+* Closes the files of a process in the fake /proc, the process itself keeps running
+*/
+static void closeFiles(const std::string& proc, const unsigned int processID, const size_t count)
+{
+	for (size_t index = 0; index < count; index++)
+	{
+		unlink((proc + "/" + std::to_string(processID) + "/fd/" + std::to_string(index + 3)).c_str());
+	}
+}
+
+int main()
+{
+	std::string directory = makeTemporaryDirectory();
+	if (directory.empty())
+	{
+		printf("FAILED: could not create a temporary directory\n");
+		return 1;
+	}
+
+	//the entries of /proc that are not processes are not looked into
+	std::string proc = directory + "/proc";
+	addProcess(proc, 100, "server", { Listener, Listener6, Accepted, ClosingAccepted, Accepted6 });
+	addProcess(proc, 200, "client", { Client, ClosingClient, Client6 });
+	addProcess(proc, 300, "resolver", { Udp, Udp6 });
+	makeDirectories(proc + "/net");
+	symlink("100", (proc + "/self").c_str());
+
+	PlatformSessions sessions;
+	SocketTable table(sessions, proc, 0);
+
+	//the owners are looked for once the first snapshot found sockets without one
+	replaySnapshot(table, "snapshot1", FirstSnapshotSequences);
+
+	check(table.getSockets().size() == 10, "the first snapshot has 10 sockets, got " + std::to_string(table.getSockets().size()));
+	checkStateCounts(table, { 6, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2 }, "the first snapshot");
+	checkProcess(table, 100, 5, 3, 2, "the first snapshot");
+	checkProcess(table, 200, 3, 3, 0, "the first snapshot");
+	checkProcess(table, 300, 2, 0, 0, "the first snapshot");
+
+	const SocketTable::Socket* listener = findSocket(table, IPPROTO_TCP, 8080, 0);
+	check(listener != nullptr && listener->State == SocketState::Listen && listener->SendQueue == 512 && listener->Inode == Listener, "the send queue of the listener is its backlog");
+
+	const SocketTable::Socket* accepted = findSocket(table, IPPROTO_TCP, 8080, 40000);
+	check(accepted != nullptr && accepted->ReceiveQueue == 100 && accepted->ProcessID == 100, "the accepted connection has the 100 bytes it did not read in its queue");
+
+	std::vector<std::pair<unsigned int, unsigned int>> top = table.getTopProcesses(2);
+	check(top.size() == 2 && top[0] == std::make_pair(100u, 5u) && top[1] == std::make_pair(200u, 3u), "the server and the client own the most sockets");
+	check(table.getProcessName(100) == L"server", "the name of the server is read from its comm");
+
+	//the client on port 40001 closed its connection and the server handed the one from port 40000 to a worker that also opened a UDP socket
+	closeFiles(proc, 200, 3);
+	addProcess(proc, 200, "client", { Client, Client6 });
+	closeFiles(proc, 300, 2);
+	closeFiles(proc, 100, 5);
+	addProcess(proc, 100, "server", { Listener, Listener6, ClosingAccepted, Accepted6 });
+	addProcess(proc, 400, "worker", { Accepted, NewUdp });
+
+	//the UDP dump of the first snapshot arrives late, its sequence number tells it apart from the one asked for
+	table.startSnapshot();
+	for (auto& part : readDump("snapshot1-udp4"))
+	{
+		check(table.parseDiagMessages((const char*)part.data(), part.size(), IPPROTO_UDP, SecondSnapshotSequences[2]), "the NLMSG_DONE of a stale dump does not end the current one");
+	}
+
+	bool complete = replayDump(table, "snapshot2-tcp4", IPPROTO_TCP, SecondSnapshotSequences[0]);
+	complete &= replayDump(table, "snapshot2-tcp6", IPPROTO_TCP, SecondSnapshotSequences[1]);
+	complete &= replayDump(table, "snapshot2-udp4", IPPROTO_UDP, SecondSnapshotSequences[2]);
+	complete &= replayDump(table, "snapshot2-udp6", IPPROTO_UDP, SecondSnapshotSequences[3]);
+	table.finishSnapshot(complete);
+
+	//the closing client waits in FIN wait 2 without a file, the server has to close its side
+	check(table.getSockets().size() == 9, "the second snapshot has 9 sockets, got " + std::to_string(table.getSockets().size()));
+	checkStateCounts(table, { 4, 0, 0, 0, 1, 0, 0, 1, 0, 2, 0, 1 }, "the second snapshot");
+	check(findSocket(table, IPPROTO_UDP, 5353, 0) == nullptr, "the UDP socket of the stale dump was closed");
+
+	const SocketTable::Socket* closing = findSocket(table, IPPROTO_TCP, 40001, 8080);
+	check(closing != nullptr && closing->State == SocketState::FinWait2 && closing->Inode == 0 && closing->ProcessID == 0, "the client socket that lost its file has no owner");
+
+	//the socket handed to the worker keeps the owner it had until the next snapshot, the new UDP socket gets its owner from the scan
+	checkProcess(table, 100, 5, 2, 2, "the second snapshot");
+	checkProcess(table, 200, 2, 2, 0, "the second snapshot");
+	checkProcess(table, 400, 1, 0, 0, "the second snapshot");
+	check(table.findProcess(300) == nullptr && table.getProcessName(300).empty(), "the resolver that closed its sockets is gone");
+
+	replaySnapshot(table, "snapshot2", SecondSnapshotSequences);
+
+	checkStateCounts(table, { 4, 0, 0, 0, 1, 0, 0, 1, 0, 2, 0, 1 }, "the third snapshot");
+	checkProcess(table, 100, 4, 1, 2, "the third snapshot");
+	checkProcess(table, 400, 2, 1, 0, "the third snapshot");
+	check(table.getProcessName(400) == L"worker", "the name of the worker is read from its comm");
+
+	//a snapshot that missed the dumps over IPv6 keeps their sockets
+	table.startSnapshot();
+	replayDump(table, "snapshot2-tcp4", IPPROTO_TCP, SecondSnapshotSequences[0]);
+	table.finishSnapshot(0);
+
+	check(table.getSockets().size() == 9, "an incomplete snapshot removes no socket");
+	checkStateCounts(table, { 4, 0, 0, 0, 1, 0, 0, 1, 0, 2, 0, 1 }, "an incomplete snapshot");
+
+	if (failed_checks == 0) printf("SocketTableTests passed\n");
+	return failed_checks;
+}
@@ -0,0 +1,193 @@
+#include "TestSupport.h"
+#include "StorageInformation.h"
+#include <unistd.h>
+
+/**
+* Links a path of the fake tree to another one, like sysfs links its devices
+* @param target Where the link points to, relative to the directory of the link
+* @param path The path of the link
+*/
+static void makeLink(const std::string& target, const std::string& path)
+{
+	makeDirectories(path.substr(0, path.rfind('/')));
+	check(symlink(target.c_str(), path.c_str()) == 0, "the link " + path + " can be created");
+}
+
+/**
+* Writes the attributes sysfs has for every disk
+* @param disk_path The directory of the disk under devices
+*/
+static void writeDisk(const std::string& disk_path, const std::string& size, const std::string& logical_block_size, const std::string& physical_block_size, const std::string& rotational, const std::string& removable)
+{
+	writeFile(disk_path + "/size", size + "\n");
+	writeFile(disk_path + "/queue/logical_block_size", logical_block_size + "\n");
+	writeFile(disk_path + "/queue/physical_block_size", physical_block_size + "\n");
+	writeFile(disk_path + "/queue/rotational", rotational + "\n");
+	writeFile(disk_path + "/removable", removable + "\n");
+}
+
+/**
+* Builds a sysfs tree like the one of a machine with a SATA SSD, an NVMe drive, a USB stick, an LVM volume and a loop device
+* The disks live under devices, block and dev/block only link to them
+* @param sys The directory that takes the place of /sys
+*/
+static void buildFakeSysfs(const std::string& sys)
+{
+	//the SATA SSD, its first partition is mounted on /boot
+	std::string sda = "devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/block/sda";
+	writeDisk(sys + "/" + sda, "1953525168", "512", "4096", "0", "0");
+	writeFile(sys + "/devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/model", "Samsung SSD 860 EVO 1TB\n");
+	writeFile(sys + "/devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/serial", "S3Z9NB0K123456A\n");
+	makeLink("../../../0:0:0:0", sys + "/" + sda + "/device");
+	writeFile(sys + "/" + sda + "/sda1/partition", "1\n");
+	makeLink("../devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/block/sda", sys + "/block/sda");
+	makeLink("../../devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/block/sda/sda1", sys + "/dev/block/8:1");
+
+	//the NVMe drive holds the LVM volume mounted on /, it has no serial in sysfs
+	std::string nvme = "devices/pci0000:00/0000:00:1d.0/0000:03:00.0/nvme/nvme0/nvme0n1";
+	writeDisk(sys + "/" + nvme, "1000215216", "512", "512", "0", "0");
+	writeFile(sys + "/devices/pci0000:00/0000:00:1d.0/0000:03:00.0/nvme/nvme0/model", "WDC PC SN730\n");
+	makeLink("../../nvme0", sys + "/" + nvme + "/device");
+	makeLink("../devices/pci0000:00/0000:00:1d.0/0000:03:00.0/nvme/nvme0/nvme0n1", sys + "/block/nvme0n1");
+
+	//the USB stick is mounted whole, without a partition table, and has no model
+	std::string sdb = "devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/host1/target1:0:0/1:0:0:0/block/sdb";
+	writeDisk(sys + "/" + sdb, "60063744", "512", "512", "1", "1");
+	makeLink("../../../1:0:0:0", sys + "/" + sdb + "/device");
+	makeLink("../devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/host1/target1:0:0/1:0:0:0/block/sdb", sys + "/block/sdb");
+	makeLink("../../devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/host1/target1:0:0/1:0:0:0/block/sdb", sys + "/dev/block/8:16");
+
+	//the LVM volume and the loop device have no hardware behind them
+	writeDisk(sys + "/devices/virtual/block/dm-0", "1000206336", "4096", "4096", "0", "0");
+	writeFile(sys + "/devices/virtual/block/dm-0/dm/name", "vg0-root\n");
+	makeLink("../devices/virtual/block/dm-0", sys + "/block/dm-0");
+	makeLink("../../devices/virtual/block/dm-0", sys + "/dev/block/253:0");
+
+	writeDisk(sys + "/devices/virtual/block/loop0", "0", "512", "512", "0", "0");
+	makeLink("../devices/virtual/block/loop0", sys + "/block/loop0");
+}
+
+/**
+* The drives are read from mountinfo and the block devices they are mounted from
+*/
+static void testDrives(StorageInformation& storage)
+{
+	check(storage.Drives.size() == 5, "the pseudo file systems are not listed as drives, got " + std::to_string(storage.Drives.size()) + " drives");
+	check(storage.Drives.find(L"/proc") == storage.Drives.end(), "proc is not a drive");
+	check(storage.Drives.find(L"/run") == storage.Drives.end(), "tmpfs is not a drive");
+
+	auto& root = storage.Drives[L"/"];
+	check(root.Device == L"/dev/mapper/vg0-root" && root.FileSystem == L"ext4", "the root is the ext4 volume on /dev/mapper/vg0-root");
+	check(root.VolumeName == L"vg0-root", "the LVM volume is named after its device mapper name");
+	check(root.BytesPerSector == 4096, "the sector size of the LVM volume is its own");
+	check(root.VolumeType == L"Fixed Drive", "the LVM volume is fixed");
+
+	auto& boot = storage.Drives[L"/boot"];
+	check(boot.Device == L"/dev/sda1" && boot.FileSystem == L"vfat", "/boot is the vfat partition on /dev/sda1");
+	check(boot.BytesPerSector == 512, "the partition has the sector size of its disk");
+	check(boot.VolumeType == L"Fixed Drive", "the partition of a fixed disk is fixed");
+
+	check(storage.Drives.find(L"/media/usb stick") != storage.Drives.end(), "the escaped space of a mount point is read as a space");
+	auto& stick = storage.Drives[L"/media/usb stick"];
+	check(stick.Device == L"/dev/sdb" && stick.FileSystem == L"exfat", "the stick is the exfat file system on /dev/sdb");
+	check(stick.VolumeType == L"Removable Drive", "the stick is removable");
+
+	auto& share = storage.Drives[L"/srv/data"];
+	check(share.Device == L"fileserver:/export/data" && share.FileSystem == L"nfs4", "the share is the NFS export it was mounted from");
+	check(share.VolumeType == L"Network Drive", "the share is a network drive");
+
+	//btrfs reports an anonymous device number, the drive is listed without what sysfs would tell about it
+	auto& pool = storage.Drives[L"/mnt/pool"];
+	check(pool.Device == L"/dev/sdc" && pool.FileSystem == L"btrfs", "the btrfs pool is listed by its source");
+	check(pool.VolumeType == L"Fixed Drive" && pool.BytesPerSector == 0, "the btrfs pool is not looked up by its anonymous device number");
+}
+
+/**
+* The physical disks are the block devices that have a device behind them
+*/
+static void testPhysicalDisks(StorageInformation& storage)
+{
+	check(storage.PhysicalDisks.size() == 3, "only the disks with hardware behind them are listed, got " + std::to_string(storage.PhysicalDisks.size()) + " disks");
+	check(storage.PhysicalDisks.find(L"loop0") == storage.PhysicalDisks.end(), "the loop device is not a physical disk");
+	check(storage.PhysicalDisks.find(L"dm-0") == storage.PhysicalDisks.end(), "the LVM volume is not a physical disk");
+
+	auto& sda = storage.PhysicalDisks[L"sda"];
+	check(sda.Size == 1953525168ULL * 512 && sda.AllocatedSize == sda.Size, "the size is counted in 512 byte sectors");
+	check(sda.LogicalSectorSize == 512 && sda.PhysicalSectorSize == 4096, "the sector sizes are read from the queue");
+	check(sda.MediaType == L"SSD", "a disk that does not rotate is an SSD");
+	check(sda.FriendlyName == L"Samsung SSD 860 EVO 1TB", "the disk is named after its model");
+	check(sda.partNumber == L"S3Z9NB0K123456A", "the serial is read from the device");
+	check(sda.Usage == L"Fixed", "the SATA disk is fixed");
+	check(sda.BusType == L"SATA", "a disk behind an ATA port is on SATA");
+	check(sda.DeviceID == L"sda", "the device ID is the kernel name");
+
+	auto& nvme = storage.PhysicalDisks[L"nvme0n1"];
+	check(nvme.Size == 1000215216ULL * 512, "the size of the NVMe drive is read");
+	check(nvme.FriendlyName == L"WDC PC SN730" && nvme.partNumber.empty(), "the NVMe drive is named after its model and has no serial");
+	check(nvme.BusType == L"NVMe", "the NVMe drive is on NVMe");
+
+	auto& sdb = storage.PhysicalDisks[L"sdb"];
+	check(sdb.MediaType == L"HDD", "a disk that rotates is an HDD");
+	check(sdb.FriendlyName == L"sdb", "a disk without a model is named after its kernel name");
+	check(sdb.Usage == L"Removable", "the stick is removable");
+	check(sdb.BusType == L"USB", "a disk behind a USB port is on USB");
+}
+
+/**
+* Refreshing reports the disks and drives that came and went and keeps the rest
+*/
+static void testRefresh(StorageInformation& storage, const std::string& root)
+{
+	//the stick is pulled out and a virtio disk is attached
+	unlink((root + "/sys/block/sdb").c_str());
+	writeDisk(root + "/sys/devices/pci0000:00/0000:00:05.0/virtio2/block/vda", "41943040", "512", "512", "1", "0");
+	makeLink("../../../virtio2", root + "/sys/devices/pci0000:00/0000:00:05.0/virtio2/block/vda/device");
+	makeLink("../devices/pci0000:00/0000:00:05.0/virtio2/block/vda", root + "/sys/block/vda");
+
+	StorageInformation::StorageChanges changes = storage.refreshPhysicalDisks();
+	check(changes.RemovedDisks.size() == 1 && changes.RemovedDisks[0] == L"sdb", "the pulled stick is reported as removed");
+	check(changes.AddedDisks.size() == 1 && changes.AddedDisks[0] == L"vda", "the virtio disk is reported as added");
+	check(storage.PhysicalDisks.size() == 3 && storage.PhysicalDisks[L"vda"].BusType == L"Virtio", "the virtio disk is read");
+
+	//the known disks stay if sysfs can not be listed
+	rename((root + "/sys/block").c_str(), (root + "/sys/block.hidden").c_str());
+	changes = storage.refreshPhysicalDisks();
+	check(changes.empty() && storage.PhysicalDisks.size() == 3, "the known disks are kept when the block directory can not be listed");
+	rename((root + "/sys/block.hidden").c_str(), (root + "/sys/block").c_str());
+
+	//the stick is unmounted as well
+	writeFile(root + "/mountinfo",
+		"22 1 253:0 / / rw,relatime shared:1 - ext4 /dev/mapper/vg0-root rw\n"
+		"24 22 8:1 / /boot rw,relatime shared:2 - vfat /dev/sda1 rw\n"
+		"26 22 0:45 / /srv/data rw,relatime shared:4 - nfs4 fileserver:/export/data rw\n"
+		"27 22 0:46 / /mnt/pool rw,relatime shared:5 - btrfs /dev/sdc rw\n");
+
+	changes = storage.refreshDrives();
+	check(changes.RemovedDrives.size() == 1 && changes.RemovedDrives[0] == L"/media/usb stick", "the unmounted stick is reported as removed");
+	check(changes.AddedDrives.empty(), "no drive was added");
+	check(storage.Drives.size() == 4, "the other drives are kept");
+}
+
+int main()
+{
+	std::string root = makeTemporaryDirectory();
+	buildFakeSysfs(root + "/sys");
+	writeFile(root + "/mountinfo",
+		"22 1 253:0 / / rw,relatime shared:1 - ext4 /dev/mapper/vg0-root rw\n"
+		"23 22 0:21 / /proc rw,nosuid,nodev,noexec,relatime shared:12 - proc proc rw\n"
+		"24 22 8:1 / /boot rw,relatime shared:2 - vfat /dev/sda1 rw,fmask=0077,dmask=0077\n"
+		"25 22 8:16 / /media/usb\\040stick rw,nosuid,nodev,relatime shared:3 - exfat /dev/sdb rw\n"
+		"26 22 0:45 / /srv/data rw,relatime shared:4 - nfs4 fileserver:/export/data rw,vers=4.2\n"
+		"27 22 0:46 / /mnt/pool rw,relatime shared:5 - btrfs /dev/sdc rw,space_cache=v2\n"
+		"28 22 0:25 / /run rw,nosuid,nodev shared:6 - tmpfs tmpfs rw,mode=755\n");
+
+	//the probes only fill in what the drives answer, the mount points of the fake tree do not exist
+	StorageInformation storage(std::make_shared<PlatformSessions>(), root + "/sys", root + "/mountinfo");
+
+	testDrives(storage);
+	testPhysicalDisks(storage);
+	testRefresh(storage, root);
+
+	if (failed_checks == 0) printf("StorageInformationTests passed\n");
+	return failed_checks;
+}
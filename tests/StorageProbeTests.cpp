@@ -0,0 +1,99 @@
+#include "TestSupport.h"
+#include "StorageInformation.h"
+#include <chrono>
+#include <future>
+
+/**
+* Gets the time since the given time in milliseconds
+*/
+static long long millisecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+	return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+* A probe that is never released stays pending and is not reported as finished
+*/
+static void testAbandonedProbe()
+{
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+
+	DeviceProbes probes;
+	probes.start(L"hang", [released]() { released.wait(); });
+	probes.start(L"fast", []() {});
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	check(!probes.wait(200), "wait() reports that a probe did not finish");
+	check(millisecondsSince(start) < 1000, "wait() returns at its timeout");
+
+	std::vector<DeviceProbes::FinishedProbe> finished = probes.takeFinished();
+	check(finished.size() == 1 && finished[0].Key == L"fast", "only the probe that returned is collected");
+	check(probes.getPendingCount() == 1, "the abandoned probe is still counted as pending");
+
+	//the probe is collected once it returns after all
+	release.set_value();
+	check(probes.wait(5000), "the released probe finishes");
+	finished = probes.takeFinished();
+	check(finished.size() == 1 && finished[0].Key == L"hang", "the released probe is collected");
+	check(probes.getPendingCount() == 0, "nothing is pending once every probe was collected");
+}
+
+/**
+* The drive that does not answer is marked as timed out after the 3 second deadline and filled in once it answers
+* The probe of the drive mounted on /hang blocks until the end of the test, the one on /fast returns right away
+*/
+static void testHangingDrive()
+{
+	std::string root = makeTemporaryDirectory();
+	makeDirectories(root + "/sys/block");
+	writeFile(root + "/mountinfo",
+		"22 1 0:40 / /fast rw - nfs4 server:/fast rw\n"
+		"23 1 0:41 / /hang rw - nfs4 server:/hang rw\n");
+
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+
+	auto drive_probe = [released](const std::wstring& Volume, auto& drive)
+	{
+		if (Volume == L"/hang") released.wait();
+		drive.VolumeSerialNumber = 42;
+	};
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	StorageInformation storage(std::make_shared<PlatformSessions>(), root + "/sys", root + "/mountinfo", StorageInformation::DefaultProbeTimeout, drive_probe);
+	long long elapsed = millisecondsSince(start);
+
+	check(elapsed >= StorageInformation::DefaultProbeTimeout - 100 && elapsed < StorageInformation::DefaultProbeTimeout + 1000, "the inventory waits for the deadline and no longer, took " + std::to_string(elapsed) + " ms");
+	check(storage.Drives.size() == 2, "both drives are listed");
+	check(storage.Drives[L"/hang"].ProbeTimedOut, "the drive that did not answer is marked as timed out");
+	check(!storage.Drives[L"/fast"].ProbeTimedOut && storage.Drives[L"/fast"].VolumeSerialNumber == 42, "the drive that answered is filled in");
+	check(storage.isProbing(L"/hang"), "the probe of the drive that did not answer is still running");
+
+	//refreshing while the probe hangs never waits for it
+	start = std::chrono::steady_clock::now();
+	StorageInformation::StorageChanges changes = storage.refreshDrives();
+	changes.append(storage.collectLateProbes());
+	check(millisecondsSince(start) < 500, "a refresh finishes while a probe hangs");
+	check(changes.empty(), "nothing changed while the probe hangs");
+
+	//the drive is filled in once its probe answers after all
+	release.set_value();
+	start = std::chrono::steady_clock::now();
+	while (storage.isProbing(L"/hang") && millisecondsSince(start) < 5000)
+	{
+		changes.append(storage.collectLateProbes());
+	}
+
+	check(changes.UpdatedDrives.size() == 1 && changes.UpdatedDrives[0] == L"/hang", "the late answer is reported as an updated drive");
+	check(!storage.Drives[L"/hang"].ProbeTimedOut && storage.Drives[L"/hang"].VolumeSerialNumber == 42, "the late answer fills in the drive");
+}
+
+int main()
+{
+	testAbandonedProbe();
+	testHangingDrive();
+
+	if (failed_checks == 0) printf("StorageProbeTests passed\n");
+	return failed_checks;
+}
@@ -0,0 +1,283 @@
+#include "TestSupport.h"
+#include "TcpHealth.h"
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/tcp.h>
+
+/**
+* The directory the recorded dumps are read from
+* The health dumps were recorded together with the first snapshot of SocketTableTests, they have the tcp_info of its three client connections and the three the server accepted
+* The many-remotes dump was recorded in a network namespace with a server on 127.0.0.1:9090 that accepted 260 connections, each from its own address between 127.0.1.1 and 127.0.2.60
+*/
+static const std::string FixtureDirectory = "tests/fixtures/sock-diag/";
+
+/**
+* The sequence numbers the dumps were recorded with, the first snapshot of the socket table in the order TCP and TCP over IPv6
+*/
+static const unsigned int FirstSnapshotSequences[] = { 1, 2 };
+static const unsigned int HealthSequences[] = { 5, 6 };
+static const unsigned int ManyRemotesSequence = 1;
+
+/**
+* The inodes the sockets of the health dumps had when they were recorded
+*/
+static const unsigned long long Listener = 118822, Listener6 = 118823;
+static const unsigned long long Client = 118824, Accepted = 118825, ClosingClient = 118826, ClosingAccepted = 118827, Client6 = 118828, Accepted6 = 118829;
+static const unsigned long long Udp = 118830, Udp6 = 118831;
+
+/**
+* Reads every part of a recorded dump, the parts are numbered from 1 in the order they were received
+* @param name The name of the dump, like "health-tcp4"
+*/
+static std::vector<std::vector<unsigned char>> readDump(const std::string& name)
+{
+	std::vector<std::vector<unsigned char>> parts;
+
+	std::vector<unsigned char> part;
+	while (readFixture(FixtureDirectory + name + "-" + std::to_string(parts.size() + 1) + ".bin", part))
+	{
+		parts.push_back(part);
+	}
+
+	return parts;
+}
+
+/**
+* Replays the parts of a dump like they were received from the socket
+* @return If every part but the last asked for more and the last one ended the dump
+*/
+static bool replayDump(TcpHealth& health, const std::string& name, const unsigned int sequence)
+{
+	std::vector<std::vector<unsigned char>> parts = readDump(name);
+	bool ended_last = !parts.empty();
+
+	for (size_t index = 0; index < parts.size(); index++)
+	{
+		bool more = health.parseDiagMessages((const char*)parts[index].data(), parts[index].size(), sequence);
+		ended_last &= more == (index + 1 < parts.size());
+	}
+
+	return ended_last;
+}
+
+/**
+* Finds the metrics of a remote address among the top ones
+* @return The metrics, nullptr if the address is not among them
+*/
+static const TcpHealthMetrics* findEndpoint(const std::vector<TcpHealth::EndpointHealth>& endpoints, const std::string& address)
+{
+	for (const TcpHealth::EndpointHealth& endpoint : endpoints)
+	{
+		if (endpoint.Address == address) return &endpoint.Metrics;
+	}
+
+	return nullptr;
+}
+
+/**
+* Builds a sock_diag message from a recorded one with another remote address and a tcp_info changed by the caller
+* @param recorded The recorded message
+* @param remoteAddress The remote IPv4 address of the new message
+* @param infoLength The length of the tcp_info, shorter than the recorded one to act like an older kernel
+* @param change Changes the tcp_info read from the recorded message
+*/
+template <typename Change>
+static std::vector<unsigned char> buildMessage(const nlmsghdr* recorded, const char* remoteAddress, const size_t infoLength, Change change)
+{
+	const inet_diag_msg* recorded_diag = (const inet_diag_msg*)NLMSG_DATA(recorded);
+
+	tcp_info info;
+	memset(&info, 0, sizeof(info));
+
+	unsigned int attributes_length = recorded->nlmsg_len - NLMSG_LENGTH(sizeof(inet_diag_msg));
+	for (const rtattr* attribute = (const rtattr*)(recorded_diag + 1); RTA_OK(attribute, attributes_length); attribute = RTA_NEXT(attribute, attributes_length))
+	{
+		if (attribute->rta_type == INET_DIAG_INFO) memcpy(&info, RTA_DATA(attribute), std::min((size_t)RTA_PAYLOAD(attribute), sizeof(info)));
+	}
+
+	change(info);
+
+	std::vector<unsigned char> message(NLMSG_LENGTH(sizeof(inet_diag_msg)) + RTA_SPACE(infoLength), 0);
+
+	nlmsghdr* header = (nlmsghdr*)message.data();
+	*header = *recorded;
+	header->nlmsg_len = (unsigned int)message.size();
+
+	inet_diag_msg* diag = (inet_diag_msg*)NLMSG_DATA(header);
+	*diag = *recorded_diag;
+	memset(diag->id.idiag_dst, 0, sizeof(diag->id.idiag_dst));
+	inet_pton(AF_INET, remoteAddress, diag->id.idiag_dst);
+
+	rtattr* attribute = (rtattr*)(diag + 1);
+	attribute->rta_type = INET_DIAG_INFO;
+	attribute->rta_len = RTA_LENGTH(infoLength);
+	memcpy(RTA_DATA(attribute), &info, infoLength);
+
+	return message;
+}
+
+/**
+* The connections of the first snapshot of SocketTableTests get their owners from the socket table
+*/
+static void testOwners(const std::string& directory)
+{
+	std::string proc = directory + "/proc";
+	std::vector<std::pair<unsigned int, std::vector<unsigned long long>>> processes =
+	{
+		{ 100, { Listener, Listener6, Accepted, ClosingAccepted, Accepted6 } },
+		{ 200, { Client, ClosingClient, Client6 } },
+		{ 300, { Udp, Udp6 } },
+	};
+
+	for (auto& process : processes)
+	{
+		std::string fd = proc + "/" + std::to_string(process.first) + "/fd";
+		makeDirectories(fd);
+
+		for (size_t index = 0; index < process.second.size(); index++)
+		{
+			symlink(("socket:[" + std::to_string(process.second[index]) + "]").c_str(), (fd + "/" + std::to_string(index + 3)).c_str());
+		}
+	}
+
+	PlatformSessions sessions;
+	SocketTable table(sessions, proc, 0);
+
+	//only the TCP sockets are needed, the snapshot is left incomplete without the UDP ones
+	table.startSnapshot();
+	for (auto& part : readDump("snapshot1-tcp4")) table.parseDiagMessages((const char*)part.data(), part.size(), IPPROTO_TCP, FirstSnapshotSequences[0]);
+	for (auto& part : readDump("snapshot1-tcp6")) table.parseDiagMessages((const char*)part.data(), part.size(), IPPROTO_TCP, FirstSnapshotSequences[1]);
+	table.finishSnapshot(0);
+
+	TcpHealth health(sessions, &table);
+	health.startSample();
+	check(replayDump(health, "health-tcp4", HealthSequences[0]) && replayDump(health, "health-tcp6", HealthSequences[1]), "the health dumps end at NLMSG_DONE");
+	health.finishSample();
+
+	//the listeners have no tcp_info and were not asked for
+	check(health.System.Connections == 6, "the system has 6 connections, got " + std::to_string(health.System.Connections));
+	check(health.System.AverageRtt > 0 && health.System.AverageRtt <= health.System.MaxRtt, "the connections measured their round trip time");
+	check(health.System.Retransmits == 0 && health.System.RetransmitRatio == 0, "nothing was retransmitted over the loopback");
+	check(health.System.AverageCongestionWindow > 0, "the connections have a congestion window");
+
+	std::vector<TcpHealth::ProcessHealth> owners = health.getTopProcesses(5);
+	check(owners.size() == 2 && owners[0].ProcessID == 100 && owners[0].Metrics.Connections == 3 && owners[1].ProcessID == 200 && owners[1].Metrics.Connections == 3,
+		"the server and the client own 3 connections each");
+
+	std::vector<TcpHealth::EndpointHealth> endpoints = health.getTopEndpoints(5);
+	const TcpHealthMetrics* loopback = findEndpoint(endpoints, "127.0.0.1");
+	const TcpHealthMetrics* loopback6 = findEndpoint(endpoints, "::1");
+	check(endpoints.size() == 2 && loopback != nullptr && loopback->Connections == 4 && loopback6 != nullptr && loopback6->Connections == 2, "both ends of every connection count for their remote address");
+
+	//without a socket table the owners are not known
+	TcpHealth unowned(sessions, nullptr);
+	unowned.startSample();
+	replayDump(unowned, "health-tcp4", HealthSequences[0]);
+	unowned.finishSample();
+	check(unowned.System.Connections == 4 && unowned.getTopProcesses(5).empty(), "the connections have no owners without a socket table");
+}
+
+/**
+* A connection that did not measure its round trip time yet and one from a kernel with a shorter tcp_info
+*/
+static void testChangedInfo()
+{
+	std::vector<unsigned char> recorded = readDump("health-tcp4")[0];
+	const nlmsghdr* message = (const nlmsghdr*)recorded.data();
+
+	//the tcp_info of kernels before 4.2 ended after the bytes received, the segments sent came later
+	std::vector<unsigned char> old_kernel = buildMessage(message, "192.0.2.1", offsetof(tcp_info, tcpi_segs_out), [](tcp_info& info)
+	{
+		info.tcpi_rtt = 2500;
+		info.tcpi_rttvar = 1000;
+		info.tcpi_total_retrans = 3;
+		info.tcpi_snd_cwnd = 10;
+		info.tcpi_snd_mss = 1000;
+	});
+
+	std::vector<unsigned char> connecting = buildMessage(message, "192.0.2.2", sizeof(tcp_info), [](tcp_info& info)
+	{
+		info.tcpi_rtt = 0;
+		info.tcpi_rttvar = 0;
+		info.tcpi_segs_out = 1;
+	});
+
+	//the bytes past the short tcp_info are the next message, they are not read as its fields
+	std::vector<unsigned char> buffer = old_kernel;
+	buffer.insert(buffer.end(), connecting.begin(), connecting.end());
+
+	PlatformSessions sessions;
+	TcpHealth health(sessions, nullptr);
+	health.startSample();
+	check(health.parseDiagMessages((const char*)buffer.data(), buffer.size(), 0), "the messages without NLMSG_DONE ask for more");
+	health.finishSample();
+
+	std::vector<TcpHealth::EndpointHealth> endpoints = health.getTopEndpoints(5);
+
+	const TcpHealthMetrics* old = findEndpoint(endpoints, "192.0.2.1");
+	check(old != nullptr && old->Connections == 1 && old->AverageRtt == 2.5 && old->MaxRtt == 2.5 && old->RttVariation == 1 && old->AverageCongestionWindow == 10000,
+		"the fields of a short tcp_info are read");
+	check(old != nullptr && old->Retransmits == 3 && std::isnan(old->RetransmitRatio), "the retransmit ratio of a tcp_info without the segments sent is NaN");
+
+	const TcpHealthMetrics* unmeasured = findEndpoint(endpoints, "192.0.2.2");
+	check(unmeasured != nullptr && unmeasured->Connections == 1 && std::isnan(unmeasured->AverageRtt) && std::isnan(unmeasured->MaxRtt) && std::isnan(unmeasured->RttVariation),
+		"a round trip time of 0 was not measured yet and is NaN");
+
+	//the system averages the round trip time over the connection that measured it only
+	check(health.System.Connections == 2 && health.System.AverageRtt == 2.5 && health.System.RetransmitRatio == 0, "the system leaves out what a connection did not measure");
+}
+
+/**
+* The remote addresses past the slots lose their place to the ones with more connections
+*/
+static void testManyRemotes()
+{
+	PlatformSessions sessions;
+	TcpHealth health(sessions, nullptr);
+
+	health.startSample();
+	check(replayDump(health, "many-remotes", ManyRemotesSequence), "the dump of 520 connections ends at NLMSG_DONE");
+	health.finishSample();
+
+	check(health.System.Connections == 520, "the system has both ends of the 260 connections, got " + std::to_string(health.System.Connections));
+
+	std::vector<TcpHealth::EndpointHealth> endpoints = health.getTopEndpoints(1000);
+	check(endpoints.size() == TcpHealth::EndpointSlots, "the remote addresses fill every slot, got " + std::to_string(endpoints.size()));
+
+	//every client connected to the server, its address never gives its slot away
+	check(!endpoints.empty() && endpoints[0].Address == "127.0.0.1" && endpoints[0].Metrics.Connections == 260, "the address of the server keeps its slot and has every client connection");
+
+	double counted = 0;
+	for (const TcpHealth::EndpointHealth& endpoint : endpoints) counted += endpoint.Metrics.Connections;
+
+	//261 addresses in 256 slots move at least 5 of them to Other
+	TcpHealthMetrics other = health.getOtherEndpoints();
+	check(other.Connections >= 5 && counted + other.Connections == 520, "the connections of the addresses that lost their slot are in Other, got " + std::to_string(other.Connections));
+	check(!std::isnan(other.AverageRtt), "Other keeps the round trip times of the connections it took over");
+}
+
+int main()
+{
+	std::string directory = makeTemporaryDirectory();
+	if (directory.empty())
+	{
+		printf("FAILED: could not create a temporary directory\n");
+		return 1;
+	}
+
+	testOwners(directory);
+	testChangedInfo();
+	testManyRemotes();
+
+	if (failed_checks == 0) printf("TcpHealthTests passed\n");
+	return failed_checks;
+}
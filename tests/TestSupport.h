@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+
+/**
+* The number of checks that failed, every test returns it as its exit code
+*/
+static int failed_checks = 0;
+
+/**
+* Counts a check that failed and prints what was expected
+* @param passed The result of the check
+* @param description What the check expects
+*/
+inline void check(const bool passed, const std::string& description)
+{
+	if (passed) return;
+
+	failed_checks++;
+	printf("FAILED: %s\n", description.c_str());
+}
+
+/**
+* Reads a fixture file whole
+* @param path The path of the fixture, relative to the directory the test runs in
+* @param data Receives the bytes of the fixture
+* @return false if the fixture could not be opened
+*/
+inline bool readFixture(const std::string& path, std::vector<unsigned char>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return 0;
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return 1;
+}
+
+/**
+* Creates a directory and every directory above it that does not exist yet
+* @param path The path of the directory
+*/
+inline void makeDirectories(const std::string& path)
+{
+	for (size_t separator = path.find('/', 1); separator != std::string::npos; separator = path.find('/', separator + 1))
+	{
+		mkdir(path.substr(0, separator).c_str(), 0755);
+	}
+
+	mkdir(path.c_str(), 0755);
+}
+
+/**
+* Writes a file of a fake tree, the directories it is in are created
+* @param path The path of the file
+* @param content The content of the file
+*/
+inline void writeFile(const std::string& path, const std::string& content)
+{
+	makeDirectories(path.substr(0, path.rfind('/')));
+
+	std::ofstream file(path, std::ios::binary);
+	file << content;
+}
+
+/**
+* Creates an empty directory to build a fake tree in
+* @return The path of the directory
+*/
+inline std::string makeTemporaryDirectory()
+{
+	char path[] = "/tmp/sib-test-XXXXXX";
+	return mkdtemp(path) != nullptr ? path : std::string();
+}